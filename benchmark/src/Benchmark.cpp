@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+
+Benchmark::Benchmark() { startMicros = 0; }
+
+void Benchmark::start(string name) {
+  currentName = name;
+  startMicros = ofGetElapsedTimeMicros();
+}
+
+void Benchmark::stop(int iterations) {
+  Result result;
+  result.name = currentName;
+  result.iterations = iterations;
+  result.totalMicros = ofGetElapsedTimeMicros() - startMicros;
+  results.push_back(result);
+
+  ofLogNotice("Benchmark") << result.name << ": " << iterations << " in "
+                           << result.totalMicros / 1000.0 << " ms";
+}
+
+void Benchmark::addValue(string name, double value, string unit) {
+  Value newValue;
+  newValue.name = name;
+  newValue.value = value;
+  newValue.unit = unit;
+  values.push_back(newValue);
+
+  ofLogNotice("Benchmark") << name << ": " << value << " " << unit;
+}
+
+string Benchmark::toJson() {
+  std::stringstream json;
+  json << "{\n  \"version\": \"" << ofGetVersionInfo() << "\",\n";
+  json << "  \"results\": [";
+  for (int i = 0; i < results.size(); i++) {
+    Result& result = results[i];
+    double perIteration =
+        result.iterations > 0
+            ? (double)result.totalMicros / result.iterations
+            : 0.0;
+    json << (i > 0 ? "," : "") << "\n    {\"name\": \"" << result.name
+         << "\", \"iterations\": " << result.iterations
+         << ", \"total_us\": " << result.totalMicros
+         << ", \"per_iteration_us\": " << perIteration << "}";
+  }
+  json << "\n  ],\n  \"values\": [";
+  for (int i = 0; i < values.size(); i++) {
+    json << (i > 0 ? "," : "") << "\n    {\"name\": \"" << values[i].name
+         << "\", \"value\": " << values[i].value << ", \"unit\": \""
+         << values[i].unit << "\"}";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+bool Benchmark::save(string fileName) {
+  std::ofstream file(ofToDataPath(fileName, true).c_str());
+  if (!file.is_open()) {
+    ofLogError("Benchmark") << "Could not write " << fileName;
+    return false;
+  }
+  file << toJson();
+  return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Times named cases and writes the results as JSON
+class Benchmark {
+ public:
+  Benchmark();
+
+  void start(string name);
+  // Stop the running case, iterations is the number of operations done
+  void stop(int iterations);
+  // Record a value that is not a time, like memory use
+  void addValue(string name, double value, string unit);
+
+  string toJson();
+  bool save(string fileName);
+
+ private:
+  struct Result {
+    string name;
+    int iterations;
+    unsigned long long totalMicros;
+  };
+
+  struct Value {
+    string name;
+    double value;
+    string unit;
+  };
+
+  vector<Result> results;
+  vector<Value> values;
+  string currentName;
+  unsigned long long startMicros;
+};
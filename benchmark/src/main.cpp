@@ -0,0 +1,20 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofApp.h"
+
+// Usage: benchmark [number of surfaces] [output file]
+int main(int argc, char* argv[])
+{
+	// No window and no GL context, surfaces only draw when asked to
+	ofAppNoWindow window;
+	ofSetupOpenGL(&window, 1024, 768, OF_WINDOW);
+
+	ofApp* app = new ofApp();
+	if (argc > 1) {
+		app->numSurfaces = ofToInt(argv[1]);
+	}
+	if (argc > 2) {
+		app->outputFile = argv[2];
+	}
+	ofRunApp(app);
+}
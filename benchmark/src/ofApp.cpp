@@ -0,0 +1,1116 @@
+#include "ofApp.h"
+
+using namespace ofx::piMapper;
+
+// Big endian MP4 boxes for the synthetic movie of benchmarkKeyframeIndex
+static void appendUInt32(string& data, unsigned int value) {
+  data += (char)((value >> 24) & 0xff);
+  data += (char)((value >> 16) & 0xff);
+  data += (char)((value >> 8) & 0xff);
+  data += (char)(value & 0xff);
+}
+
+static string makeBox(string type, string contents) {
+  string box;
+  appendUInt32(box, contents.size() + 8);
+  return box + type + contents;
+}
+
+static void addLatencyValues(Benchmark& benchmark, string name,
+                             vector<unsigned long long>& latencies) {
+  if (!latencies.size()) return;
+  std::sort(latencies.begin(), latencies.end());
+  int last = latencies.size() - 1;
+  benchmark.addValue(name + " p50", latencies[last / 2] / 1000.0, "ms");
+  benchmark.addValue(name + " p95", latencies[last * 95 / 100] / 1000.0,
+                     "ms");
+  benchmark.addValue(name + " max", latencies[last] / 1000.0, "ms");
+}
+
+ofApp::ofApp() {
+  numSurfaces = DEFAULT_NUM_SURFACES;
+  outputFile = DEFAULT_OUTPUT_FILE;
+  mediaServer = NULL;
+}
+
+void ofApp::setup() {
+  ofSetLogLevel(OF_LOG_WARNING);
+  ofSetLogLevel("Benchmark", OF_LOG_NOTICE);
+  // Same sequence of surfaces on every run
+  ofSeedRandom(1);
+
+  // Media server lists the directories on construction
+  createMediaFiles();
+  mediaServer = new MediaServer();
+  // On by default on the Pi, measured in benchmarkTextureCompression
+  mediaServer->setCompressImages(false);
+
+  benchmarkSurfaces();
+  benchmarkPersistence();
+  benchmarkMediaServer();
+  benchmarkDirectoryWatcher();
+  benchmarkUndo();
+  benchmarkGeometry();
+  benchmarkVertexInput();
+  benchmarkControl();
+  benchmarkPresets();
+  benchmarkCueList();
+  benchmarkVideoSync();
+  benchmarkGaplessLoop();
+  benchmarkKeyframeIndex();
+  benchmarkSeek();
+  benchmarkRegions();
+  benchmarkAtlas();
+  benchmarkDownscale();
+  benchmarkImageCrop();
+  benchmarkTiledImage();
+  benchmarkTextureCompression();
+
+  delete mediaServer;
+  mediaServer = NULL;
+  removeMediaFiles();
+
+  benchmark.addValue("surfaces", numSurfaces, "count");
+  cout << benchmark.toJson();
+  ofExit(benchmark.save(outputFile) ? 0 : 1);
+}
+
+void ofApp::createMediaFiles() {
+  ofDirectory::createDirectory(DEFAULT_IMAGES_DIR, true, true);
+  ofDirectory::createDirectory(DEFAULT_VIDEOS_DIR, true, true);
+  for (int i = 0; i < NUM_MEDIA_FILES; i++) {
+    // Only names matter, the files are never loaded
+    ofFile image(DEFAULT_IMAGES_DIR + ofToString(i) + ".jpg",
+                 ofFile::WriteOnly);
+    ofFile video(DEFAULT_VIDEOS_DIR + ofToString(i) + ".mp4",
+                 ofFile::WriteOnly);
+  }
+}
+
+void ofApp::removeMediaFiles() {
+  ofDirectory::removeDirectory(DEFAULT_IMAGES_DIR, true);
+  ofDirectory::removeDirectory(DEFAULT_VIDEOS_DIR, true);
+}
+
+void ofApp::addRandomSurfaces(SurfaceManager& surfaceManager, int surfaceType,
+                              int count) {
+  int numVertices = surfaceType == SurfaceType::QUAD_SURFACE ? 4 : 3;
+  for (int i = 0; i < count; i++) {
+    ofVec2f center(ofRandom(1920), ofRandom(1080));
+    vector<ofVec2f> vertices;
+    vector<ofVec2f> texCoords;
+    for (int j = 0; j < numVertices; j++) {
+      float angle = TWO_PI * j / numVertices;
+      vertices.push_back(center +
+                         ofVec2f(cos(angle), sin(angle)) * ofRandom(20, 200));
+      texCoords.push_back(ofVec2f(0.5f + cos(angle) * 0.5f,
+                                  0.5f + sin(angle) * 0.5f));
+    }
+    surfaceManager.addSurface(surfaceType, vertices, texCoords);
+  }
+}
+
+void ofApp::benchmarkSurfaces() {
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  int numQuads = numSurfaces / 2;
+  int numTriangles = numSurfaces - numQuads;
+
+  benchmark.start("addSurface quad");
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE, numQuads);
+  benchmark.stop(numQuads);
+
+  benchmark.start("addSurface triangle");
+  addRandomSurfaces(surfaceManager, SurfaceType::TRIANGLE_SURFACE,
+                    numTriangles);
+  benchmark.stop(numTriangles);
+
+  // Every vertex change of a quad recalculates its 4d texture coordinates
+  benchmark.start("setVertex quad");
+  for (int i = 0; i < numQuads; i++) {
+    BaseSurface* surface = surfaceManager.getSurface(i);
+    ofVec3f& vertex = surface->getVertices()[0];
+    surface->setVertex(0, ofVec2f(vertex.x + 1.0f, vertex.y));
+  }
+  benchmark.stop(numQuads);
+
+  benchmark.start("setTexCoord quad");
+  for (int i = 0; i < numQuads; i++) {
+    BaseSurface* surface = surfaceManager.getSurface(i);
+    surface->setTexCoord(0, surface->getTexCoords()[0] + ofVec2f(0.01f, 0));
+  }
+  benchmark.stop(numQuads);
+
+  // Like a click in the projection mapping mode, topmost surface first
+  vector<ofVec2f> points;
+  for (int i = 0; i < NUM_HIT_TEST_POINTS; i++) {
+    points.push_back(ofVec2f(ofRandom(1920), ofRandom(1080)));
+  }
+  int numHits = 0;
+  benchmark.start("hitTest");
+  for (int i = 0; i < points.size(); i++) {
+    for (int j = surfaceManager.size() - 1; j >= 0; j--) {
+      if (surfaceManager.getSurface(j)->hitTest(points[i])) {
+        numHits++;
+      }
+    }
+  }
+  benchmark.stop(points.size() * surfaceManager.size());
+  benchmark.addValue("hitTest hits", numHits, "count");
+
+  benchmark.start("flushEdits");
+  surfaceManager.flushEdits();
+  benchmark.stop(surfaceManager.size());
+
+  // Each of the three scenes copies every surface once, after that
+  // only surfaces with a new revision are copied
+  benchmark.start("publishScene copy");
+  for (int i = 0; i < 3; i++) {
+    surfaceManager.publishScene();
+  }
+  benchmark.stop(3 * surfaceManager.size());
+
+  benchmark.start("publishScene unchanged");
+  for (int i = 0; i < 3; i++) {
+    surfaceManager.publishScene();
+  }
+  benchmark.stop(3 * surfaceManager.size());
+
+  benchmark.start("clear");
+  int numCleared = surfaceManager.size();
+  surfaceManager.clear();
+  benchmark.stop(numCleared);
+}
+
+void ofApp::benchmarkPersistence() {
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE,
+                    numSurfaces / 2);
+  addRandomSurfaces(surfaceManager, SurfaceType::TRIANGLE_SURFACE,
+                    numSurfaces - numSurfaces / 2);
+
+  // The part of saveXmlSettings that runs on the main thread
+  vector<SurfaceSnapshot> snapshot;
+  benchmark.start("save snapshot");
+  surfaceManager.getSnapshot(snapshot);
+  benchmark.stop(snapshot.size());
+
+  // The part that runs on the writer thread
+  ofxXmlSettings xml;
+  benchmark.start("save serialize");
+  SettingsWriter::write(xml, snapshot);
+  xml.saveFile("benchmark.xml");
+  benchmark.stop(snapshot.size());
+
+  SurfaceManager loadedSurfaceManager;
+  loadedSurfaceManager.setMediaServer(mediaServer);
+  benchmark.start("loadXmlSettings");
+  loadedSurfaceManager.loadXmlSettings("benchmark.xml");
+  benchmark.stop(loadedSurfaceManager.size());
+
+  // Whatever was saved has to come back
+  vector<SurfaceSnapshot> loaded;
+  loadedSurfaceManager.getSnapshot(loaded);
+  int numMismatches = loaded.size() == snapshot.size() ? 0 : 1;
+  for (int i = 0; i < loaded.size() && i < snapshot.size(); i++) {
+    for (int j = 0; j < loaded[i].vertices.size(); j++) {
+      if (!loaded[i].vertices[j].match(snapshot[i].vertices[j], 0.01f)) {
+        numMismatches++;
+        break;
+      }
+    }
+  }
+  benchmark.addValue("round trip mismatches", numMismatches, "count");
+
+  // Reloading an unchanged file must not touch anything
+  benchmark.start("reloadXmlSettings unchanged");
+  loadedSurfaceManager.reloadXmlSettings("benchmark.xml");
+  benchmark.stop(loadedSurfaceManager.size());
+
+  ofFile::removeFile("benchmark.xml");
+}
+
+void ofApp::benchmarkMediaServer() {
+  int numQueries = 100;
+  benchmark.start("getImageNames");
+  for (int i = 0; i < numQueries; i++) {
+    mediaServer->getImageNames();
+  }
+  benchmark.stop(numQueries);
+
+  benchmark.start("getVideoNames");
+  for (int i = 0; i < numQueries; i++) {
+    mediaServer->getVideoNames();
+  }
+  benchmark.stop(numQueries);
+  benchmark.addValue("media files",
+                     mediaServer->getNumImages() + mediaServer->getNumVideos(),
+                     "count");
+}
+
+void ofApp::benchmarkDirectoryWatcher() {
+  string path = ofToDataPath("sources/watched/", true);
+  ofDirectory::createDirectory(path, false, true);
+  DirectoryWatcher watcher(path, SourceType::SOURCE_TYPE_IMAGE);
+
+  vector<Poco::File> files;
+  for (int i = 0; i < NUM_MEDIA_FILES; i++) {
+    files.push_back(Poco::File(path + ofToString(i) + ".jpg"));
+  }
+
+  benchmark.start("DirectoryWatcher added");
+  for (int i = 0; i < files.size(); i++) {
+    ofx::IO::DirectoryWatcherManager::DirectoryEvent event(
+        files[i], Poco::DirectoryWatcher::DW_ITEM_ADDED);
+    watcher.onDirectoryWatcherItemAdded(event);
+  }
+  benchmark.stop(files.size());
+
+  // Removing the oldest first is the worst case for the path list
+  benchmark.start("DirectoryWatcher removed");
+  for (int i = 0; i < files.size(); i++) {
+    ofx::IO::DirectoryWatcherManager::DirectoryEvent event(
+        files[i], Poco::DirectoryWatcher::DW_ITEM_REMOVED);
+    watcher.onDirectoryWatcherItemRemoved(event);
+  }
+  benchmark.stop(files.size());
+
+  ofDirectory::removeDirectory(path, true, false);
+}
+
+void ofApp::benchmarkUndo() {
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE, 50);
+  addRandomSurfaces(surfaceManager, SurfaceType::TRIANGLE_SURFACE, 50);
+
+  EditHistory history;
+  history.setSurfaceManager(&surfaceManager);
+  // Large enough to keep the whole script
+  history.setMemoryBudget(64 * 1024 * 1024);
+
+  // Drags of vertices, texture coordinates and whole surfaces, a few
+  // frames each, with surfaces added and removed in between
+  benchmark.start("record edits");
+  for (int i = 0; i < NUM_UNDO_EDITS; i++) {
+    if (i % 10 == 0) history.seal();
+    if (i % 500 == 250) {
+      addRandomSurfaces(surfaceManager, SurfaceType::TRIANGLE_SURFACE, 1);
+      continue;
+    }
+    if (i % 500 == 499) {
+      surfaceManager.removeSurface((i / 500) % surfaceManager.size());
+      continue;
+    }
+    BaseSurface* surface =
+        surfaceManager.getSurface((i / 10) % surfaceManager.size());
+    if ((i / 10) % 4 == 0) {
+      surface->moveBy(ofVec2f(ofRandom(-2, 2), ofRandom(-2, 2)));
+    } else if ((i / 10) % 4 == 1) {
+      int index = (i / 10) % surface->getTexCoords().size();
+      ofVec2f texCoord = surface->getTexCoords()[index];
+      surface->setTexCoord(index,
+                           texCoord + ofVec2f(0.0f, ofRandom(-0.01f, 0.01f)));
+    } else {
+      int index = (i / 10) % surface->getVertices().size();
+      ofVec3f& vertex = surface->getVertices()[index];
+      surface->setVertex(index,
+                         ofVec2f(vertex.x + ofRandom(-2, 2), vertex.y));
+    }
+    surfaceManager.flushEdits();
+  }
+  benchmark.stop(NUM_UNDO_EDITS);
+  benchmark.addValue("history entries", history.size(), "count");
+  benchmark.addValue("history memory", history.getMemoryUsage(), "bytes");
+
+  benchmark.start("undo");
+  int numUndone = 0;
+  while (history.canUndo()) {
+    history.undo();
+    numUndone++;
+  }
+  benchmark.stop(numUndone);
+}
+
+void ofApp::benchmarkGeometry() {
+  SurfaceManager serial;
+  SurfaceManager parallel;
+  serial.setNumGeometryWorkers(0);
+  int numQuads = NUM_ANIMATED_SURFACES / 2;
+
+  // Same surfaces in both
+  ofSeedRandom(2);
+  addRandomSurfaces(serial, SurfaceType::QUAD_SURFACE, numQuads);
+  addRandomSurfaces(serial, SurfaceType::TRIANGLE_SURFACE,
+                    NUM_ANIMATED_SURFACES - numQuads);
+  ofSeedRandom(2);
+  addRandomSurfaces(parallel, SurfaceType::QUAD_SURFACE, numQuads);
+  addRandomSurfaces(parallel, SurfaceType::TRIANGLE_SURFACE,
+                    NUM_ANIMATED_SURFACES - numQuads);
+
+  benchmark.addValue("updateGeometry serial", animateSurfaces(serial), "us");
+  benchmark.addValue("updateGeometry parallel", animateSurfaces(parallel),
+                     "us");
+  benchmark.addValue("geometry workers", parallel.getNumGeometryWorkers(),
+                     "count");
+
+  // Results must not depend on which thread did the work
+  int numMismatches = 0;
+  vector<GLfloat> serialVertices, parallelVertices;
+  vector<GLfloat> serialTexCoords, parallelTexCoords;
+  vector<GLushort> serialIndices, parallelIndices;
+  for (int i = 0; i < serial.size(); i++) {
+    serial.getSurface(i)->getGeometry(serialVertices, serialTexCoords,
+                                      serialIndices);
+    parallel.getSurface(i)->getGeometry(parallelVertices, parallelTexCoords,
+                                        parallelIndices);
+    if (serialVertices != parallelVertices ||
+        serialTexCoords != parallelTexCoords) {
+      numMismatches++;
+    }
+  }
+  benchmark.addValue("geometry mismatches", numMismatches, "count");
+}
+
+float ofApp::animateSurfaces(SurfaceManager& surfaceManager) {
+  unsigned long long totalMicros = 0;
+  for (int frame = 0; frame < NUM_ANIMATION_FRAMES; frame++) {
+    for (int i = 0; i < surfaceManager.size(); i++) {
+      float angle = frame * 0.1f + i;
+      surfaceManager.getSurface(i)->moveBy(ofVec2f(cos(angle), sin(angle)));
+    }
+    unsigned long long start = ofGetElapsedTimeMicros();
+    surfaceManager.updateGeometry();
+    totalMicros += ofGetElapsedTimeMicros() - start;
+  }
+  return (float)totalMicros / NUM_ANIMATION_FRAMES;
+}
+
+void ofApp::benchmarkVertexInput() {
+  SurfaceManager surfaceManager;
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE,
+                    NUM_TRACKED_SURFACES);
+  VertexInput* input = surfaceManager.getVertexInput();
+
+  // A tracker faster than the frame rate, only the last update counts
+  vector<VertexUpdate> updates;
+  for (int i = 0; i < NUM_TRACKER_UPDATES; i++) {
+    for (int j = 0; j < NUM_TRACKED_SURFACES; j++) {
+      VertexUpdate update;
+      update.surfaceId = surfaceManager.getSurface(j)->getId();
+      update.numVertices = 4;
+      for (int k = 0; k < 4; k++) {
+        update.vertices[k] = ofVec2f(ofRandom(1920), ofRandom(1080));
+      }
+      updates.push_back(update);
+    }
+  }
+
+  benchmark.start("VertexInput push");
+  input->push(&updates[0], updates.size());
+  benchmark.stop(updates.size());
+
+  benchmark.start("VertexInput apply");
+  surfaceManager.applyVertexInput();
+  benchmark.stop(updates.size() - input->getNumEvicted());
+  benchmark.addValue("VertexInput evicted", input->getNumEvicted(), "count");
+  benchmark.addValue("VertexInput replaced", input->getNumReplaced(),
+                     "count");
+
+  int numMismatches = 0;
+  int last = updates.size() - NUM_TRACKED_SURFACES;
+  for (int i = 0; i < NUM_TRACKED_SURFACES; i++) {
+    ofVec3f vertex = surfaceManager.getSurface(i)->getVertices()[0];
+    if (!updates[last + i].vertices[0].match(ofVec2f(vertex.x, vertex.y),
+                                             0.01f)) {
+      numMismatches++;
+    }
+  }
+  benchmark.addValue("VertexInput mismatches", numMismatches, "count");
+}
+
+void ofApp::benchmarkControl() {
+  SurfaceManager surfaceManager;
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE, 100);
+  ControlServer server;
+  server.setSurfaceManager(&surfaceManager);
+  if (!server.setup(BENCHMARK_CONTROL_PORT)) return;
+
+  vector<string> packets;
+  for (int i = 0; i < NUM_FLOOD_MESSAGES; i++) {
+    OscMessage message(CONTROL_ADDRESS_VERTEX);
+    message.addInt(i % surfaceManager.size());
+    message.addInt(i % 4);
+    message.addFloat(ofRandom(1920));
+    message.addFloat(ofRandom(1080));
+    packets.push_back(message.serialize());
+  }
+  Poco::Net::DatagramSocket sender;
+  Poco::Net::SocketAddress address(DEFAULT_CONTROL_HOST,
+                                   BENCHMARK_CONTROL_PORT);
+
+  // Flood while the main thread is busy, it catches up frame by frame.
+  // Packets the system could not buffer never reach the server.
+  benchmark.start("control flood send");
+  for (int i = 0; i < packets.size(); i++) {
+    sender.sendTo(packets[i].data(), packets[i].size(), address);
+  }
+  benchmark.stop(packets.size());
+  unsigned long long start = ofGetElapsedTimeMicros();
+  unsigned int numHandled = 0;
+  for (int frame = 0; frame < 100; frame++) {
+    ofSleepMillis(16);
+    server.update();
+    ControlStats stats = server.getStats();
+    if (stats.numPackets == numHandled && frame > 0) break;
+    numHandled = stats.numPackets;
+  }
+  float seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0f;
+  addControlStats("control flood", server);
+  benchmark.addValue("control flood applied per second",
+                     server.getStats().numApplied / seconds, "count");
+
+  // A show control machine sending a steady stream
+  server.resetStats();
+  for (int frame = 0; frame < NUM_PACED_FRAMES; frame++) {
+    for (int i = 0; i < NUM_PACED_MESSAGES; i++) {
+      string& packet = packets[(frame * NUM_PACED_MESSAGES + i) %
+                               packets.size()];
+      sender.sendTo(packet.data(), packet.size(), address);
+    }
+    ofSleepMillis(16);
+    server.update();
+  }
+  addControlStats("control paced", server);
+  server.close();
+}
+
+void ofApp::addControlStats(string name, ControlServer& server) {
+  ControlStats stats = server.getStats();
+  benchmark.addValue(name + " received", stats.numMessages, "count");
+  benchmark.addValue(name + " dropped", stats.numDropped, "count");
+  benchmark.addValue(name + " applied", stats.numApplied, "count");
+  benchmark.addValue(name + " average latency", stats.averageLatencyMicros,
+                     "us");
+  benchmark.addValue(name + " max latency", stats.maxLatencyMicros, "us");
+}
+
+void ofApp::benchmarkPresets() {
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE,
+                    NUM_PRESET_SURFACES);
+  surfaceManager.capturePreset("a");
+  vector<SurfaceSnapshot> expected;
+  surfaceManager.getSnapshot(expected);
+
+  // Same number of surfaces but every vertex differs, the worst case
+  surfaceManager.clear();
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE,
+                    NUM_PRESET_SURFACES);
+  surfaceManager.capturePreset("b");
+
+  benchmark.start("switchPreset");
+  for (int i = 0; i < NUM_PRESET_SWITCHES; i++) {
+    surfaceManager.switchPreset(i % 2 == 0 ? "a" : "b");
+  }
+  benchmark.stop(NUM_PRESET_SWITCHES);
+
+  surfaceManager.switchPreset("a");
+  vector<SurfaceSnapshot> switched;
+  surfaceManager.getSnapshot(switched);
+  int numMismatches = switched.size() == expected.size() ? 0 : 1;
+  for (int i = 0; i < switched.size() && i < expected.size(); i++) {
+    for (int j = 0; j < switched[i].vertices.size(); j++) {
+      if (!switched[i].vertices[j].match(expected[i].vertices[j], 0.01f)) {
+        numMismatches++;
+        break;
+      }
+    }
+  }
+  benchmark.addValue("preset mismatches", numMismatches, "count");
+  surfaceManager.clearPresets();
+}
+
+void ofApp::benchmarkCueList() {
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE,
+                    NUM_CUE_SOURCES);
+
+  CueList cueList;
+  cueList.setSurfaceManager(&surfaceManager);
+  cueList.setMediaServer(mediaServer);
+  for (int i = 0; i < NUM_CUES; i++) {
+    Cue cue;
+    cue.name = ofToString(i);
+    for (int j = 0; j < NUM_CUE_SOURCES; j++) {
+      CueSource source;
+      source.surfaceIndex = j;
+      source.sourceType = SOURCE_TYPE_NAME_IMAGE;
+      source.sourceName = ofToString((i * NUM_CUE_SOURCES + j) %
+                                     NUM_MEDIA_FILES) + ".jpg";
+      cue.sources.push_back(source);
+    }
+    cueList.addCue(cue);
+  }
+
+  // The part of every update that decides what to prefetch, the
+  // decoding itself happens on the loader thread
+  benchmark.start("CueList updatePrefetch");
+  for (int i = 0; i < NUM_ANIMATION_FRAMES; i++) {
+    cueList.updatePrefetch();
+  }
+  benchmark.stop(NUM_ANIMATION_FRAMES);
+  benchmark.addValue("prefetch cues", cueList.getPrefetchCues(), "count");
+}
+
+void ofApp::benchmarkVideoSync() {
+  // A player whose timer runs slightly fast, driven by a virtual clock
+  ShowClock clock;
+  clock.setVirtual(true);
+  VideoSync sync;
+  double duration = SIMULATED_CLIP_DURATION;
+  double frameDuration = 1.0 / SIMULATED_CLIP_FPS;
+  double frameTime = 1.0 / NUM_SIMULATED_UPDATES_PER_SECOND;
+  int numUpdates = SIMULATED_SYNC_SECONDS * NUM_SIMULATED_UPDATES_PER_SECOND;
+
+  double freeTime = 0.0;
+  double syncedTime = 0.0;
+  double maxFreeError = 0.0;
+  benchmark.start("VideoSync update");
+  for (int i = 0; i < numUpdates; i++) {
+    clock.advance(frameTime);
+    double step = frameTime * SIMULATED_PLAYER_RATE;
+
+    freeTime = fmod(freeTime + step, duration);
+    double freeError = fabs(freeTime - fmod(clock.getTime(), duration));
+    maxFreeError = std::max(maxFreeError,
+                            std::min(freeError, duration - freeError));
+
+    int correction = sync.update(clock.getTime(), syncedTime, duration,
+                                 frameDuration);
+    if (correction == VideoSync::CORRECTION_REPEAT) {
+      step = 0.0;
+    } else if (correction == VideoSync::CORRECTION_DROP) {
+      step *= SYNC_CATCH_UP_SPEED;
+    } else if (correction == VideoSync::CORRECTION_SEEK) {
+      syncedTime = sync.getSeekTime();
+    }
+    syncedTime = fmod(syncedTime + step, duration);
+  }
+  benchmark.stop(numUpdates);
+
+  benchmark.addValue("free running max error", maxFreeError * 1000.0, "ms");
+  benchmark.addValue("synced max error", sync.getMaxError() * 1000.0, "ms");
+  benchmark.addValue("synced average error", sync.getAverageError() * 1000.0,
+                     "ms");
+  benchmark.addValue("repeated frames", sync.getNumRepeated(), "count");
+  benchmark.addValue("dropped frames", sync.getNumDropped(), "count");
+  benchmark.addValue("sync seeks", sync.getNumSeeks(), "count");
+}
+
+void ofApp::benchmarkGaplessLoop() {
+  if (!ofFile::doesFileExist(LOOP_CLIP_FILE)) {
+    ofLogNotice("benchmark") << "No " << LOOP_CLIP_FILE
+                             << ", skipping gapless loop";
+    return;
+  }
+  runLoopClip(false);
+  runLoopClip(true);
+}
+
+void ofApp::runLoopClip(bool gapless) {
+  string path = ofToDataPath(LOOP_CLIP_FILE, true);
+  VideoSource source;
+  source.loadVideo(path);
+  source.setGaplessLoop(gapless);
+
+  // Updates like the app loop would, until the clip looped a few times
+  ofEventArgs args;
+  string mode = gapless ? "gapless" : "normal";
+  unsigned long long maxFrameInterval = 0;
+  float startTime = ofGetElapsedTimef();
+  benchmark.start("loop clip " + mode);
+  while (source.getNumLoops() < NUM_LOOP_CLIP_LOOPS &&
+         ofGetElapsedTimef() - startTime < LOOP_CLIP_TIMEOUT) {
+    source.update(args);
+    maxFrameInterval = std::max(maxFrameInterval,
+                                source.getLastFrameInterval());
+    ofSleepMillis(LOOP_UPDATE_MILLIS);
+  }
+  benchmark.stop(source.getNumLoops());
+
+  benchmark.addValue(mode + " max loop interval",
+                     source.getMaxLoopInterval() / 1000.0, "ms");
+  benchmark.addValue(mode + " max frame interval",
+                     maxFrameInterval / 1000.0, "ms");
+  source.clear();
+}
+
+void ofApp::benchmarkKeyframeIndex() {
+  // Video track with a time to sample and a sync sample table, a byte of
+  // media data per sample
+  string version(4, '\0');
+  string mdhd = version + string(8, '\0');
+  appendUInt32(mdhd, 12800);
+  mdhd += string(8, '\0');
+  string hdlr = version + string(4, '\0') + "vide" + string(13, '\0');
+  string stts = version;
+  appendUInt32(stts, 1);
+  appendUInt32(stts, INDEX_MOVIE_FRAMES);
+  appendUInt32(stts, 512);
+  string stss = version;
+  appendUInt32(stss, INDEX_MOVIE_FRAMES / INDEX_MOVIE_GOP);
+  for (int i = 0; i < INDEX_MOVIE_FRAMES; i += INDEX_MOVIE_GOP) {
+    appendUInt32(stss, i + 1);
+  }
+  string stbl = makeBox("stbl", makeBox("stts", stts) + makeBox("stss", stss));
+  string mdia = makeBox("mdia", makeBox("mdhd", mdhd) +
+                                    makeBox("hdlr", hdlr) +
+                                    makeBox("minf", stbl));
+  string path = ofToDataPath(INDEX_MOVIE_FILE, true);
+  std::ofstream movie(path.c_str(), std::ios::binary);
+  movie << makeBox("ftyp", "isom") +
+               makeBox("mdat", string(INDEX_MOVIE_FRAMES, '\0')) +
+               makeBox("moov", makeBox("trak", mdia));
+  movie.close();
+
+  KeyframeIndex index;
+  benchmark.start("KeyframeIndex build");
+  for (int i = 0; i < NUM_INDEX_BUILDS; i++) {
+    index.build(path);
+  }
+  benchmark.stop(NUM_INDEX_BUILDS);
+  benchmark.addValue("keyframes", index.size(), "count");
+
+  // What MediaServer keeps between runs
+  ofxXmlSettings xml;
+  benchmark.start("KeyframeIndex save");
+  index.save(xml);
+  benchmark.stop(1);
+  KeyframeIndex loadedIndex;
+  benchmark.start("KeyframeIndex load");
+  loadedIndex.load(xml);
+  benchmark.stop(1);
+
+  double duration = index.getDuration();
+  benchmark.start("getKeyframeBefore");
+  for (int i = 0; i < NUM_KEYFRAME_LOOKUPS; i++) {
+    loadedIndex.getKeyframeBefore(duration * i / NUM_KEYFRAME_LOOKUPS);
+  }
+  benchmark.stop(NUM_KEYFRAME_LOOKUPS);
+  ofFile::removeFile(INDEX_MOVIE_FILE);
+}
+
+void ofApp::benchmarkSeek() {
+  if (!ofFile::doesFileExist(SEEK_CLIP_FILE)) {
+    ofLogNotice("benchmark") << "No " << SEEK_CLIP_FILE
+                             << ", skipping seek latency";
+    return;
+  }
+  string path = ofToDataPath(SEEK_CLIP_FILE, true);
+  KeyframeIndex index;
+  if (!index.build(path)) {
+    ofLogNotice("benchmark") << "No keyframe index for " << SEEK_CLIP_FILE
+                             << ", skipping seek latency";
+    return;
+  }
+
+  VideoSource source;
+  source.loadVideo(path);
+  // Exact seeks decode from the keyframe before the target
+  runSeeks(source, "exact seek", 0.0, index.getDuration());
+  source.setKeyframeIndex(index);
+  runSeeks(source, "indexed seek", DEFAULT_KEYFRAME_SNAP, index.getDuration());
+  source.clear();
+}
+
+void ofApp::runSeeks(VideoSource& source, string mode, double snap,
+                     double duration) {
+  // Same targets for every mode
+  ofSeedRandom(NUM_CLIP_SEEKS);
+  ofEventArgs args;
+  vector<unsigned long long> latencies;
+  for (int i = 0; i < NUM_CLIP_SEEKS; i++) {
+    source.seek(ofRandom(duration), snap);
+    float startTime = ofGetElapsedTimef();
+    while (source.isSeeking() &&
+           ofGetElapsedTimef() - startTime < SEEK_TIMEOUT) {
+      source.update(args);
+      ofSleepMillis(1);
+    }
+    if (!source.isSeeking()) {
+      latencies.push_back(source.getSeekLatency());
+    }
+  }
+  addLatencyValues(benchmark, mode, latencies);
+}
+
+void ofApp::benchmarkRegions() {
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  int numRegions = REGION_GRID_SIZE * REGION_GRID_SIZE;
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE, numRegions);
+
+  float cellSize = 1.0f / REGION_GRID_SIZE;
+  benchmark.start("assign region source");
+  for (int i = 0; i < numRegions; i++) {
+    SurfaceEdit edit;
+    edit.type = SurfaceEdit::SOURCE;
+    edit.surfaceIndex = i;
+    edit.sourceType = SOURCE_TYPE_NAME_REGION;
+    edit.sourceName = RegionSource::makeName(
+        SOURCE_TYPE_NAME_IMAGE, "0.jpg",
+        ofRectangle((i % REGION_GRID_SIZE) * cellSize,
+                    (i / REGION_GRID_SIZE) * cellSize, cellSize, cellSize));
+    surfaceManager.applyEdit(edit);
+  }
+  benchmark.stop(numRegions);
+
+  // All regions draw the texture of one decoded image
+  std::set<ofTexture*> textures;
+  for (int i = 0; i < surfaceManager.size(); i++) {
+    textures.insert(surfaceManager.getSurface(i)->getSource()->getTexture());
+  }
+  benchmark.addValue("region surfaces", numRegions, "count");
+  benchmark.addValue("region textures", textures.size(), "count");
+
+  // The image is unloaded along with the last region
+  benchmark.start("unassign region source");
+  for (int i = 0; i < numRegions; i++) {
+    SurfaceEdit edit;
+    edit.type = SurfaceEdit::SOURCE;
+    edit.surfaceIndex = i;
+    edit.sourceType = SOURCE_TYPE_NAME_NONE;
+    edit.sourceName = SOURCE_TYPE_NAME_NONE;
+    surfaceManager.applyEdit(edit);
+  }
+  benchmark.stop(numRegions);
+}
+
+void ofApp::benchmarkAtlas() {
+  // Without a GL context this is the padding and packing work
+  TextureAtlas atlas;
+  vector<ofPixels> images(NUM_ATLAS_IMAGES);
+  for (int i = 0; i < images.size(); i++) {
+    images[i].allocate(
+        ofRandom(MIN_ATLAS_IMAGE_SIZE, DEFAULT_MAX_ATLAS_IMAGE_SIZE),
+        ofRandom(MIN_ATLAS_IMAGE_SIZE, DEFAULT_MAX_ATLAS_IMAGE_SIZE),
+        OF_IMAGE_COLOR);
+  }
+
+  vector<AtlasEntry*> entries(images.size());
+  benchmark.start("atlas add");
+  for (int i = 0; i < images.size(); i++) {
+    entries[i] = atlas.add(ofToString(i), images[i]);
+  }
+  benchmark.stop(images.size());
+  benchmark.addValue("atlas images", atlas.getNumEntries(), "count");
+  benchmark.addValue("atlas pages", atlas.getNumPages(), "count");
+  benchmark.addValue("atlas first page usage", atlas.getUsage(0) * 100.0f,
+                     "%");
+
+  // Every other image goes, which triggers repacks of the pages
+  benchmark.start("atlas remove");
+  for (int i = 0; i < images.size(); i += 2) {
+    atlas.remove(entries[i]);
+    entries[i] = NULL;
+  }
+  benchmark.stop(images.size() / 2);
+  benchmark.addValue("atlas repacks", atlas.getNumRepacks(), "count");
+
+  benchmark.start("atlas add after remove");
+  for (int i = 0; i < images.size(); i += 2) {
+    entries[i] = atlas.add(ofToString(i), images[i]);
+  }
+  benchmark.stop(images.size() / 2);
+  benchmark.addValue("atlas pages after remove", atlas.getNumPages(),
+                     "count");
+
+  for (int i = 0; i < entries.size(); i++) {
+    atlas.remove(entries[i]);
+  }
+}
+
+void ofApp::benchmarkDownscale() {
+  ofPixels source;
+  source.allocate(DOWNSCALE_SOURCE_WIDTH, DOWNSCALE_SOURCE_HEIGHT,
+                  OF_IMAGE_COLOR);
+  unsigned char* pixels = source.getPixels();
+  for (int i = 0; i < source.size(); i++) {
+    pixels[i] = ofRandom(256);
+  }
+  runDownscales(source, "rgb", 2048);
+  runDownscales(source, "rgb", 400);
+  source.setImageType(OF_IMAGE_COLOR_ALPHA);
+  runDownscales(source, "rgba", 2048);
+  runDownscales(source, "rgba", 400);
+  benchmark.addValue("downscale simd", ImageScaler::hasSimd() ? 1 : 0,
+                     "bool");
+}
+
+void ofApp::runDownscales(ofPixels& source, string name, int maxSize) {
+  float scale = (float)maxSize / source.getWidth();
+  int width = maxSize;
+  int height = source.getHeight() * scale + 0.5f;
+  name += " to " + ofToString(maxSize);
+
+  ofPixels target;
+  benchmark.start("downscale scalar " + name);
+  for (int i = 0; i < NUM_DOWNSCALES; i++) {
+    ImageScaler::downscaleScalar(source, target, width, height);
+  }
+  benchmark.stop(NUM_DOWNSCALES);
+
+  ofPixels simdTarget;
+  benchmark.start("downscale " + name);
+  for (int i = 0; i < NUM_DOWNSCALES; i++) {
+    ImageScaler::downscale(source, simdTarget, width, height);
+  }
+  benchmark.stop(NUM_DOWNSCALES);
+
+  // Only the rounding of the two versions may differ
+  int maxDifference = 0;
+  for (int i = 0; i < target.size(); i++) {
+    maxDifference = std::max(maxDifference,
+                             std::abs(target[i] - simdTarget[i]));
+  }
+  benchmark.addValue("downscale difference " + name, maxDifference,
+                     "levels");
+}
+
+void ofApp::benchmarkImageCrop() {
+  ofPixels pixels;
+  pixels.allocate(CROP_IMAGE_WIDTH, CROP_IMAGE_HEIGHT, OF_IMAGE_COLOR);
+  for (int i = 0; i < pixels.size(); i++) {
+    pixels[i] = i % 251;
+  }
+  ofSaveImage(pixels, DEFAULT_IMAGES_DIR CROP_IMAGE_FILE);
+
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(mediaServer);
+  addRandomSurfaces(surfaceManager, SurfaceType::QUAD_SURFACE, 1);
+  setTexCoords(surfaceManager, ofRectangle(0.1f, 0.1f, 0.2f, 0.2f));
+  string path =
+      surfaceManager.getSourcePath(SOURCE_TYPE_NAME_IMAGE, CROP_IMAGE_FILE);
+
+  for (int crop = 0; crop < 2; crop++) {
+    mediaServer->setCropImages(crop);
+    string name = crop ? "cropped image" : "whole image";
+    benchmark.start("load " + name);
+    setImageSource(surfaceManager, CROP_IMAGE_FILE);
+    benchmark.stop(1);
+    ofRectangle region = mediaServer->getImageCrop(path);
+    benchmark.addValue(name + " uploaded pixels",
+                       region.width * CROP_IMAGE_WIDTH * region.height *
+                           CROP_IMAGE_HEIGHT,
+                       "count");
+    if (!crop) setImageSource(surfaceManager, SOURCE_TYPE_NAME_NONE);
+  }
+
+  // Dragging a corner out of the crop decodes the image again in the
+  // background, the update events collect it
+  setTexCoords(surfaceManager, ofRectangle(0.1f, 0.1f, 0.8f, 0.8f));
+  float startTime = ofGetElapsedTimef();
+  benchmark.start("grow image crop");
+  surfaceManager.updateGeometry();
+  ofEventArgs args;
+  while (mediaServer->getImageCrop(path).width < 0.8f &&
+         ofGetElapsedTimef() - startTime < CROP_TIMEOUT) {
+    ofNotifyEvent(ofEvents().update, args);
+    ofSleepMillis(1);
+  }
+  benchmark.stop(1);
+  ofRectangle region = mediaServer->getImageCrop(path);
+  benchmark.addValue("grown crop uploaded pixels",
+                     region.width * CROP_IMAGE_WIDTH * region.height *
+                         CROP_IMAGE_HEIGHT,
+                     "count");
+
+  setImageSource(surfaceManager, SOURCE_TYPE_NAME_NONE);
+  mediaServer->setCropImages(false);
+}
+
+void ofApp::setTexCoords(SurfaceManager& surfaceManager, ofRectangle rect) {
+  ofVec2f corners[4] = {ofVec2f(rect.x, rect.y),
+                        ofVec2f(rect.x + rect.width, rect.y),
+                        ofVec2f(rect.x + rect.width, rect.y + rect.height),
+                        ofVec2f(rect.x, rect.y + rect.height)};
+  for (int i = 0; i < 4; i++) {
+    SurfaceEdit edit;
+    edit.type = SurfaceEdit::TEX_COORD;
+    edit.surfaceIndex = 0;
+    edit.pointIndex = i;
+    edit.from = surfaceManager.getSurface(0)->getTexCoords()[i];
+    edit.to = corners[i];
+    surfaceManager.applyEdit(edit);
+  }
+}
+
+void ofApp::setImageSource(SurfaceManager& surfaceManager, string name) {
+  SurfaceEdit edit;
+  edit.type = SurfaceEdit::SOURCE;
+  edit.surfaceIndex = 0;
+  edit.sourceType = name == SOURCE_TYPE_NAME_NONE ? SOURCE_TYPE_NAME_NONE
+                                                  : SOURCE_TYPE_NAME_IMAGE;
+  edit.sourceName = name;
+  surfaceManager.applyEdit(edit);
+}
+
+void ofApp::benchmarkTiledImage() {
+  ofPixels pixels;
+  pixels.allocate(TILED_IMAGE_WIDTH, TILED_IMAGE_HEIGHT, OF_IMAGE_COLOR);
+  for (int i = 0; i < pixels.size(); i++) {
+    pixels[i] = i % 253;
+  }
+  ofDirectory::createDirectory(DEFAULT_TILED_DIR, true, true);
+  ofSaveImage(pixels, DEFAULT_TILED_DIR TILED_IMAGE_FILE);
+  string path = ofToDataPath(DEFAULT_TILED_DIR TILED_IMAGE_FILE, true);
+  string tilePath = TiledImageSource::getTilePath(path);
+  ofFile::removeFile(tilePath, false);
+
+  benchmark.start("cut image into tiles");
+  TiledImageSource* source = static_cast<TiledImageSource*>(
+      mediaServer->loadMedia(path, SourceType::SOURCE_TYPE_TILED));
+  float startTime = ofGetElapsedTimef();
+  ofEventArgs args;
+  while (source->isPreparing() &&
+         ofGetElapsedTimef() - startTime < TILED_TIMEOUT) {
+    ofNotifyEvent(ofEvents().update, args);
+    ofSleepMillis(1);
+  }
+  benchmark.stop(1);
+  if (!source->isLoaded()) {
+    PIMAPPER_LOG_WARNING("Benchmark") << "Could not cut " << path;
+    mediaServer->unloadMedia(path);
+    ofFile::removeFile(DEFAULT_TILED_DIR TILED_IMAGE_FILE);
+    return;
+  }
+  benchmark.addValue("tiles", source->getNumTiles(), "count");
+
+  // A surface in the middle touching four tiles
+  benchmark.start("first tiled window");
+  waitForTiles(source, ofRectangle(0.48f, 0.25f, 0.04f, 0.2f));
+  benchmark.stop(1);
+
+  // A projector sized window moving along the panorama
+  source->setBudget(TILED_BUDGET);
+  unsigned long long maxMemory = 0;
+  int reads = source->getNumTileReads();
+  benchmark.start("pan tiled window");
+  for (int i = 0; i < NUM_TILED_PANS; i++) {
+    float x = (float)i / NUM_TILED_PANS * 0.8f;
+    waitForTiles(source, ofRectangle(x, 0.0f, 0.15f, 1.0f));
+    maxMemory = std::max(maxMemory, source->getResidentMemory());
+  }
+  benchmark.stop(NUM_TILED_PANS);
+  benchmark.addValue("tile reads while panning",
+                     source->getNumTileReads() - reads, "count");
+  benchmark.addValue("tiled resident memory", maxMemory / 1024, "KB");
+  benchmark.addValue("tiled budget", TILED_BUDGET / 1024, "KB");
+  benchmark.addValue("tiles resident", source->getNumResidentTiles(),
+                     "count");
+
+  mediaServer->unloadMedia(path);
+  ofFile::removeFile(tilePath, false);
+  ofFile::removeFile(DEFAULT_TILED_DIR TILED_IMAGE_FILE);
+}
+
+void ofApp::benchmarkTextureCompression() {
+  // Smooth gradients with some grain, like a photo
+  ofPixels pixels;
+  pixels.allocate(COMPRESS_IMAGE_WIDTH, COMPRESS_IMAGE_HEIGHT, OF_IMAGE_COLOR);
+  for (int y = 0; y < COMPRESS_IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < COMPRESS_IMAGE_WIDTH; x++) {
+      for (int c = 0; c < 3; c++) {
+        pixels[(y * COMPRESS_IMAGE_WIDTH + x) * 3 + c] = ofClamp(
+            128.0f + 100.0f * sin(x * 0.01f * (c + 1)) * cos(y * 0.007f) +
+                ofRandom(-4.0f, 4.0f),
+            0.0f, 255.0f);
+      }
+    }
+  }
+  ofSaveImage(pixels, DEFAULT_IMAGES_DIR COMPRESS_IMAGE_FILE);
+  string path = ofToDataPath(DEFAULT_IMAGES_DIR COMPRESS_IMAGE_FILE, true);
+  string cachePath = TextureCache::getCachePath(path);
+  ofFile::removeFile(cachePath, false);
+
+  vector<unsigned char> blocks;
+  benchmark.start("etc encode");
+  int format = EtcCodec::encode(pixels, blocks);
+  benchmark.stop(1);
+  ofPixels decoded;
+  benchmark.start("etc decode");
+  EtcCodec::decode(&blocks[0], blocks.size(), format, COMPRESS_IMAGE_WIDTH,
+                   COMPRESS_IMAGE_HEIGHT, decoded);
+  benchmark.stop(1);
+  double squaredError = 0.0;
+  for (int i = 0; i < pixels.size(); i++) {
+    double difference = pixels[i] - decoded[i];
+    squaredError += difference * difference;
+  }
+  benchmark.addValue(
+      "etc psnr",
+      squaredError > 0.0
+          ? 10.0 * log10(255.0 * 255.0 * pixels.size() / squaredError)
+          : 99.0,
+      "dB");
+  benchmark.addValue("etc size", blocks.size() / 1024, "KB");
+
+  // Loaded as before while the cache is built in the background, the
+  // update events swap the texture
+  mediaServer->setCompressImages(true);
+  benchmark.start("load image to compress");
+  ImageSource* source = static_cast<ImageSource*>(
+      mediaServer->loadMedia(path, SourceType::SOURCE_TYPE_IMAGE));
+  benchmark.stop(1);
+  benchmark.addValue("uncompressed texture memory",
+                     source->getTextureMemory() / 1024, "KB");
+  float startTime = ofGetElapsedTimef();
+  ofEventArgs args;
+  benchmark.start("compress image in background");
+  while (mediaServer->isCompressing() &&
+         ofGetElapsedTimef() - startTime < COMPRESS_TIMEOUT) {
+    ofNotifyEvent(ofEvents().update, args);
+    ofSleepMillis(1);
+  }
+  ofNotifyEvent(ofEvents().update, args);
+  benchmark.stop(1);
+  benchmark.addValue("compressed upload",
+                     TextureCache::getUploadFormat(format) != 0 ? 1 : 0,
+                     "bool");
+  benchmark.addValue("swapped texture memory",
+                     source->getTextureMemory() / 1024, "KB");
+  mediaServer->unloadMedia(path);
+
+  // From the cache, decoded here if the GPU can not take the blocks
+  benchmark.start("load compressed image");
+  source = static_cast<ImageSource*>(
+      mediaServer->loadMedia(path, SourceType::SOURCE_TYPE_IMAGE));
+  benchmark.stop(1);
+  benchmark.addValue("compressed texture memory",
+                     source->getTextureMemory() / 1024, "KB");
+  mediaServer->unloadMedia(path);
+
+  mediaServer->setCompressImages(false);
+  ofFile::removeFile(cachePath, false);
+  ofFile::removeFile(DEFAULT_IMAGES_DIR COMPRESS_IMAGE_FILE);
+}
+
+bool ofApp::waitForTiles(TiledImageSource* source, ofRectangle bounds) {
+  float startTime = ofGetElapsedTimef();
+  ofEventArgs args;
+  while (ofGetElapsedTimef() - startTime < TILED_TIMEOUT) {
+    // Asking again keeps the window from being released
+    BaseSource* view = source->getView(bounds);
+    if (view == source ||
+        !static_cast<TileWindow*>(view)->missingTiles.size()) {
+      return true;
+    }
+    ofNotifyEvent(ofEvents().update, args);
+    ofSleepMillis(1);
+  }
+  return false;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxPiMapper.h"
+#include "EditHistory.h"
+#include "ImageScaler.h"
+#include "EtcCodec.h"
+#include "TextureCache.h"
+#include "Benchmark.h"
+
+// Defaults, both can be given on the command line
+#define DEFAULT_NUM_SURFACES 2000
+#define DEFAULT_OUTPUT_FILE "benchmark.json"
+// Fake media files put into the media directories
+#define NUM_MEDIA_FILES 500
+#define NUM_HIT_TEST_POINTS 200
+#define NUM_UNDO_EDITS 20000
+#define NUM_ANIMATED_SURFACES 10000
+#define NUM_ANIMATION_FRAMES 60
+// Surfaces driven by a simulated tracker and updates per surface and frame
+#define NUM_TRACKED_SURFACES 200
+#define NUM_TRACKER_UPDATES 4
+// Control messages sent as fast as possible, then at a steady rate
+#define NUM_FLOOD_MESSAGES 20000
+#define NUM_PACED_FRAMES 120
+#define NUM_PACED_MESSAGES 20
+#define BENCHMARK_CONTROL_PORT 9099
+// Surfaces in each of two presets and switches between them
+#define NUM_PRESET_SURFACES 500
+#define NUM_PRESET_SWITCHES 100
+// Cues in the list and sources each of them assigns
+#define NUM_CUES 100
+#define NUM_CUE_SOURCES 20
+// Simulated video following the show clock, the player runs 0.2% fast
+#define SIMULATED_SYNC_SECONDS 600
+#define NUM_SIMULATED_UPDATES_PER_SECOND 60
+#define SIMULATED_CLIP_DURATION 30.0
+#define SIMULATED_CLIP_FPS 25.0
+#define SIMULATED_PLAYER_RATE 1.002
+
+// Put a short clip here to measure the frame interval at loop points
+#define LOOP_CLIP_FILE "loop.mp4"
+#define NUM_LOOP_CLIP_LOOPS 5
+#define LOOP_UPDATE_MILLIS 5
+#define LOOP_CLIP_TIMEOUT 120.0f
+
+// A synthetic hour of 25 fps video with a keyframe every 2 seconds
+#define INDEX_MOVIE_FILE "benchmark.mp4"
+#define INDEX_MOVIE_FRAMES 90000
+#define INDEX_MOVIE_GOP 50
+#define NUM_INDEX_BUILDS 20
+#define NUM_KEYFRAME_LOOKUPS 100000
+// Put a clip here to measure seek latency with and without its index
+#define SEEK_CLIP_FILE "seek.mp4"
+#define NUM_CLIP_SEEKS 50
+#define SEEK_TIMEOUT 2.0f
+
+// Regions of one image in a grid, each on a surface of its own
+#define REGION_GRID_SIZE 16
+
+// Icons of random size up to the atlas maximum, packed and unpacked
+#define NUM_ATLAS_IMAGES 400
+#define MIN_ATLAS_IMAGE_SIZE 16
+
+// A camera photo scaled down to the texture limit of the Pi and to the
+// size of a small surface
+#define DOWNSCALE_SOURCE_WIDTH 6000
+#define DOWNSCALE_SOURCE_HEIGHT 4000
+#define NUM_DOWNSCALES 3
+
+// A backdrop of which one surface shows a corner
+#define CROP_IMAGE_FILE "crop.png"
+#define CROP_IMAGE_WIDTH 4000
+#define CROP_IMAGE_HEIGHT 3000
+#define CROP_TIMEOUT 10.0f
+// A panorama wider than the texture limit of the Pi, panned over with a
+// budget for a few windows
+#define TILED_IMAGE_FILE "panorama.png"
+#define TILED_IMAGE_WIDTH 12288
+#define TILED_IMAGE_HEIGHT 1536
+#define TILED_BUDGET 33554432
+#define NUM_TILED_PANS 20
+#define TILED_TIMEOUT 60.0f
+// A photo sized image compressed for the GPU
+#define COMPRESS_IMAGE_FILE "compress.png"
+#define COMPRESS_IMAGE_WIDTH 2048
+#define COMPRESS_IMAGE_HEIGHT 1536
+#define COMPRESS_TIMEOUT 30.0f
+
+// Runs every case once on startup, writes the results and exits. Checks of
+// the results are in the tests app.
+class ofApp : public ofBaseApp {
+ public:
+  ofApp();
+
+  void setup();
+
+  int numSurfaces;
+  string outputFile;
+
+ private:
+  Benchmark benchmark;
+  ofx::piMapper::MediaServer* mediaServer;
+
+  void createMediaFiles();
+  void removeMediaFiles();
+  void addRandomSurfaces(ofx::piMapper::SurfaceManager& surfaceManager,
+                         int surfaceType, int count);
+
+  void benchmarkSurfaces();
+  void benchmarkPersistence();
+  void benchmarkMediaServer();
+  void benchmarkDirectoryWatcher();
+  void benchmarkUndo();
+  void benchmarkGeometry();
+  void benchmarkVertexInput();
+  void benchmarkControl();
+  void benchmarkPresets();
+  void benchmarkCueList();
+  void benchmarkVideoSync();
+  void benchmarkGaplessLoop();
+  void runLoopClip(bool gapless);
+  void benchmarkKeyframeIndex();
+  void benchmarkSeek();
+  void benchmarkRegions();
+  void benchmarkAtlas();
+  void benchmarkDownscale();
+  void runDownscales(ofPixels& source, string name, int maxSize);
+  void benchmarkImageCrop();
+  void benchmarkTiledImage();
+  void benchmarkTextureCompression();
+  // Sends update events until the window for bounds has all its tiles
+  bool waitForTiles(ofx::piMapper::TiledImageSource* source,
+                    ofRectangle bounds);
+  void setTexCoords(ofx::piMapper::SurfaceManager& surfaceManager,
+                    ofRectangle rect);
+  void setImageSource(ofx::piMapper::SurfaceManager& surfaceManager,
+                      string name);
+  void runSeeks(ofx::piMapper::VideoSource& source, string mode, double snap,
+                double duration);
+  void addControlStats(string name, ofx::piMapper::ControlServer& server);
+  // Average microseconds of updateGeometry per frame
+  float animateSurfaces(ofx::piMapper::SurfaceManager& surfaceManager);
+};
@@ -2,12 +2,15 @@
 
 void ofApp::setup() {
   bShowInfo = false;
+  bShowStats = false;
   
   // Pass pointers to our media server instance to both:
   // surface manager and it's gui, only then we will be able to
   // load surface data from xml settings files
   surfaceManager.setMediaServer(&mediaServer);
   gui.setMediaServer(&mediaServer);
+  // Keep videos on different surfaces from drifting apart
+  mediaServer.setSyncVideos(true);
 
   // check if the surfaces.xml file is there
   // if not - load defaultSurfaces.xml
@@ -17,8 +20,28 @@ void ofApp::setup() {
     surfaceManager.loadXmlSettings("defaultSurfaces.xml");
   }
 
+  // Journal every edit so a crash does not lose the calibration,
+  // the journal is compacted into surfaces.xml once a minute
+  surfaceManager.enableAutosave("surfaces.xml");
+  // Pick up changes made to surfaces.xml while running
+  surfaceManager.watchXmlSettings("surfaces.xml");
+
   // Pass the surface manager to the mapper graphical user interface
   gui.setSurfaceManager(&surfaceManager);
+  statsHud.setSurfaceManager(&surfaceManager);
+
+  // Accept OSC messages from show control software on this machine
+  controlServer.setSurfaceManager(&surfaceManager);
+  controlServer.setMediaServer(&mediaServer);
+  controlServer.setCueList(&cueList);
+  controlServer.setup();
+
+  // Run a show if there is one, <g> fires the next cue
+  cueList.setSurfaceManager(&surfaceManager);
+  cueList.setMediaServer(&mediaServer);
+  if (ofFile::doesFileExist("cues.xml")) {
+    cueList.load("cues.xml");
+  }
 
   // Create FBO
   fbo = new ofFbo();
@@ -72,6 +95,10 @@ void ofApp::draw() {
     ss << "Press <r> or <n> to add random or normal surface.\n";
     ss << "Press <q> to add a new quad surface.\n";
     ss << "Press <s> to save the composition.\n";
+    ss << "Press <z> to undo and <y> to redo.\n";
+    ss << "Press <p> to start profiling, again to save profile.json/csv.\n";
+    ss << "Press <h> to toggle render statistics.\n";
+    ss << "Press <g> to fire the next cue of cues.xml.\n";
     ss << "Press <f> to toggle fullscreen.\n";
     ss << "Press <a> to reassign the fbo texture to the first surface\n";
     ss << "Hit <i> to hide this message.";
@@ -79,6 +106,10 @@ void ofApp::draw() {
     ofDrawBitmapStringHighlight(ss.str(), 10, 20, ofColor(0, 0, 0, 100),
                                 ofColor(255, 255, 255, 200));
   }
+
+  if (bShowStats) {
+    statsHud.draw(ofGetWidth() - 320, 20);
+  }
 }
 
 void ofApp::exit() {
@@ -123,6 +154,21 @@ void ofApp::keyPressed(int key) {
     case 'a':
       setFboAsSource();
       break;
+    case 'z':
+      gui.undo();
+      break;
+    case 'y':
+      gui.redo();
+      break;
+    case 'p':
+      toggleProfiler();
+      break;
+    case 'h':
+      bShowStats = !bShowStats;
+      break;
+    case 'g':
+      cueList.go();
+      break;
     case OF_KEY_BACKSPACE:
       surfaceManager.removeSelectedSurface();
       break;
@@ -187,4 +233,16 @@ void ofApp::addSurface() {
 
 void ofApp::setFboAsSource() {
   surfaceManager.getSurface(0)->setSource(fboSource);
-}
\ No newline at end of file
+}
+
+void ofApp::toggleProfiler() {
+  ofx::piMapper::Profiler& profiler = ofx::piMapper::Profiler::instance();
+  if (!profiler.isEnabled()) {
+    profiler.clear();
+    profiler.setEnabled(true);
+    return;
+  }
+  profiler.setEnabled(false);
+  profiler.saveChromeTrace("profile.json");
+  profiler.saveCsv("profile.csv");
+}
@@ -17,12 +17,17 @@ class ofApp : public ofBaseApp {
   void addQuadSurface();
   void addSurface();
   void setFboAsSource();
+  void toggleProfiler();
 
   ofImage image;
   ofx::piMapper::MediaServer mediaServer;
   ofx::piMapper::SurfaceManager surfaceManager;
   ofx::piMapper::SurfaceManagerGui gui;
+  ofx::piMapper::ControlServer controlServer;
+  ofx::piMapper::CueList cueList;
   bool bShowInfo;
+  bool bShowStats;
+  ofx::piMapper::StatsHud statsHud;
   ofFbo* fbo;
   ofx::piMapper::BaseSource* fboSource;
   vector<ofRectangle> rects;
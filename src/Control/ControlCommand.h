@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofx {
+namespace piMapper {
+// A control message that has been checked for the right arguments,
+// waiting to be applied on the main thread
+struct ControlCommand {
+  enum { VERTEX, TEX_COORD, MOVE, SOURCE, LOAD, PRESET, CUE_GO, CUE_FIRE };
+
+  ControlCommand() {
+    type = VERTEX;
+    surfaceIndex = 0;
+    pointIndex = 0;
+    receivedMicros = 0;
+  }
+
+  int type;
+  int surfaceIndex;
+  // Vertex or texture coordinate index for VERTEX and TEX_COORD,
+  // cue index for CUE_FIRE
+  int pointIndex;
+  // Position for VERTEX and TEX_COORD, offset for MOVE,
+  // fade duration in x for PRESET
+  ofVec2f value;
+  // Source type for SOURCE
+  std::string sourceType;
+  // Source name for SOURCE, settings file for LOAD, name for PRESET
+  std::string name;
+  // ofGetElapsedTimeMicros when the packet arrived
+  unsigned long long receivedMicros;
+};
+}
+}
@@ -0,0 +1,320 @@
+#include "ControlServer.h"
+#include "Poco/Timespan.h"
+#include "Poco/TimeoutException.h"
+#include "Poco/Net/NetException.h"
+#include "Profiler.h"
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+ControlStats::ControlStats() {
+  numPackets = 0;
+  numMessages = 0;
+  numInvalid = 0;
+  numDropped = 0;
+  numRejected = 0;
+  numApplied = 0;
+  averageLatencyMicros = 0.0f;
+  maxLatencyMicros = 0;
+}
+
+ControlServer::ControlServer() : queue(CONTROL_QUEUE_CAPACITY) {
+  bListening = false;
+  surfaceManager = NULL;
+  mediaServer = NULL;
+  cueList = NULL;
+  resetStats();
+  ofAddListener(ofEvents().update, this, &ControlServer::handleUpdate);
+}
+
+ControlServer::~ControlServer() {
+  ofRemoveListener(ofEvents().update, this, &ControlServer::handleUpdate);
+  close();
+}
+
+bool ControlServer::setup(int port, std::string host) {
+  close();
+  try {
+    socket.bind(Poco::Net::SocketAddress(host, port), true);
+    socket.setReceiveTimeout(
+        Poco::Timespan(0, CONTROL_RECEIVE_TIMEOUT_MS * 1000));
+  } catch (Poco::Exception& e) {
+    PIMAPPER_LOG_ERROR("ControlServer")
+        << "Could not listen on " << host << ":" << port << ": "
+        << e.displayText();
+    return false;
+  }
+  bListening = true;
+  startThread(true, false);
+  PIMAPPER_LOG_NOTICE("ControlServer") << "Listening on " << host << ":"
+                                       << port;
+  return true;
+}
+
+void ControlServer::close() {
+  if (!bListening) return;
+  // The thread notices within the receive timeout
+  waitForThread(true);
+  socket.close();
+  bListening = false;
+}
+
+bool ControlServer::isListening() { return bListening; }
+
+void ControlServer::setSurfaceManager(SurfaceManager* newSurfaceManager) {
+  surfaceManager = newSurfaceManager;
+}
+
+void ControlServer::setMediaServer(MediaServer* newMediaServer) {
+  mediaServer = newMediaServer;
+}
+
+void ControlServer::setCueList(CueList* newCueList) { cueList = newCueList; }
+
+void ControlServer::handleUpdate(ofEventArgs& args) { update(); }
+
+void ControlServer::update() {
+  PIMAPPER_PROFILE("update", "ControlServer");
+  int numAppliedBefore = numApplied;
+  // Commands arriving while we are at it wait for the next frame
+  ControlCommand command;
+  for (int i = 0; i < queue.getCapacity() && queue.pop(command); i++) {
+    if (surfaceManager == NULL || !apply(command)) {
+      numRejected++;
+      continue;
+    }
+    numApplied++;
+    unsigned long long latency = ofGetElapsedTimeMicros() -
+                                 command.receivedMicros;
+    totalLatencyMicros += latency;
+    maxLatencyMicros = std::max(maxLatencyMicros, latency);
+  }
+
+  // Show the changes this frame even if the surface manager
+  // has already been updated
+  if (numApplied != numAppliedBefore) {
+    surfaceManager->updateGeometry();
+    surfaceManager->publishScene();
+  }
+}
+
+bool ControlServer::toCommand(OscMessage& message, ControlCommand& command) {
+  std::string& address = message.getAddress();
+  std::string tags = message.getTypeTags();
+  // Numbers may be ints or floats
+  for (int i = 0; i < tags.size(); i++) {
+    if (tags[i] == 'f') tags[i] = 'i';
+  }
+
+  if (address == CONTROL_ADDRESS_VERTEX ||
+      address == CONTROL_ADDRESS_TEX_COORD) {
+    if (tags != "iiii") return false;
+    command.type = address == CONTROL_ADDRESS_VERTEX
+                       ? ControlCommand::VERTEX
+                       : ControlCommand::TEX_COORD;
+    command.surfaceIndex = message.getInt(0);
+    command.pointIndex = message.getInt(1);
+    command.value = ofVec2f(message.getFloat(2), message.getFloat(3));
+  } else if (address == CONTROL_ADDRESS_MOVE) {
+    if (tags != "iii") return false;
+    command.type = ControlCommand::MOVE;
+    command.surfaceIndex = message.getInt(0);
+    command.value = ofVec2f(message.getFloat(1), message.getFloat(2));
+  } else if (address == CONTROL_ADDRESS_SOURCE) {
+    if (tags != "iss") return false;
+    command.type = ControlCommand::SOURCE;
+    command.surfaceIndex = message.getInt(0);
+    command.sourceType = message.getString(1);
+    command.name = message.getString(2);
+  } else if (address == CONTROL_ADDRESS_LOAD) {
+    if (tags != "s") return false;
+    command.type = ControlCommand::LOAD;
+    command.name = message.getString(0);
+    // Only files in the data directory
+    if (command.name.find('/') != std::string::npos ||
+        command.name.find('\\') != std::string::npos ||
+        command.name.find("..") != std::string::npos) {
+      return false;
+    }
+  } else if (address == CONTROL_ADDRESS_PRESET) {
+    if (tags != "s" && tags != "si") return false;
+    command.type = ControlCommand::PRESET;
+    command.name = message.getString(0);
+    if (tags == "si") command.value.x = message.getFloat(1);
+  } else if (address == CONTROL_ADDRESS_CUE_GO) {
+    if (tags != "") return false;
+    command.type = ControlCommand::CUE_GO;
+  } else if (address == CONTROL_ADDRESS_CUE_FIRE) {
+    if (tags != "i") return false;
+    command.type = ControlCommand::CUE_FIRE;
+    command.pointIndex = message.getInt(0);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+ControlStats ControlServer::getStats() {
+  ControlStats stats;
+  stats.numPackets = __sync_fetch_and_add(&numPackets, 0);
+  stats.numMessages = __sync_fetch_and_add(&numMessages, 0);
+  stats.numInvalid = __sync_fetch_and_add(&numInvalid, 0);
+  stats.numDropped = __sync_fetch_and_add(&numDropped, 0);
+  stats.numRejected = numRejected;
+  stats.numApplied = numApplied;
+  if (numApplied > 0) {
+    stats.averageLatencyMicros = (float)totalLatencyMicros / numApplied;
+  }
+  stats.maxLatencyMicros = maxLatencyMicros;
+  return stats;
+}
+
+void ControlServer::resetStats() {
+  __sync_lock_test_and_set(&numPackets, 0);
+  __sync_lock_test_and_set(&numMessages, 0);
+  __sync_lock_test_and_set(&numInvalid, 0);
+  __sync_lock_test_and_set(&numDropped, 0);
+  numRejected = 0;
+  numApplied = 0;
+  totalLatencyMicros = 0;
+  maxLatencyMicros = 0;
+}
+
+void ControlServer::threadedFunction() {
+  vector<char> buffer(MAX_CONTROL_PACKET_SIZE);
+  while (isThreadRunning()) {
+    int size;
+    try {
+      size = socket.receiveBytes(&buffer[0], buffer.size());
+    } catch (Poco::TimeoutException& e) {
+      continue;
+    } catch (Poco::Exception& e) {
+      PIMAPPER_LOG_THROTTLED(OF_LOG_WARNING, "ControlServer")
+          << e.displayText();
+      continue;
+    }
+    if (size > 0) receive(&buffer[0], size);
+  }
+}
+
+void ControlServer::receive(const char* data, int size) {
+  unsigned long long receivedMicros = ofGetElapsedTimeMicros();
+  __sync_fetch_and_add(&numPackets, 1);
+
+  vector<OscMessage> messages;
+  if (!OscMessage::parse(data, size, messages)) {
+    __sync_fetch_and_add(&numInvalid, 1);
+  }
+
+  for (int i = 0; i < messages.size(); i++) {
+    __sync_fetch_and_add(&numMessages, 1);
+    ControlCommand command;
+    if (!toCommand(messages[i], command)) {
+      __sync_fetch_and_add(&numInvalid, 1);
+      continue;
+    }
+    command.receivedMicros = receivedMicros;
+    if (!queue.push(command)) {
+      __sync_fetch_and_add(&numDropped, 1);
+    }
+  }
+}
+
+bool ControlServer::apply(ControlCommand& command) {
+  if (command.type == ControlCommand::LOAD) {
+    if (!ofFile::doesFileExist(command.name)) return false;
+    surfaceManager->reloadXmlSettings(command.name);
+    return true;
+  }
+  if (command.type == ControlCommand::PRESET) {
+    if (!surfaceManager->hasPreset(command.name)) return false;
+    return surfaceManager->switchPreset(command.name, command.value.x);
+  }
+  if (command.type == ControlCommand::CUE_GO) {
+    if (cueList == NULL) return false;
+    if (cueList->getCurrentCue() + 1 >= cueList->size()) return false;
+    cueList->go();
+    return true;
+  }
+  if (command.type == ControlCommand::CUE_FIRE) {
+    if (cueList == NULL) return false;
+    if (command.pointIndex < 0 || command.pointIndex >= cueList->size()) {
+      return false;
+    }
+    cueList->fire(command.pointIndex);
+    return true;
+  }
+
+  if (command.surfaceIndex < 0 ||
+      command.surfaceIndex >= surfaceManager->size()) {
+    return false;
+  }
+  BaseSurface* surface = surfaceManager->getSurface(command.surfaceIndex);
+
+  SurfaceEdit edit;
+  edit.surfaceIndex = command.surfaceIndex;
+  edit.pointIndex = command.pointIndex;
+  edit.to = command.value;
+  if (command.type == ControlCommand::VERTEX) {
+    if (command.pointIndex < 0 ||
+        command.pointIndex >= surface->getVertices().size()) {
+      return false;
+    }
+    edit.type = SurfaceEdit::VERTEX;
+  } else if (command.type == ControlCommand::TEX_COORD) {
+    if (command.pointIndex < 0 ||
+        command.pointIndex >= surface->getTexCoords().size()) {
+      return false;
+    }
+    edit.type = SurfaceEdit::TEX_COORD;
+  } else if (command.type == ControlCommand::MOVE) {
+    edit.type = SurfaceEdit::MOVE;
+  } else if (command.type == ControlCommand::SOURCE) {
+    if (!isSourceAvailable(command.sourceType, command.name)) return false;
+    edit.type = SurfaceEdit::SOURCE;
+    edit.sourceType = command.sourceType;
+    edit.sourceName = command.name;
+  } else {
+    return false;
+  }
+
+  surfaceManager->applyEdit(edit);
+  return true;
+}
+
+bool ControlServer::isSourceAvailable(std::string& sourceType,
+                                      std::string& name) {
+  if (sourceType == SOURCE_TYPE_NAME_NONE) return true;
+  if (mediaServer == NULL) return false;
+
+  if (sourceType == SOURCE_TYPE_NAME_REGION) {
+    // Named after the parent, see RegionSource
+    std::string parent;
+    ofRectangle region;
+    if (!RegionSource::splitRegion(name, parent, region)) return false;
+    size_t separator = parent.find('/');
+    if (separator == std::string::npos) return false;
+    std::string parentType = parent.substr(0, separator);
+    std::string parentName = parent.substr(separator + 1);
+    if (parentType == SOURCE_TYPE_NAME_REGION) return false;
+    return isSourceAvailable(parentType, parentName);
+  }
+
+  if (sourceType == SOURCE_TYPE_NAME_TILED) {
+    // Not listed by a watcher, the file has to be in the directory
+    return name.find('/') == std::string::npos &&
+           ofFile::doesFileExist(mediaServer->getDefaultTiledDir() + name);
+  }
+
+  vector<std::string> names;
+  if (sourceType == SOURCE_TYPE_NAME_IMAGE) {
+    names = mediaServer->getImageNames();
+  } else if (sourceType == SOURCE_TYPE_NAME_VIDEO) {
+    names = mediaServer->getVideoNames();
+  } else {
+    return false;
+  }
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "LockFreeQueue.h"
+#include "OscMessage.h"
+#include "ControlCommand.h"
+#include "SurfaceManager.h"
+#include "MediaServer.h"
+#include "CueList.h"
+
+#define DEFAULT_CONTROL_PORT 9000
+// Only this machine can send by default
+#define DEFAULT_CONTROL_HOST "127.0.0.1"
+// Commands that can wait for the next frame before new ones are dropped
+#define CONTROL_QUEUE_CAPACITY 1024
+#define MAX_CONTROL_PACKET_SIZE 8192
+// How often the receiving thread checks whether it should stop
+#define CONTROL_RECEIVE_TIMEOUT_MS 100
+
+// Addresses understood by ControlServer, i is an int, f a float and
+// s a string. Numbers may be sent as either int or float.
+#define CONTROL_ADDRESS_VERTEX "/pimapper/surface/vertex"      // i i f f
+#define CONTROL_ADDRESS_TEX_COORD "/pimapper/surface/texcoord" // i i f f
+#define CONTROL_ADDRESS_MOVE "/pimapper/surface/move"          // i f f
+#define CONTROL_ADDRESS_SOURCE "/pimapper/surface/source"      // i s s
+#define CONTROL_ADDRESS_LOAD "/pimapper/load"                  // s
+#define CONTROL_ADDRESS_PRESET "/pimapper/preset"              // s [f]
+#define CONTROL_ADDRESS_CUE_GO "/pimapper/cue/go"              // none
+#define CONTROL_ADDRESS_CUE_FIRE "/pimapper/cue/fire"          // i
+
+namespace ofx {
+namespace piMapper {
+struct ControlStats {
+  ControlStats();
+
+  unsigned int numPackets;
+  unsigned int numMessages;
+  // Not OSC or unknown address or arguments
+  unsigned int numInvalid;
+  // Queue was full
+  unsigned int numDropped;
+  // Valid commands that could not be applied, like a missing surface
+  unsigned int numRejected;
+  unsigned int numApplied;
+  // Time from receiving a packet until its command was applied
+  float averageLatencyMicros;
+  unsigned long long maxLatencyMicros;
+};
+
+// Receives OSC messages over UDP on its own thread and turns them into
+// commands. They are applied to the surface manager on the main thread,
+// on every update, as surface edits, so they are journaled and undoable.
+class ControlServer : public ofThread {
+ public:
+  ControlServer();
+  ~ControlServer();
+
+  // Starts listening, false if the port can not be opened.
+  // Pass "0.0.0.0" as host to accept messages from other machines.
+  bool setup(int port = DEFAULT_CONTROL_PORT,
+             std::string host = DEFAULT_CONTROL_HOST);
+  void close();
+  bool isListening();
+
+  void setSurfaceManager(SurfaceManager* newSurfaceManager);
+  void setMediaServer(MediaServer* newMediaServer);
+  // Cue messages are rejected without one
+  void setCueList(CueList* newCueList);
+
+  // Applies queued commands, this happens on every update
+  void update();
+
+  // Turn one message into a command, false if it is not a valid command
+  static bool toCommand(OscMessage& message, ControlCommand& command);
+
+  ControlStats getStats();
+  void resetStats();
+
+ private:
+  Poco::Net::DatagramSocket socket;
+  bool bListening;
+  SurfaceManager* surfaceManager;
+  MediaServer* mediaServer;
+  CueList* cueList;
+  LockFreeQueue<ControlCommand> queue;
+
+  // Written by the receiving thread
+  volatile unsigned int numPackets;
+  volatile unsigned int numMessages;
+  volatile unsigned int numInvalid;
+  volatile unsigned int numDropped;
+  // Main thread only
+  unsigned int numRejected;
+  unsigned int numApplied;
+  unsigned long long totalLatencyMicros;
+  unsigned long long maxLatencyMicros;
+
+  void handleUpdate(ofEventArgs& args);
+  void threadedFunction();
+  void receive(const char* data, int size);
+  bool apply(ControlCommand& command);
+  bool isSourceAvailable(std::string& sourceType, std::string& name);
+};
+}
+}
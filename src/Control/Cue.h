@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ofMain.h"
+#include "TransitionType.h"
+
+namespace ofx {
+namespace piMapper {
+struct CueSource {
+  CueSource() { startTime = -1.0f; }
+
+  int surfaceIndex;
+  std::string sourceType;
+  std::string sourceName;
+  // Seconds into a video to start at, negative plays on from where it is
+  float startTime;
+};
+
+// One step of a show. The preset is switched to first, then the sources
+// are assigned with the transition of the cue.
+struct Cue {
+  Cue() {
+    transitionType = TransitionType::TRANSITION_CROSSFADE;
+    transitionDuration = DEFAULT_TRANSITION_DURATION;
+    followTime = 0.0f;
+  }
+
+  std::string name;
+  // Name given to SurfaceManager::addPreset, empty keeps the surfaces
+  std::string preset;
+  vector<CueSource> sources;
+  int transitionType;
+  float transitionDuration;
+  // Seconds until the next cue fires on its own, 0 waits for go
+  float followTime;
+};
+}
+}
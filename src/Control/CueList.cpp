@@ -0,0 +1,277 @@
+#include "CueList.h"
+#include "Profiler.h"
+
+namespace ofx {
+namespace piMapper {
+CueList::CueList() {
+  surfaceManager = NULL;
+  mediaServer = NULL;
+  currentCue = -1;
+  firedTime = 0.0f;
+  numPrefetchCues = DEFAULT_PREFETCH_CUES;
+  prefetchBudget = DEFAULT_PREFETCH_BUDGET;
+  prefetchedMemory = 0;
+  ofAddListener(ofEvents().update, this, &CueList::handleUpdate);
+}
+
+CueList::~CueList() {
+  ofRemoveListener(ofEvents().update, this, &CueList::handleUpdate);
+}
+
+void CueList::setSurfaceManager(SurfaceManager* newSurfaceManager) {
+  surfaceManager = newSurfaceManager;
+}
+
+void CueList::setMediaServer(MediaServer* newMediaServer) {
+  mediaServer = newMediaServer;
+}
+
+bool CueList::load(string fileName) {
+  ofxXmlSettings xml;
+  if (!xml.loadFile(fileName) || !xml.tagExists("cues")) {
+    PIMAPPER_LOG_WARNING("CueList") << "Could not load " << fileName;
+    return false;
+  }
+
+  if (xml.tagExists("presets") && surfaceManager != NULL) {
+    xml.pushTag("presets");
+    for (int i = 0; i < xml.getNumTags("preset"); i++) {
+      xml.pushTag("preset", i);
+      surfaceManager->addPreset(xml.getValue("name", ""),
+                                xml.getValue("file", ""));
+      xml.popTag();  // preset
+    }
+    xml.popTag();  // presets
+  }
+
+  clear();
+  xml.pushTag("cues");
+  for (int i = 0; i < xml.getNumTags("cue"); i++) {
+    xml.pushTag("cue", i);
+    Cue cue;
+    cue.name = xml.getValue("name", "");
+    cue.preset = xml.getValue("preset", "");
+    cue.transitionType = getTransitionType(xml.getValue("transition", ""));
+    cue.transitionDuration =
+        xml.getValue("duration", DEFAULT_TRANSITION_DURATION);
+    cue.followTime = xml.getValue("follow", 0.0f);
+
+    if (xml.tagExists("sources")) {
+      xml.pushTag("sources");
+      for (int j = 0; j < xml.getNumTags("source"); j++) {
+        xml.pushTag("source", j);
+        CueSource source;
+        source.surfaceIndex = xml.getValue("surface", -1);
+        source.sourceType = xml.getValue("source-type", "");
+        source.sourceName = xml.getValue("source-name", "");
+        source.startTime = xml.getValue("start", -1.0f);
+        xml.popTag();  // source
+        // Unknown types would stop the application when the cue fires
+        if (source.sourceType != SOURCE_TYPE_NAME_NONE &&
+            source.sourceType != SOURCE_TYPE_NAME_IMAGE &&
+            source.sourceType != SOURCE_TYPE_NAME_VIDEO &&
+            source.sourceType != SOURCE_TYPE_NAME_REGION &&
+            source.sourceType != SOURCE_TYPE_NAME_TILED) {
+          PIMAPPER_LOG_WARNING("CueList") << "Unknown source type "
+                                          << source.sourceType << " in cue "
+                                          << cue.name;
+          continue;
+        }
+        cue.sources.push_back(source);
+      }
+      xml.popTag();  // sources
+    }
+    xml.popTag();  // cue
+    addCue(cue);
+  }
+  xml.popTag();  // cues
+  return true;
+}
+
+void CueList::addCue(Cue& cue) { cues.push_back(cue); }
+
+void CueList::clear() {
+  cues.clear();
+  currentCue = -1;
+}
+
+int CueList::size() { return cues.size(); }
+
+Cue& CueList::getCue(int index) {
+  if (index < 0 || index >= cues.size()) {
+    throw std::runtime_error("Cue index out of bounds.");
+  }
+  return cues[index];
+}
+
+void CueList::go() {
+  if (currentCue + 1 >= cues.size()) {
+    PIMAPPER_LOG_NOTICE("CueList") << "No cue left";
+    return;
+  }
+  fire(currentCue + 1);
+}
+
+void CueList::fire(int index) {
+  if (surfaceManager == NULL) {
+    ofLogFatalError("CueList") << "Surface manager not set";
+    std::exit(EXIT_FAILURE);
+  }
+  Cue& cue = getCue(index);
+  PIMAPPER_PROFILE("update", "fire cue");
+
+  if (cue.preset != "") {
+    float fadeDuration =
+        cue.transitionType == TransitionType::TRANSITION_NONE
+            ? 0.0f
+            : cue.transitionDuration;
+    surfaceManager->switchPreset(cue.preset, fadeDuration);
+  }
+  for (int i = 0; i < cue.sources.size(); i++) {
+    CueSource& source = cue.sources[i];
+    if (source.surfaceIndex < 0 ||
+        source.surfaceIndex >= surfaceManager->size()) {
+      PIMAPPER_LOG_WARNING("CueList") << "No surface " << source.surfaceIndex
+                                      << " for cue " << cue.name;
+      continue;
+    }
+    surfaceManager->transitionSource(source.surfaceIndex, source.sourceType,
+                                     source.sourceName, cue.transitionType,
+                                     cue.transitionDuration);
+    string path = surfaceManager->getSourcePath(source.sourceType,
+                                                source.sourceName);
+    // The transition owns the prefetch now, it is not ours to cancel
+    vector<std::string>::iterator requested =
+        std::find(requestedPaths.begin(), requestedPaths.end(), path);
+    if (requested != requestedPaths.end()) requestedPaths.erase(requested);
+    if (source.startTime >= 0.0f && mediaServer != NULL &&
+        source.sourceType == SOURCE_TYPE_NAME_VIDEO) {
+      // Lands on a keyframe if one is close, see MediaServer::seekVideo
+      mediaServer->seekVideo(path, source.startTime);
+    }
+  }
+
+  currentCue = index;
+  firedTime = ofGetElapsedTimef();
+  PIMAPPER_LOG_NOTICE("CueList") << "Fired cue " << index << " " << cue.name;
+  ofNotifyEvent(onCueFired, index, this);
+  // Move the prefetch window along right away
+  updatePrefetch();
+}
+
+int CueList::getCurrentCue() { return currentCue; }
+
+void CueList::setPrefetchCues(int numCues) {
+  numPrefetchCues = numCues < 0 ? 0 : numCues;
+}
+
+int CueList::getPrefetchCues() { return numPrefetchCues; }
+
+void CueList::setPrefetchBudget(unsigned long long bytes) {
+  prefetchBudget = bytes;
+}
+
+unsigned long long CueList::getPrefetchBudget() { return prefetchBudget; }
+
+unsigned long long CueList::getPrefetchedMemory() { return prefetchedMemory; }
+
+void CueList::updatePrefetch() {
+  if (surfaceManager == NULL || mediaServer == NULL) return;
+
+  vector<Media> media;
+  getUpcomingMedia(media);
+
+  // Walk the media in the order it is needed. Anything shown already is
+  // resident and free. Only one prefetch is started per call, its size
+  // is known once it is ready, so the budget is exceeded by one at most.
+  vector<std::string> wantedPaths;
+  unsigned long long usedMemory = 0;
+  bool bRequested = false;
+  for (int i = 0; i < media.size(); i++) {
+    std::string& path = media[i].path;
+    bool bPrefetched = mediaServer->isPrefetched(path);
+    if (mediaServer->isMediaReady(path) && !bPrefetched) continue;
+    // Requesting it again would only fail again
+    if (mediaServer->isPrefetchFailed(path)) continue;
+    if (usedMemory >= prefetchBudget) break;
+    wantedPaths.push_back(path);
+
+    if (bPrefetched) {
+      usedMemory += mediaServer->getSourceByPath(path)->getTextureMemory();
+    } else if (mediaServer->isPrefetching(path)) {
+      bRequested = true;
+    } else if (!bRequested) {
+      mediaServer->prefetchMedia(path, media[i].type);
+      if (std::find(requestedPaths.begin(), requestedPaths.end(), path) ==
+          requestedPaths.end()) {
+        requestedPaths.push_back(path);
+      }
+      bRequested = true;
+    }
+  }
+  prefetchedMemory = usedMemory;
+
+  // Drop what is not wanted anymore, forget what has been claimed
+  int i = 0;
+  while (i < requestedPaths.size()) {
+    std::string& path = requestedPaths[i];
+    bool bWanted = std::find(wantedPaths.begin(), wantedPaths.end(), path) !=
+                   wantedPaths.end();
+    // A fired cue waiting for the media needs it as much as we did
+    if (!bWanted && !surfaceManager->isTransitionPending(path)) {
+      mediaServer->cancelPrefetch(path);
+    }
+    if (!bWanted || (!mediaServer->isPrefetched(path) &&
+                     !mediaServer->isPrefetching(path))) {
+      requestedPaths.erase(requestedPaths.begin() + i);
+      continue;
+    }
+    i++;
+  }
+}
+
+void CueList::handleUpdate(ofEventArgs& args) {
+  if (currentCue >= 0 && currentCue + 1 < cues.size()) {
+    float followTime = cues[currentCue].followTime;
+    if (followTime > 0.0f && ofGetElapsedTimef() - firedTime >= followTime) {
+      go();
+    }
+  }
+  updatePrefetch();
+}
+
+void CueList::getUpcomingMedia(vector<Media>& media) {
+  media.clear();
+  for (int i = currentCue + 1;
+       i < cues.size() && i <= currentCue + numPrefetchCues; i++) {
+    for (int j = 0; j < cues[i].sources.size(); j++) {
+      CueSource& source = cues[i].sources[j];
+      Media item;
+      item.path =
+          surfaceManager->getSourcePath(source.sourceType, source.sourceName);
+      if (item.path == "") continue;
+      item.type = SourceType::GetSourceTypeEnum(source.sourceType);
+      // Regions are free once their parent is there
+      if (item.type == SourceType::SOURCE_TYPE_REGION) {
+        std::string parentPath;
+        if (!mediaServer->getRegionParent(item.path, parentPath, item.type)) {
+          continue;
+        }
+        item.path = parentPath;
+      }
+      bool bListed = false;
+      for (int k = 0; k < media.size() && !bListed; k++) {
+        bListed = media[k].path == item.path;
+      }
+      if (!bListed) media.push_back(item);
+    }
+  }
+}
+
+int CueList::getTransitionType(std::string name) {
+  if (name == "none") return TransitionType::TRANSITION_NONE;
+  if (name == "wipe") return TransitionType::TRANSITION_WIPE;
+  return TransitionType::TRANSITION_CROSSFADE;
+}
+}
+}
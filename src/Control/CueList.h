@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofEvents.h"
+#include "ofxXmlSettings.h"
+#include "Cue.h"
+#include "SurfaceManager.h"
+#include "MediaServer.h"
+#include "Log.h"
+
+// Upcoming cues whose media is kept ready
+#define DEFAULT_PREFETCH_CUES 2
+// Bytes of texture memory prefetched media may take on top of what is shown
+#define DEFAULT_PREFETCH_BUDGET (64 * 1024 * 1024)
+
+namespace ofx {
+namespace piMapper {
+// Runs a show as a list of cues. Cues fire on go or after the follow time
+// of the previous one. Media of the next cues is prefetched in the order
+// the cues come in until the memory budget is used up, so a cue fires
+// with its textures resident.
+class CueList {
+ public:
+  CueList();
+  ~CueList();
+
+  void setSurfaceManager(SurfaceManager* newSurfaceManager);
+  void setMediaServer(MediaServer* newMediaServer);
+
+  // Presets listed in the file are added to the surface manager
+  bool load(string fileName);
+  void addCue(Cue& cue);
+  void clear();
+  int size();
+  Cue& getCue(int index);
+
+  // Fire the cue after the current one
+  void go();
+  void fire(int index);
+  // Index of the cue fired last, -1 before the first one
+  int getCurrentCue();
+
+  void setPrefetchCues(int numCues);
+  int getPrefetchCues();
+  void setPrefetchBudget(unsigned long long bytes);
+  unsigned long long getPrefetchBudget();
+  // Texture memory of media prefetched and not shown yet
+  unsigned long long getPrefetchedMemory();
+  // Refresh what is prefetched, this happens on every update
+  void updatePrefetch();
+
+  // Passed the index of the cue that fired
+  ofEvent<int> onCueFired;
+
+ private:
+  struct Media {
+    std::string path;
+    int type;
+  };
+
+  SurfaceManager* surfaceManager;
+  MediaServer* mediaServer;
+  vector<Cue> cues;
+  int currentCue;
+  float firedTime;
+  int numPrefetchCues;
+  unsigned long long prefetchBudget;
+  unsigned long long prefetchedMemory;
+  // Media prefetched by us, nobody else's prefetches are cancelled
+  vector<std::string> requestedPaths;
+
+  void handleUpdate(ofEventArgs& args);
+  void getUpcomingMedia(vector<Media>& media);
+  static int getTransitionType(std::string name);
+};
+}
+}
@@ -0,0 +1,213 @@
+#include "OscMessage.h"
+
+// Bundles inside bundles are allowed, up to this depth
+#define MAX_OSC_BUNDLE_DEPTH 4
+
+namespace ofx {
+namespace piMapper {
+static void writeString(std::string& packet, const std::string& value) {
+  packet += value;
+  // Terminated and padded to a multiple of 4 bytes
+  int numPadding = 4 - value.size() % 4;
+  packet.append(numPadding, '\0');
+}
+
+static void writeInt(std::string& packet, int value) {
+  unsigned int bits = value;
+  packet += (char)((bits >> 24) & 0xFF);
+  packet += (char)((bits >> 16) & 0xFF);
+  packet += (char)((bits >> 8) & 0xFF);
+  packet += (char)(bits & 0xFF);
+}
+
+OscArgument::OscArgument() {
+  type = 'i';
+  intValue = 0;
+  floatValue = 0.0f;
+}
+
+OscMessage::OscMessage() {}
+
+OscMessage::OscMessage(std::string newAddress) { address = newAddress; }
+
+std::string& OscMessage::getAddress() { return address; }
+
+void OscMessage::setAddress(std::string newAddress) { address = newAddress; }
+
+void OscMessage::addInt(int value) {
+  OscArgument argument;
+  argument.type = 'i';
+  argument.intValue = value;
+  arguments.push_back(argument);
+}
+
+void OscMessage::addFloat(float value) {
+  OscArgument argument;
+  argument.type = 'f';
+  argument.floatValue = value;
+  arguments.push_back(argument);
+}
+
+void OscMessage::addString(std::string value) {
+  OscArgument argument;
+  argument.type = 's';
+  argument.stringValue = value;
+  arguments.push_back(argument);
+}
+
+int OscMessage::getNumArguments() { return arguments.size(); }
+
+char OscMessage::getArgumentType(int index) {
+  if (index < 0 || index >= arguments.size()) {
+    throw std::runtime_error("OSC argument index out of bounds.");
+  }
+  return arguments[index].type;
+}
+
+int OscMessage::getInt(int index) {
+  char type = getArgumentType(index);
+  if (type == 'f') return (int)arguments[index].floatValue;
+  if (type == 's') return ofToInt(arguments[index].stringValue);
+  return arguments[index].intValue;
+}
+
+float OscMessage::getFloat(int index) {
+  char type = getArgumentType(index);
+  if (type == 'i') return arguments[index].intValue;
+  if (type == 's') return ofToFloat(arguments[index].stringValue);
+  return arguments[index].floatValue;
+}
+
+std::string OscMessage::getString(int index) {
+  char type = getArgumentType(index);
+  if (type == 'i') return ofToString(arguments[index].intValue);
+  if (type == 'f') return ofToString(arguments[index].floatValue);
+  return arguments[index].stringValue;
+}
+
+std::string OscMessage::getTypeTags() {
+  std::string tags;
+  for (int i = 0; i < arguments.size(); i++) {
+    tags += arguments[i].type;
+  }
+  return tags;
+}
+
+std::string OscMessage::serialize() {
+  std::string packet;
+  writeString(packet, address);
+  writeString(packet, "," + getTypeTags());
+  for (int i = 0; i < arguments.size(); i++) {
+    OscArgument& argument = arguments[i];
+    if (argument.type == 'i') {
+      writeInt(packet, argument.intValue);
+    } else if (argument.type == 'f') {
+      int bits;
+      memcpy(&bits, &argument.floatValue, 4);
+      writeInt(packet, bits);
+    } else {
+      writeString(packet, argument.stringValue);
+    }
+  }
+  return packet;
+}
+
+bool OscMessage::parse(const char* data, int size,
+                       vector<OscMessage>& messages) {
+  if (size >= 8 && memcmp(data, "#bundle", 8) == 0) {
+    return parseBundle(data, size, messages, 0);
+  }
+  return parseMessage(data, size, messages);
+}
+
+bool OscMessage::parseMessage(const char* data, int size,
+                              vector<OscMessage>& messages) {
+  OscMessage message;
+  int position = 0;
+  if (!readString(data, size, position, message.address)) return false;
+  if (message.address.size() == 0 || message.address[0] != '/') {
+    return false;
+  }
+
+  // Very old senders leave out the type tags, there are no arguments then
+  std::string tags;
+  if (position < size) {
+    if (!readString(data, size, position, tags)) return false;
+    if (tags.size() == 0 || tags[0] != ',') return false;
+  }
+
+  for (int i = 1; i < tags.size(); i++) {
+    OscArgument argument;
+    argument.type = tags[i];
+    if (tags[i] == 'i') {
+      if (!readInt(data, size, position, argument.intValue)) return false;
+    } else if (tags[i] == 'f') {
+      int bits;
+      if (!readInt(data, size, position, bits)) return false;
+      memcpy(&argument.floatValue, &bits, 4);
+    } else if (tags[i] == 's') {
+      if (!readString(data, size, position, argument.stringValue)) {
+        return false;
+      }
+    } else {
+      // Unknown sizes, the rest of the message can not be read
+      return false;
+    }
+    message.arguments.push_back(argument);
+  }
+
+  messages.push_back(message);
+  return true;
+}
+
+bool OscMessage::parseBundle(const char* data, int size,
+                             vector<OscMessage>& messages, int depth) {
+  if (depth >= MAX_OSC_BUNDLE_DEPTH) return false;
+  // "#bundle" and the 8 byte time tag
+  int position = 16;
+  if (size < position) return false;
+
+  while (position < size) {
+    int elementSize;
+    if (!readInt(data, size, position, elementSize)) return false;
+    if (elementSize <= 0 || elementSize % 4 != 0 ||
+        elementSize > size - position) {
+      return false;
+    }
+    const char* element = data + position;
+    bool bParsed;
+    if (elementSize >= 8 && memcmp(element, "#bundle", 8) == 0) {
+      bParsed = parseBundle(element, elementSize, messages, depth + 1);
+    } else {
+      bParsed = parseMessage(element, elementSize, messages);
+    }
+    if (!bParsed) return false;
+    position += elementSize;
+  }
+  return true;
+}
+
+bool OscMessage::readString(const char* data, int size, int& position,
+                            std::string& value) {
+  int end = position;
+  while (end < size && data[end] != '\0') end++;
+  if (end >= size) return false;
+  value.assign(data + position, end - position);
+  // Skip the terminator and padding
+  position = (end / 4 + 1) * 4;
+  return position <= size;
+}
+
+bool OscMessage::readInt(const char* data, int size, int& position,
+                         int& value) {
+  if (size - position < 4) return false;
+  const unsigned char* bytes = (const unsigned char*)(data + position);
+  unsigned int bits = ((unsigned int)bytes[0] << 24) |
+                      ((unsigned int)bytes[1] << 16) |
+                      ((unsigned int)bytes[2] << 8) | bytes[3];
+  value = (int)bits;
+  position += 4;
+  return true;
+}
+}
+}
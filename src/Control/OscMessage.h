@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofx {
+namespace piMapper {
+struct OscArgument {
+  OscArgument();
+
+  // OSC type tag: 'i', 'f' or 's'
+  char type;
+  int intValue;
+  float floatValue;
+  std::string stringValue;
+};
+
+// The subset of OSC 1.0 needed for control messages: int32, float32
+// and string arguments, optionally wrapped in bundles. Bundle time tags
+// are ignored, messages are executed as soon as they arrive.
+class OscMessage {
+ public:
+  OscMessage();
+  OscMessage(std::string newAddress);
+
+  std::string& getAddress();
+  void setAddress(std::string newAddress);
+
+  void addInt(int value);
+  void addFloat(float value);
+  void addString(std::string value);
+
+  int getNumArguments();
+  char getArgumentType(int index);
+  // Numbers are converted between int and float as needed
+  int getInt(int index);
+  float getFloat(int index);
+  std::string getString(int index);
+  // Type tags of all arguments, like "iiff"
+  std::string getTypeTags();
+
+  // Encoded packet ready to be sent
+  std::string serialize();
+
+  // Appends every message in a packet, false if it is malformed.
+  // Messages read before the error are kept.
+  static bool parse(const char* data, int size,
+                    vector<OscMessage>& messages);
+
+ private:
+  std::string address;
+  vector<OscArgument> arguments;
+
+  static bool parseMessage(const char* data, int size,
+                           vector<OscMessage>& messages);
+  static bool parseBundle(const char* data, int size,
+                          vector<OscMessage>& messages, int depth);
+  static bool readString(const char* data, int size, int& position,
+                         std::string& value);
+  static bool readInt(const char* data, int size, int& position, int& value);
+};
+}
+}
@@ -0,0 +1,127 @@
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+LogBuffer& LogBuffer::instance() {
+  static LogBuffer logBuffer;
+  return logBuffer;
+}
+
+LogBuffer::LogBuffer() {
+  next = 0;
+  count = 0;
+  bConsoleOutput = true;
+  entries.resize(DEFAULT_LOG_BUFFER_SIZE);
+}
+
+void LogBuffer::add(ofLogLevel level, const string& module,
+                    const string& message) {
+  mutex.lock();
+  LogEntry& entry = entries[next];
+  entry.level = level;
+  entry.module = module;
+  entry.message = message;
+  entry.frame = ofGetFrameNum();
+  entry.time = ofGetElapsedTimef();
+  next = (next + 1) % entries.size();
+  if (count < entries.size()) count++;
+  bool bConsole = bConsoleOutput;
+  mutex.unlock();
+
+  if (!bConsole) return;
+  switch (level) {
+    case OF_LOG_VERBOSE:
+      ofLogVerbose(module) << message;
+      break;
+    case OF_LOG_NOTICE:
+      ofLogNotice(module) << message;
+      break;
+    case OF_LOG_WARNING:
+      ofLogWarning(module) << message;
+      break;
+    case OF_LOG_ERROR:
+      ofLogError(module) << message;
+      break;
+    default:
+      ofLogFatalError(module) << message;
+      break;
+  }
+}
+
+void LogBuffer::setSize(int size) {
+  if (size < 1) size = 1;
+  mutex.lock();
+  entries.clear();
+  entries.resize(size);
+  next = 0;
+  count = 0;
+  mutex.unlock();
+}
+
+void LogBuffer::getEntries(vector<LogEntry>& result) {
+  mutex.lock();
+  result.clear();
+  int first = (next - count + entries.size()) % entries.size();
+  for (int i = 0; i < count; i++) {
+    result.push_back(entries[(first + i) % entries.size()]);
+  }
+  mutex.unlock();
+}
+
+void LogBuffer::clear() {
+  mutex.lock();
+  next = 0;
+  count = 0;
+  mutex.unlock();
+}
+
+void LogBuffer::setConsoleOutput(bool enabled) {
+  mutex.lock();
+  bConsoleOutput = enabled;
+  mutex.unlock();
+}
+
+bool LogBuffer::getConsoleOutput() {
+  mutex.lock();
+  bool enabled = bConsoleOutput;
+  mutex.unlock();
+  return enabled;
+}
+
+Log::Log(ofLogLevel newLevel, const string& newModule, int newNumSuppressed) {
+  level = newLevel;
+  module = newModule;
+  numSuppressed = newNumSuppressed;
+}
+
+Log::~Log() {
+  if (numSuppressed > 0) {
+    message << " (" << numSuppressed << " similar messages suppressed)";
+  }
+  LogBuffer::instance().add(level, module, message.str());
+}
+
+LogThrottle::LogThrottle() {
+  lastTime = 0.0f;
+  numSuppressed = 0;
+  bPassed = false;
+}
+
+bool LogThrottle::pass() {
+  float now = ofGetElapsedTimef();
+  if (bPassed && now - lastTime < LOG_THROTTLE_INTERVAL) {
+    numSuppressed++;
+    return false;
+  }
+  bPassed = true;
+  lastTime = now;
+  return true;
+}
+
+int LogThrottle::take() {
+  int suppressed = numSuppressed;
+  numSuppressed = 0;
+  return suppressed;
+}
+}
+}
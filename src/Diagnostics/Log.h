@@ -0,0 +1,130 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Numeric levels for the preprocessor, same order as ofLogLevel
+#define PIMAPPER_LOG_LEVEL_VERBOSE 0
+#define PIMAPPER_LOG_LEVEL_NOTICE 1
+#define PIMAPPER_LOG_LEVEL_WARNING 2
+#define PIMAPPER_LOG_LEVEL_ERROR 3
+#define PIMAPPER_LOG_LEVEL_FATAL_ERROR 4
+#define PIMAPPER_LOG_LEVEL_SILENT 5
+
+// Messages below this level are compiled out, together with everything
+// that builds them. Pass -DPIMAPPER_LOG_LEVEL=2 to keep warnings and up.
+#ifndef PIMAPPER_LOG_LEVEL
+#define PIMAPPER_LOG_LEVEL PIMAPPER_LOG_LEVEL_NOTICE
+#endif
+
+// Entries kept in memory by default
+#define DEFAULT_LOG_BUFFER_SIZE 256
+// Throttled messages are let through at most once per this many seconds
+#define LOG_THROTTLE_INTERVAL 1.0f
+
+#define PIMAPPER_LOG_ENABLED(level) ((int)(level) >= PIMAPPER_LOG_LEVEL)
+
+// Use like ofLog: PIMAPPER_LOG_WARNING("Module") << "message";
+#define PIMAPPER_LOG(level, module) \
+  if (!PIMAPPER_LOG_ENABLED(level)) {  \
+  } else                               \
+    ofx::piMapper::Log(level, module)
+
+#define PIMAPPER_LOG_VERBOSE(module) PIMAPPER_LOG(OF_LOG_VERBOSE, module)
+#define PIMAPPER_LOG_NOTICE(module) PIMAPPER_LOG(OF_LOG_NOTICE, module)
+#define PIMAPPER_LOG_WARNING(module) PIMAPPER_LOG(OF_LOG_WARNING, module)
+#define PIMAPPER_LOG_ERROR(module) PIMAPPER_LOG(OF_LOG_ERROR, module)
+
+// For messages that would repeat every frame. Every call site is limited
+// on its own and the next message that passes tells how many were dropped.
+// Call sites are told apart by their line, so keep one per line.
+#define PIMAPPER_LOG_THROTTLED(level, module)                      \
+  if (!PIMAPPER_LOG_ENABLED(level) ||                             \
+      !ofx::piMapper::getLogThrottle<__LINE__>().pass()) {        \
+  } else                                                          \
+    ofx::piMapper::Log(level, module,                             \
+                       ofx::piMapper::getLogThrottle<__LINE__>().take())
+
+namespace ofx {
+namespace piMapper {
+struct LogEntry {
+  ofLogLevel level;
+  string module;
+  string message;
+  unsigned long frame;
+  float time;
+};
+
+// Keeps the latest log entries in memory and optionally passes
+// them on to ofLog. Safe to use from any thread.
+class LogBuffer {
+ public:
+  static LogBuffer& instance();
+
+  void add(ofLogLevel level, const string& module, const string& message);
+  void setSize(int size);
+  // Oldest first
+  void getEntries(vector<LogEntry>& result);
+  void clear();
+
+  // Enabled by default, disable to keep log output off the console
+  void setConsoleOutput(bool enabled);
+  bool getConsoleOutput();
+
+ private:
+  LogBuffer();
+
+  ofMutex mutex;
+  vector<LogEntry> entries;
+  int next;
+  int count;
+  bool bConsoleOutput;
+};
+
+// Collects one message and hands it to LogBuffer when destroyed
+class Log {
+ public:
+  Log(ofLogLevel newLevel, const string& newModule, int numSuppressed = 0);
+  ~Log();
+
+  template <class T>
+  Log& operator<<(const T& value) {
+    message << value;
+    return *this;
+  }
+
+  // For std::endl and friends
+  Log& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+    return *this;
+  }
+
+ private:
+  ofLogLevel level;
+  string module;
+  std::ostringstream message;
+  int numSuppressed;
+};
+
+class LogThrottle {
+ public:
+  LogThrottle();
+  // True if a message may pass now
+  bool pass();
+  // Number of messages dropped since the last one passed
+  int take();
+
+ private:
+  float lastTime;
+  int numSuppressed;
+  bool bPassed;
+};
+
+// The throttle of a line, every file including this has its own
+namespace {
+template <int line>
+LogThrottle& getLogThrottle() {
+  static LogThrottle throttle;
+  return throttle;
+}
+}
+}
+}
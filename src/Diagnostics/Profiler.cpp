@@ -0,0 +1,311 @@
+#include "Profiler.h"
+#include "Log.h"
+#include "Poco/Thread.h"
+
+namespace ofx {
+namespace piMapper {
+bool Profiler::bEnabled = false;
+
+// Labels are file names, they may contain anything
+static std::string escapeJson(const std::string& text) {
+  std::string escaped;
+  for (int i = 0; i < text.size(); i++) {
+    if (text[i] == '"' || text[i] == '\\') {
+      escaped += '\\';
+    }
+    escaped += text[i];
+  }
+  return escaped;
+}
+
+static std::string escapeCsv(const std::string& text) {
+  std::string escaped = "\"";
+  for (int i = 0; i < text.size(); i++) {
+    if (text[i] == '"') escaped += '"';
+    escaped += text[i];
+  }
+  return escaped + "\"";
+}
+
+// Threads started by oF are Poco threads, the main thread is not
+static bool isMainThread() { return Poco::Thread::current() == NULL; }
+
+Profiler& Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() {
+  currentFrame = 0;
+  appFrame = 0;
+  bGpuSupported = false;
+  bGpuChecked = false;
+  bGpuActive = false;
+  setNumFrames(DEFAULT_PROFILER_FRAMES);
+}
+
+void Profiler::setEnabled(bool enabled) {
+  bEnabled = enabled;
+  if (!bEnabled && bGpuActive) {
+    endGpu();
+  }
+}
+
+void Profiler::setNumFrames(int numFrames) {
+  if (numFrames < 1) numFrames = 1;
+  mutex.lock();
+  frames.clear();
+  frames.resize(numFrames);
+  for (int i = 0; i < frames.size(); i++) {
+    frames[i].number = 0;
+  }
+  mutex.unlock();
+}
+
+int Profiler::getNumFrames() {
+  mutex.lock();
+  int numFrames = frames.size();
+  mutex.unlock();
+  return numFrames;
+}
+
+void Profiler::clear() {
+  mutex.lock();
+  for (int i = 0; i < frames.size(); i++) {
+    frames[i].number = 0;
+    frames[i].samples.clear();
+  }
+  mutex.unlock();
+}
+
+void Profiler::record(const char* category, const char* name, int index,
+                      int label, unsigned long long start,
+                      unsigned long long end) {
+  ProfileSample sample;
+  sample.category = category;
+  sample.name = name;
+  sample.index = index;
+  sample.label = label;
+  sample.start = start;
+  sample.duration = end - start;
+  sample.gpu = false;
+  sample.mainThread = isMainThread();
+
+  mutex.lock();
+  if (sample.mainThread) appFrame = ofGetFrameNum();
+  sample.frame = appFrame;
+  getFrame(sample.frame).samples.push_back(sample);
+  mutex.unlock();
+}
+
+int Profiler::addLabel(const std::string& label) {
+  mutex.lock();
+  int index;
+  std::map<std::string, int>::iterator it = labelIndices.find(label);
+  if (it != labelIndices.end()) {
+    index = it->second;
+  } else {
+    labels.push_back(label);
+    index = labels.size() - 1;
+    labelIndices[label] = index;
+  }
+  mutex.unlock();
+  return index;
+}
+
+const std::string& Profiler::getLabel(int label) {
+  mutex.lock();
+  if (label < 0 || label >= labels.size()) {
+    mutex.unlock();
+    throw std::runtime_error("Profiler label index out of bounds.");
+  }
+  const std::string& text = labels[label];
+  mutex.unlock();
+  return text;
+}
+
+void Profiler::beginGpu(const char* name) {
+  // Queries belong to the context of the main thread
+  if (bGpuActive || !isMainThread() || !checkGpuSupport()) return;
+  mutex.lock();
+  collectGpuQueries();
+  mutex.unlock();
+  if (!freeQueries.size()) {
+    // Results are not coming back fast enough, skip this one
+    return;
+  }
+#ifndef TARGET_OPENGLES
+  GpuQuery query;
+  query.id = freeQueries.back();
+  freeQueries.pop_back();
+  query.name = name;
+  query.frame = ofGetFrameNum();
+  query.start = ofGetElapsedTimeMicros();
+  glBeginQuery(GL_TIME_ELAPSED, query.id);
+  pendingQueries.push_back(query);
+  bGpuActive = true;
+#endif
+}
+
+void Profiler::endGpu() {
+  if (!bGpuActive || !isMainThread()) return;
+#ifndef TARGET_OPENGLES
+  glEndQuery(GL_TIME_ELAPSED);
+#endif
+  bGpuActive = false;
+}
+
+void Profiler::getSamples(vector<ProfileSample>& samples) {
+  mutex.lock();
+  if (isMainThread()) collectGpuQueries();
+  samples.clear();
+  // Frames are not necessarily consecutive, sort slots by frame number
+  std::map<unsigned long, Frame*> ordered;
+  for (int i = 0; i < frames.size(); i++) {
+    if (frames[i].samples.size()) {
+      ordered[frames[i].number] = &frames[i];
+    }
+  }
+  std::map<unsigned long, Frame*>::iterator it;
+  for (it = ordered.begin(); it != ordered.end(); it++) {
+    vector<ProfileSample>& frameSamples = it->second->samples;
+    samples.insert(samples.end(), frameSamples.begin(), frameSamples.end());
+  }
+  mutex.unlock();
+}
+
+float Profiler::getAverage(const char* category, const char* name) {
+  unsigned long long total = 0;
+  int numFrames = 0;
+  mutex.lock();
+  for (int i = 0; i < frames.size(); i++) {
+    bool bFound = false;
+    for (int j = 0; j < frames[i].samples.size(); j++) {
+      ProfileSample& sample = frames[i].samples[j];
+      if (strcmp(sample.category, category) == 0 &&
+          strcmp(sample.name, name) == 0) {
+        total += sample.duration;
+        bFound = true;
+      }
+    }
+    if (bFound) numFrames++;
+  }
+  mutex.unlock();
+  return numFrames > 0 ? (float)total / numFrames : 0.0f;
+}
+
+bool Profiler::saveChromeTrace(string fileName) {
+  vector<ProfileSample> samples;
+  getSamples(samples);
+
+  std::ofstream file(ofToDataPath(fileName, true).c_str());
+  if (!file.is_open()) {
+    PIMAPPER_LOG_ERROR("Profiler") << "Could not write " << fileName;
+    return false;
+  }
+
+  file << "{\"traceEvents\":[";
+  for (int i = 0; i < samples.size(); i++) {
+    ProfileSample& sample = samples[i];
+    if (i > 0) file << ",";
+    file << "\n{\"name\":\"" << sample.name;
+    if (sample.label >= 0) file << " " << escapeJson(getLabel(sample.label));
+    if (sample.index >= 0) file << " " << sample.index;
+    file << "\",\"cat\":\"" << sample.category << "\",\"ph\":\"X\""
+         << ",\"ts\":" << sample.start << ",\"dur\":" << sample.duration
+         // GPU timings and other threads go on tracks of their own
+         << ",\"pid\":0,\"tid\":"
+         << (sample.gpu ? 1 : sample.mainThread ? 0 : 2)
+         << ",\"args\":{\"frame\":" << sample.frame << "}}";
+  }
+  file << "\n]}\n";
+  file.close();
+  return true;
+}
+
+bool Profiler::saveCsv(string fileName) {
+  vector<ProfileSample> samples;
+  getSamples(samples);
+
+  std::ofstream file(ofToDataPath(fileName, true).c_str());
+  if (!file.is_open()) {
+    PIMAPPER_LOG_ERROR("Profiler") << "Could not write " << fileName;
+    return false;
+  }
+
+  file << "frame,category,name,index,label,gpu,start_us,duration_us\n";
+  for (int i = 0; i < samples.size(); i++) {
+    ProfileSample& sample = samples[i];
+    file << sample.frame << "," << sample.category << "," << sample.name
+         << "," << sample.index << ","
+         << (sample.label >= 0 ? escapeCsv(getLabel(sample.label)) : "")
+         << "," << (sample.gpu ? 1 : 0) << "," << sample.start << ","
+         << sample.duration << "\n";
+  }
+  file.close();
+  return true;
+}
+
+Profiler::Frame& Profiler::getFrame(unsigned long number) {
+  if (number != currentFrame) {
+    currentFrame = number;
+    Frame& frame = frames[currentFrame % frames.size()];
+    frame.number = currentFrame;
+    frame.samples.clear();
+  }
+  return frames[currentFrame % frames.size()];
+}
+
+void Profiler::collectGpuQueries() {
+#ifndef TARGET_OPENGLES
+  // Results come back in order
+  while (pendingQueries.size()) {
+    GpuQuery& query = pendingQueries.front();
+    if (bGpuActive && pendingQueries.size() == 1) break;
+
+    GLint available = 0;
+    glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) break;
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &elapsed);
+
+    // Drop results of frames that already left the ring buffer
+    Frame& frame = frames[query.frame % frames.size()];
+    if (frame.number == query.frame) {
+      ProfileSample sample;
+      sample.category = "gpu";
+      sample.name = query.name;
+      sample.index = -1;
+      sample.label = -1;
+      sample.frame = query.frame;
+      sample.start = query.start;
+      sample.duration = elapsed / 1000;
+      sample.gpu = true;
+      sample.mainThread = true;
+      frame.samples.push_back(sample);
+    }
+
+    freeQueries.push_back(query.id);
+    pendingQueries.pop_front();
+  }
+#endif
+}
+
+bool Profiler::checkGpuSupport() {
+  if (bGpuChecked) return bGpuSupported;
+  bGpuChecked = true;
+#ifndef TARGET_OPENGLES
+  bGpuSupported = ofGLCheckExtension("GL_ARB_timer_query");
+  if (bGpuSupported) {
+    freeQueries.resize(MAX_GPU_QUERIES);
+    glGenQueries(MAX_GPU_QUERIES, &freeQueries[0]);
+  }
+#endif
+  if (!bGpuSupported) {
+    PIMAPPER_LOG_NOTICE("Profiler") << "GL timer queries not available";
+  }
+  return bGpuSupported;
+}
+}
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Number of frames kept by default
+#define DEFAULT_PROFILER_FRAMES 300
+// Pending GL timer queries, results arrive a few frames late
+#define MAX_GPU_QUERIES 16
+
+// Scoped timers, compile them out completely with PIMAPPER_NO_PROFILER.
+// Names and categories must be string literals.
+#define PIMAPPER_PROFILE_CONCAT_(a, b) a##b
+#define PIMAPPER_PROFILE_CONCAT(a, b) PIMAPPER_PROFILE_CONCAT_(a, b)
+#ifdef PIMAPPER_NO_PROFILER
+#define PIMAPPER_PROFILE(category, name)
+#define PIMAPPER_PROFILE_INDEX(category, name, index)
+#define PIMAPPER_PROFILE_LABEL(category, name, label)
+#define PIMAPPER_PROFILE_GPU(name)
+#else
+#define PIMAPPER_PROFILE(category, name)                 \
+  ofx::piMapper::ProfileScope PIMAPPER_PROFILE_CONCAT( \
+      profileScope, __LINE__)(category, name)
+#define PIMAPPER_PROFILE_INDEX(category, name, index)    \
+  ofx::piMapper::ProfileScope PIMAPPER_PROFILE_CONCAT( \
+      profileScope, __LINE__)(category, name, index)
+#define PIMAPPER_PROFILE_LABEL(category, name, label)    \
+  ofx::piMapper::ProfileScope PIMAPPER_PROFILE_CONCAT( \
+      profileScope, __LINE__)(category, name, -1, &(label))
+#define PIMAPPER_PROFILE_GPU(name)                          \
+  ofx::piMapper::GpuProfileScope PIMAPPER_PROFILE_CONCAT( \
+      gpuProfileScope, __LINE__)(name)
+#endif
+
+namespace ofx {
+namespace piMapper {
+struct ProfileSample {
+  const char* category;
+  const char* name;
+  // Surface index or -1
+  int index;
+  // Index into Profiler::getLabel or -1
+  int label;
+  unsigned long frame;
+  // Microseconds since app start
+  unsigned long long start;
+  unsigned long long duration;
+  bool gpu;
+  // False for other threads like the render thread
+  bool mainThread;
+};
+
+// Keeps CPU timings of scopes and GL timer query results of the last
+// frames in a ring buffer. Use the PIMAPPER_PROFILE macros to record,
+// from any thread. Samples of other threads go into the frame the main
+// thread is in. GPU timings are only taken on the main thread. Disabled
+// by default, which costs one branch per scope.
+class Profiler {
+ public:
+  static Profiler& instance();
+  static bool isEnabled() { return bEnabled; }
+
+  void setEnabled(bool enabled);
+  void setNumFrames(int numFrames);
+  int getNumFrames();
+  void clear();
+
+  void record(const char* category, const char* name, int index, int label,
+              unsigned long long start, unsigned long long end);
+  // Strings like source names are interned once, they are never
+  // moved so the references stay valid
+  int addLabel(const std::string& label);
+  const std::string& getLabel(int label);
+
+  // GL timer queries, they can not be nested
+  void beginGpu(const char* name);
+  void endGpu();
+
+  // All samples of the kept frames, oldest frame first
+  void getSamples(vector<ProfileSample>& samples);
+  // Average time of a scope over the kept frames in microseconds
+  float getAverage(const char* category, const char* name);
+
+  // Load into chrome://tracing or any viewer of that format
+  bool saveChromeTrace(string fileName);
+  bool saveCsv(string fileName);
+
+ private:
+  Profiler();
+
+  struct Frame {
+    unsigned long number;
+    vector<ProfileSample> samples;
+  };
+
+  struct GpuQuery {
+    unsigned int id;
+    const char* name;
+    unsigned long frame;
+    unsigned long long start;
+  };
+
+  static bool bEnabled;
+  vector<Frame> frames;
+  unsigned long currentFrame;
+  // Last frame the main thread recorded in
+  unsigned long appFrame;
+  std::deque<std::string> labels;
+  std::map<std::string, int> labelIndices;
+  // Guards frames and labels, the GPU queries are main thread only
+  ofMutex mutex;
+
+  bool bGpuSupported;
+  bool bGpuChecked;
+  bool bGpuActive;
+  vector<unsigned int> freeQueries;
+  std::deque<GpuQuery> pendingQueries;
+
+  // Both expect the mutex to be locked
+  Frame& getFrame(unsigned long number);
+  void collectGpuQueries();
+  bool checkGpuSupport();
+};
+
+class ProfileScope {
+ public:
+  ProfileScope(const char* newCategory, const char* newName,
+               int newIndex = -1, const std::string* labelString = NULL) {
+    if (!Profiler::isEnabled()) {
+      name = NULL;
+      return;
+    }
+    category = newCategory;
+    name = newName;
+    index = newIndex;
+    label = labelString != NULL ? Profiler::instance().addLabel(*labelString)
+                                : -1;
+    start = ofGetElapsedTimeMicros();
+  }
+
+  ~ProfileScope() {
+    if (name == NULL) return;
+    Profiler::instance().record(category, name, index, label, start,
+                                ofGetElapsedTimeMicros());
+  }
+
+ private:
+  const char* category;
+  const char* name;
+  int index;
+  int label;
+  unsigned long long start;
+};
+
+class GpuProfileScope {
+ public:
+  GpuProfileScope(const char* name) {
+    bActive = Profiler::isEnabled();
+    if (bActive) Profiler::instance().beginGpu(name);
+  }
+
+  ~GpuProfileScope() {
+    if (bActive) Profiler::instance().endGpu();
+  }
+
+ private:
+  bool bActive;
+};
+}
+}
@@ -0,0 +1,139 @@
+#include "RenderStats.h"
+#include "EtcCodec.h"
+
+namespace ofx {
+namespace piMapper {
+RenderCounters::RenderCounters() {
+  textureBinds = 0;
+  textureUnbinds = 0;
+  drawCalls = 0;
+  vertices = 0;
+  geometryUploads = 0;
+  geometryUploadVertices = 0;
+  textureUploads = 0;
+  textureUploadBytes = 0;
+}
+
+RenderStats& RenderStats::instance() {
+  static RenderStats renderStats;
+  return renderStats;
+}
+
+RenderStats::RenderStats() {
+  frameNumber = 0;
+  bOwnFrames = false;
+  ownFrameNumber = 0;
+}
+
+void RenderStats::countBind() {
+  mutex.lock();
+  checkFrame();
+  current.textureBinds++;
+  mutex.unlock();
+}
+
+void RenderStats::countUnbind() {
+  mutex.lock();
+  checkFrame();
+  current.textureUnbinds++;
+  mutex.unlock();
+}
+
+void RenderStats::countDraw(int numVertices) {
+  mutex.lock();
+  checkFrame();
+  current.drawCalls++;
+  current.vertices += numVertices;
+  mutex.unlock();
+}
+
+void RenderStats::countGeometryUpload(int numVertices) {
+  mutex.lock();
+  checkFrame();
+  current.geometryUploads++;
+  current.geometryUploadVertices += numVertices;
+  mutex.unlock();
+}
+
+void RenderStats::countTextureUpload(unsigned long long numBytes) {
+  mutex.lock();
+  checkFrame();
+  current.textureUploads++;
+  current.textureUploadBytes += numBytes;
+  mutex.unlock();
+}
+
+RenderCounters RenderStats::getLastFrame() {
+  mutex.lock();
+  checkFrame();
+  RenderCounters counters = last;
+  mutex.unlock();
+  return counters;
+}
+
+RenderCounters RenderStats::getCurrentFrame() {
+  mutex.lock();
+  checkFrame();
+  RenderCounters counters = current;
+  mutex.unlock();
+  return counters;
+}
+
+void RenderStats::nextFrame() {
+  mutex.lock();
+  if (!bOwnFrames) {
+    bOwnFrames = true;
+    ownFrameNumber = frameNumber;
+  }
+  ownFrameNumber++;
+  mutex.unlock();
+}
+
+void RenderStats::useAppFrames() {
+  mutex.lock();
+  bOwnFrames = false;
+  mutex.unlock();
+}
+
+unsigned long long RenderStats::getTextureMemory(ofTexture* texture) {
+  if (texture == NULL || !texture->isAllocated()) return 0;
+  ofTextureData& data = texture->getTextureData();
+
+  // tex_w and tex_h are the allocated size, also for non power of two
+  // textures emulated with a larger power of two one
+  unsigned long long width = data.tex_w;
+  unsigned long long height = data.tex_h;
+  // Compressed ones are blocks of 4x4 pixels
+  if (EtcCodec::isFormat(data.glTypeInternal)) {
+    return EtcCodec::getDataSize(data.glTypeInternal, width, height);
+  }
+
+  int bytesPerPixel;
+  switch (data.glTypeInternal) {
+    case GL_LUMINANCE:
+      bytesPerPixel = 1;
+      break;
+    case GL_LUMINANCE_ALPHA:
+      bytesPerPixel = 2;
+      break;
+    case GL_RGB:
+    case GL_RGB8:
+      bytesPerPixel = 3;
+      break;
+    default:
+      bytesPerPixel = 4;
+      break;
+  }
+  return width * height * bytesPerPixel;
+}
+
+void RenderStats::checkFrame() {
+  unsigned long frame = bOwnFrames ? ownFrameNumber : ofGetFrameNum();
+  if (frame == frameNumber) return;
+  // Nothing counted during a frame still counts as a frame
+  last = frame == frameNumber + 1 ? current : RenderCounters();
+  current = RenderCounters();
+  frameNumber = frame;
+}
+}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Counting is cheap, but it can be compiled out with PIMAPPER_NO_RENDER_STATS
+#ifdef PIMAPPER_NO_RENDER_STATS
+#define PIMAPPER_COUNT_BIND()
+#define PIMAPPER_COUNT_UNBIND()
+#define PIMAPPER_COUNT_DRAW(numVertices)
+#define PIMAPPER_COUNT_GEOMETRY_UPLOAD(numVertices)
+#define PIMAPPER_COUNT_TEXTURE_UPLOAD(numBytes)
+#else
+#define PIMAPPER_COUNT_BIND() \
+  ofx::piMapper::RenderStats::instance().countBind()
+#define PIMAPPER_COUNT_UNBIND() \
+  ofx::piMapper::RenderStats::instance().countUnbind()
+#define PIMAPPER_COUNT_DRAW(numVertices) \
+  ofx::piMapper::RenderStats::instance().countDraw(numVertices)
+#define PIMAPPER_COUNT_GEOMETRY_UPLOAD(numVertices) \
+  ofx::piMapper::RenderStats::instance().countGeometryUpload(numVertices)
+#define PIMAPPER_COUNT_TEXTURE_UPLOAD(numBytes) \
+  ofx::piMapper::RenderStats::instance().countTextureUpload(numBytes)
+#endif
+
+namespace ofx {
+namespace piMapper {
+struct RenderCounters {
+  RenderCounters();
+
+  int textureBinds;
+  int textureUnbinds;
+  int drawCalls;
+  int vertices;
+  int geometryUploads;
+  int geometryUploadVertices;
+  int textureUploads;
+  unsigned long long textureUploadBytes;
+};
+
+// Counts GL work per frame. Counters of the frame being drawn are
+// reset when the first count of the next frame comes in. Counting is
+// safe from any thread, uploads on the main thread go into the frame
+// the render thread draws while it runs.
+class RenderStats {
+ public:
+  static RenderStats& instance();
+
+  void countBind();
+  void countUnbind();
+  void countDraw(int numVertices);
+  void countGeometryUpload(int numVertices);
+  void countTextureUpload(unsigned long long numBytes);
+
+  // Counters of the last complete frame
+  RenderCounters getLastFrame();
+  // Counters of the frame so far
+  RenderCounters getCurrentFrame();
+
+  // Frames are those of ofGetFrameNum, until a render thread calls
+  // nextFrame before each frame it draws. useAppFrames goes back.
+  void nextFrame();
+  void useAppFrames();
+
+  // Memory taken by the texture on the GPU in bytes, including padding
+  static unsigned long long getTextureMemory(ofTexture* texture);
+
+ private:
+  RenderStats();
+
+  unsigned long frameNumber;
+  bool bOwnFrames;
+  unsigned long ownFrameNumber;
+  RenderCounters current;
+  RenderCounters last;
+  ofMutex mutex;
+
+  void checkFrame();
+};
+}
+}
@@ -0,0 +1,78 @@
+#include "StatsHud.h"
+#include "VideoSource.h"
+#include "ImageSource.h"
+#include "TiledImageSource.h"
+
+namespace ofx {
+namespace piMapper {
+StatsHud::StatsHud() { surfaceManager = NULL; }
+
+void StatsHud::setSurfaceManager(SurfaceManager* newSurfaceManager) {
+  surfaceManager = newSurfaceManager;
+}
+
+void StatsHud::draw(int x, int y) {
+  ofDrawBitmapStringHighlight(getText(), x, y, ofColor(0, 0, 0, 200),
+                              ofColor(0, 255, 0, 255));
+}
+
+string StatsHud::getText() {
+  RenderCounters counters = RenderStats::instance().getLastFrame();
+
+  stringstream ss;
+  ss << "fps: " << ofGetFrameRate() << "\n";
+  ss << "draw calls: " << counters.drawCalls << " (" << counters.vertices
+     << " vertices)\n";
+  ss << "texture binds/unbinds: " << counters.textureBinds << "/"
+     << counters.textureUnbinds << "\n";
+  ss << "geometry uploads: " << counters.geometryUploads << " ("
+     << counters.geometryUploadVertices << " vertices)\n";
+  ss << "texture uploads: " << counters.textureUploads << " ("
+     << counters.textureUploadBytes / 1024 << " KB)\n";
+
+  if (surfaceManager == NULL) return ss.str();
+
+  // Sources are shared between surfaces, count each texture once
+  std::map<ofTexture*, BaseSource*> textures;
+  for (int i = 0; i < surfaceManager->size(); i++) {
+    BaseSource* source = surfaceManager->getSurface(i)->getSource();
+    if (source->getTexture() != NULL) {
+      textures[source->getTexture()] = source;
+    }
+  }
+
+  unsigned long long total = 0;
+  std::map<ofTexture*, BaseSource*>::iterator it;
+  for (it = textures.begin(); it != textures.end(); it++) {
+    // Atlas pages are counted whole
+    unsigned long long memory = RenderStats::getTextureMemory(it->first);
+    // The texture of tiled images is the preview, windows come on top
+    if (it->second->getType() == SourceType::SOURCE_TYPE_TILED) {
+      memory = it->second->getTextureMemory();
+    }
+    string name = it->second->getName();
+    if (it->second->getType() == SourceType::SOURCE_TYPE_IMAGE &&
+        static_cast<ImageSource*>(it->second)->isPacked()) {
+      name = "atlas page";
+    }
+    ss << (name == "" ? "default" : name) << ": " << memory / 1024
+       << " KB";
+    if (it->second->getType() == SourceType::SOURCE_TYPE_VIDEO) {
+      VideoSync& sync = static_cast<VideoSource*>(it->second)->getSync();
+      ss << ", sync " << (int)(sync.getError() * 1000.0) << " ms";
+    }
+    if (it->second->getType() == SourceType::SOURCE_TYPE_TILED) {
+      TiledImageSource* tiledSource =
+          static_cast<TiledImageSource*>(it->second);
+      ss << " with " << tiledSource->getNumWindows() << " windows, "
+         << tiledSource->getNumResidentTiles() << "/"
+         << tiledSource->getNumTiles() << " tiles in memory";
+    }
+    ss << "\n";
+    total += memory;
+  }
+  ss << "texture memory: " << total / 1024 << " KB";
+  return ss.str();
+}
+}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofMain.h"
+#include "RenderStats.h"
+#include "SurfaceManager.h"
+
+namespace ofx {
+namespace piMapper {
+// On-screen overlay with the render counters of the last frame and
+// the texture memory used by the sources of all surfaces
+class StatsHud {
+ public:
+  StatsHud();
+
+  void setSurfaceManager(SurfaceManager* newSurfaceManager);
+  void draw(int x, int y);
+  string getText();
+
+ private:
+  SurfaceManager* surfaceManager;
+};
+}
+}
@@ -0,0 +1,497 @@
+#include "EtcCodec.h"
+#include <climits>
+
+namespace ofx {
+namespace piMapper {
+// Intensity modifiers of ETC1, the small and the large one of each table
+static const int etcModifiers[8][2] = {{2, 8},   {5, 17},  {9, 29},
+                                       {13, 42}, {18, 60}, {24, 80},
+                                       {33, 106}, {47, 183}};
+// Distances of the T and H modes of ETC2
+static const int etcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+// Alpha modifiers of EAC, the first four are negative
+static const int eacModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+// EAC table with a modifier of 0 at this index, for blocks of one alpha
+#define EAC_FLAT_TABLE 13
+#define EAC_FLAT_INDEX 4
+
+// Pixels of a block are numbered by column, pixel x, y is x * 4 + y
+struct EtcBlock {
+  int colors[16][3];
+  int alphas[16];
+};
+
+static int clampByte(int value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Blocks are big endian
+static unsigned int readUInt32(const unsigned char* data) {
+  return ((unsigned int)data[0] << 24) | ((unsigned int)data[1] << 16) |
+         ((unsigned int)data[2] << 8) | (unsigned int)data[3];
+}
+
+static void writeUInt32(unsigned char* data, unsigned int value) {
+  for (int i = 0; i < 4; i++) {
+    data[i] = (value >> (24 - i * 8)) & 0xff;
+  }
+}
+
+// Index values 0 to 3 add the small, add the large, subtract the small
+// and subtract the large modifier of a table
+static int getModifier(int table, int index) {
+  int modifier = etcModifiers[table][index & 1];
+  return index & 2 ? -modifier : modifier;
+}
+
+// Most significant bits of the indices are in the upper half
+static int getPixelIndex(unsigned int low, int pixel) {
+  return (((low >> (16 + pixel)) & 1) << 1) | ((low >> pixel) & 1);
+}
+
+// Halves are side by side, or on top of each other if flipped
+static int getHalf(int pixel, bool bFlip) {
+  return (bFlip ? pixel % 4 : pixel / 4) >= 2 ? 1 : 0;
+}
+
+static int getColorError(const int* color, const int* base, int modifier) {
+  int error = 0;
+  for (int c = 0; c < 3; c++) {
+    int difference = clampByte(base[c] + modifier) - color[c];
+    error += difference * difference;
+  }
+  return error;
+}
+
+static void readBlock(ofPixels& pixels, int left, int top, EtcBlock& block) {
+  int width = pixels.getWidth();
+  int height = pixels.getHeight();
+  int channels = pixels.getNumChannels();
+  const unsigned char* data = pixels.getPixels();
+  for (int x = 0; x < 4; x++) {
+    for (int y = 0; y < 4; y++) {
+      int sourceX = std::min(left + x, width - 1);
+      int sourceY = std::min(top + y, height - 1);
+      const unsigned char* pixel =
+          data + ((size_t)sourceY * width + sourceX) * channels;
+      int i = x * 4 + y;
+      for (int c = 0; c < 3; c++) {
+        block.colors[i][c] = channels < 3 ? pixel[0] : pixel[c];
+      }
+      if (channels == 2 || channels == 4) {
+        block.alphas[i] = pixel[channels - 1];
+      } else {
+        block.alphas[i] = 255;
+      }
+    }
+  }
+}
+
+// Picks the table with the least error for one half around its base
+// color, sets the indices of its pixels and returns the error
+static int fitTable(EtcBlock& block, bool bFlip, int half, const int* base,
+                    int& table, int* indices) {
+  int bestError = INT_MAX;
+  for (int t = 0; t < 8; t++) {
+    int error = 0;
+    int tableIndices[16];
+    for (int i = 0; i < 16 && error < bestError; i++) {
+      if (getHalf(i, bFlip) != half) continue;
+      int bestPixelError = INT_MAX;
+      for (int index = 0; index < 4; index++) {
+        int pixelError =
+            getColorError(block.colors[i], base, getModifier(t, index));
+        if (pixelError < bestPixelError) {
+          bestPixelError = pixelError;
+          tableIndices[i] = index;
+        }
+      }
+      error += bestPixelError;
+    }
+    if (error < bestError) {
+      bestError = error;
+      table = t;
+      for (int i = 0; i < 16; i++) {
+        if (getHalf(i, bFlip) == half) indices[i] = tableIndices[i];
+      }
+    }
+  }
+  return bestError;
+}
+
+static unsigned int packIndices(int* indices) {
+  unsigned int low = 0;
+  for (int i = 0; i < 16; i++) {
+    low |= ((indices[i] >> 1) & 1) << (16 + i);
+    low |= (indices[i] & 1) << i;
+  }
+  return low;
+}
+
+// Tries both orientations of the halves, each with 5 bit base colors
+// close to each other and with independent 4 bit ones. The base colors
+// are the averages of the halves.
+static void encodeColorBlock(EtcBlock& block, unsigned char* output) {
+  int bestError = INT_MAX;
+  unsigned int bestHigh = 0;
+  unsigned int bestLow = 0;
+  for (int flip = 0; flip < 2; flip++) {
+    float averages[2][3] = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+    for (int i = 0; i < 16; i++) {
+      for (int c = 0; c < 3; c++) {
+        averages[getHalf(i, flip)][c] += block.colors[i][c] / 8.0f;
+      }
+    }
+
+    // The second color is stored as a difference of -4 to 3
+    int first[3];
+    int deltas[3];
+    int bases[2][3];
+    for (int c = 0; c < 3; c++) {
+      first[c] = (int)(averages[0][c] * 31.0f / 255.0f + 0.5f);
+      int second = (int)(averages[1][c] * 31.0f / 255.0f + 0.5f);
+      deltas[c] = ofClamp(second - first[c], -4, 3);
+      second = first[c] + deltas[c];
+      bases[0][c] = (first[c] << 3) | (first[c] >> 2);
+      bases[1][c] = (second << 3) | (second >> 2);
+    }
+    int tables[2];
+    int indices[16];
+    int error = fitTable(block, flip, 0, bases[0], tables[0], indices);
+    if (error < bestError) {
+      error += fitTable(block, flip, 1, bases[1], tables[1], indices);
+    }
+    if (error < bestError) {
+      bestError = error;
+      bestHigh = (tables[0] << 5) | (tables[1] << 2) | 2 | flip;
+      for (int c = 0; c < 3; c++) {
+        bestHigh |= first[c] << (27 - c * 8);
+        bestHigh |= (deltas[c] & 7) << (24 - c * 8);
+      }
+      bestLow = packIndices(indices);
+    }
+
+    int colors[2][3];
+    for (int half = 0; half < 2; half++) {
+      for (int c = 0; c < 3; c++) {
+        colors[half][c] = (int)(averages[half][c] * 15.0f / 255.0f + 0.5f);
+        bases[half][c] = colors[half][c] * 17;
+      }
+    }
+    error = fitTable(block, flip, 0, bases[0], tables[0], indices);
+    if (error < bestError) {
+      error += fitTable(block, flip, 1, bases[1], tables[1], indices);
+    }
+    if (error < bestError) {
+      bestError = error;
+      bestHigh = (tables[0] << 5) | (tables[1] << 2) | flip;
+      for (int c = 0; c < 3; c++) {
+        bestHigh |= colors[0][c] << (28 - c * 8);
+        bestHigh |= colors[1][c] << (24 - c * 8);
+      }
+      bestLow = packIndices(indices);
+    }
+  }
+  writeUInt32(output, bestHigh);
+  writeUInt32(output + 4, bestLow);
+}
+
+// Tries every table with the multiplier spreading it over the range of
+// the block and the base centering it
+static void encodeAlphaBlock(EtcBlock& block, unsigned char* output) {
+  int minAlpha = 255;
+  int maxAlpha = 0;
+  for (int i = 0; i < 16; i++) {
+    minAlpha = std::min(minAlpha, block.alphas[i]);
+    maxAlpha = std::max(maxAlpha, block.alphas[i]);
+  }
+  int bestBase = minAlpha;
+  int bestMultiplier = 1;
+  int bestTable = EAC_FLAT_TABLE;
+  int bestIndices[16];
+  std::fill(bestIndices, bestIndices + 16, EAC_FLAT_INDEX);
+
+  if (minAlpha != maxAlpha) {
+    int bestError = INT_MAX;
+    for (int t = 0; t < 16 && bestError > 0; t++) {
+      int low = eacModifiers[t][3];
+      int high = eacModifiers[t][7];
+      int spread = (int)((float)(maxAlpha - minAlpha) / (high - low) + 0.5f);
+      for (int m = spread - 1; m <= spread + 1; m++) {
+        if (m < 1 || m > 15) continue;
+        int base = clampByte(
+            (int)((minAlpha + maxAlpha) / 2.0f - (low + high) * m / 2.0f +
+                  0.5f));
+        int error = 0;
+        int indices[16];
+        for (int i = 0; i < 16 && error < bestError; i++) {
+          int bestPixelError = INT_MAX;
+          for (int index = 0; index < 8; index++) {
+            int difference = clampByte(base + eacModifiers[t][index] * m) -
+                             block.alphas[i];
+            if (difference * difference < bestPixelError) {
+              bestPixelError = difference * difference;
+              indices[i] = index;
+            }
+          }
+          error += bestPixelError;
+        }
+        if (error < bestError) {
+          bestError = error;
+          bestBase = base;
+          bestMultiplier = m;
+          bestTable = t;
+          std::copy(indices, indices + 16, bestIndices);
+        }
+      }
+    }
+  }
+
+  output[0] = bestBase;
+  output[1] = (bestMultiplier << 4) | bestTable;
+  unsigned long long bits = 0;
+  for (int i = 0; i < 16; i++) {
+    bits |= (unsigned long long)bestIndices[i] << (45 - i * 3);
+  }
+  for (int i = 0; i < 6; i++) {
+    output[2 + i] = (bits >> (40 - i * 8)) & 0xff;
+  }
+}
+
+// Two colors, the second one spread apart by a distance
+static void decodeTBlock(unsigned int high, unsigned int low,
+                         int colors[16][3]) {
+  int first[3] = {(int)((((high >> 27) & 3) << 2) | ((high >> 24) & 3)),
+                  (int)((high >> 20) & 15), (int)((high >> 16) & 15)};
+  int second[3] = {(int)((high >> 12) & 15), (int)((high >> 8) & 15),
+                   (int)((high >> 4) & 15)};
+  int distance = etcDistances[(((high >> 2) & 3) << 1) | (high & 1)];
+  int paints[4][3];
+  for (int c = 0; c < 3; c++) {
+    paints[0][c] = first[c] * 17;
+    paints[1][c] = clampByte(second[c] * 17 + distance);
+    paints[2][c] = second[c] * 17;
+    paints[3][c] = clampByte(second[c] * 17 - distance);
+  }
+  for (int i = 0; i < 16; i++) {
+    int index = getPixelIndex(low, i);
+    for (int c = 0; c < 3; c++) {
+      colors[i][c] = paints[index][c];
+    }
+  }
+}
+
+// Two colors, both spread apart by a distance
+static void decodeHBlock(unsigned int high, unsigned int low,
+                         int colors[16][3]) {
+  int first[3] = {(int)((high >> 27) & 15),
+                  (int)((((high >> 24) & 7) << 1) | ((high >> 20) & 1)),
+                  (int)((((high >> 19) & 1) << 3) | ((high >> 15) & 7))};
+  int second[3] = {(int)((high >> 11) & 15), (int)((high >> 7) & 15),
+                   (int)((high >> 3) & 15)};
+  // The last bit of the distance is in the order of the colors
+  int firstValue = (first[0] << 8) | (first[1] << 4) | first[2];
+  int secondValue = (second[0] << 8) | (second[1] << 4) | second[2];
+  int distance = etcDistances[(((high >> 2) & 1) << 2) | ((high & 1) << 1) |
+                              (firstValue >= secondValue ? 1 : 0)];
+  int paints[4][3];
+  for (int c = 0; c < 3; c++) {
+    paints[0][c] = clampByte(first[c] * 17 + distance);
+    paints[1][c] = clampByte(first[c] * 17 - distance);
+    paints[2][c] = clampByte(second[c] * 17 + distance);
+    paints[3][c] = clampByte(second[c] * 17 - distance);
+  }
+  for (int i = 0; i < 16; i++) {
+    int index = getPixelIndex(low, i);
+    for (int c = 0; c < 3; c++) {
+      colors[i][c] = paints[index][c];
+    }
+  }
+}
+
+// Colors at the origin, the right and the bottom edge, interpolated
+static void decodePlanarBlock(unsigned int high, unsigned int low,
+                              int colors[16][3]) {
+  int origin[3] = {
+      (int)((high >> 25) & 63),
+      (int)((((high >> 24) & 1) << 6) | ((high >> 17) & 63)),
+      (int)((((high >> 16) & 1) << 5) | (((high >> 11) & 3) << 3) |
+            ((high >> 7) & 7))};
+  int horizontal[3] = {(int)((((high >> 2) & 31) << 1) | (high & 1)),
+                       (int)((low >> 25) & 127), (int)((low >> 19) & 63)};
+  int vertical[3] = {(int)((low >> 13) & 63), (int)((low >> 6) & 127),
+                     (int)(low & 63)};
+  // Red and blue have 6 bits, green 7
+  for (int c = 0; c < 3; c++) {
+    if (c == 1) {
+      origin[c] = (origin[c] << 1) | (origin[c] >> 6);
+      horizontal[c] = (horizontal[c] << 1) | (horizontal[c] >> 6);
+      vertical[c] = (vertical[c] << 1) | (vertical[c] >> 6);
+    } else {
+      origin[c] = (origin[c] << 2) | (origin[c] >> 4);
+      horizontal[c] = (horizontal[c] << 2) | (horizontal[c] >> 4);
+      vertical[c] = (vertical[c] << 2) | (vertical[c] >> 4);
+    }
+  }
+  for (int i = 0; i < 16; i++) {
+    int x = i / 4;
+    int y = i % 4;
+    for (int c = 0; c < 3; c++) {
+      colors[i][c] = clampByte((x * (horizontal[c] - origin[c]) +
+                                y * (vertical[c] - origin[c]) +
+                                4 * origin[c] + 2) >> 2);
+    }
+  }
+}
+
+// ETC1 blocks and the differential blocks of ETC2 that overflow, which
+// select the T, H and planar modes. ETC1 encoders never write those.
+static void decodeColorBlock(const unsigned char* input, int colors[16][3]) {
+  unsigned int high = readUInt32(input);
+  unsigned int low = readUInt32(input + 4);
+  bool bFlip = high & 1;
+  int bases[2][3];
+  if (high & 2) {
+    for (int c = 0; c < 3; c++) {
+      int first = (high >> (27 - c * 8)) & 31;
+      int delta = (high >> (24 - c * 8)) & 7;
+      int second = first + (delta >= 4 ? delta - 8 : delta);
+      if (second < 0 || second > 31) {
+        if (c == 0) {
+          decodeTBlock(high, low, colors);
+        } else if (c == 1) {
+          decodeHBlock(high, low, colors);
+        } else {
+          decodePlanarBlock(high, low, colors);
+        }
+        return;
+      }
+      bases[0][c] = (first << 3) | (first >> 2);
+      bases[1][c] = (second << 3) | (second >> 2);
+    }
+  } else {
+    for (int c = 0; c < 3; c++) {
+      bases[0][c] = ((high >> (28 - c * 8)) & 15) * 17;
+      bases[1][c] = ((high >> (24 - c * 8)) & 15) * 17;
+    }
+  }
+  int tables[2] = {(int)((high >> 5) & 7), (int)((high >> 2) & 7)};
+  for (int i = 0; i < 16; i++) {
+    int half = getHalf(i, bFlip);
+    int modifier = getModifier(tables[half], getPixelIndex(low, i));
+    for (int c = 0; c < 3; c++) {
+      colors[i][c] = clampByte(bases[half][c] + modifier);
+    }
+  }
+}
+
+static void decodeAlphaBlock(const unsigned char* input, int* alphas) {
+  int base = input[0];
+  int multiplier = input[1] >> 4;
+  int table = input[1] & 15;
+  unsigned long long bits = 0;
+  for (int i = 0; i < 6; i++) {
+    bits = (bits << 8) | input[2 + i];
+  }
+  for (int i = 0; i < 16; i++) {
+    int index = (bits >> (45 - i * 3)) & 7;
+    alphas[i] = clampByte(base + eacModifiers[table][index] * multiplier);
+  }
+}
+
+int EtcCodec::encode(ofPixels& pixels, vector<unsigned char>& data) {
+  data.clear();
+  if (!pixels.isAllocated()) return 0;
+  int width = pixels.getWidth();
+  int height = pixels.getHeight();
+  int channels = pixels.getNumChannels();
+
+  // Opaque images do not need the alpha blocks
+  bool bAlpha = false;
+  if (channels == 2 || channels == 4) {
+    const unsigned char* source = pixels.getPixels();
+    size_t numPixels = (size_t)width * height;
+    for (size_t i = 0; i < numPixels && !bAlpha; i++) {
+      bAlpha = source[i * channels + channels - 1] != 255;
+    }
+  }
+  int format = bAlpha ? GL_COMPRESSED_RGBA8_ETC2_EAC : GL_ETC1_RGB8_OES;
+
+  data.resize(getDataSize(format, width, height));
+  unsigned char* output = &data[0];
+  EtcBlock block;
+  for (int top = 0; top < height; top += 4) {
+    for (int left = 0; left < width; left += 4) {
+      readBlock(pixels, left, top, block);
+      // Alpha comes first in EAC blocks
+      if (bAlpha) {
+        encodeAlphaBlock(block, output);
+        output += 8;
+      }
+      encodeColorBlock(block, output);
+      output += 8;
+    }
+  }
+  return format;
+}
+
+bool EtcCodec::decode(const unsigned char* data, size_t size, int format,
+                      int width, int height, ofPixels& pixels) {
+  if (!isFormat(format) || width <= 0 || height <= 0 ||
+      size < getDataSize(format, width, height)) {
+    return false;
+  }
+  bool bAlpha = hasAlpha(format);
+  int channels = bAlpha ? 4 : 3;
+  pixels.allocate(width, height, channels);
+  unsigned char* target = pixels.getPixels();
+  int colors[16][3];
+  int alphas[16];
+  for (int top = 0; top < height; top += 4) {
+    for (int left = 0; left < width; left += 4) {
+      if (bAlpha) {
+        decodeAlphaBlock(data, alphas);
+        data += 8;
+      }
+      decodeColorBlock(data, colors);
+      data += 8;
+      for (int y = 0; y < 4 && top + y < height; y++) {
+        for (int x = 0; x < 4 && left + x < width; x++) {
+          unsigned char* pixel =
+              target + ((size_t)(top + y) * width + left + x) * channels;
+          int i = x * 4 + y;
+          for (int c = 0; c < 3; c++) {
+            pixel[c] = colors[i][c];
+          }
+          if (bAlpha) pixel[3] = alphas[i];
+        }
+      }
+    }
+  }
+  return true;
+}
+
+size_t EtcCodec::getDataSize(int format, int width, int height) {
+  if (!isFormat(format) || width <= 0 || height <= 0) return 0;
+  size_t numBlocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+  return numBlocks * (hasAlpha(format) ? 16 : 8);
+}
+
+bool EtcCodec::isFormat(int format) {
+  return format == GL_ETC1_RGB8_OES || format == GL_COMPRESSED_RGB8_ETC2 ||
+         format == GL_COMPRESSED_RGBA8_ETC2_EAC;
+}
+
+bool EtcCodec::hasAlpha(int format) {
+  return format == GL_COMPRESSED_RGBA8_ETC2_EAC;
+}
+}
+}
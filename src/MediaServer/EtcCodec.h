@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Block formats, GL headers that know them define the same values
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+namespace ofx {
+namespace piMapper {
+// Compresses pixels into ETC blocks of 4x4 pixels the GPU samples without
+// unpacking them. Opaque images become ETC1, half a byte per pixel, which
+// the VideoCore IV of the Pi reads and ETC2 decoders read as well. Images
+// with alpha become ETC2 color blocks plus EAC alpha blocks, one byte per
+// pixel. Plain C++, so it runs anywhere, decoding included.
+class EtcCodec {
+ public:
+  // Returns the format of the blocks written to data, 0 if pixels are
+  // empty. Edge blocks of sizes that are no multiple of 4 repeat the last
+  // row and column.
+  static int encode(ofPixels& pixels, vector<unsigned char>& data);
+  // Unpacks ETC1, ETC2 and ETC2 EAC blocks into RGB or RGBA pixels. False
+  // for other formats or too little data.
+  static bool decode(const unsigned char* data, size_t size, int format,
+                     int width, int height, ofPixels& pixels);
+  // Bytes of the blocks of an image, 0 for unknown formats
+  static size_t getDataSize(int format, int width, int height);
+  static bool isFormat(int format);
+  static bool hasAlpha(int format);
+};
+}
+}
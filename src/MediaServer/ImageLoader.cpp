@@ -0,0 +1,111 @@
+#include "ImageLoader.h"
+#include "ImageScaler.h"
+
+namespace ofx {
+namespace piMapper {
+ImageLoader::ImageLoader() {
+  bCurrentCancelled = false;
+  maxSize = 0;
+  currentMaxSize = 0;
+}
+
+ImageLoader::~ImageLoader() { stop(); }
+
+void ImageLoader::load(std::string path, ofRectangle crop) {
+  lock();
+  if (std::find(pendingPaths.begin(), pendingPaths.end(), path) !=
+      pendingPaths.end()) {
+    pendingCrops[path] = crop;
+  } else if (currentPath != path || bCurrentCancelled) {
+    pendingPaths.push_back(path);
+    pendingCrops[path] = crop;
+  }
+  unlock();
+  wake();
+}
+
+void ImageLoader::cancel(std::string path) {
+  lock();
+  std::deque<std::string>::iterator it =
+      std::find(pendingPaths.begin(), pendingPaths.end(), path);
+  if (it != pendingPaths.end()) {
+    pendingPaths.erase(it);
+  }
+  pendingCrops.erase(path);
+  if (currentPath == path) {
+    bCurrentCancelled = true;
+  }
+  for (int i = 0; i < loadedImages.size(); i++) {
+    if (loadedImages[i].path == path) {
+      loadedImages.erase(loadedImages.begin() + i);
+      break;
+    }
+  }
+  unlock();
+}
+
+bool ImageLoader::isLoading(std::string path) {
+  lock();
+  bool loading =
+      (currentPath == path && !bCurrentCancelled) ||
+      std::find(pendingPaths.begin(), pendingPaths.end(), path) !=
+          pendingPaths.end();
+  for (int i = 0; !loading && i < loadedImages.size(); i++) {
+    loading = loadedImages[i].path == path;
+  }
+  unlock();
+  return loading;
+}
+
+void ImageLoader::getLoaded(vector<LoadedImage>& images) {
+  images.clear();
+  lock();
+  images.insert(images.end(), loadedImages.begin(), loadedImages.end());
+  loadedImages.clear();
+  unlock();
+}
+
+void ImageLoader::setMaxSize(int size) {
+  lock();
+  maxSize = size;
+  unlock();
+}
+
+bool ImageLoader::takeTask() {
+  if (!pendingPaths.size()) return false;
+  currentImage = LoadedImage();
+  currentImage.path = pendingPaths.front();
+  pendingPaths.pop_front();
+  currentImage.crop = pendingCrops[currentImage.path];
+  pendingCrops.erase(currentImage.path);
+  currentPath = currentImage.path;
+  bCurrentCancelled = false;
+  currentMaxSize = maxSize;
+  return true;
+}
+
+void ImageLoader::runTask() {
+  currentImage.success = ofLoadImage(currentImage.pixels, currentImage.path);
+  if (currentImage.success) {
+    // Crop first, the part kept may not need scaling
+    ImageScaler::crop(currentImage.pixels, currentImage.crop);
+    ImageScaler::fit(currentImage.pixels, currentMaxSize);
+  }
+}
+
+void ImageLoader::finishTask() {
+  if (!bCurrentCancelled) {
+    loadedImages.push_back(currentImage);
+  }
+  currentImage = LoadedImage();
+  currentPath = "";
+  bCurrentCancelled = false;
+}
+
+void ImageLoader::clearTasks() {
+  // Queued images are not needed anymore
+  pendingPaths.clear();
+  pendingCrops.clear();
+}
+}
+}
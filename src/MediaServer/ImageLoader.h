@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BackgroundWorker.h"
+
+namespace ofx {
+namespace piMapper {
+struct LoadedImage {
+  std::string path;
+  ofPixels pixels;
+  // Normalized part of the file the pixels show, see ImageScaler::crop
+  ofRectangle crop;
+  // False if the file could not be decoded
+  bool success;
+};
+
+// Decodes image files into pixels on a background thread. Textures can
+// only be created on the thread owning the GL context, so finished
+// images wait until they are collected with getLoaded.
+class ImageLoader : public BackgroundWorker {
+ public:
+  ImageLoader();
+  ~ImageLoader();
+
+  // Queue a file, only its crop changes if it is queued already
+  void load(std::string path,
+            ofRectangle crop = ofRectangle(0.0f, 0.0f, 1.0f, 1.0f));
+  // Forget a queued or decoded file, one being decoded is dropped later
+  void cancel(std::string path);
+  bool isLoading(std::string path);
+  // Move out everything decoded since the last call
+  void getLoaded(vector<LoadedImage>& images);
+  // Decoded images larger than this are scaled down on the thread,
+  // see ImageScaler::fit. 0 keeps them as they are.
+  void setMaxSize(int size);
+
+ private:
+  std::deque<std::string> pendingPaths;
+  std::map<std::string, ofRectangle> pendingCrops;
+  std::deque<LoadedImage> loadedImages;
+  std::string currentPath;
+  bool bCurrentCancelled;
+  int maxSize;
+  // Owned by the thread while the task runs
+  LoadedImage currentImage;
+  int currentMaxSize;
+
+  bool takeTask();
+  void runTask();
+  void finishTask();
+  void clearTasks();
+};
+}
+}
@@ -0,0 +1,215 @@
+#include "ImageScaler.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PIMAPPER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PIMAPPER_NEON
+#endif
+
+namespace ofx {
+namespace piMapper {
+// Source pixels covered by each target pixel and the share of each,
+// weights of target pixel i start at offsets[i]
+struct BoxWeights {
+  vector<int> firsts;
+  vector<int> counts;
+  vector<int> offsets;
+  vector<float> weights;
+};
+
+static void getBoxWeights(int sourceSize, int targetSize,
+                          BoxWeights& weights) {
+  double scale = (double)sourceSize / targetSize;
+  for (int i = 0; i < targetSize; i++) {
+    double start = i * scale;
+    double end = std::min((i + 1) * scale, (double)sourceSize);
+    int first = (int)start;
+    int last = std::min((int)ceil(end), sourceSize);
+    weights.firsts.push_back(first);
+    weights.counts.push_back(last - first);
+    weights.offsets.push_back(weights.weights.size());
+    for (int j = first; j < last; j++) {
+      double covered = std::min(end, j + 1.0) - std::max(start, (double)j);
+      weights.weights.push_back(covered / scale);
+    }
+  }
+}
+
+// Adds a row of bytes times weight to a row of floats
+static void accumulateRow(const unsigned char* source, float* sums, int length,
+                          float weight, bool bSimd) {
+  int i = 0;
+#if defined(PIMAPPER_SSE2)
+  if (bSimd) {
+    __m128 weights = _mm_set1_ps(weight);
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i*)(source + i));
+      __m128i low = _mm_unpacklo_epi8(bytes, zero);
+      __m128i high = _mm_unpackhi_epi8(bytes, zero);
+      __m128 values[4];
+      values[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+      values[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+      values[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+      values[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero));
+      for (int j = 0; j < 4; j++) {
+        float* target = sums + i + j * 4;
+        _mm_storeu_ps(target, _mm_add_ps(_mm_loadu_ps(target),
+                                         _mm_mul_ps(values[j], weights)));
+      }
+    }
+  }
+#elif defined(PIMAPPER_NEON)
+  if (bSimd) {
+    for (; i + 16 <= length; i += 16) {
+      uint8x16_t bytes = vld1q_u8(source + i);
+      uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+      uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+      float32x4_t values[4];
+      values[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(low)));
+      values[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(low)));
+      values[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(high)));
+      values[3] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(high)));
+      for (int j = 0; j < 4; j++) {
+        float* target = sums + i + j * 4;
+        vst1q_f32(target, vmlaq_n_f32(vld1q_f32(target), values[j], weight));
+      }
+    }
+  }
+#endif
+  for (; i < length; i++) {
+    sums[i] += source[i] * weight;
+  }
+}
+
+// Filters a row of RGBA floats horizontally into one target pixel
+static void storePixel4(const float* row, const float* weights, int first,
+                        int count, unsigned char* target) {
+#if defined(PIMAPPER_SSE2)
+  __m128 sum = _mm_setzero_ps();
+  for (int k = 0; k < count; k++) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + (first + k) * 4),
+                                     _mm_set1_ps(weights[k])));
+  }
+  __m128i values = _mm_cvtps_epi32(sum);
+  values = _mm_packs_epi32(values, values);
+  values = _mm_packus_epi16(values, values);
+  int packed = _mm_cvtsi128_si32(values);
+  memcpy(target, &packed, 4);
+#elif defined(PIMAPPER_NEON)
+  float32x4_t sum = vdupq_n_f32(0.0f);
+  for (int k = 0; k < count; k++) {
+    sum = vmlaq_n_f32(sum, vld1q_f32(row + (first + k) * 4), weights[k]);
+  }
+  uint32x4_t values = vcvtq_u32_f32(vaddq_f32(sum, vdupq_n_f32(0.5f)));
+  uint16x4_t halves = vqmovn_u32(values);
+  uint8x8_t bytes = vqmovn_u16(vcombine_u16(halves, halves));
+  uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+  memcpy(target, &packed, 4);
+#endif
+}
+
+bool ImageScaler::fit(ofPixels& pixels, int maxSize) {
+  int width = pixels.getWidth();
+  int height = pixels.getHeight();
+  if (maxSize <= 0 || !pixels.isAllocated() ||
+      (width <= maxSize && height <= maxSize)) {
+    return false;
+  }
+  float scale = (float)maxSize / std::max(width, height);
+  ofPixels scaled;
+  downscale(pixels, scaled, std::max(1, (int)(width * scale + 0.5f)),
+            std::max(1, (int)(height * scale + 0.5f)));
+  pixels = scaled;
+  return true;
+}
+
+bool ImageScaler::crop(ofPixels& pixels, ofRectangle& region) {
+  if (!pixels.isAllocated()) return false;
+  int width = pixels.getWidth();
+  int height = pixels.getHeight();
+  int left = ofClamp(floor(region.x * width), 0, width - 1);
+  int top = ofClamp(floor(region.y * height), 0, height - 1);
+  int right = ofClamp(ceil((region.x + region.width) * width), left + 1, width);
+  int bottom =
+      ofClamp(ceil((region.y + region.height) * height), top + 1, height);
+  if (left == 0 && top == 0 && right == width && bottom == height) {
+    region.set(0.0f, 0.0f, 1.0f, 1.0f);
+    return false;
+  }
+  ofPixels cropped;
+  pixels.cropTo(cropped, left, top, right - left, bottom - top);
+  pixels = cropped;
+  region.set((float)left / width, (float)top / height,
+             (float)(right - left) / width, (float)(bottom - top) / height);
+  return true;
+}
+
+void ImageScaler::downscale(ofPixels& source, ofPixels& target, int width,
+                            int height) {
+  resample(source, target, width, height, hasSimd());
+}
+
+void ImageScaler::downscaleScalar(ofPixels& source, ofPixels& target,
+                                  int width, int height) {
+  resample(source, target, width, height, false);
+}
+
+bool ImageScaler::hasSimd() {
+#if defined(PIMAPPER_SSE2) || defined(PIMAPPER_NEON)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ImageScaler::resample(ofPixels& source, ofPixels& target, int width,
+                           int height, bool bSimd) {
+  int sourceWidth = source.getWidth();
+  int sourceHeight = source.getHeight();
+  int channels = source.getNumChannels();
+  width = ofClamp(width, 1, sourceWidth);
+  height = ofClamp(height, 1, sourceHeight);
+  target.allocate(width, height, channels);
+
+  BoxWeights columns;
+  BoxWeights rows;
+  getBoxWeights(sourceWidth, width, columns);
+  getBoxWeights(sourceHeight, height, rows);
+
+  // Rows are averaged first, which leaves one row of floats to filter
+  // horizontally per target row
+  int rowLength = sourceWidth * channels;
+  vector<float> sums(rowLength);
+  const unsigned char* sourcePixels = source.getPixels();
+  unsigned char* targetPixels = target.getPixels();
+  for (int y = 0; y < height; y++) {
+    std::fill(sums.begin(), sums.end(), 0.0f);
+    for (int k = 0; k < rows.counts[y]; k++) {
+      accumulateRow(sourcePixels + (size_t)(rows.firsts[y] + k) * rowLength,
+                    &sums[0], rowLength, rows.weights[rows.offsets[y] + k],
+                    bSimd);
+    }
+
+    unsigned char* targetRow = targetPixels + (size_t)y * width * channels;
+    for (int x = 0; x < width; x++) {
+      const float* weights = &columns.weights[columns.offsets[x]];
+      if (bSimd && channels == 4) {
+        storePixel4(&sums[0], weights, columns.firsts[x], columns.counts[x],
+                    targetRow + x * 4);
+        continue;
+      }
+      for (int c = 0; c < channels; c++) {
+        float sum = 0.0f;
+        for (int k = 0; k < columns.counts[x]; k++) {
+          sum += sums[(columns.firsts[x] + k) * channels + c] * weights[k];
+        }
+        targetRow[x * channels + c] = std::min(sum + 0.5f, 255.0f);
+      }
+    }
+  }
+}
+}
+}
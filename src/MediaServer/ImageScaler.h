@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofx {
+namespace piMapper {
+// Prepares decoded images for the upload. Downscaling is a box filter,
+// every target pixel is the average of the source area it covers. Rows
+// are filtered with SSE2 or NEON where the compiler targets them, the
+// scalar version is the fallback and the reference for the benchmark.
+class ImageScaler {
+ public:
+  // Shrinks pixels so neither side is larger than maxSize, keeping the
+  // aspect ratio. False if they fit already or maxSize is 0.
+  static bool fit(ofPixels& pixels, int maxSize);
+  // Cuts a normalized region out of pixels, rounded outwards to whole
+  // pixels. region is set to the part actually kept. False if that is
+  // the whole image, pixels are left alone then.
+  static bool crop(ofPixels& pixels, ofRectangle& region);
+  // Sizes larger than the source are clamped to it
+  static void downscale(ofPixels& source, ofPixels& target, int width,
+                        int height);
+  static void downscaleScalar(ofPixels& source, ofPixels& target, int width,
+                              int height);
+  // True if downscale uses SSE2 or NEON
+  static bool hasSimd();
+
+ private:
+  static void resample(ofPixels& source, ofPixels& target, int width,
+                       int height, bool bSimd);
+};
+}
+}
@@ -0,0 +1,271 @@
+#include "KeyframeIndex.h"
+#include "FileUtils.h"
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+// Finds the next box of a type in [begin, end), the range of its
+// contents is returned in contentBegin and contentEnd
+static bool findBox(vector<unsigned char>& data, size_t begin, size_t end,
+                    const char* type, size_t& contentBegin,
+                    size_t& contentEnd) {
+  size_t offset = begin;
+  while (offset + 8 <= end) {
+    unsigned long long boxSize = FileUtils::readUInt32BigEndian(&data[offset]);
+    size_t headerSize = 8;
+    if (boxSize == 1) {
+      if (offset + 16 > end) return false;
+      boxSize = FileUtils::readUInt64BigEndian(&data[offset + 8]);
+      headerSize = 16;
+    } else if (boxSize == 0) {
+      boxSize = end - offset;
+    }
+    if (boxSize < headerSize || boxSize > end - offset) return false;
+    if (memcmp(&data[offset + 4], type, 4) == 0) {
+      contentBegin = offset + headerSize;
+      contentEnd = offset + boxSize;
+      return true;
+    }
+    offset += boxSize;
+  }
+  return false;
+}
+
+// Follows a path of nested boxes like "mdia/minf/stbl"
+static bool findBoxPath(vector<unsigned char>& data, size_t begin, size_t end,
+                        std::string boxPath, size_t& contentBegin,
+                        size_t& contentEnd) {
+  vector<std::string> types = ofSplitString(boxPath, "/");
+  contentBegin = begin;
+  contentEnd = end;
+  for (int i = 0; i < types.size(); i++) {
+    if (!findBox(data, contentBegin, contentEnd, types[i].c_str(),
+                 contentBegin, contentEnd)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+KeyframeIndex::KeyframeIndex() {
+  modified = 0;
+  fileSize = 0;
+  duration = 0.0;
+  frameDuration = 0.0;
+}
+
+bool KeyframeIndex::build(std::string filePath) {
+  path = filePath;
+  keyframes.clear();
+  duration = 0.0;
+  frameDuration = 0.0;
+  if (!FileUtils::getStamp(path, modified, fileSize)) return false;
+
+  vector<unsigned char> data;
+  if (!readMovieHeader(path, data)) return false;
+  size_t trackBegin = 0;
+  size_t trackEnd = 0;
+  size_t offset = 0;
+  while (findBox(data, offset, data.size(), "trak", trackBegin, trackEnd)) {
+    if (readVideoTrack(data, trackBegin, trackEnd)) return true;
+    offset = trackEnd;
+  }
+  return false;
+}
+
+bool KeyframeIndex::isEmpty() { return keyframes.empty(); }
+
+int KeyframeIndex::size() { return keyframes.size(); }
+
+double KeyframeIndex::getKeyframe(int index) {
+  if (index < 0 || index >= keyframes.size()) {
+    throw std::runtime_error("Keyframe index out of bounds.");
+  }
+  return keyframes[index];
+}
+
+double KeyframeIndex::getKeyframeBefore(double time) {
+  vector<double>::iterator it =
+      std::upper_bound(keyframes.begin(), keyframes.end(), time);
+  if (it == keyframes.begin()) return 0.0;
+  return *(it - 1);
+}
+
+double KeyframeIndex::getDuration() { return duration; }
+
+double KeyframeIndex::getFrameDuration() { return frameDuration; }
+
+std::string KeyframeIndex::getPath() { return path; }
+
+bool KeyframeIndex::isCurrent() {
+  long long currentModified = 0;
+  unsigned long long currentSize = 0;
+  return FileUtils::getStamp(path, currentModified, currentSize) &&
+         currentModified == modified && currentSize == fileSize;
+}
+
+void KeyframeIndex::save(ofxXmlSettings& xml) {
+  xml.addValue("path", path);
+  xml.addValue("modified", ofToString(modified));
+  xml.addValue("size", ofToString(fileSize));
+  xml.addValue("duration", ofToString(duration, 6));
+  xml.addValue("frame-duration", ofToString(frameDuration, 6));
+  std::string times;
+  for (int i = 0; i < keyframes.size(); i++) {
+    if (i > 0) times += ",";
+    times += ofToString(keyframes[i], 6);
+  }
+  xml.addValue("keyframes", times);
+}
+
+void KeyframeIndex::load(ofxXmlSettings& xml) {
+  path = xml.getValue("path", "");
+  std::istringstream(xml.getValue("modified", "0")) >> modified;
+  std::istringstream(xml.getValue("size", "0")) >> fileSize;
+  duration = ofToDouble(xml.getValue("duration", "0"));
+  frameDuration = ofToDouble(xml.getValue("frame-duration", "0"));
+  keyframes.clear();
+  vector<std::string> times =
+      ofSplitString(xml.getValue("keyframes", ""), ",", true);
+  for (int i = 0; i < times.size(); i++) {
+    keyframes.push_back(ofToDouble(times[i]));
+  }
+}
+
+bool KeyframeIndex::readMovieHeader(std::string filePath,
+                                    vector<unsigned char>& data) {
+  std::ifstream file(filePath.c_str(), std::ios::binary);
+  if (!file.is_open()) return false;
+
+  // Skip over the top level boxes until the movie header, it is at the
+  // end of files that were not prepared for streaming
+  unsigned long long offset = 0;
+  while (offset + 8 <= fileSize) {
+    unsigned char header[16];
+    file.seekg(offset);
+    if (!file.read((char*)header, 8)) return false;
+    unsigned long long boxSize = FileUtils::readUInt32BigEndian(header);
+    unsigned long long headerSize = 8;
+    if (boxSize == 1) {
+      if (!file.read((char*)header + 8, 8)) return false;
+      boxSize = FileUtils::readUInt64BigEndian(header + 8);
+      headerSize = 16;
+    } else if (boxSize == 0) {
+      boxSize = fileSize - offset;
+    }
+    if (boxSize < headerSize || boxSize > fileSize - offset) return false;
+
+    if (memcmp(header + 4, "moov", 4) == 0) {
+      unsigned long long contentSize = boxSize - headerSize;
+      if (contentSize > MAX_MOVIE_HEADER_SIZE) {
+        PIMAPPER_LOG_WARNING("KeyframeIndex") << "Movie header of "
+                                              << filePath << " too large";
+        return false;
+      }
+      data.resize(contentSize);
+      return contentSize == 0 || file.read((char*)&data[0], contentSize);
+    }
+    offset += boxSize;
+  }
+  return false;
+}
+
+bool KeyframeIndex::readVideoTrack(vector<unsigned char>& data, size_t begin,
+                                   size_t end) {
+  size_t contentBegin = 0;
+  size_t contentEnd = 0;
+  // Handler type follows version, flags and a predefined field
+  if (!findBoxPath(data, begin, end, "mdia/hdlr", contentBegin, contentEnd) ||
+      contentEnd - contentBegin < 12 ||
+      memcmp(&data[contentBegin + 8], "vide", 4) != 0) {
+    return false;
+  }
+
+  if (!findBoxPath(data, begin, end, "mdia/mdhd", contentBegin, contentEnd) ||
+      contentEnd - contentBegin < 24) {
+    return false;
+  }
+  // Version 1 has 64 bit creation and modification times
+  bool bVersion1 = data[contentBegin] == 1;
+  size_t timescaleOffset = contentBegin + (bVersion1 ? 20 : 12);
+  if (bVersion1 && contentEnd - contentBegin < 32) return false;
+  unsigned int timescale =
+      FileUtils::readUInt32BigEndian(&data[timescaleOffset]);
+  if (timescale == 0) return false;
+
+  size_t tableBegin = 0;
+  size_t tableEnd = 0;
+  if (!findBoxPath(data, begin, end, "mdia/minf/stbl", tableBegin,
+                   tableEnd)) {
+    return false;
+  }
+
+  // Decode time to sample table, runs of samples with the same duration
+  size_t timesBegin = 0;
+  size_t timesEnd = 0;
+  if (!findBox(data, tableBegin, tableEnd, "stts", timesBegin, timesEnd) ||
+      timesEnd - timesBegin < 8) {
+    return false;
+  }
+  unsigned int numRuns = FileUtils::readUInt32BigEndian(&data[timesBegin + 4]);
+  if (numRuns > (timesEnd - timesBegin - 8) / 8) return false;
+
+  // Sync sample table, 1 based sample numbers in ascending order. All
+  // samples are keyframes if it is missing.
+  size_t syncBegin = 0;
+  size_t syncEnd = 0;
+  bool bAllKeyframes =
+      !findBox(data, tableBegin, tableEnd, "stss", syncBegin, syncEnd);
+  unsigned int numSync = 0;
+  if (!bAllKeyframes) {
+    if (syncEnd - syncBegin < 8) return false;
+    numSync = FileUtils::readUInt32BigEndian(&data[syncBegin + 4]);
+    if (numSync > (syncEnd - syncBegin - 8) / 4) return false;
+  }
+
+  unsigned long long sampleTime = 0;
+  unsigned long long sample = 1;
+  unsigned int syncIndex = 0;
+  for (unsigned int i = 0; i < numRuns; i++) {
+    const unsigned char* run = &data[timesBegin + 8 + i * 8];
+    unsigned int count = FileUtils::readUInt32BigEndian(run);
+    unsigned int delta = FileUtils::readUInt32BigEndian(run + 4);
+    unsigned long long runEnd = sample + count;
+    // Every sample takes at least a byte of the file
+    if (runEnd - 1 > fileSize) {
+      keyframes.clear();
+      return false;
+    }
+    if (bAllKeyframes) {
+      for (; sample < runEnd; sample++) {
+        keyframes.push_back((double)sampleTime / timescale);
+        sampleTime += delta;
+      }
+      continue;
+    }
+    // Jump to the keyframes within this run
+    while (syncIndex < numSync) {
+      unsigned long long syncSample =
+          FileUtils::readUInt32BigEndian(&data[syncBegin + 8 + syncIndex * 4]);
+      if (syncSample >= runEnd) break;
+      if (syncSample >= sample) {
+        keyframes.push_back(
+            (double)(sampleTime + (syncSample - sample) * delta) / timescale);
+      }
+      syncIndex++;
+    }
+    sampleTime += (unsigned long long)count * delta;
+    sample = runEnd;
+  }
+
+  unsigned long long numSamples = sample - 1;
+  if (numSamples == 0 || keyframes.empty()) {
+    keyframes.clear();
+    return false;
+  }
+  duration = (double)sampleTime / timescale;
+  frameDuration = duration / numSamples;
+  return true;
+}
+}
+}
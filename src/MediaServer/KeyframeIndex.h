@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxXmlSettings.h"
+
+// Movie headers larger than this are not indexed, in bytes
+#define MAX_MOVIE_HEADER_SIZE 67108864
+
+namespace ofx {
+namespace piMapper {
+// Times of the keyframes of a video, read from the sync sample table of
+// the first video track of an MP4 or QuickTime file. Other containers
+// give an empty index. Times are decode times, the composition offsets
+// of reordered frames are ignored.
+class KeyframeIndex {
+ public:
+  KeyframeIndex();
+
+  // Reads the file, false if it has no usable video track. The file
+  // stamp is taken either way, so failed files are not read again.
+  bool build(std::string filePath);
+  bool isEmpty();
+  int size();
+  double getKeyframe(int index);
+  // Time of the last keyframe at or before time, 0 for an empty index
+  double getKeyframeBefore(double time);
+  double getDuration();
+  double getFrameDuration();
+
+  std::string getPath();
+  // True if the file has not changed since the index was built
+  bool isCurrent();
+
+  // Write to or read from the current tag of the xml
+  void save(ofxXmlSettings& xml);
+  void load(ofxXmlSettings& xml);
+
+ private:
+  std::string path;
+  long long modified;
+  unsigned long long fileSize;
+  vector<double> keyframes;
+  double duration;
+  double frameDuration;
+
+  bool readMovieHeader(std::string filePath, vector<unsigned char>& data);
+  bool readVideoTrack(vector<unsigned char>& data, size_t begin, size_t end);
+};
+}
+}
@@ -7,17 +7,53 @@
 //
 
 #include "MediaServer.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
+  static ofRectangle clampToUnit(ofRectangle rect) {
+    float left = ofClamp(rect.x, 0.0f, 1.0f);
+    float top = ofClamp(rect.y, 0.0f, 1.0f);
+    float right = ofClamp(rect.x + rect.width, 0.0f, 1.0f);
+    float bottom = ofClamp(rect.y + rect.height, 0.0f, 1.0f);
+    return ofRectangle(left, top, right - left, bottom - top);
+  }
+  
+  // Crops are rounded outwards to whole pixels, allow for float errors
+  static bool containsRect(ofRectangle& outer, ofRectangle& inner) {
+    float epsilon = 0.0001f;
+    return inner.x >= outer.x - epsilon && inner.y >= outer.y - epsilon &&
+           inner.x + inner.width <= outer.x + outer.width + epsilon &&
+           inner.y + inner.height <= outer.y + outer.height + epsilon;
+  }
 
   MediaServer::MediaServer():
   videoWatcher(ofToDataPath(DEFAULT_VIDEOS_DIR, true), SourceType::SOURCE_TYPE_VIDEO),
   imageWatcher(ofToDataPath(DEFAULT_IMAGES_DIR, true), SourceType::SOURCE_TYPE_IMAGE) {
+    bSyncVideos = false;
+    bGaplessLoop = false;
+    bKeyframesChanged = false;
+    keyframeSnap = DEFAULT_KEYFRAME_SNAP;
+    bPackImages = true;
+    maxImageSize = 0;
+    maxTextureSize = -1;
+    bCropImages = false;
+#ifdef TARGET_RASPBERRY_PI
+    bCompressImages = true;
+#else
+    bCompressImages = false;
+#endif
+    tileBudget = DEFAULT_TILE_BUDGET;
     addWatcherListeners();
+    ofAddListener(ofEvents().update, this, &MediaServer::handleUpdate);
+    loadKeyframeIndices();
+    for (int i = 0; i < getNumVideos(); i++) {
+      indexVideo(getVideoPaths()[i]);
+    }
   }
 
   MediaServer::~MediaServer() {
+    ofRemoveListener(ofEvents().update, this, &MediaServer::handleUpdate);
     removeWatcherListeners();
   };
 
@@ -64,6 +100,10 @@ namespace piMapper {
       return loadImage(path);
     } else if (mediaType == SourceType::SOURCE_TYPE_VIDEO) {
       return loadVideo(path);
+    } else if (mediaType == SourceType::SOURCE_TYPE_REGION) {
+      return loadRegion(path);
+    } else if (mediaType == SourceType::SOURCE_TYPE_TILED) {
+      return loadTiledImage(path);
     } else {
       std::stringstream ss;
       ss << "Can not load media of unknown type: " << mediaType;
@@ -86,25 +126,33 @@ namespace piMapper {
       // Increase reference count of this source
       //referenceCount[path]++;
       imageSource->referenceCount++;
+      prefetchedPaths.erase(path);
       std::stringstream refss;
       refss << "Current reference count for " << path << " = " << imageSource->referenceCount;
-      ofLogNotice("MediaServer") << refss.str();
+      PIMAPPER_LOG_VERBOSE("MediaServer") << refss.str();
       // Notify objects registered to onImageLoaded event
       std::stringstream ss;
       ss << "Image " << path << " already loaded";
-      ofLogNotice("MediaServer") << ss.str();
+      PIMAPPER_LOG_VERBOSE("MediaServer") << ss.str();
       ofNotifyEvent(onImageLoaded, path, this);
       return imageSource;
     }
-    // Else load fresh
+    // Else load fresh, a prefetch still in progress is too late
+    imageLoader.cancel(path);
     imageSource = new ImageSource();
-    imageSource->loadImage(path);
+    imageSource->setAtlas(bPackImages ? &atlas : NULL);
+    imageSource->setMaxSize(getImageSizeLimit());
+    imageSource->setCrop(getTargetCrop(path));
+    if (!bCompressImages || !imageSource->loadCompressed(path)) {
+      imageSource->loadImage(path);
+      compressImage(imageSource);
+    }
     loadedSources[path] = imageSource;
     // Set reference count of this image path to 1
     //referenceCount[path] = 1;
     std::stringstream refss;
     refss << "Initialized reference count of " << path << " to " << imageSource->referenceCount;
-    ofLogNotice("MediaServer") << refss.str();
+    PIMAPPER_LOG_VERBOSE("MediaServer") << refss.str();
     // Notify objects registered to onImageLoaded event
     ofNotifyEvent(onImageLoaded, path, this);
     return imageSource;
@@ -112,26 +160,28 @@ namespace piMapper {
   
   void MediaServer::unloadImage(string& path) {
     ImageSource* source = static_cast<ImageSource*>(getSourceByPath(path));
-    ofLogNotice("MediaServer") << "Unload image, current reference count: " << source->referenceCount;
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Unload image, current reference count: " << source->referenceCount;
     source->referenceCount--;
     // Unload only if reference count is less or equal to 0
-    ofLogNotice("MediaServer") << "New reference count: " << source->referenceCount;
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "New reference count: " << source->referenceCount;
     if (source->referenceCount > 0) {
-      ofLogNotice("MediaServer") << "Not unloading image as it is being referenced elsewhere";
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Not unloading image as it is being referenced elsewhere";
       return;
     }
     // Reference count 0 or less, unload image
     std::stringstream ss;
     ss << "Removing image " << path;
-    ofLogNotice("MediaServer") << ss.str();
+    PIMAPPER_LOG_VERBOSE("MediaServer") << ss.str();
     // Destroy image source
     if (loadedSources.count(path)) {
-      ofLogNotice("MediaServer") << "Source count BEFORE image removal: " << loadedSources.size() << endl;
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Source count BEFORE image removal: " << loadedSources.size() << endl;
       loadedSources[path]->clear();
       std::map<std::string, BaseSource*>::iterator it = loadedSources.find(path);
       delete it->second;
       loadedSources.erase(it);
-      ofLogNotice("MediaServer") << "Source count AFTER image removal: " << loadedSources.size() << endl;
+      texCoordBounds.erase(path);
+      if (recropPaths.erase(path)) imageLoader.cancel(path);
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Source count AFTER image removal: " << loadedSources.size() << endl;
       ofNotifyEvent(onImageUnloaded, path, this);
       return;
     }
@@ -154,25 +204,39 @@ namespace piMapper {
     if (isVideoLoaded) {
       // Increase reference count of this source
       videoSource->referenceCount++;
+      prefetchedPaths.erase(path);
       std::stringstream refss;
       refss << "Current reference count for " << path << " = " << videoSource->referenceCount;
-      ofLogNotice("MediaServer") << refss.str();
+      PIMAPPER_LOG_VERBOSE("MediaServer") << refss.str();
       // Notify objects registered to onImageLoaded event
       std::stringstream ss;
       ss << "Video " << path << " already loaded";
-      ofLogNotice("MediaServer") << ss.str();
+      PIMAPPER_LOG_VERBOSE("MediaServer") << ss.str();
       ofNotifyEvent(onVideoLoaded, path, this);
       return videoSource;
     }
     // Else load fresh
     videoSource = new VideoSource();
     videoSource->loadVideo(path);
+    if (bSyncVideos) {
+      videoSource->setClock(&clock);
+    }
+    if (bGaplessLoop) {
+      videoSource->setGaplessLoop(true);
+    }
+    if (keyframeIndices.count(path)) {
+      videoSource->setKeyframeIndex(keyframeIndices[path]);
+    }
+    if (pendingSeeks.count(path)) {
+      videoSource->seek(pendingSeeks[path], keyframeSnap);
+      pendingSeeks.erase(path);
+    }
     loadedSources[path] = videoSource;
     // Set reference count of this image path to 1
     //referenceCount[path] = 1;
     std::stringstream refss;
     refss << "Initialized reference count of " << path << " to " << videoSource->referenceCount;
-    ofLogNotice("MediaServer") << refss.str();
+    PIMAPPER_LOG_VERBOSE("MediaServer") << refss.str();
     ofNotifyEvent(onVideoLoaded, path, this);
     return videoSource;
   }
@@ -184,19 +248,19 @@ namespace piMapper {
     videoSource->referenceCount--;
     // Unload only if reference count is less or equal to 0
     if (videoSource->referenceCount > 0) {
-      ofLogNotice("MediaServer") << "Not unloading video as it is being referenced elsewhere";
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Not unloading video as it is being referenced elsewhere";
       return;
     }
     // Reference count 0 or less, let's unload the video
-    ofLogNotice("MediaServer") << "Removing video " << path;
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Removing video " << path;
     // Distroy video source
     if (loadedSources.count(path)) {
-      ofLogNotice("MediaServer") << "Source count before video removal: " << loadedSources.size() << endl;
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Source count before video removal: " << loadedSources.size() << endl;
       videoSource->clear();
       std::map<std::string, BaseSource*>::iterator it = loadedSources.find(path);
       delete it->second;
       loadedSources.erase(it);
-      ofLogNotice("MediaServer") << "Source count after video removal: " << loadedSources.size() << endl;
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Source count after video removal: " << loadedSources.size() << endl;
       ofNotifyEvent(onVideoUnloaded, path, this);
       return;
     }
@@ -207,6 +271,98 @@ namespace piMapper {
     std::exit(EXIT_FAILURE);
   }
   
+  BaseSource* MediaServer::loadRegion(string& path) {
+    if (loadedSources.count(path)) {
+      BaseSource* regionSource = loadedSources[path];
+      regionSource->referenceCount++;
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Current reference count for "
+                                          << path << " = "
+                                          << regionSource->referenceCount;
+      return regionSource;
+    }
+    std::string parentPath;
+    int parentType = SourceType::SOURCE_TYPE_NONE;
+    if (!getRegionParent(path, parentPath, parentType)) {
+      ofLogFatalError("MediaServer") << "Can not load region " << path;
+      std::exit(EXIT_FAILURE);
+    }
+    ofRectangle region;
+    RegionSource::splitRegion(path, parentPath, region);
+    // Held until the region is unloaded
+    BaseSource* parent = loadMedia(parentPath, parentType);
+    RegionSource* regionSource = new RegionSource();
+    regionSource->setup(parent, path, SourceType::GetSourceTypeName(parentType),
+                        region);
+    loadedSources[path] = regionSource;
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Loaded region " << path;
+    return regionSource;
+  }
+  
+  void MediaServer::unloadRegion(string& path) {
+    RegionSource* regionSource =
+        static_cast<RegionSource*>(getSourceByPath(path));
+    regionSource->referenceCount--;
+    if (regionSource->referenceCount > 0) return;
+    std::string parentPath = regionSource->getParent()->getPath();
+    delete regionSource;
+    loadedSources.erase(path);
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Removed region " << path;
+    unloadMedia(parentPath);
+  }
+  
+  bool MediaServer::getRegionParent(string& path, string& parentPath,
+                                    int& parentType) {
+    ofRectangle region;
+    if (!RegionSource::splitRegion(path, parentPath, region)) return false;
+    parentType = getMediaType(parentPath);
+    return parentType == SourceType::SOURCE_TYPE_IMAGE ||
+           parentType == SourceType::SOURCE_TYPE_VIDEO;
+  }
+  
+  BaseSource* MediaServer::loadTiledImage(string& path) {
+    if (loadedSources.count(path)) {
+      BaseSource* tiledSource = loadedSources[path];
+      tiledSource->referenceCount++;
+      prefetchedPaths.erase(path);
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Current reference count for "
+                                          << path << " = "
+                                          << tiledSource->referenceCount;
+      return tiledSource;
+    }
+    TiledImageSource* tiledSource = new TiledImageSource();
+    tiledSource->setBudget(tileBudget);
+    // Windows only have to fit the GPU, not the image size limit
+    tiledSource->setMaxWindowSize(getMaxTextureSize());
+    tiledSource->loadImage(path);
+    loadedSources[path] = tiledSource;
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Loaded tiled image " << path;
+    return tiledSource;
+  }
+  
+  void MediaServer::unloadTiledImage(string& path) {
+    BaseSource* tiledSource = getSourceByPath(path);
+    tiledSource->referenceCount--;
+    if (tiledSource->referenceCount > 0) return;
+    tiledSource->clear();
+    delete tiledSource;
+    loadedSources.erase(path);
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Removed tiled image " << path;
+  }
+  
+  int MediaServer::getMediaType(string& path) {
+    if (loadedSources.count(path)) return loadedSources[path]->getType();
+    if (path.find(ofToDataPath(DEFAULT_IMAGES_DIR, true)) == 0) {
+      return SourceType::SOURCE_TYPE_IMAGE;
+    }
+    if (path.find(ofToDataPath(DEFAULT_VIDEOS_DIR, true)) == 0) {
+      return SourceType::SOURCE_TYPE_VIDEO;
+    }
+    if (path.find(ofToDataPath(DEFAULT_TILED_DIR, true)) == 0) {
+      return SourceType::SOURCE_TYPE_TILED;
+    }
+    return SourceType::SOURCE_TYPE_NONE;
+  }
+  
   void MediaServer::unloadMedia(string &path) {
     if (loadedSources.count(path)) {
       BaseSource* mediaSource = getSourceByPath(path);
@@ -214,6 +370,10 @@ namespace piMapper {
         unloadImage(path);
       } else if (mediaSource->getType() == SourceType::SOURCE_TYPE_VIDEO) {
         unloadVideo(path);
+      } else if (mediaSource->getType() == SourceType::SOURCE_TYPE_REGION) {
+        unloadRegion(path);
+      } else if (mediaSource->getType() == SourceType::SOURCE_TYPE_TILED) {
+        unloadTiledImage(path);
       } else {
         // Oh my god, what to do!? Relax and exit.
         ofLogFatalError("MediaServer") << "Attempt to unload media of unknown type";
@@ -234,6 +394,9 @@ namespace piMapper {
       delete i->second;
     }
     loadedSources.clear();
+    prefetchedPaths.clear();
+    failedPrefetchPaths.clear();
+    pendingSeeks.clear();
   }
   
   BaseSource* MediaServer::getSourceByPath(std::string& mediaPath) {
@@ -247,6 +410,445 @@ namespace piMapper {
     std::exit(EXIT_FAILURE);
   }
   
+  void MediaServer::prefetchMedia(string& path, int mediaType) {
+    if (loadedSources.count(path)) return;
+    failedPrefetchPaths.erase(path);
+    // Regions cost nothing once their parent is there
+    std::string parentPath;
+    int parentType = SourceType::SOURCE_TYPE_NONE;
+    if (mediaType == SourceType::SOURCE_TYPE_REGION) {
+      if (getRegionParent(path, parentPath, parentType)) {
+        prefetchMedia(parentPath, parentType);
+      }
+      return;
+    }
+    if (mediaType == SourceType::SOURCE_TYPE_IMAGE) {
+      if (bCompressImages) {
+        // Cached blocks need no decoding, they are uploaded right away
+        ImageSource* imageSource = new ImageSource();
+        imageSource->setAtlas(bPackImages ? &atlas : NULL);
+        imageSource->setMaxSize(getImageSizeLimit());
+        if (imageSource->loadCompressed(path)) {
+          imageSource->referenceCount = 0;
+          loadedSources[path] = imageSource;
+          prefetchedPaths.insert(path);
+          ofNotifyEvent(onMediaPrefetched, path, this);
+          return;
+        }
+        delete imageSource;
+      }
+      imageLoader.setMaxSize(getImageSizeLimit());
+      imageLoader.load(path, getTargetCrop(path));
+    } else if (mediaType == SourceType::SOURCE_TYPE_VIDEO ||
+               mediaType == SourceType::SOURCE_TYPE_TILED) {
+      // Players decode on threads of their own, opening them is enough
+      // to have the first frame ready when the video is needed. Tiled
+      // images read their tiles once surfaces show them.
+      BaseSource* source = loadMedia(path, mediaType);
+      source->referenceCount = 0;
+      prefetchedPaths.insert(path);
+      ofNotifyEvent(onMediaPrefetched, path, this);
+    }
+  }
+  
+  void MediaServer::cancelPrefetch(string& path) {
+    std::string parentPath;
+    int parentType = SourceType::SOURCE_TYPE_NONE;
+    if (getRegionParent(path, parentPath, parentType)) {
+      cancelPrefetch(parentPath);
+      return;
+    }
+    imageLoader.cancel(path);
+    if (!prefetchedPaths.count(path)) return;
+    prefetchedPaths.erase(path);
+    BaseSource* source = loadedSources[path];
+    source->clear();
+    delete source;
+    loadedSources.erase(path);
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Dropped prefetched " << path;
+  }
+  
+  bool MediaServer::isMediaReady(string& path) {
+    if (loadedSources.count(path)) return true;
+    std::string parentPath;
+    int parentType = SourceType::SOURCE_TYPE_NONE;
+    return getRegionParent(path, parentPath, parentType) &&
+           loadedSources.count(parentPath) > 0;
+  }
+  
+  bool MediaServer::isPrefetching(string& path) {
+    std::string parentPath;
+    int parentType = SourceType::SOURCE_TYPE_NONE;
+    if (getRegionParent(path, parentPath, parentType)) {
+      return imageLoader.isLoading(parentPath);
+    }
+    return imageLoader.isLoading(path);
+  }
+  
+  bool MediaServer::isPrefetched(string& path) {
+    return prefetchedPaths.count(path) > 0;
+  }
+  
+  bool MediaServer::isPrefetchFailed(string& path) {
+    std::string parentPath;
+    int parentType = SourceType::SOURCE_TYPE_NONE;
+    if (getRegionParent(path, parentPath, parentType)) {
+      return failedPrefetchPaths.count(parentPath) > 0;
+    }
+    return failedPrefetchPaths.count(path) > 0;
+  }
+  
+  void MediaServer::handleUpdate(ofEventArgs& args) {
+    vector<LoadedImage> images;
+    imageLoader.getLoaded(images);
+    for (int i = 0; i < images.size(); i++) {
+      if (recropPaths.count(images[i].path) &&
+          loadedSources.count(images[i].path)) {
+        recropCompleted(images[i]);
+        continue;
+      }
+      // Loaded synchronously in the meantime
+      if (loadedSources.count(images[i].path)) continue;
+      if (!images[i].success) {
+        PIMAPPER_LOG_WARNING("MediaServer") << "Could not prefetch "
+                                            << images[i].path;
+        // Whoever waits for it keeps what it has
+        failedPrefetchPaths.insert(images[i].path);
+        ofNotifyEvent(onMediaPrefetchFailed, images[i].path, this);
+        continue;
+      }
+      ImageSource* imageSource = new ImageSource();
+      imageSource->setAtlas(bPackImages ? &atlas : NULL);
+      imageSource->setMaxSize(getImageSizeLimit());
+      imageSource->setCrop(images[i].crop);
+      imageSource->loadImage(images[i].path, images[i].pixels);
+      compressImage(imageSource);
+      imageSource->referenceCount = 0;
+      loadedSources[images[i].path] = imageSource;
+      prefetchedPaths.insert(images[i].path);
+      ofNotifyEvent(onMediaPrefetched, images[i].path, this);
+    }
+
+    vector<CompressedTexture> textures;
+    compressor.getCompressed(textures);
+    for (int i = 0; i < textures.size(); i++) {
+      compressCompleted(textures[i]);
+    }
+
+    vector<KeyframeIndex> indices;
+    videoIndexer.getIndexed(indices);
+    for (int i = 0; i < indices.size(); i++) {
+      std::string path = indices[i].getPath();
+      if (indices[i].isEmpty()) {
+        PIMAPPER_LOG_VERBOSE("MediaServer") << "No keyframe index for "
+                                            << path;
+      }
+      // Kept even if empty, so the file is not read again
+      keyframeIndices[path] = indices[i];
+      bKeyframesChanged = true;
+      if (loadedSources.count(path)) {
+        VideoSource* videoSource =
+            static_cast<VideoSource*>(loadedSources[path]);
+        videoSource->setKeyframeIndex(indices[i]);
+      }
+    }
+    if (bKeyframesChanged && !videoIndexer.isIndexing()) {
+      saveKeyframeIndices();
+    }
+  }
+  
+  void MediaServer::setSyncVideos(bool syncVideos) {
+    bSyncVideos = syncVideos;
+    typedef std::map<std::string, BaseSource*>::iterator it_type;
+    for (it_type i = loadedSources.begin(); i != loadedSources.end(); i++) {
+      if (i->second->getType() == SourceType::SOURCE_TYPE_VIDEO) {
+        VideoSource* videoSource = static_cast<VideoSource*>(i->second);
+        videoSource->setClock(bSyncVideos ? &clock : NULL);
+      }
+    }
+  }
+  
+  bool MediaServer::getSyncVideos() {
+    return bSyncVideos;
+  }
+  
+  ShowClock* MediaServer::getClock() {
+    return &clock;
+  }
+  
+  void MediaServer::setGaplessLoop(bool gaplessLoop) {
+    bGaplessLoop = gaplessLoop;
+    typedef std::map<std::string, BaseSource*>::iterator it_type;
+    for (it_type i = loadedSources.begin(); i != loadedSources.end(); i++) {
+      if (i->second->getType() == SourceType::SOURCE_TYPE_VIDEO) {
+        static_cast<VideoSource*>(i->second)->setGaplessLoop(bGaplessLoop);
+      }
+    }
+  }
+  
+  bool MediaServer::getGaplessLoop() {
+    return bGaplessLoop;
+  }
+  
+  KeyframeIndex* MediaServer::getKeyframeIndex(string& path) {
+    if (!keyframeIndices.count(path)) return NULL;
+    return &keyframeIndices[path];
+  }
+  
+  bool MediaServer::isIndexing() {
+    return videoIndexer.isIndexing();
+  }
+  
+  void MediaServer::seekVideo(string& path, double time) {
+    if (!loadedSources.count(path)) {
+      pendingSeeks[path] = time;
+      return;
+    }
+    VideoSource* videoSource = static_cast<VideoSource*>(loadedSources[path]);
+    videoSource->seek(time, keyframeSnap);
+  }
+  
+  void MediaServer::setKeyframeSnap(double seconds) {
+    keyframeSnap = seconds < 0.0 ? 0.0 : seconds;
+  }
+  
+  double MediaServer::getKeyframeSnap() {
+    return keyframeSnap;
+  }
+  
+  void MediaServer::setPackImages(bool packImages) {
+    bPackImages = packImages;
+  }
+  
+  bool MediaServer::getPackImages() {
+    return bPackImages;
+  }
+  
+  TextureAtlas& MediaServer::getAtlas() {
+    return atlas;
+  }
+  
+  void MediaServer::setMaxImageSize(int size) {
+    maxImageSize = std::max(size, 0);
+  }
+  
+  int MediaServer::getMaxImageSize() {
+    return maxImageSize;
+  }
+  
+  void MediaServer::setCropImages(bool cropImages) {
+    bCropImages = cropImages;
+  }
+  
+  bool MediaServer::getCropImages() {
+    return bCropImages;
+  }
+  
+  void MediaServer::includeTexCoords(string& path, ofRectangle bounds) {
+    if (!bCropImages) return;
+    // Regions address a part of their parent
+    std::string parentPath;
+    ofRectangle region;
+    if (RegionSource::splitRegion(path, parentPath, region)) {
+      includeTexCoords(parentPath,
+                       ofRectangle(region.x + bounds.x * region.width,
+                                   region.y + bounds.y * region.height,
+                                   bounds.width * region.width,
+                                   bounds.height * region.height));
+      return;
+    }
+    if (getMediaType(path) != SourceType::SOURCE_TYPE_IMAGE) return;
+
+    bounds = clampToUnit(bounds);
+    if (texCoordBounds.count(path)) {
+      texCoordBounds[path].growToInclude(bounds);
+    } else {
+      texCoordBounds[path] = bounds;
+    }
+    if (!loadedSources.count(path) || recropPaths.count(path)) return;
+    ImageSource* imageSource = static_cast<ImageSource*>(loadedSources[path]);
+    if (containsRect(imageSource->getCrop(), bounds)) return;
+    // Until the larger crop is there the edge of the old one is repeated
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Growing the crop of " << path;
+    imageLoader.setMaxSize(getImageSizeLimit());
+    imageLoader.load(path, getTargetCrop(path));
+    recropPaths.insert(path);
+  }
+  
+  ofRectangle MediaServer::getImageCrop(string& path) {
+    if (loadedSources.count(path) &&
+        loadedSources[path]->getType() == SourceType::SOURCE_TYPE_IMAGE) {
+      return static_cast<ImageSource*>(loadedSources[path])->getCrop();
+    }
+    return getTargetCrop(path);
+  }
+  
+  ofRectangle MediaServer::getTargetCrop(string& path) {
+    ofRectangle whole(0.0f, 0.0f, 1.0f, 1.0f);
+    if (!bCropImages || !texCoordBounds.count(path)) return whole;
+    ofRectangle& bounds = texCoordBounds[path];
+    ofRectangle crop = clampToUnit(
+        ofRectangle(bounds.x - DEFAULT_IMAGE_CROP_MARGIN,
+                    bounds.y - DEFAULT_IMAGE_CROP_MARGIN,
+                    bounds.width + DEFAULT_IMAGE_CROP_MARGIN * 2.0f,
+                    bounds.height + DEFAULT_IMAGE_CROP_MARGIN * 2.0f));
+    if (crop.width * crop.height > MAX_IMAGE_CROP_AREA) return whole;
+    return crop;
+  }
+  
+  void MediaServer::recropCompleted(LoadedImage& image) {
+    recropPaths.erase(image.path);
+    if (!image.success) {
+      PIMAPPER_LOG_WARNING("MediaServer") << "Could not decode " << image.path
+                                          << " again";
+      return;
+    }
+    ImageSource* imageSource =
+        static_cast<ImageSource*>(loadedSources[image.path]);
+    imageSource->reload(image.pixels, image.crop);
+    // Texture coordinates may have moved on while decoding
+    if (!containsRect(imageSource->getCrop(), texCoordBounds[image.path])) {
+      imageLoader.load(image.path, getTargetCrop(image.path));
+      recropPaths.insert(image.path);
+    }
+  }
+  
+  void MediaServer::setCompressImages(bool compressImages) {
+    bCompressImages = compressImages;
+  }
+  
+  bool MediaServer::getCompressImages() {
+    return bCompressImages;
+  }
+  
+  void MediaServer::compressImages() {
+    int maxSize = getImageSizeLimit();
+    for (int i = 0; i < getNumImages(); i++) {
+      std::string path = getImagePaths()[i];
+      if (!TextureCache::isCurrent(TextureCache::getCachePath(path), path,
+                                   maxSize)) {
+        compressor.compress(path, maxSize);
+      }
+    }
+  }
+  
+  bool MediaServer::isCompressing() {
+    return compressor.isCompressing();
+  }
+  
+  void MediaServer::compressImage(ImageSource* imageSource) {
+    if (!bCompressImages || imageSource->isPacked() ||
+        imageSource->isCompressed()) {
+      return;
+    }
+    compressor.compress(imageSource->getPath(), getImageSizeLimit());
+  }
+  
+  void MediaServer::compressCompleted(CompressedTexture& texture) {
+    std::string path = texture.path;
+    if (texture.format == 0) {
+      PIMAPPER_LOG_WARNING("MediaServer") << "Could not compress " << path;
+      return;
+    }
+    // Decoding the blocks again would only lose quality
+    if (!bCompressImages || !loadedSources.count(path) ||
+        TextureCache::getUploadFormat(texture.format) == 0) {
+      return;
+    }
+    ImageSource* imageSource = static_cast<ImageSource*>(loadedSources[path]);
+    if (imageSource->isPacked() || imageSource->isCompressed()) return;
+    // The compressed texture holds the whole image, a larger crop is not
+    // needed anymore
+    if (recropPaths.erase(path)) imageLoader.cancel(path);
+    imageSource->clear();
+    if (!imageSource->loadCompressed(path)) {
+      imageSource->loadImage(path);
+    }
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Swapped in compressed " << path;
+  }
+  
+  void MediaServer::setTileBudget(unsigned long long bytes) {
+    tileBudget = bytes;
+    typedef std::map<std::string, BaseSource*>::iterator it_type;
+    for (it_type i = loadedSources.begin(); i != loadedSources.end(); i++) {
+      if (i->second->getType() == SourceType::SOURCE_TYPE_TILED) {
+        static_cast<TiledImageSource*>(i->second)->setBudget(tileBudget);
+      }
+    }
+  }
+  
+  unsigned long long MediaServer::getTileBudget() {
+    return tileBudget;
+  }
+  
+  int MediaServer::getMaxTextureSize() {
+    if (maxTextureSize < 0) {
+      GLint size = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+      maxTextureSize = size;
+      PIMAPPER_LOG_VERBOSE("MediaServer") << "Maximum texture size "
+                                          << maxTextureSize;
+    }
+    return maxTextureSize;
+  }
+  
+  int MediaServer::getImageSizeLimit() {
+    int textureSize = getMaxTextureSize();
+    if (textureSize == 0) return maxImageSize;
+    if (maxImageSize == 0) return textureSize;
+    return std::min(maxImageSize, textureSize);
+  }
+  
+  void MediaServer::indexVideo(string& path) {
+    if (keyframeIndices.count(path)) {
+      if (keyframeIndices[path].isCurrent()) return;
+      keyframeIndices.erase(path);
+    }
+    videoIndexer.index(path);
+  }
+  
+  void MediaServer::loadKeyframeIndices() {
+    ofxXmlSettings xml;
+    if (!xml.loadFile(DEFAULT_KEYFRAME_INDEX_FILE) ||
+        !xml.tagExists("keyframe-indices")) {
+      return;
+    }
+    xml.pushTag("keyframe-indices");
+    for (int i = 0; i < xml.getNumTags("video"); i++) {
+      xml.pushTag("video", i);
+      KeyframeIndex index;
+      index.load(xml);
+      // Changed files are indexed again, removed ones are forgotten
+      if (index.isCurrent()) {
+        keyframeIndices[index.getPath()] = index;
+      }
+      xml.popTag(); // video
+    }
+    xml.popTag(); // keyframe-indices
+    PIMAPPER_LOG_VERBOSE("MediaServer") << "Loaded " << keyframeIndices.size()
+                                        << " keyframe indices";
+  }
+  
+  void MediaServer::saveKeyframeIndices() {
+    ofxXmlSettings xml;
+    xml.addTag("keyframe-indices");
+    xml.pushTag("keyframe-indices");
+    typedef std::map<std::string, KeyframeIndex>::iterator it_type;
+    int i = 0;
+    for (it_type it = keyframeIndices.begin(); it != keyframeIndices.end(); it++) {
+      xml.addTag("video");
+      xml.pushTag("video", i++);
+      it->second.save(xml);
+      xml.popTag(); // video
+    }
+    xml.popTag(); // keyframe-indices
+    if (!xml.saveFile(DEFAULT_KEYFRAME_INDEX_FILE)) {
+      PIMAPPER_LOG_WARNING("MediaServer") << "Could not save "
+                                          << DEFAULT_KEYFRAME_INDEX_FILE;
+    }
+    bKeyframesChanged = false;
+  }
+  
   std::string MediaServer::getDefaultImageDir() {
     return DEFAULT_IMAGES_DIR;
   }
@@ -255,11 +857,17 @@ namespace piMapper {
     return DEFAULT_VIDEOS_DIR;
   }
   
+  std::string MediaServer::getDefaultTiledDir() {
+    return DEFAULT_TILED_DIR;
+  }
+  
   std::string MediaServer::getDefaultMediaDir(int sourceType) {
     if (sourceType == SourceType::SOURCE_TYPE_IMAGE) {
       return getDefaultImageDir();
     } else if (sourceType == SourceType::SOURCE_TYPE_VIDEO) {
       return getDefaultVideoDir();
+    } else if (sourceType == SourceType::SOURCE_TYPE_TILED) {
+      return getDefaultTiledDir();
     } else {
       std::stringstream ss;
       ss << "Could not get default media dir. Unknown source type: " << sourceType;
@@ -269,16 +877,24 @@ namespace piMapper {
   }
   
   void MediaServer::handleImageAdded(string& path) {
+    failedPrefetchPaths.erase(path);
     ofNotifyEvent(onImageAdded, path, this);
   }
   void MediaServer::handleImageRemoved(string& path) {
+    failedPrefetchPaths.erase(path);
     ofNotifyEvent(onImageRemoved, path, this);
   }
  
   void MediaServer::handleVideoAdded(string& path) {
+    indexVideo(path);
     ofNotifyEvent(onVideoAdded, path, this);
   }
   void MediaServer::handleVideoRemoved(string& path) {
+    videoIndexer.cancel(path);
+    if (keyframeIndices.count(path)) {
+      keyframeIndices.erase(path);
+      bKeyframesChanged = true;
+    }
     ofNotifyEvent(onVideoRemoved, path, this);
   }
   
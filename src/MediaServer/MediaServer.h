@@ -10,13 +10,29 @@
 
 #include "ofMain.h"
 #include "DirectoryWatcher.h"
+#include "ImageLoader.h"
+#include "VideoIndexer.h"
+#include "KeyframeIndex.h"
+#include "ShowClock.h"
+#include "TextureAtlas.h"
+#include "TextureCompressor.h"
 #include "BaseSource.h"
 #include "ImageSource.h"
 #include "VideoSource.h"
+#include "RegionSource.h"
+#include "TiledImageSource.h"
 #include "SourceType.h"
 
 #define DEFAULT_IMAGES_DIR "sources/images/"
 #define DEFAULT_VIDEOS_DIR "sources/videos/"
+#define DEFAULT_TILED_DIR "sources/tiled/"
+#define DEFAULT_KEYFRAME_INDEX_FILE "keyframes.xml"
+// Seeks this close after a keyframe start at the keyframe, in seconds
+#define DEFAULT_KEYFRAME_SNAP 0.2
+// Normalized margin around the texture coordinates of cropped images
+#define DEFAULT_IMAGE_CROP_MARGIN 0.1f
+// Crops covering more of the image than this load the whole image
+#define MAX_IMAGE_CROP_AREA 0.75f
 
 namespace ofx {
 namespace piMapper {
@@ -38,11 +54,94 @@ class MediaServer {
   void unloadImage(string& path);
   BaseSource* loadVideo(string& path);
   void unloadVideo(string& path);
+  // Regions of images and videos, see RegionSource. The parent is loaded
+  // along with the first region of it and shared by all of them.
+  BaseSource* loadRegion(string& path);
+  void unloadRegion(string& path);
+  // Path and type of the media a region path points into, false if the
+  // path is not the one of a region
+  bool getRegionParent(string& path, string& parentPath, int& parentType);
+  // Images larger than a texture, see TiledImageSource
+  BaseSource* loadTiledImage(string& path);
+  void unloadTiledImage(string& path);
   void unloadMedia(string& path);
   void clear(); // Force all loaded source unload
   BaseSource* getSourceByPath(std::string& mediaPath);
+
+  // Load media ahead of its use, images are decoded in the background.
+  // Once it is ready loadMedia returns it without touching the disk.
+  // Prefetched media nobody has loaded stays until cancelPrefetch.
+  void prefetchMedia(string& path, int mediaType);
+  void cancelPrefetch(string& path);
+  // Loaded or prefetched, its texture can be drawn right away
+  bool isMediaReady(string& path);
+  bool isPrefetching(string& path);
+  // Ready but not loaded by anyone yet
+  bool isPrefetched(string& path);
+  // The last prefetch of path could not be decoded. Cleared by the next
+  // prefetchMedia of it or once the file is added or removed.
+  bool isPrefetchFailed(string& path);
+
+  // Keep all videos at the position of the show clock modulo their
+  // duration, see VideoSource::getSync for the error of each
+  void setSyncVideos(bool syncVideos);
+  bool getSyncVideos();
+  ShowClock* getClock();
+  // Loop videos without a stall at the loop point, see
+  // VideoSource::setGaplessLoop
+  void setGaplessLoop(bool gaplessLoop);
+  bool getGaplessLoop();
+
+  // Keyframe indices of all videos are built in the background and kept
+  // in DEFAULT_KEYFRAME_INDEX_FILE, a video is only read again once it
+  // changes. NULL until the video has been indexed.
+  KeyframeIndex* getKeyframeIndex(string& path);
+  bool isIndexing();
+  // Seek a loaded video, one that is not loaded yet starts there
+  void seekVideo(string& path, double time);
+  void setKeyframeSnap(double seconds);
+  double getKeyframeSnap();
+  // Pack images up to the maximum size of the atlas into shared pages,
+  // see TextureAtlas. Applies to images loaded afterwards.
+  void setPackImages(bool packImages);
+  bool getPackImages();
+  TextureAtlas& getAtlas();
+  // Images are scaled down on load so neither side is larger than this,
+  // for example SurfaceManager::getNeededImageSize. 0 leaves only the
+  // maximum texture size of the GPU. Applies to images loaded afterwards.
+  void setMaxImageSize(int size);
+  int getMaxImageSize();
+  // Upload only the part of an image the surfaces showing it address
+  // plus a margin, see ImageSource::setCrop. Surfaces report their
+  // texture coordinates with includeTexCoords, the crop is the union
+  // of them. It grows in the background when coordinates move outside
+  // of it and only shrinks when the image is unloaded.
+  void setCropImages(bool cropImages);
+  bool getCropImages();
+  // Bounds of normalized texture coordinates of a surface showing an
+  // image or a region of one, other paths are ignored
+  void includeTexCoords(string& path, ofRectangle bounds);
+  // Part of an image that is loaded, the whole image if not cropped
+  ofRectangle getImageCrop(string& path);
+  // Load images from GPU compressed caches, see TextureCache. An image
+  // without a current cache loads as before and is compressed in the
+  // background, its texture is swapped for the compressed one once done
+  // if the GPU takes the format. Compressed images are loaded whole and
+  // not packed. On by default on the Pi. Applies to images loaded
+  // afterwards.
+  void setCompressImages(bool compressImages);
+  bool getCompressImages();
+  // Compress all images without a current cache in the background, for
+  // example while setting up a show
+  void compressImages();
+  bool isCompressing();
+  // Memory for the tiles and windows of each tiled image, see
+  // TiledImageSource::setBudget
+  void setTileBudget(unsigned long long bytes);
+  unsigned long long getTileBudget();
   std::string getDefaultImageDir();
   std::string getDefaultVideoDir();
+  std::string getDefaultTiledDir();
   std::string getDefaultMediaDir(int sourceType);
   
   // Custom events
@@ -54,12 +153,56 @@ class MediaServer {
   ofEvent<string> onImageUnloaded;
   ofEvent<string> onVideoLoaded;
   ofEvent<string> onVideoUnloaded;
+  // Passed the path given to prefetchMedia once it is ready
+  ofEvent<string> onMediaPrefetched;
+  // Passed the path given to prefetchMedia if it could not be decoded
+  ofEvent<string> onMediaPrefetchFailed;
 
  private:
   // Directory Watchers
   ofx::piMapper::DirectoryWatcher videoWatcher;
   ofx::piMapper::DirectoryWatcher imageWatcher;
   std::map<std::string, BaseSource*> loadedSources;
+  ImageLoader imageLoader;
+  // Ready but not loaded by anyone, their reference count is 0
+  std::set<std::string> prefetchedPaths;
+  std::set<std::string> failedPrefetchPaths;
+  ShowClock clock;
+  bool bSyncVideos;
+  bool bGaplessLoop;
+  VideoIndexer videoIndexer;
+  std::map<std::string, KeyframeIndex> keyframeIndices;
+  // Saved once the indexer is done
+  bool bKeyframesChanged;
+  double keyframeSnap;
+  std::map<std::string, double> pendingSeeks;
+  TextureAtlas atlas;
+  bool bPackImages;
+  int maxImageSize;
+  // Queried with the first image, 0 without a GL context
+  int maxTextureSize;
+  int getMaxTextureSize();
+  int getImageSizeLimit();
+  unsigned long long tileBudget;
+  bool bCropImages;
+  TextureCompressor compressor;
+  bool bCompressImages;
+  // Unless the image is packed or compressed already
+  void compressImage(ImageSource* imageSource);
+  void compressCompleted(CompressedTexture& texture);
+  // Union of the texture coordinates included for each image
+  std::map<std::string, ofRectangle> texCoordBounds;
+  // Loaded images being decoded again with a larger crop
+  std::set<std::string> recropPaths;
+  // Texture coordinates included so far plus the margin
+  ofRectangle getTargetCrop(string& path);
+  void recropCompleted(LoadedImage& image);
+  void indexVideo(string& path);
+  void loadKeyframeIndices();
+  void saveKeyframeIndices();
+  void handleUpdate(ofEventArgs& args);
+  // By the directory it is in, for media that is not loaded
+  int getMediaType(string& path);
   // imageWatcher event listeners
   void handleImageAdded(string& path);
   void handleImageRemoved(string& path);
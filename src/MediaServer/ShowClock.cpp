@@ -0,0 +1,41 @@
+#include "ShowClock.h"
+
+namespace ofx {
+namespace piMapper {
+ShowClock::ShowClock() {
+  bVirtual = false;
+  virtualTime = 0.0;
+  startTime = getApplicationTime();
+}
+
+double ShowClock::getTime() {
+  if (bVirtual) return virtualTime;
+  return getApplicationTime() - startTime;
+}
+
+void ShowClock::setTime(double seconds) {
+  if (bVirtual) {
+    virtualTime = seconds;
+  } else {
+    startTime = getApplicationTime() - seconds;
+  }
+}
+
+void ShowClock::advance(double seconds) { setTime(getTime() + seconds); }
+
+void ShowClock::reset() { setTime(0.0); }
+
+void ShowClock::setVirtual(bool makeVirtual) {
+  if (makeVirtual == bVirtual) return;
+  double time = getTime();
+  bVirtual = makeVirtual;
+  setTime(time);
+}
+
+bool ShowClock::isVirtual() { return bVirtual; }
+
+double ShowClock::getApplicationTime() {
+  return ofGetElapsedTimeMicros() / 1000000.0;
+}
+}
+}
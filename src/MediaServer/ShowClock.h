@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofx {
+namespace piMapper {
+// Time of the show in seconds, shared by all video sources. It follows
+// the application clock unless it is made virtual. A virtual clock only
+// moves when told to, so sync can be simulated without real time passing.
+class ShowClock {
+ public:
+  ShowClock();
+
+  double getTime();
+  void setTime(double seconds);
+  void advance(double seconds);
+  // Start over from 0
+  void reset();
+
+  // Switching keeps the current time
+  void setVirtual(bool makeVirtual);
+  bool isVirtual();
+
+ private:
+  bool bVirtual;
+  double virtualTime;
+  // Application time at which the show time was 0
+  double startTime;
+
+  double getApplicationTime();
+};
+}
+}
@@ -0,0 +1,258 @@
+#include "TextureAtlas.h"
+#include "RenderStats.h"
+
+namespace ofx {
+namespace piMapper {
+// Tallest first leaves the least room under the skyline
+static bool isTaller(const AtlasEntry* a, const AtlasEntry* b) {
+  return a->height > b->height;
+}
+
+TextureAtlas::TextureAtlas() {
+  maxImageSize = DEFAULT_MAX_ATLAS_IMAGE_SIZE;
+  numRepacks = 0;
+}
+
+TextureAtlas::~TextureAtlas() {
+  for (int i = 0; i < pages.size(); i++) {
+    for (int j = 0; j < pages[i]->entries.size(); j++) {
+      delete pages[i]->entries[j];
+    }
+    delete pages[i];
+  }
+  pages.clear();
+}
+
+AtlasEntry* TextureAtlas::add(std::string path, ofPixels& pixels) {
+  if (!pixels.isAllocated() || !fits(pixels.getWidth(), pixels.getHeight())) {
+    return NULL;
+  }
+
+  AtlasEntry* entry = new AtlasEntry();
+  entry->path = path;
+  entry->texture = NULL;
+  entry->width = pixels.getWidth();
+  entry->height = pixels.getHeight();
+
+  // Pages are RGBA, repeat the edge pixels into the padding
+  ofPixels rgba = pixels;
+  rgba.setImageType(OF_IMAGE_COLOR_ALPHA);
+  int paddedWidth = entry->width + ATLAS_PADDING * 2;
+  int paddedHeight = entry->height + ATLAS_PADDING * 2;
+  entry->pixels.allocate(paddedWidth, paddedHeight, OF_IMAGE_COLOR_ALPHA);
+  unsigned char* target = entry->pixels.getPixels();
+  const unsigned char* source = rgba.getPixels();
+  for (int y = 0; y < paddedHeight; y++) {
+    int sourceY = ofClamp(y - ATLAS_PADDING, 0, entry->height - 1);
+    for (int x = 0; x < paddedWidth; x++) {
+      int sourceX = ofClamp(x - ATLAS_PADDING, 0, entry->width - 1);
+      memcpy(target + (y * paddedWidth + x) * 4,
+             source + (sourceY * entry->width + sourceX) * 4, 4);
+    }
+  }
+
+  place(entry);
+  return entry;
+}
+
+void TextureAtlas::remove(AtlasEntry* entry) {
+  Page* page = getPage(entry);
+  if (page != NULL) {
+    page->entries.erase(
+        std::find(page->entries.begin(), page->entries.end(), entry));
+    int area = entry->pixels.getWidth() * entry->pixels.getHeight();
+    page->usedArea -= area;
+    page->freedArea += area;
+  }
+  delete entry;
+  if (page == NULL) return;
+
+  if (!page->entries.size()) {
+    pages.erase(std::find(pages.begin(), pages.end(), page));
+    delete page;
+  } else if (page->freedArea >
+             ATLAS_REPACK_WASTE * ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE) {
+    repack(page);
+  }
+}
+
+bool TextureAtlas::fits(int width, int height) {
+  return width > 0 && height > 0 && width <= maxImageSize &&
+         height <= maxImageSize;
+}
+
+void TextureAtlas::setMaxImageSize(int size) {
+  // Packed images keep their place, this applies to the next ones
+  maxImageSize = ofClamp(size, 0, ATLAS_PAGE_SIZE - ATLAS_PADDING * 2);
+}
+
+int TextureAtlas::getMaxImageSize() { return maxImageSize; }
+
+int TextureAtlas::getNumPages() { return pages.size(); }
+
+int TextureAtlas::getNumEntries() {
+  int numEntries = 0;
+  for (int i = 0; i < pages.size(); i++) {
+    numEntries += pages[i]->entries.size();
+  }
+  return numEntries;
+}
+
+int TextureAtlas::getNumRepacks() { return numRepacks; }
+
+float TextureAtlas::getUsage(int page) {
+  if (page < 0 || page >= pages.size()) {
+    throw std::runtime_error("Atlas page index out of bounds.");
+  }
+  return (float)pages[page]->usedArea / (ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE);
+}
+
+void TextureAtlas::place(AtlasEntry* entry) {
+  for (int i = 0; i < pages.size(); i++) {
+    if (insert(pages[i], entry)) return;
+  }
+  // Space of removed images is only reclaimed by a repack
+  for (int i = 0; i < pages.size(); i++) {
+    if (pages[i]->freedArea == 0) continue;
+    repack(pages[i]);
+    if (insert(pages[i], entry)) return;
+  }
+
+  Page* page = new Page();
+  page->texture.allocate(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, GL_RGBA);
+  page->usedArea = 0;
+  page->freedArea = 0;
+  resetSkyline(page);
+  pages.push_back(page);
+  // Always fits, see fits
+  insert(page, entry);
+}
+
+bool TextureAtlas::insert(Page* page, AtlasEntry* entry) {
+  int width = entry->pixels.getWidth();
+  int height = entry->pixels.getHeight();
+  int nodeIndex = 0;
+  int x = 0;
+  int y = 0;
+  if (!findPosition(page, width, height, nodeIndex, x, y)) return false;
+  addSkylineLevel(page, nodeIndex, x, y, width, height);
+  page->entries.push_back(entry);
+  page->usedArea += width * height;
+  upload(page, entry, x, y);
+  return true;
+}
+
+bool TextureAtlas::findPosition(Page* page, int width, int height,
+                                int& nodeIndex, int& x, int& y) {
+  vector<SkylineNode>& skyline = page->skyline;
+  // Lowest position, the narrowest node breaks ties
+  int bestY = ATLAS_PAGE_SIZE;
+  int bestWidth = ATLAS_PAGE_SIZE + 1;
+  nodeIndex = -1;
+  for (int i = 0; i < skyline.size(); i++) {
+    if (skyline[i].x + width > ATLAS_PAGE_SIZE) break;
+    // The image rests on the highest node under it
+    int top = 0;
+    int widthLeft = width;
+    for (int j = i; widthLeft > 0; j++) {
+      top = std::max(top, skyline[j].y);
+      widthLeft -= skyline[j].width;
+    }
+    if (top + height > ATLAS_PAGE_SIZE) continue;
+    if (top < bestY || (top == bestY && skyline[i].width < bestWidth)) {
+      nodeIndex = i;
+      bestY = top;
+      bestWidth = skyline[i].width;
+    }
+  }
+  if (nodeIndex < 0) return false;
+  x = skyline[nodeIndex].x;
+  y = bestY;
+  return true;
+}
+
+void TextureAtlas::addSkylineLevel(Page* page, int nodeIndex, int x, int y,
+                                   int width, int height) {
+  vector<SkylineNode>& skyline = page->skyline;
+  SkylineNode node;
+  node.x = x;
+  node.y = y + height;
+  node.width = width;
+  skyline.insert(skyline.begin() + nodeIndex, node);
+
+  // Cut away what the new level covers of the following nodes
+  for (int i = nodeIndex + 1; i < skyline.size();) {
+    int previousEnd = skyline[i - 1].x + skyline[i - 1].width;
+    if (skyline[i].x >= previousEnd) break;
+    int shrink = previousEnd - skyline[i].x;
+    skyline[i].x += shrink;
+    skyline[i].width -= shrink;
+    if (skyline[i].width > 0) break;
+    skyline.erase(skyline.begin() + i);
+  }
+
+  // Merge neighbours of the same height
+  for (int i = 0; i + 1 < skyline.size();) {
+    if (skyline[i].y == skyline[i + 1].y) {
+      skyline[i].width += skyline[i + 1].width;
+      skyline.erase(skyline.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+}
+
+void TextureAtlas::upload(Page* page, AtlasEntry* entry, int x, int y) {
+  entry->texture = &page->texture;
+  entry->region.set((float)(x + ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+                    (float)(y + ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+                    (float)entry->width / ATLAS_PAGE_SIZE,
+                    (float)entry->height / ATLAS_PAGE_SIZE);
+
+  ofTextureData& data = page->texture.getTextureData();
+  glBindTexture(data.textureTarget, data.textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(data.textureTarget, 0, x, y, entry->pixels.getWidth(),
+                  entry->pixels.getHeight(), GL_RGBA, GL_UNSIGNED_BYTE,
+                  entry->pixels.getPixels());
+  glBindTexture(data.textureTarget, 0);
+  PIMAPPER_COUNT_TEXTURE_UPLOAD(entry->pixels.getWidth() *
+                                entry->pixels.getHeight() * 4);
+}
+
+void TextureAtlas::repack(Page* page) {
+  vector<AtlasEntry*> entries = page->entries;
+  std::sort(entries.begin(), entries.end(), isTaller);
+  page->entries.clear();
+  page->usedArea = 0;
+  page->freedArea = 0;
+  resetSkyline(page);
+  numRepacks++;
+
+  vector<AtlasEntry*> leftovers;
+  for (int i = 0; i < entries.size(); i++) {
+    if (!insert(page, entries[i])) leftovers.push_back(entries[i]);
+  }
+  // A different order may not fit the same images, move them elsewhere
+  for (int i = 0; i < leftovers.size(); i++) {
+    place(leftovers[i]);
+  }
+}
+
+void TextureAtlas::resetSkyline(Page* page) {
+  page->skyline.clear();
+  SkylineNode node;
+  node.x = 0;
+  node.y = 0;
+  node.width = ATLAS_PAGE_SIZE;
+  page->skyline.push_back(node);
+}
+
+TextureAtlas::Page* TextureAtlas::getPage(AtlasEntry* entry) {
+  for (int i = 0; i < pages.size(); i++) {
+    if (&pages[i]->texture == entry->texture) return pages[i];
+  }
+  return NULL;
+}
+}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Width and height of an atlas page in pixels
+#define ATLAS_PAGE_SIZE 2048
+// Images larger than this in either direction get their own texture
+#define DEFAULT_MAX_ATLAS_IMAGE_SIZE 256
+// Edge pixels are repeated this far around each image, so filtering
+// does not pick up the neighbours
+#define ATLAS_PADDING 2
+// A page is repacked when this share of its area was freed
+#define ATLAS_REPACK_WASTE 0.25f
+
+namespace ofx {
+namespace piMapper {
+// An image packed into an atlas. Repacking moves it, so read the texture
+// and region whenever they are used.
+struct AtlasEntry {
+  std::string path;
+  ofTexture* texture;
+  // Normalized part of the page the image takes, padding excluded
+  ofRectangle region;
+  int width;
+  int height;
+  // RGBA with padding, kept to upload it again after a repack
+  ofPixels pixels;
+};
+
+// Packs small images into shared texture pages with a skyline packer, so
+// surfaces showing them can be drawn without a texture bind in between.
+// Adding an image only uploads that image. Removing one frees its space
+// for the next repack of its page, empty pages are released.
+class TextureAtlas {
+ public:
+  TextureAtlas();
+  ~TextureAtlas();
+
+  // Copies the image into a page, NULL if it is too large to be packed
+  AtlasEntry* add(std::string path, ofPixels& pixels);
+  void remove(AtlasEntry* entry);
+  bool fits(int width, int height);
+  void setMaxImageSize(int size);
+  int getMaxImageSize();
+
+  int getNumPages();
+  int getNumEntries();
+  int getNumRepacks();
+  // Share of the area of a page taken by images and their padding
+  float getUsage(int page);
+
+ private:
+  // Top edge of the packed images over a span of the page
+  struct SkylineNode {
+    int x;
+    int y;
+    int width;
+  };
+
+  struct Page {
+    ofTexture texture;
+    vector<SkylineNode> skyline;
+    vector<AtlasEntry*> entries;
+    int usedArea;
+    int freedArea;
+  };
+
+  vector<Page*> pages;
+  int maxImageSize;
+  int numRepacks;
+
+  // Tries the pages in order, opens a new one if none has room
+  void place(AtlasEntry* entry);
+  bool insert(Page* page, AtlasEntry* entry);
+  bool findPosition(Page* page, int width, int height, int& nodeIndex,
+                    int& x, int& y);
+  void addSkylineLevel(Page* page, int nodeIndex, int x, int y, int width,
+                       int height);
+  void upload(Page* page, AtlasEntry* entry, int x, int y);
+  void repack(Page* page);
+  void resetSkyline(Page* page);
+  Page* getPage(AtlasEntry* entry);
+};
+}
+}
@@ -0,0 +1,216 @@
+#include "TextureCache.h"
+#include "FileUtils.h"
+#include "ImageScaler.h"
+#include "Log.h"
+
+// KTX 1.1, see the Khronos KTX file format specification
+#define KTX_HEADER_SIZE 64
+#define KTX_ENDIANNESS 0x04030201
+// Values of GL_RGB and GL_RGBA, which the file stores as they are
+#define KTX_BASE_FORMAT_RGB 0x1907
+#define KTX_BASE_FORMAT_RGBA 0x1908
+// Key of the image stamp, the value is "modified size"
+#define KTX_STAMP_KEY "ofxPiMapper.source"
+
+namespace ofx {
+namespace piMapper {
+static const unsigned char ktxIdentifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+static std::string getStamp(long long modified, unsigned long long size) {
+  std::stringstream stamp;
+  stamp << modified << " " << size;
+  return stamp.str();
+}
+
+std::string TextureCache::getCachePath(std::string imagePath) {
+  return FileUtils::getCachePath(imagePath, DEFAULT_TEXTURE_CACHE_DIR, ".ktx");
+}
+
+int TextureCache::build(std::string imagePath, std::string cachePath,
+                        int maxSize) {
+  long long modified = 0;
+  unsigned long long size = 0;
+  if (!FileUtils::getStamp(imagePath, modified, size)) return 0;
+  ofPixels pixels;
+  if (!ofLoadImage(pixels, imagePath)) {
+    PIMAPPER_LOG_WARNING("TextureCache") << "Could not decode " << imagePath;
+    return 0;
+  }
+  ImageScaler::fit(pixels, maxSize);
+  CompressedImage image;
+  image.format = EtcCodec::encode(pixels, image.data);
+  image.width = pixels.getWidth();
+  image.height = pixels.getHeight();
+  if (image.format == 0 || !write(cachePath, image, modified, size)) {
+    return 0;
+  }
+  return image.format;
+}
+
+bool TextureCache::load(std::string cachePath, std::string imagePath,
+                        CompressedImage& image) {
+  std::ifstream file(cachePath.c_str(), std::ios::binary);
+  if (!readHeader(file, imagePath, image)) return false;
+  // The size of the level follows the key value pairs
+  size_t dataSize =
+      EtcCodec::getDataSize(image.format, image.width, image.height);
+  unsigned char sizeField[4];
+  if (!file.read((char*)sizeField, 4) ||
+      FileUtils::readUInt32(sizeField) != dataSize) {
+    return false;
+  }
+  image.data.resize(dataSize);
+  file.read((char*)&image.data[0], dataSize);
+  return !file.fail();
+}
+
+bool TextureCache::isCurrent(std::string cachePath, std::string imagePath,
+                             int maxSize) {
+  std::ifstream file(cachePath.c_str(), std::ios::binary);
+  CompressedImage image;
+  return readHeader(file, imagePath, image) &&
+         (maxSize == 0 || std::max(image.width, image.height) <= maxSize);
+}
+
+bool TextureCache::readHeader(std::ifstream& file, std::string imagePath,
+                              CompressedImage& image) {
+  long long modified = 0;
+  unsigned long long size = 0;
+  if (!FileUtils::getStamp(imagePath, modified, size)) return false;
+  unsigned char header[KTX_HEADER_SIZE];
+  if (!file.is_open() || !file.read((char*)header, KTX_HEADER_SIZE) ||
+      memcmp(header, ktxIdentifier, 12) != 0 ||
+      FileUtils::readUInt32(header + 12) != KTX_ENDIANNESS) {
+    return false;
+  }
+  image.format = FileUtils::readUInt32(header + 28);
+  image.width = FileUtils::readUInt32(header + 36);
+  image.height = FileUtils::readUInt32(header + 40);
+  unsigned int keyValueSize = FileUtils::readUInt32(header + 60);
+  // One level of a 2D texture, as written by write
+  if (!EtcCodec::isFormat(image.format) || image.width <= 0 ||
+      image.height <= 0 || FileUtils::readUInt32(header + 44) != 0 ||
+      FileUtils::readUInt32(header + 52) != 1 ||
+      FileUtils::readUInt32(header + 56) != 1 || keyValueSize > 65536) {
+    return false;
+  }
+
+  vector<unsigned char> keyValues(keyValueSize);
+  if (keyValueSize > 0 && !file.read((char*)&keyValues[0], keyValueSize)) {
+    return false;
+  }
+  // Built from a different version of the image
+  std::string stamp;
+  unsigned int offset = 0;
+  while (offset + 4 <= keyValueSize) {
+    unsigned int entrySize = FileUtils::readUInt32(&keyValues[offset]);
+    if (entrySize > keyValueSize - offset - 4) return false;
+    std::string entry((char*)&keyValues[offset + 4], entrySize);
+    size_t separator = entry.find('\0');
+    if (separator != std::string::npos &&
+        entry.substr(0, separator) == KTX_STAMP_KEY) {
+      stamp = entry.substr(separator + 1);
+      stamp = stamp.substr(0, stamp.find('\0'));
+    }
+    offset += 4 + (entrySize + 3) / 4 * 4;
+  }
+  return stamp == getStamp(modified, size);
+}
+
+int TextureCache::getUploadFormat(int format) {
+  // Queried once, the formats do not change while running
+  static bool bQueried = false;
+  static std::set<int> formats;
+  if (!bQueried) {
+    bQueried = true;
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &numFormats);
+    if (numFormats > 0) {
+      vector<GLint> list(numFormats);
+      glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &list[0]);
+      formats.insert(list.begin(), list.end());
+    }
+    // Not every driver lists the formats of its extensions
+    const GLubyte* extensions = glGetString(GL_EXTENSIONS);
+    if (extensions != NULL) {
+      std::string names = (const char*)extensions;
+      if (names.find("GL_OES_compressed_ETC1_RGB8_texture") !=
+          std::string::npos) {
+        formats.insert(GL_ETC1_RGB8_OES);
+      }
+      if (names.find("GL_ARB_ES3_compatibility") != std::string::npos) {
+        formats.insert(GL_COMPRESSED_RGB8_ETC2);
+        formats.insert(GL_COMPRESSED_RGBA8_ETC2_EAC);
+      }
+    }
+    PIMAPPER_LOG_VERBOSE("TextureCache")
+        << "ETC1 " << formats.count(GL_ETC1_RGB8_OES) << ", ETC2 "
+        << formats.count(GL_COMPRESSED_RGBA8_ETC2_EAC);
+  }
+  if (formats.count(format)) return format;
+  if (format == GL_ETC1_RGB8_OES && formats.count(GL_COMPRESSED_RGB8_ETC2)) {
+    return GL_COMPRESSED_RGB8_ETC2;
+  }
+  return 0;
+}
+
+bool TextureCache::write(std::string path, CompressedImage& image,
+                         long long modified, unsigned long long size) {
+  size_t separator = path.rfind('/');
+  if (separator != std::string::npos) {
+    ofDirectory::createDirectory(path.substr(0, separator), false, true);
+  }
+  // Written next to it first, a half written file is never loaded
+  std::string tempPath = path + ".tmp";
+  std::ofstream file(tempPath.c_str(), std::ios::binary);
+  if (!file.is_open()) {
+    PIMAPPER_LOG_WARNING("TextureCache") << "Could not write " << tempPath;
+    return false;
+  }
+  std::string entry = KTX_STAMP_KEY;
+  entry.push_back('\0');
+  entry += getStamp(modified, size);
+  entry.push_back('\0');
+  int padding = (4 - entry.size() % 4) % 4;
+
+  file.write((char*)ktxIdentifier, 12);
+  FileUtils::writeUInt32(file, KTX_ENDIANNESS);
+  // Compressed data has no type and format, only an internal format
+  FileUtils::writeUInt32(file, 0);
+  FileUtils::writeUInt32(file, 1);
+  FileUtils::writeUInt32(file, 0);
+  FileUtils::writeUInt32(file, image.format);
+  FileUtils::writeUInt32(file, EtcCodec::hasAlpha(image.format)
+                                   ? KTX_BASE_FORMAT_RGBA
+                                   : KTX_BASE_FORMAT_RGB);
+  FileUtils::writeUInt32(file, image.width);
+  FileUtils::writeUInt32(file, image.height);
+  // No depth, no array, one face and one level
+  FileUtils::writeUInt32(file, 0);
+  FileUtils::writeUInt32(file, 0);
+  FileUtils::writeUInt32(file, 1);
+  FileUtils::writeUInt32(file, 1);
+  FileUtils::writeUInt32(file, 4 + entry.size() + padding);
+  FileUtils::writeUInt32(file, entry.size());
+  file.write(entry.c_str(), entry.size());
+  file.write("\0\0\0", padding);
+  FileUtils::writeUInt32(file, image.data.size());
+  file.write((char*)&image.data[0], image.data.size());
+  file.close();
+  if (file.fail()) {
+    PIMAPPER_LOG_WARNING("TextureCache") << "Could not write " << tempPath;
+    ofFile::removeFile(tempPath, false);
+    return false;
+  }
+
+  try {
+    Poco::File(tempPath).renameTo(path);
+  } catch (Poco::Exception& e) {
+    PIMAPPER_LOG_WARNING("TextureCache") << e.displayText();
+    return false;
+  }
+  return true;
+}
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include "EtcCodec.h"
+
+// Compressed textures are kept here in the data folder, in the folders of
+// the images, see FileUtils::getCachePath
+#define DEFAULT_TEXTURE_CACHE_DIR "textures/"
+
+namespace ofx {
+namespace piMapper {
+struct CompressedImage {
+  // See EtcCodec
+  int format;
+  int width;
+  int height;
+  vector<unsigned char> data;
+};
+
+// Images compressed with EtcCodec, stored as KTX files along with the
+// modification time and size of the image they were made from. Only
+// uploading them needs a GL context, so caches can be built on another
+// Linux machine and copied to the Pi next to the images.
+class TextureCache {
+ public:
+  // Path of the cached texture of an image in the data folder
+  static std::string getCachePath(std::string imagePath);
+  // Decodes an image, scales it to fit maxSize unless that is 0 and
+  // writes it compressed to cachePath. Returns the format, 0 if the image
+  // could not be decoded or the file not written.
+  static int build(std::string imagePath, std::string cachePath,
+                   int maxSize = 0);
+  // False if the file is missing, broken or older than the image
+  static bool load(std::string cachePath, std::string imagePath,
+                   CompressedImage& image);
+  // Reads only the header, also false if the texture is larger than
+  // maxSize unless that is 0
+  static bool isCurrent(std::string cachePath, std::string imagePath,
+                        int maxSize = 0);
+  // Format to pass to glCompressedTexImage2D for blocks of a format,
+  // 0 if the GPU can not sample them and they have to be decoded. ETC1
+  // blocks are valid ETC2 blocks. Always 0 without a GL context.
+  static int getUploadFormat(int format);
+
+ private:
+  // Checks the header and the stamp, the data size comes next
+  static bool readHeader(std::ifstream& file, std::string imagePath,
+                         CompressedImage& image);
+  static bool write(std::string path, CompressedImage& image,
+                    long long modified, unsigned long long size);
+};
+}
+}
@@ -0,0 +1,76 @@
+#include "TextureCompressor.h"
+
+namespace ofx {
+namespace piMapper {
+TextureCompressor::TextureCompressor() {
+  currentTexture.format = 0;
+  currentMaxSize = 0;
+}
+
+TextureCompressor::~TextureCompressor() { stop(); }
+
+void TextureCompressor::compress(std::string path, int maxSize) {
+  lock();
+  if (std::find(pendingPaths.begin(), pendingPaths.end(), path) ==
+      pendingPaths.end()) {
+    pendingPaths.push_back(path);
+  }
+  pendingSizes[path] = maxSize;
+  unlock();
+  wake();
+}
+
+bool TextureCompressor::isCompressing(std::string path) {
+  lock();
+  bool compressing =
+      currentPath == path ||
+      std::find(pendingPaths.begin(), pendingPaths.end(), path) !=
+          pendingPaths.end();
+  unlock();
+  return compressing;
+}
+
+bool TextureCompressor::isCompressing() {
+  lock();
+  bool compressing = currentPath != "" || pendingPaths.size() > 0;
+  unlock();
+  return compressing;
+}
+
+void TextureCompressor::getCompressed(vector<CompressedTexture>& textures) {
+  textures.clear();
+  lock();
+  textures.insert(textures.end(), compressedTextures.begin(),
+                  compressedTextures.end());
+  compressedTextures.clear();
+  unlock();
+}
+
+bool TextureCompressor::takeTask() {
+  if (!pendingPaths.size()) return false;
+  currentTexture.path = pendingPaths.front();
+  pendingPaths.pop_front();
+  currentMaxSize = pendingSizes[currentTexture.path];
+  pendingSizes.erase(currentTexture.path);
+  currentPath = currentTexture.path;
+  return true;
+}
+
+void TextureCompressor::runTask() {
+  currentTexture.format = TextureCache::build(
+      currentTexture.path, TextureCache::getCachePath(currentTexture.path),
+      currentMaxSize);
+}
+
+void TextureCompressor::finishTask() {
+  compressedTextures.push_back(currentTexture);
+  currentPath = "";
+}
+
+void TextureCompressor::clearTasks() {
+  // The image being compressed is finished, the rest is dropped
+  pendingPaths.clear();
+  pendingSizes.clear();
+}
+}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BackgroundWorker.h"
+#include "TextureCache.h"
+
+namespace ofx {
+namespace piMapper {
+struct CompressedTexture {
+  std::string path;
+  // See EtcCodec, 0 if the image could not be compressed
+  int format;
+};
+
+// Builds texture caches on a background thread, see TextureCache::build.
+// Like with ImageLoader, finished images wait until they are collected
+// with getCompressed.
+class TextureCompressor : public BackgroundWorker {
+ public:
+  TextureCompressor();
+  ~TextureCompressor();
+
+  // Queue an image unless it is queued already, it is scaled to fit
+  // maxSize unless that is 0
+  void compress(std::string path, int maxSize);
+  bool isCompressing(std::string path);
+  // Anything queued or being compressed
+  bool isCompressing();
+  // Move out everything compressed since the last call
+  void getCompressed(vector<CompressedTexture>& textures);
+
+ private:
+  std::deque<std::string> pendingPaths;
+  std::map<std::string, int> pendingSizes;
+  std::deque<CompressedTexture> compressedTextures;
+  std::string currentPath;
+  // Owned by the thread while the task runs
+  CompressedTexture currentTexture;
+  int currentMaxSize;
+
+  bool takeTask();
+  void runTask();
+  void finishTask();
+  void clearTasks();
+};
+}
+}
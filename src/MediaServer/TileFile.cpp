@@ -0,0 +1,189 @@
+#include "TileFile.h"
+#include "FileUtils.h"
+#include "ImageScaler.h"
+#include "Log.h"
+
+#define TILE_FILE_MAGIC "PMTILES1"
+// Magic, image stamp and six 32 bit fields
+#define TILE_FILE_HEADER_SIZE 48
+
+namespace ofx {
+namespace piMapper {
+TileFile::TileFile() {
+  width = 0;
+  height = 0;
+  numChannels = 0;
+  tileSize = 0;
+  previewWidth = 0;
+  previewHeight = 0;
+  dataOffset = 0;
+}
+
+bool TileFile::build(std::string imagePath, std::string tilePath,
+                     int tileSize) {
+  long long modified = 0;
+  unsigned long long size = 0;
+  if (tileSize <= 0 || !FileUtils::getStamp(imagePath, modified, size)) {
+    return false;
+  }
+  ofPixels pixels;
+  if (!ofLoadImage(pixels, imagePath)) {
+    PIMAPPER_LOG_WARNING("TileFile") << "Could not decode " << imagePath;
+    return false;
+  }
+  ofPixels preview = pixels;
+  ImageScaler::fit(preview, TILE_PREVIEW_SIZE);
+
+  size_t separator = tilePath.rfind('/');
+  if (separator != std::string::npos) {
+    ofDirectory::createDirectory(tilePath.substr(0, separator), false, true);
+  }
+  // Written next to it first, a half written file is never opened
+  std::string tempPath = tilePath + ".tmp";
+  std::ofstream file(tempPath.c_str(), std::ios::binary);
+  if (!file.is_open()) {
+    PIMAPPER_LOG_WARNING("TileFile") << "Could not write " << tempPath;
+    return false;
+  }
+  int width = pixels.getWidth();
+  int height = pixels.getHeight();
+  int numChannels = pixels.getNumChannels();
+  file.write(TILE_FILE_MAGIC, 8);
+  FileUtils::writeUInt64(file, modified);
+  FileUtils::writeUInt64(file, size);
+  FileUtils::writeUInt32(file, width);
+  FileUtils::writeUInt32(file, height);
+  FileUtils::writeUInt32(file, numChannels);
+  FileUtils::writeUInt32(file, tileSize);
+  FileUtils::writeUInt32(file, preview.getWidth());
+  FileUtils::writeUInt32(file, preview.getHeight());
+  file.write((char*)preview.getPixels(),
+             (size_t)preview.getWidth() * preview.getHeight() * numChannels);
+
+  // Row by row of each tile, see readTile for the offsets
+  const unsigned char* data = pixels.getPixels();
+  size_t rowLength = (size_t)width * numChannels;
+  for (int top = 0; top < height; top += tileSize) {
+    int tileHeight = std::min(tileSize, height - top);
+    for (int left = 0; left < width; left += tileSize) {
+      int tileWidth = std::min(tileSize, width - left);
+      for (int y = top; y < top + tileHeight; y++) {
+        file.write((char*)data + y * rowLength + left * numChannels,
+                   tileWidth * numChannels);
+      }
+    }
+  }
+  file.close();
+  if (file.fail()) {
+    PIMAPPER_LOG_WARNING("TileFile") << "Could not write " << tempPath;
+    ofFile::removeFile(tempPath, false);
+    return false;
+  }
+
+  try {
+    Poco::File(tempPath).renameTo(tilePath);
+  } catch (Poco::Exception& e) {
+    PIMAPPER_LOG_WARNING("TileFile") << e.displayText();
+    return false;
+  }
+  return true;
+}
+
+bool TileFile::open(std::string tilePath, std::string imagePath) {
+  path = "";
+  long long modified = 0;
+  unsigned long long size = 0;
+  if (!FileUtils::getStamp(imagePath, modified, size)) return false;
+  std::ifstream file(tilePath.c_str(), std::ios::binary);
+  unsigned char header[TILE_FILE_HEADER_SIZE];
+  if (!file.is_open() || !file.read((char*)header, TILE_FILE_HEADER_SIZE) ||
+      memcmp(header, TILE_FILE_MAGIC, 8) != 0) {
+    return false;
+  }
+  // Built from a different version of the image
+  if ((long long)FileUtils::readUInt64(header + 8) != modified ||
+      FileUtils::readUInt64(header + 16) != size) {
+    return false;
+  }
+  width = FileUtils::readUInt32(header + 24);
+  height = FileUtils::readUInt32(header + 28);
+  numChannels = FileUtils::readUInt32(header + 32);
+  tileSize = FileUtils::readUInt32(header + 36);
+  previewWidth = FileUtils::readUInt32(header + 40);
+  previewHeight = FileUtils::readUInt32(header + 44);
+  if (width <= 0 || height <= 0 || numChannels <= 0 || numChannels > 4 ||
+      tileSize <= 0) {
+    return false;
+  }
+  dataOffset = TILE_FILE_HEADER_SIZE +
+               (unsigned long long)previewWidth * previewHeight * numChannels;
+  // Truncated files would return garbage for the last tiles
+  file.seekg(0, std::ios::end);
+  unsigned long long expectedSize =
+      dataOffset + (unsigned long long)width * height * numChannels;
+  if ((unsigned long long)file.tellg() != expectedSize) return false;
+  path = tilePath;
+  return true;
+}
+
+bool TileFile::isOpen() { return path != ""; }
+
+bool TileFile::readPreview(ofPixels& pixels) {
+  if (!isOpen()) return false;
+  std::ifstream file(path.c_str(), std::ios::binary);
+  pixels.allocate(previewWidth, previewHeight, numChannels);
+  file.seekg(TILE_FILE_HEADER_SIZE);
+  file.read((char*)pixels.getPixels(),
+            (size_t)previewWidth * previewHeight * numChannels);
+  return !file.fail();
+}
+
+bool TileFile::readTile(int column, int row, ofPixels& pixels) {
+  if (!isOpen() || column < 0 || column >= getNumColumns() || row < 0 ||
+      row >= getNumRows()) {
+    return false;
+  }
+  int tileWidth = getTileWidth(column);
+  int tileHeight = getTileHeight(row);
+  // The rows of tiles above take whole image rows, the tiles to the left
+  // in this row are as high as this one
+  unsigned long long offset =
+      dataOffset +
+      ((unsigned long long)row * tileSize * width +
+       (unsigned long long)column * tileSize * tileHeight) *
+          numChannels;
+  std::ifstream file(path.c_str(), std::ios::binary);
+  file.seekg(offset);
+  pixels.allocate(tileWidth, tileHeight, numChannels);
+  file.read((char*)pixels.getPixels(),
+            (size_t)tileWidth * tileHeight * numChannels);
+  return !file.fail();
+}
+
+int TileFile::getWidth() { return width; }
+
+int TileFile::getHeight() { return height; }
+
+int TileFile::getNumChannels() { return numChannels; }
+
+int TileFile::getTileSize() { return tileSize; }
+
+int TileFile::getNumColumns() {
+  return tileSize > 0 ? (width + tileSize - 1) / tileSize : 0;
+}
+
+int TileFile::getNumRows() {
+  return tileSize > 0 ? (height + tileSize - 1) / tileSize : 0;
+}
+
+int TileFile::getNumTiles() { return getNumColumns() * getNumRows(); }
+
+int TileFile::getTileWidth(int column) {
+  return std::min(tileSize, width - column * tileSize);
+}
+
+int TileFile::getTileHeight(int row) {
+  return std::min(tileSize, height - row * tileSize);
+}
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+
+// Width and height of a tile in pixels
+#define DEFAULT_TILE_SIZE 512
+// Longer side of the preview stored along with the tiles
+#define TILE_PREVIEW_SIZE 1024
+
+namespace ofx {
+namespace piMapper {
+// An image cut into a grid of tiles, stored uncompressed so any tile can
+// be read without decoding the rest. Tiles are in rows from the top left,
+// the ones in the last column and row may be smaller. A downscaled
+// preview of the whole image comes before them.
+class TileFile {
+ public:
+  TileFile();
+
+  // Decodes an image once and writes its tiles to tilePath. The whole
+  // image has to fit into memory while doing so.
+  static bool build(std::string imagePath, std::string tilePath,
+                    int tileSize = DEFAULT_TILE_SIZE);
+
+  // Reads the header, false if the file is missing, broken or older
+  // than the image it was built from
+  bool open(std::string tilePath, std::string imagePath);
+  bool isOpen();
+  // Tiles and the preview are read with a stream of their own, so any
+  // thread can call these once the file is open
+  bool readPreview(ofPixels& pixels);
+  bool readTile(int column, int row, ofPixels& pixels);
+
+  int getWidth();
+  int getHeight();
+  int getNumChannels();
+  int getTileSize();
+  int getNumColumns();
+  int getNumRows();
+  int getNumTiles();
+  int getTileWidth(int column);
+  int getTileHeight(int row);
+
+ private:
+  std::string path;
+  int width;
+  int height;
+  int numChannels;
+  int tileSize;
+  int previewWidth;
+  int previewHeight;
+  // Offset of the first tile
+  unsigned long long dataOffset;
+};
+}
+}
@@ -0,0 +1,123 @@
+#include "TileLoader.h"
+
+namespace ofx {
+namespace piMapper {
+TileLoader::TileLoader() {
+  bPreparePending = false;
+  bPreparing = false;
+  currentTile = -1;
+  numReads = 0;
+  bCurrentPrepare = false;
+}
+
+TileLoader::~TileLoader() { stop(); }
+
+void TileLoader::prepare(std::string imagePath, std::string tilePath) {
+  lock();
+  prepareImagePath = imagePath;
+  prepareTilePath = tilePath;
+  bPreparePending = true;
+  bPreparing = true;
+  unlock();
+  wake();
+}
+
+bool TileLoader::isPreparing() {
+  lock();
+  bool preparing = bPreparing;
+  unlock();
+  return preparing;
+}
+
+void TileLoader::setFile(TileFile& tileFile) {
+  lock();
+  file = tileFile;
+  unlock();
+}
+
+void TileLoader::load(int index) {
+  if (isLoading(index)) return;
+  lock();
+  pendingTiles.push_back(index);
+  unlock();
+  wake();
+}
+
+bool TileLoader::isLoading(int index) {
+  lock();
+  bool loading =
+      currentTile == index ||
+      std::find(pendingTiles.begin(), pendingTiles.end(), index) !=
+          pendingTiles.end();
+  for (int i = 0; !loading && i < loadedTiles.size(); i++) {
+    loading = loadedTiles[i].index == index;
+  }
+  unlock();
+  return loading;
+}
+
+void TileLoader::getLoaded(vector<LoadedTile>& tiles) {
+  tiles.clear();
+  lock();
+  tiles.insert(tiles.end(), loadedTiles.begin(), loadedTiles.end());
+  loadedTiles.clear();
+  unlock();
+}
+
+int TileLoader::getNumReads() {
+  lock();
+  int reads = numReads;
+  unlock();
+  return reads;
+}
+
+bool TileLoader::takeTask() {
+  if (bPreparePending) {
+    bCurrentPrepare = true;
+    currentImagePath = prepareImagePath;
+    currentTilePath = prepareTilePath;
+    bPreparePending = false;
+    return true;
+  }
+  if (!pendingTiles.size()) return false;
+  bCurrentPrepare = false;
+  currentLoaded = LoadedTile();
+  currentLoaded.index = pendingTiles.front();
+  pendingTiles.pop_front();
+  currentTile = currentLoaded.index;
+  currentFile = file;
+  return true;
+}
+
+void TileLoader::runTask() {
+  if (bCurrentPrepare) {
+    TileFile::build(currentImagePath, currentTilePath);
+    return;
+  }
+  int numColumns = currentFile.getNumColumns();
+  int index = currentLoaded.index;
+  currentLoaded.success =
+      numColumns > 0 && currentFile.readTile(index % numColumns,
+                                             index / numColumns,
+                                             currentLoaded.pixels);
+}
+
+void TileLoader::finishTask() {
+  if (bCurrentPrepare) {
+    // Asked to prepare again in the meantime
+    if (!bPreparePending) bPreparing = false;
+    return;
+  }
+  loadedTiles.push_back(currentLoaded);
+  currentLoaded = LoadedTile();
+  currentTile = -1;
+  numReads++;
+}
+
+void TileLoader::clearTasks() {
+  // A file being built is finished, queued tiles are not needed anymore
+  bPreparePending = false;
+  pendingTiles.clear();
+}
+}
+}
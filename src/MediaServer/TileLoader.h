@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BackgroundWorker.h"
+#include "TileFile.h"
+
+namespace ofx {
+namespace piMapper {
+struct LoadedTile {
+  // Column plus row times the number of columns
+  int index;
+  ofPixels pixels;
+  // False if the tile could not be read
+  bool success;
+};
+
+// Reads tiles of a TileFile on a background thread, after building the
+// file if asked to. Like with ImageLoader, finished tiles wait until
+// they are collected with getLoaded.
+class TileLoader : public BackgroundWorker {
+ public:
+  TileLoader();
+  ~TileLoader();
+
+  // Builds the tile file of an image, see TileFile::build. Open it once
+  // isPreparing is false again.
+  void prepare(std::string imagePath, std::string tilePath);
+  bool isPreparing();
+  // Tiles are read from a copy of the open file
+  void setFile(TileFile& tileFile);
+  // Queue a tile unless it is queued or read already
+  void load(int index);
+  bool isLoading(int index);
+  // Move out everything read since the last call
+  void getLoaded(vector<LoadedTile>& tiles);
+  // Tiles read from the disk so far
+  int getNumReads();
+
+ private:
+  TileFile file;
+  std::string prepareImagePath;
+  std::string prepareTilePath;
+  bool bPreparePending;
+  bool bPreparing;
+  std::deque<int> pendingTiles;
+  std::deque<LoadedTile> loadedTiles;
+  int currentTile;
+  int numReads;
+  // Owned by the thread while the task runs
+  bool bCurrentPrepare;
+  std::string currentImagePath;
+  std::string currentTilePath;
+  TileFile currentFile;
+  LoadedTile currentLoaded;
+
+  bool takeTask();
+  void runTask();
+  void finishTask();
+  void clearTasks();
+};
+}
+}
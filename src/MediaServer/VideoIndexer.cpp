@@ -0,0 +1,77 @@
+#include "VideoIndexer.h"
+
+namespace ofx {
+namespace piMapper {
+VideoIndexer::VideoIndexer() { bCurrentCancelled = false; }
+
+VideoIndexer::~VideoIndexer() { stop(); }
+
+void VideoIndexer::index(std::string path) {
+  lock();
+  if (std::find(pendingPaths.begin(), pendingPaths.end(), path) ==
+          pendingPaths.end() &&
+      (currentPath != path || bCurrentCancelled)) {
+    pendingPaths.push_back(path);
+  }
+  unlock();
+  wake();
+}
+
+void VideoIndexer::cancel(std::string path) {
+  lock();
+  std::deque<std::string>::iterator it =
+      std::find(pendingPaths.begin(), pendingPaths.end(), path);
+  if (it != pendingPaths.end()) {
+    pendingPaths.erase(it);
+  }
+  if (currentPath == path) {
+    bCurrentCancelled = true;
+  }
+  for (int i = 0; i < indexedFiles.size(); i++) {
+    if (indexedFiles[i].getPath() == path) {
+      indexedFiles.erase(indexedFiles.begin() + i);
+      break;
+    }
+  }
+  unlock();
+}
+
+bool VideoIndexer::isIndexing() {
+  lock();
+  bool indexing = pendingPaths.size() || currentPath != "";
+  unlock();
+  return indexing;
+}
+
+void VideoIndexer::getIndexed(vector<KeyframeIndex>& indices) {
+  indices.clear();
+  lock();
+  indices.insert(indices.end(), indexedFiles.begin(), indexedFiles.end());
+  indexedFiles.clear();
+  unlock();
+}
+
+bool VideoIndexer::takeTask() {
+  if (!pendingPaths.size()) return false;
+  currentPath = pendingPaths.front();
+  pendingPaths.pop_front();
+  bCurrentCancelled = false;
+  return true;
+}
+
+void VideoIndexer::runTask() {
+  currentIndex = KeyframeIndex();
+  currentIndex.build(currentPath);
+}
+
+void VideoIndexer::finishTask() {
+  if (!bCurrentCancelled) {
+    indexedFiles.push_back(currentIndex);
+  }
+  currentPath = "";
+  bCurrentCancelled = false;
+}
+
+void VideoIndexer::clearTasks() { pendingPaths.clear(); }
+}
+}
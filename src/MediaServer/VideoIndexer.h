@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BackgroundWorker.h"
+#include "KeyframeIndex.h"
+
+namespace ofx {
+namespace piMapper {
+// Builds keyframe indices of video files on a background thread, one
+// file after the other. Finished indices are collected with getIndexed.
+class VideoIndexer : public BackgroundWorker {
+ public:
+  VideoIndexer();
+  ~VideoIndexer();
+
+  // Queue a file, nothing happens if it is queued already
+  void index(std::string path);
+  // Forget a queued or finished file, one being read is dropped later
+  void cancel(std::string path);
+  // True while any file is queued or being read
+  bool isIndexing();
+  // Move out everything finished since the last call, the index of a
+  // file that could not be read is empty
+  void getIndexed(vector<KeyframeIndex>& indices);
+
+ private:
+  std::deque<std::string> pendingPaths;
+  std::deque<KeyframeIndex> indexedFiles;
+  std::string currentPath;
+  bool bCurrentCancelled;
+  // Owned by the thread while the task runs
+  KeyframeIndex currentIndex;
+
+  bool takeTask();
+  void runTask();
+  void finishTask();
+  void clearTasks();
+};
+}
+}
@@ -0,0 +1,66 @@
+#include "VideoSync.h"
+
+namespace ofx {
+namespace piMapper {
+VideoSync::VideoSync() { reset(); }
+
+int VideoSync::update(double clockTime, double playerTime, double duration,
+                      double frameDuration) {
+  if (duration <= 0.0) return CORRECTION_NONE;
+
+  double target = fmod(clockTime, duration);
+  if (target < 0.0) target += duration;
+  // Shortest way around the loop point
+  error = playerTime - target;
+  if (error > duration / 2.0) error -= duration;
+  if (error < -duration / 2.0) error += duration;
+
+  double absError = fabs(error);
+  maxError = std::max(maxError, absError);
+  totalError += absError;
+  numUpdates++;
+
+  if (absError > SYNC_SEEK_THRESHOLD) {
+    seekTime = target;
+    numSeeks++;
+    return CORRECTION_SEEK;
+  }
+  if (absError < frameDuration / 2.0) {
+    return CORRECTION_NONE;
+  }
+  if (error > 0.0) {
+    numRepeated++;
+    return CORRECTION_REPEAT;
+  }
+  numDropped++;
+  return CORRECTION_DROP;
+}
+
+double VideoSync::getSeekTime() { return seekTime; }
+
+double VideoSync::getError() { return error; }
+
+double VideoSync::getMaxError() { return maxError; }
+
+double VideoSync::getAverageError() {
+  return numUpdates > 0 ? totalError / numUpdates : 0.0;
+}
+
+int VideoSync::getNumRepeated() { return numRepeated; }
+
+int VideoSync::getNumDropped() { return numDropped; }
+
+int VideoSync::getNumSeeks() { return numSeeks; }
+
+void VideoSync::reset() {
+  error = 0.0;
+  maxError = 0.0;
+  totalError = 0.0;
+  numUpdates = 0;
+  numRepeated = 0;
+  numDropped = 0;
+  numSeeks = 0;
+  seekTime = 0.0;
+}
+}
+}
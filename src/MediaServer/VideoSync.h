@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Errors larger than this are corrected by seeking, in seconds
+#define SYNC_SEEK_THRESHOLD 0.5
+// Playback speed of a player that fell behind, until it has caught up
+#define SYNC_CATCH_UP_SPEED 1.25f
+
+namespace ofx {
+namespace piMapper {
+// Decides how a video player is corrected to follow the show clock.
+// Clips loop, so the target position is the clock time modulo the clip
+// duration. Small errors are corrected by repeating a frame per update
+// while ahead and playing at SYNC_CATCH_UP_SPEED while behind, large ones
+// by seeking. It does not know about players, a simulated one driven by
+// a virtual ShowClock works just as well.
+class VideoSync {
+ public:
+  enum {
+    CORRECTION_NONE,
+    CORRECTION_REPEAT,
+    CORRECTION_DROP,
+    CORRECTION_SEEK
+  };
+
+  VideoSync();
+
+  // Returns the correction the player should apply now
+  int update(double clockTime, double playerTime, double duration,
+             double frameDuration);
+  // Position to seek to after CORRECTION_SEEK
+  double getSeekTime();
+
+  // Signed error of the last update in seconds, positive means ahead
+  double getError();
+  double getMaxError();
+  double getAverageError();
+  int getNumRepeated();
+  int getNumDropped();
+  int getNumSeeks();
+  void reset();
+
+ private:
+  double error;
+  double maxError;
+  double totalError;
+  int numUpdates;
+  int numRepeated;
+  int numDropped;
+  int numSeeks;
+  double seekTime;
+};
+}
+}
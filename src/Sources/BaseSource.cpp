@@ -1,4 +1,5 @@
 #include "BaseSource.h"
+#include "RenderStats.h"
 
 namespace ofx {
   namespace piMapper {
@@ -18,6 +19,28 @@ namespace ofx {
       return texture;
     }
     
+    ofRectangle BaseSource::getTextureRegion() {
+      return ofRectangle(0.0f, 0.0f, 1.0f, 1.0f);
+    }
+    
+    BaseSource* BaseSource::getView(ofRectangle texCoordBounds) {
+      return this;
+    }
+    
+    float BaseSource::getWidth() {
+      if (getTexture() == NULL) return 0.0f;
+      return getTexture()->getWidth() * getTextureRegion().width;
+    }
+    
+    float BaseSource::getHeight() {
+      if (getTexture() == NULL) return 0.0f;
+      return getTexture()->getHeight() * getTextureRegion().height;
+    }
+    
+    unsigned long long BaseSource::getTextureMemory() {
+      return RenderStats::getTextureMemory(getTexture());
+    }
+    
     std::string& BaseSource::getName() {
       return name;
     }
@@ -10,8 +10,21 @@ namespace ofx {
     public:
       BaseSource();
       BaseSource(ofTexture* newTexture); // Only one clean way of passing the texture
-      ~BaseSource();
-      ofTexture* getTexture();
+      virtual ~BaseSource();
+      virtual ofTexture* getTexture();
+      // Normalized part of the texture the source shows, surfaces map
+      // their texture coordinates into it. The whole texture by default.
+      virtual ofRectangle getTextureRegion();
+      // Source to draw a surface with these normalized texture coordinate
+      // bounds from, with a texture and region of its own. Sources too
+      // large for one texture return a part of them, see
+      // TiledImageSource. The source itself by default.
+      virtual BaseSource* getView(ofRectangle texCoordBounds);
+      // Size of that part in pixels, 0 without a texture
+      float getWidth();
+      float getHeight();
+      // Bytes the texture takes on the GPU, 0 if there is none
+      virtual unsigned long long getTextureMemory();
       std::string& getName();
       bool isLoadable(); // Maybe the loading features shoud go to a derrived class
       bool isLoaded();   // as BaseSourceLoadable
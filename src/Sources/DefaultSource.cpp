@@ -0,0 +1,45 @@
+#include "DefaultSource.h"
+
+namespace ofx {
+  namespace piMapper {
+    ofTexture* DefaultSource::sharedTexture = NULL;
+    int DefaultSource::numInstances = 0;
+
+    DefaultSource::DefaultSource() {
+      numInstances++;
+    }
+
+    DefaultSource::~DefaultSource() {
+      numInstances--;
+      if (numInstances <= 0 && sharedTexture != NULL) {
+        sharedTexture->clear();
+        delete sharedTexture;
+        sharedTexture = NULL;
+      }
+      texture = NULL;
+    }
+
+    ofTexture* DefaultSource::getTexture() {
+      if (sharedTexture == NULL) {
+        createTexture();
+      }
+      texture = sharedTexture;
+      return texture;
+    }
+
+    void DefaultSource::createTexture() {
+      ofPixels pixels;
+      pixels.allocate(DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, 1);
+      int squareSize = DEFAULT_TEXTURE_SQUARE_SIZE;
+      for (int y = 0; y < pixels.getHeight(); y++) {
+        bool sy = (y / squareSize) % 2 == 1;
+        for (int x = 0; x < pixels.getWidth(); x++) {
+          bool sx = (x / squareSize) % 2 == 1;
+          pixels[y * pixels.getWidth() + x] = sx == sy ? 255 : 0;
+        }
+      }
+      sharedTexture = new ofTexture();
+      sharedTexture->loadData(pixels);
+    }
+  }
+}
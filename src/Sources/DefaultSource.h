@@ -0,0 +1,25 @@
+#pragma once
+
+#include "BaseSource.h"
+
+// Size of the test pattern texture and its squares
+#define DEFAULT_TEXTURE_SIZE 500
+#define DEFAULT_TEXTURE_SQUARE_SIZE 10
+
+namespace ofx {
+  namespace piMapper {
+    // Checkerboard test pattern shown by surfaces without a source.
+    // All surfaces share one texture that is created on first use,
+    // so surfaces can be created without a GL context.
+    class DefaultSource : public BaseSource {
+    public:
+      DefaultSource();
+      ~DefaultSource();
+      ofTexture* getTexture();
+    private:
+      static ofTexture* sharedTexture;
+      static int numInstances;
+      static void createTexture();
+    };
+  }
+}
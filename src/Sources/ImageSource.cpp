@@ -1,4 +1,8 @@
 #include "ImageSource.h"
+#include "ImageScaler.h"
+#include "EtcCodec.h"
+#include "RenderStats.h"
+#include "Log.h"
 
 namespace ofx {
   namespace piMapper {
@@ -7,33 +11,182 @@ namespace ofx {
       loadable = true;
       loaded = false;
       type = SourceType::SOURCE_TYPE_IMAGE;
+      image = NULL;
+      compressedTexture = NULL;
+      atlas = NULL;
+      atlasEntry = NULL;
+      maxSize = 0;
+      crop.set(0.0f, 0.0f, 1.0f, 1.0f);
     }
     
     ImageSource::~ImageSource() {}
     
+    void ImageSource::setAtlas(TextureAtlas* newAtlas) {
+      atlas = newAtlas;
+    }
+    
+    void ImageSource::setMaxSize(int size) {
+      maxSize = size;
+    }
+    
+    void ImageSource::setCrop(ofRectangle newCrop) {
+      crop = newCrop;
+    }
+    
+    ofRectangle& ImageSource::getCrop() {
+      return crop;
+    }
+    
     void ImageSource::loadImage(std::string& filePath) {
+      if (atlas != NULL || maxSize > 0 ||
+          crop != ofRectangle(0.0f, 0.0f, 1.0f, 1.0f)) {
+        // The size is only known after decoding
+        ofPixels pixels;
+        ofLoadImage(pixels, filePath);
+        ImageScaler::crop(pixels, crop);
+        loadImage(filePath, pixels);
+        return;
+      }
       path = filePath;
       //cout << "loading image: " << filePath << endl;
       setNameFromPath(filePath);
       //cout << "path: " << path << endl;
       image = new ofImage();
       if (!image->loadImage(filePath)) {
-        ofLogWarning("ImageSource") << "Could not load image";
+        PIMAPPER_LOG_WARNING("ImageSource") << "Could not load image";
         //std::exit(EXIT_FAILURE);
       }
       texture = &image->getTextureReference();
+      PIMAPPER_COUNT_TEXTURE_UPLOAD(getTextureMemory());
+      loaded = true;
+    }
+    
+    void ImageSource::loadImage(std::string& filePath, ofPixels& pixels) {
+      path = filePath;
+      setNameFromPath(filePath);
+      // Nothing to do if the image loader scaled it already
+      ImageScaler::fit(pixels, maxSize);
+      if (atlas != NULL) {
+        atlasEntry = atlas->add(filePath, pixels);
+        if (atlasEntry != NULL) {
+          loaded = true;
+          return;
+        }
+      }
+      image = new ofImage();
+      if (pixels.isAllocated()) {
+        image->setFromPixels(pixels);
+      } else {
+        PIMAPPER_LOG_WARNING("ImageSource") << "Could not load image";
+      }
+      texture = &image->getTextureReference();
+      PIMAPPER_COUNT_TEXTURE_UPLOAD(getTextureMemory());
       loaded = true;
     }
     
+    bool ImageSource::loadCompressed(std::string& filePath) {
+      CompressedImage compressed;
+      if (!TextureCache::load(TextureCache::getCachePath(filePath), filePath,
+                              compressed) ||
+          (maxSize > 0 &&
+           std::max(compressed.width, compressed.height) > maxSize)) {
+        return false;
+      }
+      // The cache holds the whole image
+      crop.set(0.0f, 0.0f, 1.0f, 1.0f);
+      int uploadFormat = TextureCache::getUploadFormat(compressed.format);
+      if (uploadFormat == 0) {
+        // Still faster than decoding the image file
+        ofPixels pixels;
+        EtcCodec::decode(&compressed.data[0], compressed.data.size(),
+                         compressed.format, compressed.width,
+                         compressed.height, pixels);
+        loadImage(filePath, pixels);
+        return true;
+      }
+      path = filePath;
+      setNameFromPath(filePath);
+      // Compressed textures can not be rectangle textures
+      compressedTexture = new ofTexture();
+      compressedTexture->allocate(compressed.width, compressed.height, GL_RGB,
+                                  false);
+      ofTextureData& data = compressedTexture->getTextureData();
+      // Sampled in full, also where a power of two size was allocated
+      data.tex_w = compressed.width;
+      data.tex_h = compressed.height;
+      data.tex_t = 1.0f;
+      data.tex_u = 1.0f;
+      data.glTypeInternal = uploadFormat;
+      glBindTexture(data.textureTarget, data.textureID);
+      glCompressedTexImage2D(data.textureTarget, 0, uploadFormat,
+                             compressed.width, compressed.height, 0,
+                             compressed.data.size(), &compressed.data[0]);
+      glBindTexture(data.textureTarget, 0);
+      texture = compressedTexture;
+      PIMAPPER_COUNT_TEXTURE_UPLOAD(compressed.data.size());
+      loaded = true;
+      return true;
+    }
+    
     void ImageSource::clear() {
       texture = NULL;
-      image->clear();
-      delete image;
-      image = NULL;
+      if (atlasEntry != NULL) {
+        atlas->remove(atlasEntry);
+        atlasEntry = NULL;
+      }
+      if (image != NULL) {
+        image->clear();
+        delete image;
+        image = NULL;
+      }
+      if (compressedTexture != NULL) {
+        compressedTexture->clear();
+        delete compressedTexture;
+        compressedTexture = NULL;
+      }
       //path = "";
       //name = "";
       loaded = false;
     }
     
+    void ImageSource::reload(ofPixels& pixels, ofRectangle newCrop) {
+      std::string filePath = path;
+      clear();
+      crop = newCrop;
+      loadImage(filePath, pixels);
+    }
+    
+    ofTexture* ImageSource::getTexture() {
+      return atlasEntry != NULL ? atlasEntry->texture : texture;
+    }
+    
+    ofRectangle ImageSource::getTextureRegion() {
+      ofRectangle region = atlasEntry != NULL ? atlasEntry->region
+                                              : BaseSource::getTextureRegion();
+      if (crop == ofRectangle(0.0f, 0.0f, 1.0f, 1.0f)) return region;
+      // The texture holds only the crop, the whole image reaches past it
+      return ofRectangle(region.x - crop.x / crop.width * region.width,
+                         region.y - crop.y / crop.height * region.height,
+                         region.width / crop.width,
+                         region.height / crop.height);
+    }
+    
+    unsigned long long ImageSource::getTextureMemory() {
+      // The page is shared, count only the part of this image
+      if (atlasEntry != NULL) {
+        return (unsigned long long)atlasEntry->pixels.getWidth() *
+               atlasEntry->pixels.getHeight() * 4;
+      }
+      return BaseSource::getTextureMemory();
+    }
+    
+    bool ImageSource::isPacked() {
+      return atlasEntry != NULL;
+    }
+    
+    bool ImageSource::isCompressed() {
+      return compressedTexture != NULL;
+    }
+    
   }
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "BaseSource.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
 
 namespace ofx {
   namespace piMapper {
@@ -9,10 +11,42 @@ namespace ofx {
       ImageSource();
       ~ImageSource();
       std::string& getPath();
+      // Small images are packed into this atlas instead of getting their
+      // own texture, set it before loading. NULL turns packing off.
+      void setAtlas(TextureAtlas* newAtlas);
+      // Images larger than this are scaled down before the upload,
+      // 0 uploads them as they are. Set it before loading.
+      void setMaxSize(int size);
+      // Only this normalized part of the file is uploaded, set it before
+      // loading. Texture coordinates still address the whole image.
+      void setCrop(ofRectangle newCrop);
+      ofRectangle& getCrop();
       void loadImage(std::string& filePath);
+      // Use pixels decoded elsewhere, only the texture upload happens here.
+      // They are cropped already, see ImageScaler::crop.
+      void loadImage(std::string& filePath, ofPixels& pixels);
+      // Replace the texture with a different crop of the same file
+      void reload(ofPixels& pixels, ofRectangle newCrop);
+      // Load the image from its TextureCache file instead, whole and not
+      // packed. The blocks are uploaded as they are if the GPU takes
+      // them, otherwise they are decoded here. False if there is no
+      // current cache file or it is larger than the maximum size.
+      bool loadCompressed(std::string& filePath);
       void clear();
+      // The atlas page if the image is packed
+      ofTexture* getTexture();
+      ofRectangle getTextureRegion();
+      unsigned long long getTextureMemory();
+      bool isPacked();
+      // The texture holds the blocks of the cache file
+      bool isCompressed();
     private:
       ofImage* image;
+      ofTexture* compressedTexture;
+      TextureAtlas* atlas;
+      int maxSize;
+      ofRectangle crop;
+      AtlasEntry* atlasEntry;
     };
   }
-}
\ No newline at end of file
+}
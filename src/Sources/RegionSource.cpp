@@ -0,0 +1,85 @@
+#include "RegionSource.h"
+
+namespace ofx {
+  namespace piMapper {
+    RegionSource::RegionSource() {
+      loadable = true;
+      loaded = false;
+      type = SourceType::SOURCE_TYPE_REGION;
+      parent = NULL;
+      region.set(0.0f, 0.0f, 1.0f, 1.0f);
+    }
+    
+    RegionSource::~RegionSource() {}
+    
+    void RegionSource::setup(BaseSource* newParent, std::string& regionPath,
+                             std::string parentType, ofRectangle& newRegion) {
+      parent = newParent;
+      path = regionPath;
+      region = newRegion;
+      name = makeName(parentType, parent->getName(), region);
+      loaded = true;
+    }
+    
+    ofTexture* RegionSource::getTexture() {
+      // Video sources get their texture when the player is ready
+      return parent != NULL ? parent->getTexture() : NULL;
+    }
+    
+    ofRectangle RegionSource::getTextureRegion() {
+      if (parent == NULL) return region;
+      // Parents may show a part of their texture themselves
+      ofRectangle parentRegion = parent->getTextureRegion();
+      return ofRectangle(parentRegion.x + region.x * parentRegion.width,
+                         parentRegion.y + region.y * parentRegion.height,
+                         region.width * parentRegion.width,
+                         region.height * parentRegion.height);
+    }
+    
+    BaseSource* RegionSource::getParent() {
+      return parent;
+    }
+    
+    ofRectangle& RegionSource::getRegion() {
+      return region;
+    }
+    
+    std::string RegionSource::makeName(std::string parentType,
+                                       std::string parentName,
+                                       ofRectangle region) {
+      return addRegion(parentType + "/" + parentName, region);
+    }
+    
+    std::string RegionSource::addRegion(std::string parentPath,
+                                        ofRectangle& region) {
+      std::stringstream ss;
+      ss << parentPath << "#" << region.x << "," << region.y << ","
+         << region.width << "," << region.height;
+      return ss.str();
+    }
+    
+    bool RegionSource::splitRegion(std::string regionPath,
+                                   std::string& parentPath,
+                                   ofRectangle& region) {
+      size_t separator = regionPath.rfind('#');
+      if (separator == std::string::npos) return false;
+      vector<std::string> values =
+          ofSplitString(regionPath.substr(separator + 1), ",");
+      if (values.size() != 4) return false;
+      float numbers[4];
+      for (int i = 0; i < 4; i++) {
+        std::istringstream stream(values[i]);
+        if (!(stream >> numbers[i])) return false;
+      }
+      // Empty regions or regions outside of the texture
+      if (numbers[2] <= 0.0f || numbers[3] <= 0.0f || numbers[0] < 0.0f ||
+          numbers[1] < 0.0f || numbers[0] + numbers[2] > 1.0001f ||
+          numbers[1] + numbers[3] > 1.0001f) {
+        return false;
+      }
+      parentPath = regionPath.substr(0, separator);
+      region.set(numbers[0], numbers[1], numbers[2], numbers[3]);
+      return true;
+    }
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "BaseSource.h"
+
+namespace ofx {
+  namespace piMapper {
+    // A normalized rectangle of an image or video source. It draws the
+    // texture of its parent, so any number of regions share one decode.
+    // The name is the parent type and name followed by the region, like
+    // "video/stage.mp4#0,0,0.5,0.5". The path is the parent path with the
+    // same suffix, MediaServer keeps regions by that path.
+    class RegionSource : public BaseSource {
+    public:
+      RegionSource();
+      ~RegionSource();
+      void setup(BaseSource* newParent, std::string& regionPath,
+                 std::string parentType, ofRectangle& newRegion);
+      ofTexture* getTexture();
+      ofRectangle getTextureRegion();
+      BaseSource* getParent();
+      ofRectangle& getRegion();
+      
+      static std::string makeName(std::string parentType,
+                                  std::string parentName, ofRectangle region);
+      // Appends the region to a parent name or path
+      static std::string addRegion(std::string parentPath, ofRectangle& region);
+      // False if there is no valid region at the end
+      static bool splitRegion(std::string regionPath, std::string& parentPath,
+                              ofRectangle& region);
+      
+    private:
+      BaseSource* parent;
+      ofRectangle region;
+    };
+  }
+}
@@ -5,18 +5,30 @@
 #define SOURCE_TYPE_NAME_NONE "none"
 #define SOURCE_TYPE_NAME_IMAGE "image"
 #define SOURCE_TYPE_NAME_VIDEO "video"
+#define SOURCE_TYPE_NAME_REGION "region"
+#define SOURCE_TYPE_NAME_TILED "tiled"
 
 namespace ofx {
   namespace piMapper {
     class SourceType {
     public:
-      enum { SOURCE_TYPE_NONE, SOURCE_TYPE_IMAGE, SOURCE_TYPE_VIDEO };
+      enum {
+        SOURCE_TYPE_NONE,
+        SOURCE_TYPE_IMAGE,
+        SOURCE_TYPE_VIDEO,
+        SOURCE_TYPE_REGION,
+        SOURCE_TYPE_TILED
+      };
       
       static std::string GetSourceTypeName(int sourceTypeEnum) {
         if (sourceTypeEnum == SOURCE_TYPE_IMAGE) {
           return SOURCE_TYPE_NAME_IMAGE;
         } else if (sourceTypeEnum == SOURCE_TYPE_VIDEO) {
           return SOURCE_TYPE_NAME_VIDEO;
+        } else if (sourceTypeEnum == SOURCE_TYPE_REGION) {
+          return SOURCE_TYPE_NAME_REGION;
+        } else if (sourceTypeEnum == SOURCE_TYPE_TILED) {
+          return SOURCE_TYPE_NAME_TILED;
         } else if (sourceTypeEnum == SOURCE_TYPE_NONE) {
           return SOURCE_TYPE_NAME_NONE;
         } else {
@@ -27,11 +39,25 @@ namespace ofx {
         }
       };
       
+      // Whether GetSourceTypeEnum accepts sourceTypeName, use this to check
+      // names read from files before passing them on
+      static bool IsSourceTypeName(std::string sourceTypeName) {
+        return sourceTypeName == SOURCE_TYPE_NAME_IMAGE ||
+               sourceTypeName == SOURCE_TYPE_NAME_VIDEO ||
+               sourceTypeName == SOURCE_TYPE_NAME_REGION ||
+               sourceTypeName == SOURCE_TYPE_NAME_TILED ||
+               sourceTypeName == SOURCE_TYPE_NAME_NONE;
+      }
+      
       static int GetSourceTypeEnum(std::string sourceTypeName) {
         if (sourceTypeName == SOURCE_TYPE_NAME_IMAGE) {
           return SOURCE_TYPE_IMAGE;
         } else if (sourceTypeName == SOURCE_TYPE_NAME_VIDEO) {
           return SOURCE_TYPE_VIDEO;
+        } else if (sourceTypeName == SOURCE_TYPE_NAME_REGION) {
+          return SOURCE_TYPE_REGION;
+        } else if (sourceTypeName == SOURCE_TYPE_NAME_TILED) {
+          return SOURCE_TYPE_TILED;
         } else if (sourceTypeName == SOURCE_TYPE_NAME_NONE) {
           return SOURCE_TYPE_NONE;
         } else {
@@ -0,0 +1,354 @@
+#include "TiledImageSource.h"
+#include "ImageScaler.h"
+#include "FileUtils.h"
+#include "RenderStats.h"
+#include "Log.h"
+
+namespace ofx {
+  namespace piMapper {
+    static GLint getGlFormat(int numChannels) {
+      if (numChannels == 1) return GL_LUMINANCE;
+      if (numChannels == 2) return GL_LUMINANCE_ALPHA;
+      if (numChannels == 4) return GL_RGBA;
+      return GL_RGB;
+    }
+
+    TileWindow::TileWindow() {
+      type = SourceType::SOURCE_TYPE_TILED;
+      texture = &windowTexture;
+      region.set(0.0f, 0.0f, 1.0f, 1.0f);
+      firstColumn = 0;
+      firstRow = 0;
+      lastColumn = 0;
+      lastRow = 0;
+      scale = 1;
+      lastUsedTime = 0.0f;
+    }
+
+    ofRectangle TileWindow::getTextureRegion() {
+      return region;
+    }
+
+    TiledImageSource::TiledImageSource() {
+      loadable = true;
+      loaded = false;
+      type = SourceType::SOURCE_TYPE_TILED;
+      bPreparing = false;
+      budget = DEFAULT_TILE_BUDGET;
+      maxWindowSize = 0;
+      ofAddListener(ofEvents().update, this, &TiledImageSource::update);
+    }
+
+    TiledImageSource::~TiledImageSource() {
+      ofRemoveListener(ofEvents().update, this, &TiledImageSource::update);
+      clear();
+    }
+
+    void TiledImageSource::loadImage(std::string& filePath) {
+      path = filePath;
+      setNameFromPath(filePath);
+      if (openTiles()) return;
+      PIMAPPER_LOG_NOTICE("TiledImageSource") << "Cutting " << path
+                                              << " into tiles";
+      loader.prepare(path, getTilePath(path));
+      bPreparing = true;
+    }
+
+    void TiledImageSource::clear() {
+      for (int i = 0; i < windows.size(); i++) {
+        delete windows[i];
+      }
+      windows.clear();
+      tiles.clear();
+      preview.clear();
+      previewPixels.clear();
+      texture = NULL;
+      loaded = false;
+    }
+
+    bool TiledImageSource::isPreparing() {
+      return bPreparing;
+    }
+
+    BaseSource* TiledImageSource::getView(ofRectangle texCoordBounds) {
+      if (!loaded) return this;
+      int width = file.getWidth();
+      int height = file.getHeight();
+      int tileSize = file.getTileSize();
+      // Pixels of the image the texture coordinates touch
+      int left = ofClamp(floor(texCoordBounds.getLeft() * width), 0, width - 1);
+      int top = ofClamp(floor(texCoordBounds.getTop() * height), 0,
+                        height - 1);
+      int right = ofClamp(ceil(texCoordBounds.getRight() * width), left + 1,
+                          width);
+      int bottom = ofClamp(ceil(texCoordBounds.getBottom() * height), top + 1,
+                           height);
+      int firstColumn = left / tileSize;
+      int firstRow = top / tileSize;
+      int lastColumn = (right - 1) / tileSize;
+      int lastRow = (bottom - 1) / tileSize;
+
+      int windowWidth =
+          std::min((lastColumn + 1) * tileSize, width) - firstColumn * tileSize;
+      int windowHeight =
+          std::min((lastRow + 1) * tileSize, height) - firstRow * tileSize;
+      int scale = 1;
+      while (maxWindowSize > 0 && scale < tileSize &&
+             ((windowWidth + scale - 1) / scale > maxWindowSize ||
+              (windowHeight + scale - 1) / scale > maxWindowSize)) {
+        scale *= 2;
+      }
+      // Tiles shrunk this much are no sharper than the preview
+      if ((float)width / scale <= previewPixels.getWidth()) return this;
+
+      for (int i = 0; i < windows.size(); i++) {
+        TileWindow* window = windows[i];
+        if (window->firstColumn == firstColumn && window->firstRow == firstRow &&
+            window->lastColumn == lastColumn && window->lastRow == lastRow &&
+            window->scale == scale) {
+          window->lastUsedTime = ofGetElapsedTimef();
+          return window;
+        }
+      }
+      return createWindow(firstColumn, firstRow, lastColumn, lastRow, scale);
+    }
+
+    unsigned long long TiledImageSource::getTextureMemory() {
+      unsigned long long memory = RenderStats::getTextureMemory(&preview);
+      for (int i = 0; i < windows.size(); i++) {
+        memory += RenderStats::getTextureMemory(&windows[i]->windowTexture);
+      }
+      return memory;
+    }
+
+    void TiledImageSource::setBudget(unsigned long long bytes) {
+      budget = bytes;
+      evictTiles();
+    }
+
+    unsigned long long TiledImageSource::getBudget() {
+      return budget;
+    }
+
+    void TiledImageSource::setMaxWindowSize(int size) {
+      maxWindowSize = std::max(size, 0);
+    }
+
+    int TiledImageSource::getImageWidth() {
+      return file.getWidth();
+    }
+
+    int TiledImageSource::getImageHeight() {
+      return file.getHeight();
+    }
+
+    int TiledImageSource::getNumTiles() {
+      return file.getNumTiles();
+    }
+
+    int TiledImageSource::getNumResidentTiles() {
+      return tiles.size();
+    }
+
+    unsigned long long TiledImageSource::getResidentMemory() {
+      unsigned long long memory = 0;
+      std::map<int, CachedTile>::iterator it;
+      for (it = tiles.begin(); it != tiles.end(); it++) {
+        memory += it->second.pixels.size();
+      }
+      for (int i = 0; i < windows.size(); i++) {
+        memory += RenderStats::getTextureMemory(&windows[i]->windowTexture);
+      }
+      return memory;
+    }
+
+    int TiledImageSource::getNumWindows() {
+      return windows.size();
+    }
+
+    int TiledImageSource::getNumTileReads() {
+      return loader.getNumReads();
+    }
+
+    std::string TiledImageSource::getTilePath(std::string& imagePath) {
+      return FileUtils::getCachePath(imagePath, DEFAULT_TILE_CACHE_DIR,
+                                     ".tiles");
+    }
+
+    void TiledImageSource::update(ofEventArgs& args) {
+      if (bPreparing && !loader.isPreparing()) {
+        bPreparing = false;
+        if (!openTiles()) {
+          PIMAPPER_LOG_WARNING("TiledImageSource") << "Could not cut " << path
+                                                   << " into tiles";
+        }
+      }
+
+      vector<LoadedTile> loadedTiles;
+      loader.getLoaded(loadedTiles);
+      for (int i = 0; i < loadedTiles.size(); i++) {
+        int index = loadedTiles[i].index;
+        if (!loadedTiles[i].success) {
+          PIMAPPER_LOG_WARNING("TiledImageSource") << "Could not read tile "
+                                                   << index << " of " << path;
+        } else {
+          CachedTile& tile = tiles[index];
+          tile.pixels.swap(loadedTiles[i].pixels);
+          tile.lastUsedTime = ofGetElapsedTimef();
+        }
+        // Failed tiles keep showing the preview
+        for (int j = 0; j < windows.size(); j++) {
+          if (!windows[j]->missingTiles.erase(index)) continue;
+          if (loadedTiles[i].success) {
+            drawTile(windows[j], index % file.getNumColumns(),
+                     index / file.getNumColumns());
+          }
+        }
+      }
+
+      releaseWindows();
+      evictTiles();
+    }
+
+    bool TiledImageSource::openTiles() {
+      if (!file.open(getTilePath(path), path) ||
+          !file.readPreview(previewPixels)) {
+        return false;
+      }
+      loader.setFile(file);
+      preview.allocate(previewPixels);
+      preview.loadData(previewPixels);
+      PIMAPPER_COUNT_TEXTURE_UPLOAD(previewPixels.size());
+      texture = &preview;
+      loaded = true;
+      PIMAPPER_LOG_VERBOSE("TiledImageSource")
+          << "Opened " << file.getNumTiles() << " tiles of " << path;
+      return true;
+    }
+
+    TileWindow* TiledImageSource::createWindow(int firstColumn, int firstRow,
+                                               int lastColumn, int lastRow,
+                                               int scale) {
+      TileWindow* window = new TileWindow();
+      window->firstColumn = firstColumn;
+      window->firstRow = firstRow;
+      window->lastColumn = lastColumn;
+      window->lastRow = lastRow;
+      window->scale = scale;
+      window->lastUsedTime = ofGetElapsedTimef();
+
+      // Only the last tile of a row or column can be smaller
+      int tileSize = file.getTileSize();
+      int width = (lastColumn - firstColumn) * tileSize / scale +
+                  (file.getTileWidth(lastColumn) + scale - 1) / scale;
+      int height = (lastRow - firstRow) * tileSize / scale +
+                   (file.getTileHeight(lastRow) + scale - 1) / scale;
+      window->windowTexture.allocate(width, height,
+                                     getGlFormat(file.getNumChannels()));
+      float imageWidth = (float)file.getWidth() / scale;
+      float imageHeight = (float)file.getHeight() / scale;
+      window->region.set(-(float)firstColumn * tileSize / scale / width,
+                         -(float)firstRow * tileSize / scale / height,
+                         imageWidth / width, imageHeight / height);
+      windows.push_back(window);
+
+      for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+          int index = row * file.getNumColumns() + column;
+          if (!tiles.count(index)) {
+            window->missingTiles.insert(index);
+            loader.load(index);
+          }
+          drawTile(window, column, row);
+        }
+      }
+      PIMAPPER_LOG_VERBOSE("TiledImageSource")
+          << "Window of " << path << " over columns " << firstColumn << "-"
+          << lastColumn << ", rows " << firstRow << "-" << lastRow;
+      return window;
+    }
+
+    void TiledImageSource::drawTile(TileWindow* window, int column, int row) {
+      int index = row * file.getNumColumns() + column;
+      int tileSize = file.getTileSize();
+      int scale = window->scale;
+      int numChannels = file.getNumChannels();
+      int width = (file.getTileWidth(column) + scale - 1) / scale;
+      int height = (file.getTileHeight(row) + scale - 1) / scale;
+
+      ofPixels scaled;
+      ofPixels* pixels = &scaled;
+      if (tiles.count(index)) {
+        CachedTile& tile = tiles[index];
+        tile.lastUsedTime = ofGetElapsedTimef();
+        if (scale > 1) {
+          ImageScaler::downscale(tile.pixels, scaled, width, height);
+        } else {
+          pixels = &tile.pixels;
+        }
+      } else {
+        // Nearest pixel of the preview
+        scaled.allocate(width, height, numChannels);
+        int previewWidth = previewPixels.getWidth();
+        int previewHeight = previewPixels.getHeight();
+        float scaleX = (float)previewWidth / file.getWidth();
+        float scaleY = (float)previewHeight / file.getHeight();
+        const unsigned char* source = previewPixels.getPixels();
+        unsigned char* target = scaled.getPixels();
+        for (int y = 0; y < height; y++) {
+          int sourceY = std::min(
+              (int)((row * tileSize + (y + 0.5f) * scale) * scaleY),
+              previewHeight - 1);
+          for (int x = 0; x < width; x++) {
+            int sourceX = std::min(
+                (int)((column * tileSize + (x + 0.5f) * scale) * scaleX),
+                previewWidth - 1);
+            memcpy(target + (y * width + x) * numChannels,
+                   source + (sourceY * previewWidth + sourceX) * numChannels,
+                   numChannels);
+          }
+        }
+      }
+
+      ofTextureData& data = window->windowTexture.getTextureData();
+      glBindTexture(data.textureTarget, data.textureID);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glTexSubImage2D(data.textureTarget, 0,
+                      (column - window->firstColumn) * tileSize / scale,
+                      (row - window->firstRow) * tileSize / scale, width, height,
+                      getGlFormat(numChannels), GL_UNSIGNED_BYTE,
+                      pixels->getPixels());
+      glBindTexture(data.textureTarget, 0);
+      PIMAPPER_COUNT_TEXTURE_UPLOAD(width * height * numChannels);
+    }
+
+    void TiledImageSource::releaseWindows() {
+      float now = ofGetElapsedTimef();
+      for (int i = 0; i < windows.size();) {
+        if (now - windows[i]->lastUsedTime > TILE_WINDOW_TIMEOUT) {
+          delete windows[i];
+          windows.erase(windows.begin() + i);
+        } else {
+          i++;
+        }
+      }
+    }
+
+    void TiledImageSource::evictTiles() {
+      // Every tile in memory is in its windows already, dropping the
+      // least recently used only costs a read when a window comes back
+      unsigned long long memory = getResidentMemory();
+      while (memory > budget && tiles.size()) {
+        std::map<int, CachedTile>::iterator oldest = tiles.begin();
+        std::map<int, CachedTile>::iterator it;
+        for (it = tiles.begin(); it != tiles.end(); it++) {
+          if (it->second.lastUsedTime < oldest->second.lastUsedTime) {
+            oldest = it;
+          }
+        }
+        memory -= oldest->second.pixels.size();
+        tiles.erase(oldest);
+      }
+    }
+  }
+}
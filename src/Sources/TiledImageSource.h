@@ -0,0 +1,101 @@
+#pragma once
+
+#include "BaseSource.h"
+#include "TileFile.h"
+#include "TileLoader.h"
+
+// Tile files are kept here in the data folder, in the folders of the
+// images, see FileUtils::getCachePath
+#define DEFAULT_TILE_CACHE_DIR "tiles/"
+// Tiles kept in memory and window textures together, in bytes
+#define DEFAULT_TILE_BUDGET 67108864
+// Windows no surface asked for this long are released, in seconds
+#define TILE_WINDOW_TIMEOUT 1.0f
+
+namespace ofx {
+  namespace piMapper {
+    // Texture made of the tiles a surface of a TiledImageSource touches
+    class TileWindow : public BaseSource {
+    public:
+      TileWindow();
+      ofRectangle getTextureRegion();
+
+      ofTexture windowTexture;
+      // Maps texture coordinates of the whole image into the window
+      ofRectangle region;
+      // Range of tiles covered, last ones included
+      int firstColumn;
+      int firstRow;
+      int lastColumn;
+      int lastRow;
+      // Tiles are shrunk by this power of two to fit into a texture
+      int scale;
+      // Filled in from the preview until they are read
+      std::set<int> missingTiles;
+      float lastUsedTime;
+    };
+
+    // An image larger than a texture can be, like a panorama spanning a
+    // projector wall. It is cut into a TileFile once, surfaces then draw
+    // from a window of the tiles their texture coordinates touch, see
+    // getView. Tiles are read in the background and the preview fills in
+    // until they are there. Read tiles stay in memory for other windows
+    // as long as they fit into the budget along with the windows.
+    class TiledImageSource : public BaseSource {
+    public:
+      TiledImageSource();
+      ~TiledImageSource();
+      // Builds the tile file in the background if there is no current
+      // one, there is no texture until it is done
+      void loadImage(std::string& filePath);
+      void clear();
+      bool isPreparing();
+      // The window for a surface, or the source itself if the preview is
+      // as sharp as the window would be. The texture is the preview.
+      BaseSource* getView(ofRectangle texCoordBounds);
+      // Preview and windows
+      unsigned long long getTextureMemory();
+      void setBudget(unsigned long long bytes);
+      unsigned long long getBudget();
+      // Windows larger than this in either direction are made of shrunk
+      // tiles, 0 for no limit. Applies to windows made afterwards.
+      void setMaxWindowSize(int size);
+      int getImageWidth();
+      int getImageHeight();
+      int getNumTiles();
+      int getNumResidentTiles();
+      // Tiles in memory and window textures, kept within the budget
+      // unless the windows alone take more
+      unsigned long long getResidentMemory();
+      int getNumWindows();
+      int getNumTileReads();
+
+      static std::string getTilePath(std::string& imagePath);
+
+    private:
+      struct CachedTile {
+        ofPixels pixels;
+        float lastUsedTime;
+      };
+
+      TileFile file;
+      TileLoader loader;
+      bool bPreparing;
+      ofTexture preview;
+      ofPixels previewPixels;
+      std::map<int, CachedTile> tiles;
+      vector<TileWindow*> windows;
+      unsigned long long budget;
+      int maxWindowSize;
+
+      void update(ofEventArgs& args);
+      bool openTiles();
+      TileWindow* createWindow(int firstColumn, int firstRow, int lastColumn,
+                               int lastRow, int scale);
+      // Copies a tile into a window, from the preview if it is not read
+      void drawTile(TileWindow* window, int column, int row);
+      void releaseWindows();
+      void evictTiles();
+    };
+  }
+}
@@ -1,4 +1,7 @@
 #include "VideoSource.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "Log.h"
 
 namespace ofx {
   namespace piMapper {
@@ -7,11 +10,23 @@ namespace ofx {
       loadable = true;
       loaded = false;
       type = SourceType::SOURCE_TYPE_VIDEO;
+      clock = NULL;
+      bHolding = false;
+      bGaplessLoop = false;
+      bLooped = false;
+      lastPosition = 0.0f;
+      lastFrameMicros = 0;
+      lastFrameInterval = 0;
+      maxLoopInterval = 0;
+      numLoops = 0;
+      bSeeking = false;
+      seekMicros = 0;
+      seekLatency = 0;
 #ifdef TARGET_RASPBERRY_PI
       omxPlayer = NULL;
 #else
       videoPlayer = NULL;
-
+      standbyPlayer = NULL;
 #endif
     }
     
@@ -33,6 +48,7 @@ namespace ofx {
       omxPlayer = new ofxOMXPlayer();
       omxPlayer->setup(settings);
       texture = &(omxPlayer->getTextureReference());
+      ofAddListener(ofEvents().update, this, &VideoSource::update);
 #else
       // regular ofVideoPlayer
       videoPlayer = new ofVideoPlayer();
@@ -47,12 +63,13 @@ namespace ofx {
     
     void VideoSource::clear() {
       texture = NULL;
+      ofRemoveListener(ofEvents().update, this, &VideoSource::update);
 #ifdef TARGET_RASPBERRY_PI
       omxPlayer->close();
       delete omxPlayer;
       omxPlayer = NULL;
 #else
-      ofRemoveListener(ofEvents().update, this, &VideoSource::update);
+      closeStandbyPlayer();
       videoPlayer->stop();
       videoPlayer->close();
       delete videoPlayer;
@@ -63,12 +80,228 @@ namespace ofx {
       loaded = false;
     }
     
-#ifndef TARGET_RASPBERRY_PI
     void VideoSource::update(ofEventArgs &args) {
-      if (videoPlayer != NULL) {
-        videoPlayer->update();
+      PIMAPPER_PROFILE_LABEL("update", "video", name);
+#ifndef TARGET_RASPBERRY_PI
+      if (videoPlayer == NULL) return;
+      videoPlayer->update();
+      if (standbyPlayer != NULL) {
+        // Uploads the first frame once after every seek back
+        standbyPlayer->update();
+        updateLoop();
+      }
+      if (videoPlayer->isFrameNew()) {
+        // New frames are uploaded as RGB
+        PIMAPPER_COUNT_TEXTURE_UPLOAD((unsigned long long)
+            videoPlayer->getWidth() * videoPlayer->getHeight() * 3);
+        // The player has wrapped around by itself
+        float position = videoPlayer->getPosition();
+        if (position < lastPosition) bLooped = true;
+        lastPosition = position;
+        recordFrame();
+        if (bSeeking) {
+          seekLatency = ofGetElapsedTimeMicros() - seekMicros;
+          bSeeking = false;
+        }
+      }
+#else
+      // The OMX player updates its texture by itself
+      if (omxPlayer == NULL) return;
+#endif
+      updateSync();
+    }
+    
+    void VideoSource::setClock(ShowClock* newClock) {
+      clock = newClock;
+      sync.reset();
+    }
+    
+    VideoSync& VideoSource::getSync() {
+      return sync;
+    }
+    
+    void VideoSource::setGaplessLoop(bool gapless) {
+      bGaplessLoop = gapless;
+#ifndef TARGET_RASPBERRY_PI
+      if (videoPlayer == NULL) return;
+      if (bGaplessLoop && standbyPlayer == NULL) {
+        openStandbyPlayer();
+      } else if (!bGaplessLoop && standbyPlayer != NULL) {
+        closeStandbyPlayer();
+        videoPlayer->setLoopState(OF_LOOP_NORMAL);
+        if (videoPlayer->getIsMovieDone()) {
+          videoPlayer->firstFrame();
+          videoPlayer->play();
+        }
       }
+#endif
     }
+    
+    bool VideoSource::getGaplessLoop() {
+      return bGaplessLoop;
+    }
+    
+    unsigned long long VideoSource::getLastFrameInterval() {
+      return lastFrameInterval;
+    }
+    
+    unsigned long long VideoSource::getMaxLoopInterval() {
+      return maxLoopInterval;
+    }
+    
+    int VideoSource::getNumLoops() {
+      return numLoops;
+    }
+    
+    void VideoSource::seek(double time, double snap) {
+#ifdef TARGET_RASPBERRY_PI
+      PIMAPPER_LOG_NOTICE("VideoSource") << "Can not seek " << name;
+#else
+      if (videoPlayer == NULL) return;
+      double duration = videoPlayer->getDuration();
+      if (duration <= 0.0) return;
+      double target = time;
+      if (!keyframeIndex.isEmpty()) {
+        double keyframe = keyframeIndex.getKeyframeBefore(time);
+        if (time - keyframe <= snap) {
+          // A bit into the frame, rounding must not land on the one before
+          target = keyframe + keyframeIndex.getFrameDuration() * 0.25;
+        }
+      }
+      seekMicros = ofGetElapsedTimeMicros();
+      bSeeking = true;
+      // Not a wrap around of the player
+      lastPosition = 0.0f;
+      videoPlayer->setPosition(ofClamp(target / duration, 0.0, 1.0));
 #endif
+    }
+    
+    void VideoSource::setKeyframeIndex(KeyframeIndex& index) {
+      keyframeIndex = index;
+    }
+    
+    KeyframeIndex& VideoSource::getKeyframeIndex() {
+      return keyframeIndex;
+    }
+    
+    bool VideoSource::isSeeking() {
+      return bSeeking;
+    }
+    
+    unsigned long long VideoSource::getSeekLatency() {
+      return seekLatency;
+    }
+    
+    void VideoSource::recordFrame() {
+      unsigned long long now = ofGetElapsedTimeMicros();
+      if (lastFrameMicros > 0) {
+        lastFrameInterval = now - lastFrameMicros;
+        if (bLooped) {
+          maxLoopInterval = std::max(maxLoopInterval, lastFrameInterval);
+          numLoops++;
+        }
+      }
+      bLooped = false;
+      lastFrameMicros = now;
+    }
+    
+#ifndef TARGET_RASPBERRY_PI
+    void VideoSource::openStandbyPlayer() {
+      standbyPlayer = new ofVideoPlayer();
+      standbyPlayer->loadMovie(path);
+      standbyPlayer->setLoopState(OF_LOOP_NONE);
+      standbyPlayer->play();
+      standbyPlayer->setPaused(true);
+      standbyPlayer->firstFrame();
+      // The end of the clip is handled by updateLoop from now on
+      videoPlayer->setLoopState(OF_LOOP_NONE);
+    }
+    
+    void VideoSource::closeStandbyPlayer() {
+      if (standbyPlayer == NULL) return;
+      standbyPlayer->stop();
+      standbyPlayer->close();
+      delete standbyPlayer;
+      standbyPlayer = NULL;
+    }
+    
+    void VideoSource::updateLoop() {
+      float duration = videoPlayer->getDuration();
+      int numFrames = videoPlayer->getTotalNumFrames();
+      if (duration <= 0.0f || numFrames <= 0) return;
+      
+      // Switch when the last frame is up, the standby player shows
+      // the first one already
+      float remaining = duration * (1.0f - videoPlayer->getPosition());
+      if (remaining > duration / numFrames && !videoPlayer->getIsMovieDone()) {
+        return;
+      }
+      std::swap(videoPlayer, standbyPlayer);
+      videoPlayer->setPaused(false);
+      texture = &(videoPlayer->getTextureReference());
+      // The seek back happens while the other player is shown
+      standbyPlayer->setPaused(true);
+      standbyPlayer->firstFrame();
+      
+      // The switch itself shows a new frame
+      bLooped = true;
+      lastPosition = 0.0f;
+      recordFrame();
+    }
+#endif
+    
+    void VideoSource::updateSync() {
+      // A frame is repeated by holding the player for one update
+      if (bHolding) {
+#ifdef TARGET_RASPBERRY_PI
+        omxPlayer->setPaused(false);
+#else
+        videoPlayer->setPaused(false);
+#endif
+        bHolding = false;
+      }
+      if (clock == NULL) return;
+      
+#ifdef TARGET_RASPBERRY_PI
+      double duration = omxPlayer->getDuration();
+      double playerTime = omxPlayer->getMediaTime();
+      int numFrames = omxPlayer->getTotalNumFrames();
+#else
+      double duration = videoPlayer->getDuration();
+      double playerTime = videoPlayer->getPosition() * duration;
+      int numFrames = videoPlayer->getTotalNumFrames();
+#endif
+      // Not known until the video has started
+      if (numFrames <= 0 || duration <= 0.0) return;
+      
+      int correction = sync.update(clock->getTime(), playerTime, duration,
+                                   duration / numFrames);
+#ifndef TARGET_RASPBERRY_PI
+      // Falling behind drops frames by playing faster until caught up,
+      // seeking on every update would stutter
+      float speed = correction == VideoSync::CORRECTION_DROP
+                        ? SYNC_CATCH_UP_SPEED
+                        : 1.0f;
+      if (videoPlayer->getSpeed() != speed) {
+        videoPlayer->setSpeed(speed);
+      }
+#endif
+      if (correction == VideoSync::CORRECTION_REPEAT) {
+#ifdef TARGET_RASPBERRY_PI
+        omxPlayer->setPaused(true);
+#else
+        videoPlayer->setPaused(true);
+#endif
+        bHolding = true;
+        return;
+      }
+#ifndef TARGET_RASPBERRY_PI
+      // The OMX player used here has no seeking, a source that falls
+      // behind stays behind on the Pi. Its error is still measured.
+      if (correction == VideoSync::CORRECTION_SEEK) {
+        videoPlayer->setPosition(sync.getSeekTime() / duration);
+      }
+#endif
+    }
   }
 }
\ No newline at end of file
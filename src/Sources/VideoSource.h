@@ -2,6 +2,9 @@
 
 #include "ofMain.h"
 #include "BaseSource.h"
+#include "ShowClock.h"
+#include "VideoSync.h"
+#include "KeyframeIndex.h"
 #ifdef TARGET_RASPBERRY_PI
   /*
    Notice that if you get an error like this:
@@ -31,17 +34,62 @@ namespace ofx {
       std::string& getPath();
       void loadVideo(std::string& path);
       void clear();
-#ifndef TARGET_RASPBERRY_PI
       void update(ofEventArgs& args);
-#endif
+      // Follow the show clock, NULL lets the player loop on its own
+      void setClock(ShowClock* newClock);
+      // Sync error and corrections so far
+      VideoSync& getSync();
+      // Keep a second player paused on the first frame and switch to it
+      // at the end of the clip, so looping never waits for a seek. Costs
+      // a second decoder. On the Pi the OMX player loops by itself.
+      void setGaplessLoop(bool gapless);
+      bool getGaplessLoop();
+      // Microseconds between the last two new frames
+      unsigned long long getLastFrameInterval();
+      // Longest interval between the last frame and the first one
+      // after a loop point
+      unsigned long long getMaxLoopInterval();
+      int getNumLoops();
+      // Seek to a time in seconds. Targets at most snap seconds after a
+      // keyframe of the index start at that keyframe, so the decoder has
+      // no frames to decode up to the target. The OMX player can't seek.
+      void seek(double time, double snap = 0.0);
+      void setKeyframeIndex(KeyframeIndex& index);
+      KeyframeIndex& getKeyframeIndex();
+      // Until the first new frame after a seek
+      bool isSeeking();
+      // Microseconds from the last seek to the first new frame after it
+      unsigned long long getSeekLatency();
       
     private:
+      ShowClock* clock;
+      VideoSync sync;
+      // Paused for a frame to repeat it
+      bool bHolding;
+      bool bGaplessLoop;
+      bool bLooped;
+      float lastPosition;
+      unsigned long long lastFrameMicros;
+      unsigned long long lastFrameInterval;
+      unsigned long long maxLoopInterval;
+      int numLoops;
+      KeyframeIndex keyframeIndex;
+      bool bSeeking;
+      unsigned long long seekMicros;
+      unsigned long long seekLatency;
+      void updateSync();
+      void recordFrame();
 #ifdef TARGET_RASPBERRY_PI
       ofxOMXPlayer* omxPlayer; // Naming different for less confusion
 #else 
       // Go with ofVideoPlayer or
       // TODO: High Performance Video player on newer Macs
       ofVideoPlayer* videoPlayer;
+      // Paused on the first frame while gapless looping
+      ofVideoPlayer* standbyPlayer;
+      void openStandbyPlayer();
+      void closeStandbyPlayer();
+      void updateLoop();
 #endif
     };
   }
@@ -1,80 +1,63 @@
 #include "BaseSurface.h"
+#include "RegionSource.h"
+#include "RenderStats.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
+unsigned int BaseSurface::nextId = 1;
 
 BaseSurface::BaseSurface() {
+  revision = 0;
+  id = nextId++;
+  bGeometryDirty = true;
   ofEnableNormalizedTexCoords();
-  createDefaultTexture();
+  defaultSource = new DefaultSource();
+  source = defaultSource;
+  transitionSource = NULL;
+  transitionType = TransitionType::TRANSITION_NONE;
+  transitionProgress = 1.0f;
 }
   
   BaseSurface::~BaseSurface() {
     delete defaultSource;
     defaultSource = NULL;
-    defaultTexture.clear();
-  }
-
-void BaseSurface::createDefaultTexture() {
-  ofPixels pixels;
-  pixels.allocate(500, 500, 1);
-  for (int i = 0; i < pixels.size(); i++) {
-    pixels[i] = 255;
-  }
-  int squareSize = 10;  // size of each test pattern square
-  bool sy = false;
-  for (int y = 0; y < pixels.getWidth(); y += squareSize) {
-    bool sx = false;
-    for (int x = 0; x < pixels.getHeight(); x += squareSize) {
-      for (int yi = 0; yi < squareSize; yi++) {
-        for (int xi = 0; xi < squareSize; xi++) {
-          if (sx && sy)
-            pixels[(y + yi) * pixels.getWidth() + x + xi] = 255;
-          else if (sx && !sy)
-            pixels[(y + yi) * pixels.getWidth() + x + xi] = 0;
-          else if (!sx && sy)
-            pixels[(y + yi) * pixels.getWidth() + x + xi] = 0;
-          else
-            pixels[(y + yi) * pixels.getWidth() + x + xi] = 255;
-        }
-      }
-      sx = !sx;
-    }
-    sy = !sy;
   }
 
-  // load pixels into texture
-  defaultTexture.loadData(pixels);
-  // Create new source to be the default
-  defaultSource = new BaseSource(&defaultTexture);
-  source = defaultSource;
-}
-
 void BaseSurface::drawTexture(ofVec2f position) {
   if (source->getTexture() == NULL) {
-    ofLogWarning("BaseSurface") << "Source texture empty. Not drawing.";
+    PIMAPPER_LOG_THROTTLED(OF_LOG_WARNING, "BaseSurface")
+        << "Source texture empty. Not drawing.";
     return;
   }
   
+  // Only the region of the texture the source shows
+  ofRectangle region = source->getTextureRegion();
   ofMesh texMesh;
   texMesh.addVertex(position);
-  texMesh.addVertex(position + ofVec2f(source->getTexture()->getWidth(), 0.0f));
+  texMesh.addVertex(position + ofVec2f(source->getWidth(), 0.0f));
   texMesh.addVertex(position +
-                    ofVec2f(source->getTexture()->getWidth(), source->getTexture()->getHeight()));
-  texMesh.addVertex(position + ofVec2f(0.0f, source->getTexture()->getHeight()));
+                    ofVec2f(source->getWidth(), source->getHeight()));
+  texMesh.addVertex(position + ofVec2f(0.0f, source->getHeight()));
   texMesh.addTriangle(0, 2, 3);
   texMesh.addTriangle(0, 1, 2);
-  texMesh.addTexCoord(ofVec2f(0.0f, 0.0f));
-  texMesh.addTexCoord(ofVec2f(1.0f, 0.0f));
-  texMesh.addTexCoord(ofVec2f(1.0f, 1.0f));
-  texMesh.addTexCoord(ofVec2f(0.0f, 1.0f));
+  texMesh.addTexCoord(ofVec2f(region.getLeft(), region.getTop()));
+  texMesh.addTexCoord(ofVec2f(region.getRight(), region.getTop()));
+  texMesh.addTexCoord(ofVec2f(region.getRight(), region.getBottom()));
+  texMesh.addTexCoord(ofVec2f(region.getLeft(), region.getBottom()));
   source->getTexture()->bind();
+  PIMAPPER_COUNT_BIND();
   texMesh.draw();
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(texMesh.getNumVertices());
+  PIMAPPER_COUNT_DRAW(texMesh.getNumIndices());
   source->getTexture()->unbind();
+  PIMAPPER_COUNT_UNBIND();
 }
 
   //void BaseSurface::setTexture(ofTexture* texturePtr) { texture = texturePtr; }
   void BaseSurface::setSource(BaseSource* newSource) {
     source = newSource;
+    markChanged();
   }
 
   //ofTexture* BaseSurface::getTexture() { return texture; }
@@ -86,5 +69,77 @@ void BaseSurface::drawTexture(ofVec2f position) {
   BaseSource* BaseSurface::getDefaultSource() {
     return defaultSource;
   }
+
+  ofRectangle BaseSurface::getTexCoordBounds() {
+    vector<ofVec2f>& texCoords = getTexCoords();
+    if (texCoords.empty()) return ofRectangle(0.0f, 0.0f, 1.0f, 1.0f);
+    ofRectangle bounds(texCoords[0].x, texCoords[0].y, 0.0f, 0.0f);
+    for (int i = 1; i < texCoords.size(); i++) {
+      bounds.growToInclude(texCoords[i].x, texCoords[i].y);
+    }
+    return bounds;
+  }
+
+  BaseSource* BaseSurface::getSourceView() {
+    return source->getView(getTexCoordBounds());
+  }
+
+  bool BaseSurface::isStatic() {
+    if (transitionSource != NULL) return false;
+    BaseSource* content = source;
+    if (source->getType() == SourceType::SOURCE_TYPE_REGION) {
+      content = static_cast<RegionSource*>(source)->getParent();
+      // Not bound to its media yet
+      if (content == NULL) return false;
+    }
+    return source == defaultSource ||
+           content->getType() == SourceType::SOURCE_TYPE_IMAGE;
+  }
+
+  void BaseSurface::setTransition(BaseSource* fromSource, int newTransitionType,
+                                  float progress) {
+    transitionSource = fromSource;
+    transitionType = newTransitionType;
+    transitionProgress = progress;
+  }
+
+  void BaseSurface::clearTransition() {
+    setTransition(NULL, TransitionType::TRANSITION_NONE, 1.0f);
+  }
+
+  BaseSource* BaseSurface::getTransitionSource() {
+    return transitionSource;
+  }
+
+  int BaseSurface::getTransitionType() {
+    return transitionType;
+  }
+
+  float BaseSurface::getTransitionProgress() {
+    return transitionProgress;
+  }
+
+  unsigned int BaseSurface::getRevision() {
+    return revision;
+  }
+
+  unsigned int BaseSurface::getId() {
+    return id;
+  }
+
+  void BaseSurface::updateGeometry() {
+    if (!bGeometryDirty) return;
+    calculateGeometry();
+    bGeometryDirty = false;
+  }
+
+  bool BaseSurface::isGeometryDirty() {
+    return bGeometryDirty;
+  }
+
+  void BaseSurface::markChanged() {
+    revision++;
+    bGeometryDirty = true;
+  }
 }
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "ofMain.h"
 #include <string>
 #include "BaseSource.h"
+#include "DefaultSource.h"
+#include "TransitionType.h"
 
 using namespace std;
 
@@ -23,6 +25,10 @@ class BaseSurface {
   virtual ofPolyline getTextureHitArea() {};
   virtual vector<ofVec3f>& getVertices() {};
   virtual vector<ofVec2f>& getTexCoords() {};
+  // Arrays as drawn with GL: 3 floats per vertex, 4 per texture coordinate
+  virtual void getGeometry(vector<GLfloat>& vertices,
+                           vector<GLfloat>& texCoords,
+                           vector<GLushort>& indices) {};
 
   // Draws a texture using ofMesh
   void drawTexture(ofVec2f position);
@@ -33,15 +39,54 @@ class BaseSurface {
   //ofTexture* getDefaultTexture();
   BaseSource* getSource();
   BaseSource* getDefaultSource();
+  // Bounds of the texture coordinates, the whole texture if there are none
+  ofRectangle getTexCoordBounds();
+  // What to draw the surface from, see BaseSource::getView
+  BaseSource* getSourceView();
+
+  // Static surfaces show an image or the default test pattern,
+  // their pixels do not change unless the surface itself changes
+  bool isStatic();
+
+  // Blend from fromSource to the current source, progress goes from 0
+  // to 1. The surface does not own fromSource and the transition does
+  // not change the revision, it is picked up on every publish.
+  void setTransition(BaseSource* fromSource, int transitionType,
+                     float progress);
+  void clearTransition();
+  BaseSource* getTransitionSource();
+  int getTransitionType();
+  float getTransitionProgress();
+
+  // Revision is increased every time geometry or source changes,
+  // compare it to a stored value to find out if the surface needs a redraw
+  unsigned int getRevision();
+  // Unique for the lifetime of the application, never 0
+  unsigned int getId();
+
+  // Derived data like hit areas and GL arrays is recalculated only when
+  // needed. SurfaceManager does it for all changed surfaces at once on
+  // its worker threads, so it must not touch GL or other surfaces.
+  void updateGeometry();
+  bool isGeometryDirty();
   
  protected:
   ofMesh mesh;
   //ofTexture* texture;
-  ofTexture defaultTexture;
   BaseSource* source;
   BaseSource* defaultSource;
+  BaseSource* transitionSource;
+  int transitionType;
+  float transitionProgress;
+  unsigned int revision;
+  unsigned int id;
+  static unsigned int nextId;
+  bool bGeometryDirty;
+  ofPolyline hitArea;
+  ofRectangle hitBounds;
   
-  void createDefaultTexture();
+  void markChanged();
+  virtual void calculateGeometry() {};
 };
 }
 }
\ No newline at end of file
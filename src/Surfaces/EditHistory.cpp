@@ -0,0 +1,247 @@
+#include "EditHistory.h"
+
+namespace ofx {
+namespace piMapper {
+PointEditCommand::PointEditCommand(SurfaceEdit& edit) { merge(edit); }
+
+void PointEditCommand::undo(SurfaceManager* surfaceManager) {
+  for (int i = changes.size() - 1; i >= 0; i--) {
+    apply(surfaceManager, changes[i], true);
+  }
+}
+
+void PointEditCommand::redo(SurfaceManager* surfaceManager) {
+  for (int i = 0; i < changes.size(); i++) {
+    apply(surfaceManager, changes[i], false);
+  }
+}
+
+bool PointEditCommand::merge(SurfaceEdit& edit) {
+  if (edit.type != SurfaceEdit::VERTEX &&
+      edit.type != SurfaceEdit::TEX_COORD &&
+      edit.type != SurfaceEdit::MOVE) {
+    return false;
+  }
+  int pointIndex = edit.type == SurfaceEdit::MOVE ? -1 : edit.pointIndex;
+
+  for (int i = 0; i < changes.size(); i++) {
+    PointChange& change = changes[i];
+    if (change.surfaceIndex != edit.surfaceIndex) continue;
+
+    // Moves and vertex edits of the same surface do not commute
+    if ((change.type == SurfaceEdit::MOVE && edit.type == SurfaceEdit::VERTEX) ||
+        (change.type == SurfaceEdit::VERTEX && edit.type == SurfaceEdit::MOVE)) {
+      return false;
+    }
+
+    if (change.type == edit.type && change.pointIndex == pointIndex) {
+      if (edit.type == SurfaceEdit::MOVE) {
+        change.to += edit.to;
+      } else {
+        change.to = edit.to;
+      }
+      return true;
+    }
+  }
+
+  PointChange change;
+  change.type = edit.type;
+  change.pointIndex = pointIndex;
+  change.surfaceIndex = edit.surfaceIndex;
+  change.from = edit.from;
+  change.to = edit.to;
+  changes.push_back(change);
+  return true;
+}
+
+int PointEditCommand::getMemoryUsage() {
+  return sizeof(PointEditCommand) + changes.capacity() * sizeof(PointChange);
+}
+
+void PointEditCommand::apply(SurfaceManager* surfaceManager,
+                             PointChange& change, bool bUndo) {
+  SurfaceEdit edit;
+  edit.type = change.type;
+  edit.surfaceIndex = change.surfaceIndex;
+  edit.pointIndex = change.pointIndex;
+  if (change.type == SurfaceEdit::MOVE) {
+    edit.to = bUndo ? -change.to : change.to;
+  } else {
+    edit.from = bUndo ? change.to : change.from;
+    edit.to = bUndo ? change.from : change.to;
+  }
+  surfaceManager->applyEdit(edit);
+}
+
+SurfaceEditCommand::SurfaceEditCommand(SurfaceEdit& newEdit) {
+  edit = newEdit;
+}
+
+void SurfaceEditCommand::undo(SurfaceManager* surfaceManager) {
+  SurfaceEdit inverse = edit;
+  if (edit.type == SurfaceEdit::ADD) {
+    inverse.type = SurfaceEdit::REMOVE;
+  } else if (edit.type == SurfaceEdit::REMOVE) {
+    inverse.type = SurfaceEdit::ADD;
+  } else if (edit.type == SurfaceEdit::SOURCE) {
+    inverse.sourceType = edit.fromSourceType;
+    inverse.sourceName = edit.fromSourceName;
+    inverse.fromSourceType = edit.sourceType;
+    inverse.fromSourceName = edit.sourceName;
+  }
+  surfaceManager->applyEdit(inverse);
+}
+
+void SurfaceEditCommand::redo(SurfaceManager* surfaceManager) {
+  surfaceManager->applyEdit(edit);
+}
+
+int SurfaceEditCommand::getMemoryUsage() {
+  return sizeof(SurfaceEditCommand) + edit.fromSourceType.capacity() +
+         edit.fromSourceName.capacity() + edit.sourceType.capacity() +
+         edit.sourceName.capacity() + edit.surface.sourceType.capacity() +
+         edit.surface.sourceName.capacity() +
+         edit.surface.vertices.capacity() * sizeof(ofVec2f) +
+         edit.surface.texCoords.capacity() * sizeof(ofVec2f);
+}
+
+EditHistory::EditHistory() {
+  surfaceManager = NULL;
+  memoryBudget = DEFAULT_HISTORY_MEMORY_BUDGET;
+  memoryUsage = 0;
+  bSealed = true;
+  bApplying = false;
+  lastEditTime = 0.0f;
+}
+
+EditHistory::~EditHistory() {
+  setSurfaceManager(NULL);
+  clear();
+}
+
+void EditHistory::setSurfaceManager(SurfaceManager* newSurfaceManager) {
+  if (surfaceManager != NULL) {
+    ofRemoveListener(surfaceManager->onSurfaceEdited, this,
+                     &EditHistory::handleSurfaceEdited);
+  }
+  clear();
+  surfaceManager = newSurfaceManager;
+  if (surfaceManager != NULL) {
+    ofAddListener(surfaceManager->onSurfaceEdited, this,
+                  &EditHistory::handleSurfaceEdited);
+  }
+}
+
+void EditHistory::setMemoryBudget(int bytes) {
+  memoryBudget = bytes;
+  enforceBudget();
+}
+
+void EditHistory::undo() {
+  if (surfaceManager == NULL) return;
+  // Pick up edits of this frame that have not been reported yet
+  surfaceManager->flushEdits();
+  seal();
+  if (!undoStack.size()) return;
+
+  EditCommand* command = undoStack.back();
+  undoStack.pop_back();
+  memoryUsage -= command->getMemoryUsage();
+  bApplying = true;
+  command->undo(surfaceManager);
+  bApplying = false;
+  redoStack.push_back(command);
+}
+
+void EditHistory::redo() {
+  if (surfaceManager == NULL) return;
+  surfaceManager->flushEdits();
+  seal();
+  if (!redoStack.size()) return;
+
+  EditCommand* command = redoStack.back();
+  redoStack.pop_back();
+  bApplying = true;
+  command->redo(surfaceManager);
+  bApplying = false;
+  push(command);
+}
+
+bool EditHistory::canUndo() { return undoStack.size() > 0; }
+
+bool EditHistory::canRedo() { return redoStack.size() > 0; }
+
+void EditHistory::clear() {
+  while (undoStack.size()) {
+    delete undoStack.back();
+    undoStack.pop_back();
+  }
+  clearRedo();
+  memoryUsage = 0;
+  bSealed = true;
+}
+
+void EditHistory::seal() { bSealed = true; }
+
+int EditHistory::size() { return undoStack.size(); }
+
+int EditHistory::getMemoryUsage() {
+  return memoryUsage;
+}
+
+void EditHistory::handleSurfaceEdited(SurfaceEdit& edit) {
+  // Edits caused by undo and redo are not new history entries
+  if (bApplying) return;
+
+  float now = ofGetElapsedTimef();
+  if (now - lastEditTime > HISTORY_MERGE_TIMEOUT) {
+    bSealed = true;
+  }
+  lastEditTime = now;
+
+  clearRedo();
+
+  if (!bSealed && undoStack.size()) {
+    EditCommand* command = undoStack.back();
+    int usageBefore = command->getMemoryUsage();
+    if (command->merge(edit)) {
+      memoryUsage += command->getMemoryUsage() - usageBefore;
+      enforceBudget();
+      return;
+    }
+  }
+
+  if (edit.type == SurfaceEdit::SOURCE || edit.type == SurfaceEdit::ADD ||
+      edit.type == SurfaceEdit::REMOVE) {
+    push(new SurfaceEditCommand(edit));
+    // Structural edits always stand on their own
+    bSealed = true;
+  } else {
+    push(new PointEditCommand(edit));
+    bSealed = false;
+  }
+}
+
+void EditHistory::push(EditCommand* command) {
+  undoStack.push_back(command);
+  memoryUsage += command->getMemoryUsage();
+  enforceBudget();
+}
+
+void EditHistory::clearRedo() {
+  while (redoStack.size()) {
+    delete redoStack.back();
+    redoStack.pop_back();
+  }
+}
+
+void EditHistory::enforceBudget() {
+  // Always keep the newest entry
+  while (memoryUsage > memoryBudget && undoStack.size() > 1) {
+    memoryUsage -= undoStack.front()->getMemoryUsage();
+    delete undoStack.front();
+    undoStack.pop_front();
+  }
+}
+}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SurfaceManager.h"
+#include "SurfaceEdit.h"
+
+// Default memory budget of the undo history in bytes
+#define DEFAULT_HISTORY_MEMORY_BUDGET 1048576
+// Edits further apart than this many seconds are never merged
+#define HISTORY_MERGE_TIMEOUT 1.0f
+
+namespace ofx {
+namespace piMapper {
+// A single undoable step
+class EditCommand {
+ public:
+  virtual ~EditCommand() {};
+  virtual void undo(SurfaceManager* surfaceManager) = 0;
+  virtual void redo(SurfaceManager* surfaceManager) = 0;
+  // Try to merge edit into this command
+  virtual bool merge(SurfaceEdit& edit) { return false; };
+  virtual int getMemoryUsage() = 0;
+};
+
+// Vertex, texture coordinate and move edits. Repeated changes of the same
+// point are merged, so a whole drag gesture costs one entry per point.
+class PointEditCommand : public EditCommand {
+ public:
+  PointEditCommand(SurfaceEdit& edit);
+  void undo(SurfaceManager* surfaceManager);
+  void redo(SurfaceManager* surfaceManager);
+  bool merge(SurfaceEdit& edit);
+  int getMemoryUsage();
+
+ private:
+  struct PointChange {
+    unsigned char type;
+    short pointIndex;
+    int surfaceIndex;
+    ofVec2f from;
+    ofVec2f to;
+  };
+  vector<PointChange> changes;
+
+  void apply(SurfaceManager* surfaceManager, PointChange& change, bool bUndo);
+};
+
+// Source changes, adding and removing surfaces
+class SurfaceEditCommand : public EditCommand {
+ public:
+  SurfaceEditCommand(SurfaceEdit& edit);
+  void undo(SurfaceManager* surfaceManager);
+  void redo(SurfaceManager* surfaceManager);
+  int getMemoryUsage();
+
+ private:
+  SurfaceEdit edit;
+};
+
+// Records edits of a SurfaceManager and lets you undo and redo them.
+// The oldest entries are dropped when the memory budget is exceeded.
+class EditHistory {
+ public:
+  EditHistory();
+  ~EditHistory();
+
+  void setSurfaceManager(SurfaceManager* newSurfaceManager);
+  void setMemoryBudget(int bytes);
+
+  void undo();
+  void redo();
+  bool canUndo();
+  bool canRedo();
+  void clear();
+
+  // Stop merging edits into the current entry, call this when
+  // a gesture like a drag ends
+  void seal();
+
+  int size();
+  int getMemoryUsage();
+
+ private:
+  SurfaceManager* surfaceManager;
+  std::deque<EditCommand*> undoStack;
+  vector<EditCommand*> redoStack;
+  int memoryBudget;
+  int memoryUsage;
+  bool bSealed;
+  bool bApplying;
+  float lastEditTime;
+
+  void handleSurfaceEdited(SurfaceEdit& edit);
+  void push(EditCommand* command);
+  void clearRedo();
+  void enforceBudget();
+};
+}
+}
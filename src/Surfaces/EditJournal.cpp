@@ -0,0 +1,248 @@
+#include "EditJournal.h"
+#include "Log.h"
+#include "SourceType.h"
+#include "SurfaceType.h"
+
+#define JOURNAL_EDIT_VERTEX "vertex"
+#define JOURNAL_EDIT_TEX_COORD "texCoord"
+#define JOURNAL_EDIT_MOVE "move"
+#define JOURNAL_EDIT_SOURCE "source"
+#define JOURNAL_EDIT_ADD "add"
+#define JOURNAL_EDIT_REMOVE "remove"
+// Marks a completely written entry
+#define JOURNAL_LINE_END "\t;"
+
+namespace ofx {
+namespace piMapper {
+EditJournal::EditJournal() {
+  sequence = 0;
+  numEntries = 0;
+}
+
+EditJournal::~EditJournal() { close(); }
+
+void EditJournal::open(std::string newPath, int afterSequence) {
+  close();
+  path = newPath;
+
+  // Continue numbering after whatever is already in there
+  vector<SurfaceEdit> edits;
+  sequence = read(path, 0, edits);
+  if (afterSequence > sequence) {
+    sequence = afterSequence;
+  }
+  numEntries = edits.size();
+
+  // A crash may have left a partial line behind, don't append to it
+  bool bEndsWithNewLine = true;
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (in.is_open() && in.seekg(-1, std::ios::end)) {
+    bEndsWithNewLine = in.get() == '\n';
+  }
+  in.close();
+
+  file.open(path.c_str(), std::ios::out | std::ios::app);
+  if (!file.is_open()) {
+    PIMAPPER_LOG_ERROR("EditJournal") << "Could not open journal " << path;
+    return;
+  }
+  if (!bEndsWithNewLine) {
+    file << "\n";
+  }
+}
+
+void EditJournal::close() {
+  if (!file.is_open()) return;
+  flush();
+  file.close();
+}
+
+bool EditJournal::isOpen() { return file.is_open(); }
+
+void EditJournal::append(SurfaceEdit& edit) {
+  if (!file.is_open()) return;
+  sequence++;
+  numEntries++;
+  buffer += serialize(sequence, edit);
+  buffer += "\n";
+}
+
+void EditJournal::flush() {
+  if (!file.is_open() || buffer.empty()) return;
+  file << buffer;
+  file.flush();
+  buffer.clear();
+}
+
+void EditJournal::truncate(int upToSequence) {
+  if (!file.is_open()) return;
+  flush();
+  file.close();
+
+  // Keep only the entries that were made after upToSequence
+  std::ifstream in(path.c_str());
+  std::string keep;
+  std::string line;
+  int kept = 0;
+  while (std::getline(in, line)) {
+    int lineSequence = 0;
+    SurfaceEdit edit;
+    if (deserialize(line, lineSequence, edit) &&
+        lineSequence > upToSequence) {
+      keep += line + "\n";
+      kept++;
+    }
+  }
+  in.close();
+
+  // Write the kept entries next to the journal and rename that over it so
+  // a crash in between leaves either the old or the new journal behind
+  std::string tempPath = path + ".tmp";
+  std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::trunc);
+  out << keep;
+  out.close();
+  bool bWritten = !out.fail();
+#ifdef TARGET_WIN32
+  if (bWritten) std::remove(path.c_str());
+#endif
+  if (!bWritten || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    PIMAPPER_LOG_ERROR("EditJournal") << "Could not compact journal " << path;
+    std::remove(tempPath.c_str());
+  } else {
+    numEntries = kept;
+  }
+  file.open(path.c_str(), std::ios::out | std::ios::app);
+}
+
+int EditJournal::getSequence() { return sequence; }
+
+int EditJournal::getNumEntries() { return numEntries; }
+
+int EditJournal::read(std::string path, int afterSequence,
+                      vector<SurfaceEdit>& edits) {
+  int lastSequence = afterSequence;
+  std::ifstream in(path.c_str());
+  if (!in.is_open()) return lastSequence;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    int lineSequence = 0;
+    SurfaceEdit edit;
+    if (!deserialize(line, lineSequence, edit)) {
+      // Most likely the last line of a crashed session, or garbage
+      PIMAPPER_LOG_WARNING("EditJournal") << "Skipping damaged journal entry";
+      continue;
+    }
+    if (lineSequence <= afterSequence) continue;
+    edits.push_back(edit);
+    lastSequence = lineSequence;
+  }
+  return lastSequence;
+}
+
+std::string EditJournal::serialize(int sequence, SurfaceEdit& edit) {
+  std::stringstream ss;
+  ss.precision(9);
+  ss << sequence << " ";
+  if (edit.type == SurfaceEdit::VERTEX) {
+    ss << JOURNAL_EDIT_VERTEX << " " << edit.surfaceIndex << " "
+       << edit.pointIndex << " " << edit.to.x << " " << edit.to.y;
+  } else if (edit.type == SurfaceEdit::TEX_COORD) {
+    ss << JOURNAL_EDIT_TEX_COORD << " " << edit.surfaceIndex << " "
+       << edit.pointIndex << " " << edit.to.x << " " << edit.to.y;
+  } else if (edit.type == SurfaceEdit::MOVE) {
+    ss << JOURNAL_EDIT_MOVE << " " << edit.surfaceIndex << " " << edit.to.x
+       << " " << edit.to.y;
+  } else if (edit.type == SurfaceEdit::SOURCE) {
+    // Source name goes last as it may contain spaces
+    ss << JOURNAL_EDIT_SOURCE << " " << edit.surfaceIndex << " "
+       << edit.sourceType << " " << edit.sourceName;
+  } else if (edit.type == SurfaceEdit::ADD) {
+    SurfaceSnapshot& surface = edit.surface;
+    ss << JOURNAL_EDIT_ADD << " " << edit.surfaceIndex << " " << surface.type;
+    ss << " " << surface.vertices.size();
+    for (int i = 0; i < surface.vertices.size(); i++) {
+      ss << " " << surface.vertices[i].x << " " << surface.vertices[i].y;
+    }
+    ss << " " << surface.texCoords.size();
+    for (int i = 0; i < surface.texCoords.size(); i++) {
+      ss << " " << surface.texCoords[i].x << " " << surface.texCoords[i].y;
+    }
+    ss << " " << surface.sourceType << " " << surface.sourceName;
+  } else if (edit.type == SurfaceEdit::REMOVE) {
+    ss << JOURNAL_EDIT_REMOVE << " " << edit.surfaceIndex;
+  }
+  ss << JOURNAL_LINE_END;
+  return ss.str();
+}
+
+bool EditJournal::deserialize(std::string line, int& sequence,
+                              SurfaceEdit& edit) {
+  // Entries cut off by a crash have no line end marker
+  std::string lineEnd = JOURNAL_LINE_END;
+  if (line.size() < lineEnd.size() ||
+      line.compare(line.size() - lineEnd.size(), lineEnd.size(), lineEnd) != 0) {
+    return false;
+  }
+  line.erase(line.size() - lineEnd.size());
+
+  std::stringstream ss(line);
+  std::string type;
+  if (!(ss >> sequence >> type >> edit.surfaceIndex)) {
+    return false;
+  }
+
+  if (type == JOURNAL_EDIT_VERTEX || type == JOURNAL_EDIT_TEX_COORD) {
+    edit.type = type == JOURNAL_EDIT_VERTEX ? SurfaceEdit::VERTEX
+                                            : SurfaceEdit::TEX_COORD;
+    if (!(ss >> edit.pointIndex >> edit.to.x >> edit.to.y)) return false;
+    if (edit.pointIndex < 0) return false;
+  } else if (type == JOURNAL_EDIT_MOVE) {
+    edit.type = SurfaceEdit::MOVE;
+    if (!(ss >> edit.to.x >> edit.to.y)) return false;
+  } else if (type == JOURNAL_EDIT_SOURCE) {
+    edit.type = SurfaceEdit::SOURCE;
+    if (!(ss >> edit.sourceType)) return false;
+    if (!SourceType::IsSourceTypeName(edit.sourceType)) return false;
+    ss.ignore(1);
+    std::getline(ss, edit.sourceName);
+  } else if (type == JOURNAL_EDIT_ADD) {
+    edit.type = SurfaceEdit::ADD;
+    SurfaceSnapshot& surface = edit.surface;
+    int numVertices = 0;
+    if (!(ss >> surface.type >> numVertices)) return false;
+    // Surfaces can only be added with all of their points
+    int numPoints = 0;
+    if (surface.type == SurfaceType::TRIANGLE_SURFACE) {
+      numPoints = 3;
+    } else if (surface.type == SurfaceType::QUAD_SURFACE) {
+      numPoints = 4;
+    } else {
+      return false;
+    }
+    if (numVertices < numPoints) return false;
+    for (int i = 0; i < numVertices; i++) {
+      ofVec2f vertex;
+      if (!(ss >> vertex.x >> vertex.y)) return false;
+      surface.vertices.push_back(vertex);
+    }
+    int numTexCoords = 0;
+    if (!(ss >> numTexCoords) || numTexCoords < numPoints) return false;
+    for (int i = 0; i < numTexCoords; i++) {
+      ofVec2f texCoord;
+      if (!(ss >> texCoord.x >> texCoord.y)) return false;
+      surface.texCoords.push_back(texCoord);
+    }
+    if (!(ss >> surface.sourceType)) return false;
+    if (!SourceType::IsSourceTypeName(surface.sourceType)) return false;
+    ss.ignore(1);
+    std::getline(ss, surface.sourceName);
+  } else if (type == JOURNAL_EDIT_REMOVE) {
+    edit.type = SurfaceEdit::REMOVE;
+  } else {
+    return false;
+  }
+  return true;
+}
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SurfaceEdit.h"
+
+namespace ofx {
+namespace piMapper {
+// Append-only log of surface edits. Every entry gets a sequence number so
+// that entries already compacted into the settings file can be skipped when
+// the journal is replayed. Entries are buffered and written out by flush(),
+// which is meant to be called once per frame.
+class EditJournal {
+ public:
+  EditJournal();
+  ~EditJournal();
+
+  // Start appending to file at path. Sequence numbering continues
+  // from the last entry found in the file or afterSequence if greater.
+  void open(std::string path, int afterSequence = 0);
+  void close();
+  bool isOpen();
+
+  void append(SurfaceEdit& edit);
+  void flush();
+
+  // Drop all entries up to and including sequence. The remaining entries
+  // are written to a temporary file that then replaces the journal.
+  void truncate(int sequence);
+
+  // Sequence number of the last appended entry
+  int getSequence();
+  // Number of entries since the journal was last truncated
+  int getNumEntries();
+
+  // Read all entries with a sequence number greater than afterSequence
+  static int read(std::string path, int afterSequence,
+                  vector<SurfaceEdit>& edits);
+
+  static std::string serialize(int sequence, SurfaceEdit& edit);
+  // Returns false for cut off lines and entries that can't be applied,
+  // like unknown source or surface types
+  static bool deserialize(std::string line, int& sequence, SurfaceEdit& edit);
+
+ private:
+  std::string path;
+  std::ofstream file;
+  std::string buffer;
+  int sequence;
+  int numEntries;
+};
+}
+}
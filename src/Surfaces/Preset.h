@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SurfaceSnapshot.h"
+#include "BaseSource.h"
+
+namespace ofx {
+namespace piMapper {
+// A named composition held in memory. Every source it uses stays loaded
+// through a reference of its own, so switching to it loads nothing.
+struct Preset {
+  vector<SurfaceSnapshot> surfaces;
+  vector<BaseSource*> sources;
+};
+}
+}
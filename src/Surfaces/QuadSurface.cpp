@@ -1,13 +1,17 @@
 #include "QuadSurface.h"
+#include "RenderStats.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
 QuadSurface::QuadSurface() {
-  cout << "QuadSurface constructor." << endl;
+  PIMAPPER_LOG_VERBOSE("QuadSurface") << "QuadSurface constructor.";
   setup();
 }
 
-QuadSurface::~QuadSurface() { cout << "QuadSurface destructor." << endl; }
+QuadSurface::~QuadSurface() {
+  PIMAPPER_LOG_VERBOSE("QuadSurface") << "QuadSurface destructor.";
+}
 
 void QuadSurface::setup() {
   // Create 4 points for the 2 triangles
@@ -64,46 +68,67 @@ void QuadSurface::setup(ofVec2f p1, ofVec2f p2, ofVec2f p3, ofVec2f p4,
   quadTexCoordinates[10] = 0;
   quadTexCoordinates[14] = 0;
 
-  calculate4dTextureCoords();
+  bGeometryDirty = true;
 }
 
 void QuadSurface::draw() {
-  if (source->getTexture() == NULL) {
-    ofLogWarning("QuadSurface") << "Source texture empty. Not drawing.";
+  // Part of a large source the texture coordinates touch
+  BaseSource* view = getSourceView();
+  if (view->getTexture() == NULL) {
+    PIMAPPER_LOG_THROTTLED(OF_LOG_WARNING, "QuadSurface")
+        << "Source texture empty. Not drawing.";
     return;
   }
   
-  /*if(mesh.haveVertsChanged() || mesh.haveTexCoordsChanged()){
-      calculate4dTextureCoords();
-  }*/
+  updateGeometry();
+  // Into the region of the texture the source shows
+  ofRectangle region = view->getTextureRegion();
+  GLfloat texCoords[16];
+  for (int i = 0; i < 16; i += 4) {
+    GLfloat q = quadTexCoordinates[i + 3];
+    texCoords[i] = region.x * q + quadTexCoordinates[i] * region.width;
+    texCoords[i + 1] = region.y * q + quadTexCoordinates[i + 1] * region.height;
+    texCoords[i + 2] = quadTexCoordinates[i + 2];
+    texCoords[i + 3] = q;
+  }
+  glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-  glTexCoordPointer(4, GL_FLOAT, 0, quadTexCoordinates);
+  glTexCoordPointer(4, GL_FLOAT, 0, texCoords);
   glVertexPointer(3, GL_FLOAT, 0, quadVertices);
 
-  source->getTexture()->bind();
+  view->getTexture()->bind();
+  PIMAPPER_COUNT_BIND();
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, quadIndices);
-  source->getTexture()->unbind();
+  // Client side arrays are sent on every draw
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(4);
+  PIMAPPER_COUNT_DRAW(6);
+  view->getTexture()->unbind();
+  PIMAPPER_COUNT_UNBIND();
+
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 void QuadSurface::setVertex(int index, ofVec2f p) {
   if (index > 3) {
-    ofLog() << "Vertex with this index does not exist: " << index << endl;
+    PIMAPPER_LOG_WARNING("QuadSurface")
+        << "Vertex with this index does not exist: " << index;
     return;
   }
 
   mesh.setVertex(index, p);
-  calculate4dTextureCoords();
+  markChanged();
 }
 
 void QuadSurface::setTexCoord(int index, ofVec2f t) {
   if (index > 3) {
-    ofLog() << "Texture coordinate with this index does not exist: " << index
-            << endl;
+    PIMAPPER_LOG_WARNING("QuadSurface")
+        << "Texture coordinate with this index does not exist: " << index;
     return;
   }
 
   mesh.setTexCoord(index, t);
-  calculate4dTextureCoords();
+  markChanged();
 }
 
 void QuadSurface::moveBy(ofVec2f v) {
@@ -111,16 +136,16 @@ void QuadSurface::moveBy(ofVec2f v) {
   for (int i = 0; i < vertices.size(); i++) {
     vertices[i] += v;
   }
-  calculate4dTextureCoords();
+  markChanged();
 }
 
 int QuadSurface::getType() { return SurfaceType::QUAD_SURFACE; }
 
 bool QuadSurface::hitTest(ofVec2f p) {
-  // Construct ofPolyline from vertices
-  ofPolyline line = getHitArea();
+  updateGeometry();
+  if (!hitBounds.inside(p.x, p.y)) return false;
 
-  if (line.inside(p.x, p.y)) {
+  if (hitArea.inside(p.x, p.y)) {
     return true;
   } else {
     return false;
@@ -129,7 +154,8 @@ bool QuadSurface::hitTest(ofVec2f p) {
 
 ofVec2f QuadSurface::getVertex(int index) {
   if (index > 3) {
-    ofLog() << "Vertex with this index does not exist: " << index << endl;
+    PIMAPPER_LOG_WARNING("QuadSurface")
+        << "Vertex with this index does not exist: " << index;
     throw std::runtime_error("Vertex index out of bounds.");
   }
 
@@ -146,20 +172,14 @@ ofVec2f QuadSurface::getTexCoord(int index) {
 }
 
 ofPolyline QuadSurface::getHitArea() {
-  ofPolyline line;
-  line.addVertex(ofPoint(mesh.getVertex(0).x, mesh.getVertex(0).y));
-  line.addVertex(ofPoint(mesh.getVertex(1).x, mesh.getVertex(1).y));
-  line.addVertex(ofPoint(mesh.getVertex(2).x, mesh.getVertex(2).y));
-  line.addVertex(ofPoint(mesh.getVertex(3).x, mesh.getVertex(3).y));
-  line.close();
-
-  return line;
+  updateGeometry();
+  return hitArea;
 }
 
 ofPolyline QuadSurface::getTextureHitArea() {
   ofPolyline line;
   vector<ofVec2f>& texCoords = mesh.getTexCoords();
-  ofVec2f textureSize = ofVec2f(source->getTexture()->getWidth(), source->getTexture()->getHeight());
+  ofVec2f textureSize = ofVec2f(source->getWidth(), source->getHeight());
   for (int i = 0; i < texCoords.size(); i++) {
     line.addVertex(ofPoint(texCoords[i] * textureSize));
   }
@@ -175,6 +195,27 @@ vector<ofVec3f>& QuadSurface::getVertices() {
 
 vector<ofVec2f>& QuadSurface::getTexCoords() { return mesh.getTexCoords(); }
 
+void QuadSurface::getGeometry(vector<GLfloat>& vertices,
+                              vector<GLfloat>& texCoords,
+                              vector<GLushort>& indices) {
+  updateGeometry();
+  vertices.assign(quadVertices, quadVertices + 12);
+  texCoords.assign(quadTexCoordinates, quadTexCoordinates + 16);
+  indices.assign(quadIndices, quadIndices + 6);
+}
+
+void QuadSurface::calculateGeometry() {
+  hitArea.clear();
+  hitArea.addVertex(ofPoint(mesh.getVertex(0).x, mesh.getVertex(0).y));
+  hitArea.addVertex(ofPoint(mesh.getVertex(1).x, mesh.getVertex(1).y));
+  hitArea.addVertex(ofPoint(mesh.getVertex(2).x, mesh.getVertex(2).y));
+  hitArea.addVertex(ofPoint(mesh.getVertex(3).x, mesh.getVertex(3).y));
+  hitArea.close();
+  hitBounds = hitArea.getBoundingBox();
+
+  calculate4dTextureCoords();
+}
+
 void QuadSurface::calculate4dTextureCoords() {
   // Perspective Warping with OpenGL Fixed Pipeline and q coordinates
   // see:
@@ -29,8 +29,11 @@ class QuadSurface : public BaseSurface {
   ofPolyline getTextureHitArea();
   vector<ofVec3f>& getVertices();
   vector<ofVec2f>& getTexCoords();
+  void getGeometry(vector<GLfloat>& vertices, vector<GLfloat>& texCoords,
+                   vector<GLushort>& indices);
 
  private:
+  void calculateGeometry();
   void calculate4dTextureCoords();
   GLfloat quadVertices[12];
   GLubyte quadIndices[6];
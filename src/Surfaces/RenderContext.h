@@ -0,0 +1,26 @@
+#pragma once
+
+namespace ofx {
+namespace piMapper {
+// GL context of the render thread, see SurfaceManager::startRenderThread.
+// Everything here is called on the render thread. The context has to
+// share textures with the one the main thread uploads media with, and
+// draw to the output. How to set that up differs per platform, see the
+// README.
+class RenderContext {
+ public:
+  virtual ~RenderContext() {}
+
+  // Before the first frame, return false if the context is not usable
+  virtual bool makeCurrent() = 0;
+  // After every frame. Swapping with vsync paces the thread.
+  virtual void swapBuffers() = 0;
+  // Before the thread ends
+  virtual void doneCurrent() = 0;
+
+  // Size of the output in pixels
+  virtual int getWidth() = 0;
+  virtual int getHeight() = 0;
+};
+}
+}
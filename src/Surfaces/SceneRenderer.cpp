@@ -0,0 +1,316 @@
+#include "SceneRenderer.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+SceneRenderer::SceneRenderer() {
+  writeScene = &scenes[0];
+  readyScene = &scenes[1];
+  drawScene = &scenes[2];
+  for (int i = 0; i < 3; i++) {
+    scenes[i].number = 0;
+  }
+  bReady = false;
+  numPublished = 0;
+  bFlattenStaticSurfaces = true;
+  bFadePending = false;
+  fadeSceneNumber = 0;
+  pendingFadeDuration = 0.0f;
+  fadeDuration = 0.0f;
+  fadeStartTime = 0.0f;
+  bFading = false;
+  renderThread = NULL;
+  renderContext = NULL;
+}
+
+SceneRenderer::~SceneRenderer() {
+  stopRenderThread();
+  clearStaticLayers();
+}
+
+void SceneRenderer::publish(vector<BaseSurface*>& surfaces) {
+  PIMAPPER_PROFILE("update", "publish scene");
+  // The write scene is two publishes old, only changed surfaces are copied
+  vector<SceneSurface>& sceneSurfaces = writeScene->surfaces;
+  sceneSurfaces.resize(surfaces.size());
+  for (int i = 0; i < surfaces.size(); i++) {
+    BaseSurface* surface = surfaces[i];
+    SceneSurface& sceneSurface = sceneSurfaces[i];
+    // Large sources give each surface a texture of the part it shows
+    ofRectangle texCoordBounds = surface->getTexCoordBounds();
+    BaseSource* view = surface->getSource()->getView(texCoordBounds);
+    ofRectangle region = view->getTextureRegion();
+    if (sceneSurface.id != surface->getId() ||
+        sceneSurface.revision != surface->getRevision() ||
+        sceneSurface.region != region) {
+      sceneSurface.id = surface->getId();
+      sceneSurface.revision = surface->getRevision();
+      surface->getGeometry(sceneSurface.vertices, sceneSurface.texCoords,
+                           sceneSurface.indices);
+      SceneSurface::mapTexCoords(sceneSurface.texCoords,
+                                 ofRectangle(0.0f, 0.0f, 1.0f, 1.0f), region);
+      sceneSurface.region = region;
+    }
+    // Sources may get their texture later without a new revision
+    ofTexture* texture = view->getTexture();
+    sceneSurface.texture = texture != NULL ? *texture : ofTexture();
+    sceneSurface.bStatic = surface->isStatic();
+    BaseSource* fromSource = surface->getTransitionSource();
+    if (fromSource != NULL) fromSource = fromSource->getView(texCoordBounds);
+    ofTexture* fromTexture =
+        fromSource != NULL ? fromSource->getTexture() : NULL;
+    sceneSurface.fromTexture =
+        fromTexture != NULL ? *fromTexture : ofTexture();
+    sceneSurface.transition = surface->getTransitionType();
+    sceneSurface.progress = surface->getTransitionProgress();
+    sceneSurface.fromTexCoords.clear();
+    if (fromSource != NULL && fromSource->getTextureRegion() != region) {
+      sceneSurface.fromTexCoords = sceneSurface.texCoords;
+      SceneSurface::mapTexCoords(sceneSurface.fromTexCoords, region,
+                                 fromSource->getTextureRegion());
+    }
+  }
+
+  mutex.lock();
+  writeScene->number = ++numPublished;
+  std::swap(writeScene, readyScene);
+  bReady = true;
+  mutex.unlock();
+
+  // Textures uploaded during this update have to be complete before
+  // the context of the render thread may use them
+  if (renderThread != NULL) glFinish();
+}
+
+void SceneRenderer::draw() {
+  mutex.lock();
+  bool bCapture = bReady && bFadePending &&
+                  readyScene->number >= fadeSceneNumber;
+  if (bCapture) bFadePending = false;
+  float duration = pendingFadeDuration;
+  mutex.unlock();
+
+  // The draw scene is ours until the swap, cache it before letting go
+  if (bCapture) {
+    captureFadeLayer(drawScene->surfaces);
+    fadeDuration = duration;
+    fadeStartTime = ofGetElapsedTimef();
+    bFading = true;
+  }
+
+  mutex.lock();
+  if (bReady) {
+    std::swap(drawScene, readyScene);
+    bReady = false;
+  }
+  mutex.unlock();
+
+  drawSurfaces(drawScene->surfaces);
+  if (bFading) drawFadeLayer();
+}
+
+void SceneRenderer::startRenderThread(RenderContext* context) {
+  if (renderThread != NULL || context == NULL) return;
+  // Layers belong to the main context, free them before handing over
+  clearStaticLayers();
+  bFading = false;
+  mutex.lock();
+  bFadePending = false;
+  mutex.unlock();
+
+  renderContext = context;
+  renderThread = new RenderThread(this);
+  renderThread->startThread(true, false);
+}
+
+void SceneRenderer::stopRenderThread() {
+  if (renderThread == NULL) return;
+  renderThread->waitForThread(true);
+  delete renderThread;
+  renderThread = NULL;
+  renderContext = NULL;
+  RenderStats::instance().useAppFrames();
+}
+
+bool SceneRenderer::isRenderThreadRunning() {
+  return renderThread != NULL && renderThread->isThreadRunning();
+}
+
+SceneRenderer::RenderThread::RenderThread(SceneRenderer* newRenderer) {
+  renderer = newRenderer;
+}
+
+void SceneRenderer::RenderThread::threadedFunction() {
+  renderer->renderLoop();
+}
+
+void SceneRenderer::renderLoop() {
+  if (!renderContext->makeCurrent()) {
+    PIMAPPER_LOG_ERROR("SceneRenderer")
+        << "Render context could not be made current";
+    return;
+  }
+  while (renderThread->isThreadRunning()) {
+    RenderStats::instance().nextFrame();
+    beginFrame();
+    draw();
+    renderContext->swapBuffers();
+  }
+  renderContext->doneCurrent();
+}
+
+void SceneRenderer::beginFrame() {
+  // What ofSetupScreen does for flat surfaces, pixels from the top left
+  int width = renderContext->getWidth();
+  int height = renderContext->getHeight();
+  glViewport(0, 0, width, height);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+#ifdef TARGET_OPENGLES
+  glOrthof(0.0f, width, height, 0.0f, -1.0f, 1.0f);
+#else
+  glOrtho(0.0, width, height, 0.0, -1.0, 1.0);
+#endif
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+void SceneRenderer::drawSurfaces(vector<SceneSurface>& surfaces) {
+  // There are no layers while the render thread runs
+  if (renderThread != NULL || !bFlattenStaticSurfaces) {
+    clearStaticLayers();
+    for (int i = 0; i < surfaces.size(); i++) {
+      PIMAPPER_PROFILE_INDEX("draw", "surface", i);
+      surfaces[i].draw(true);
+    }
+    SceneSurface::endBatch();
+    return;
+  }
+
+  // Split surfaces into runs of static ones separated by dynamic ones.
+  // Each run long enough gets its own cached layer so z-order is kept.
+  int numLayersUsed = 0;
+  vector<SceneSurface*> run;
+  for (int i = 0; i <= surfaces.size(); i++) {
+    if (i < surfaces.size() && surfaces[i].bStatic) {
+      run.push_back(&surfaces[i]);
+      continue;
+    }
+
+    if (run.size() >= MIN_STATIC_LAYER_SURFACES) {
+      if (numLayersUsed >= staticLayers.size()) {
+        staticLayers.push_back(new StaticLayer());
+      }
+      SceneSurface::endBatch();
+      PIMAPPER_PROFILE_INDEX("draw", "static layer", numLayersUsed);
+      staticLayers[numLayersUsed]->setSurfaces(run);
+      staticLayers[numLayersUsed]->draw();
+      numLayersUsed++;
+    } else {
+      // Not worth an extra full screen pass
+      for (int j = 0; j < run.size(); j++) {
+        PIMAPPER_PROFILE_INDEX("draw", "surface", i - run.size() + j);
+        run[j]->draw(true);
+      }
+    }
+    run.clear();
+
+    if (i < surfaces.size()) {
+      PIMAPPER_PROFILE_INDEX("draw", "surface", i);
+      surfaces[i].draw(true);
+    }
+  }
+  SceneSurface::endBatch();
+
+  // Free layers that are not needed anymore
+  while (staticLayers.size() > numLayersUsed) {
+    delete staticLayers.back();
+    staticLayers.pop_back();
+  }
+}
+
+void SceneRenderer::setFlattenStaticSurfaces(bool flatten) {
+  // Layers are freed by draw, they belong to the GL thread
+  bFlattenStaticSurfaces = flatten;
+}
+
+bool SceneRenderer::getFlattenStaticSurfaces() {
+  return bFlattenStaticSurfaces;
+}
+
+unsigned long SceneRenderer::getNumPublished() {
+  mutex.lock();
+  unsigned long number = numPublished;
+  mutex.unlock();
+  return number;
+}
+
+void SceneRenderer::crossfade(float duration) {
+  // The render thread switches at once
+  if (duration <= 0.0f || renderThread != NULL) return;
+  mutex.lock();
+  bFadePending = true;
+  fadeSceneNumber = numPublished + 1;
+  pendingFadeDuration = duration;
+  mutex.unlock();
+}
+
+bool SceneRenderer::isCrossfadePending() {
+  mutex.lock();
+  bool pending = bFadePending;
+  mutex.unlock();
+  return pending;
+}
+
+void SceneRenderer::captureFadeLayer(vector<SceneSurface>& surfaces) {
+  PIMAPPER_PROFILE("draw", "capture fade layer");
+  if (!fadeLayer.isAllocated() || fadeLayer.getWidth() != ofGetWidth() ||
+      fadeLayer.getHeight() != ofGetHeight()) {
+    fadeLayer.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
+  }
+  // Static layers have FBOs of their own, draw every surface directly
+  ofPushStyle();
+  ofSetColor(255, 255, 255, 255);
+  fadeLayer.begin();
+  ofClear(0, 0, 0, 0);
+  for (int i = 0; i < surfaces.size(); i++) {
+    surfaces[i].draw(true);
+  }
+  SceneSurface::endBatch();
+  fadeLayer.end();
+  ofPopStyle();
+}
+
+void SceneRenderer::drawFadeLayer() {
+  float amount = (ofGetElapsedTimef() - fadeStartTime) / fadeDuration;
+  if (amount >= 1.0f) {
+    bFading = false;
+    return;
+  }
+  PIMAPPER_PROFILE("draw", "fade layer");
+  ofPushStyle();
+  ofEnableAlphaBlending();
+  ofSetColor(255, 255, 255, 255 * (1.0f - amount));
+  fadeLayer.draw(0, 0);
+  ofPopStyle();
+  PIMAPPER_COUNT_BIND();
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(4);
+  PIMAPPER_COUNT_DRAW(4);
+  PIMAPPER_COUNT_UNBIND();
+}
+
+void SceneRenderer::clearStaticLayers() {
+  while (staticLayers.size()) {
+    delete staticLayers.back();
+    staticLayers.pop_back();
+  }
+}
+}
+}
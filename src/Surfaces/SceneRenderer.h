@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BaseSurface.h"
+#include "SceneSurface.h"
+#include "StaticLayer.h"
+#include "RenderContext.h"
+
+// Minimum number of consecutive static surfaces to be cached in a layer
+#define MIN_STATIC_LAYER_SURFACES 2
+
+namespace ofx {
+namespace piMapper {
+// Draws surfaces from copies published after every update, so drawing
+// never sees a half applied edit. There are three copies: one being
+// written, one being drawn and the latest complete one waiting to be
+// drawn next. Publishing only rewrites the copies of surfaces whose
+// revision has changed.
+//
+// SurfaceManager publishes on every update and its draw calls draw here.
+// With a render thread started, that thread draws instead and the output
+// is paced by it alone. Scenes share the textures of the sources, so a
+// source unloaded on the main thread stays on the GPU until the last
+// scene showing it has been overwritten by a later publish.
+class SceneRenderer {
+ public:
+  SceneRenderer();
+  ~SceneRenderer();
+
+  // Call from the main thread
+  void publish(vector<BaseSurface*>& surfaces);
+  // Call from the thread the current GL context belongs to, unless
+  // the render thread runs
+  void draw();
+
+  // Draw on a thread of its own into context until stopRenderThread.
+  // Static layers and crossfades need the oF renderer, which is not
+  // thread safe, so they are not used while the thread runs.
+  void startRenderThread(RenderContext* context);
+  void stopRenderThread();
+  bool isRenderThreadRunning();
+
+  // Composite consecutive static surfaces into cached layers
+  void setFlattenStaticSurfaces(bool flatten);
+  bool getFlattenStaticSurfaces();
+
+  // Number of scenes published so far
+  unsigned long getNumPublished();
+
+  // Fade from the scene drawn last to the next published one over
+  // duration seconds. The outgoing scene is rendered into a cached
+  // layer once, so its sources have to stay loaded until it has been
+  // drawn, see isCrossfadePending.
+  void crossfade(float duration);
+  // True until draw has cached the outgoing scene
+  bool isCrossfadePending();
+
+ private:
+  class RenderThread : public ofThread {
+   public:
+    RenderThread(SceneRenderer* newRenderer);
+    void threadedFunction();
+
+   private:
+    SceneRenderer* renderer;
+  };
+
+  struct Scene {
+    vector<SceneSurface> surfaces;
+    unsigned long number;
+  };
+
+  Scene scenes[3];
+  Scene* writeScene;
+  Scene* readyScene;
+  Scene* drawScene;
+  bool bReady;
+  unsigned long numPublished;
+  ofMutex mutex;
+
+  vector<StaticLayer*> staticLayers;
+  bool bFlattenStaticSurfaces;
+
+  // The first scene that fades in is numbered fadeSceneNumber
+  bool bFadePending;
+  unsigned long fadeSceneNumber;
+  float pendingFadeDuration;
+  // Owned by the drawing thread
+  float fadeDuration;
+  float fadeStartTime;
+  bool bFading;
+  ofFbo fadeLayer;
+
+  RenderThread* renderThread;
+  RenderContext* renderContext;
+
+  void renderLoop();
+  void beginFrame();
+  void drawSurfaces(vector<SceneSurface>& surfaces);
+  void captureFadeLayer(vector<SceneSurface>& surfaces);
+  void drawFadeLayer();
+  void clearStaticLayers();
+};
+}
+}
@@ -0,0 +1,295 @@
+#include "SceneSurface.h"
+#include "RenderStats.h"
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+GLuint SceneSurface::boundTextureId = 0;
+GLenum SceneSurface::boundTextureTarget = GL_TEXTURE_2D;
+
+SceneSurface::SceneSurface() {
+  id = 0;
+  revision = 0;
+  bStatic = false;
+  region.set(0.0f, 0.0f, 1.0f, 1.0f);
+  transition = TransitionType::TRANSITION_NONE;
+  progress = 1.0f;
+}
+
+void SceneSurface::draw(bool bKeepBound) {
+  if (!texture.isAllocated()) {
+    PIMAPPER_LOG_THROTTLED(OF_LOG_WARNING, "SceneSurface")
+        << "Source texture empty. Not drawing.";
+    return;
+  }
+  if (!indices.size()) return;
+  if (transition != TransitionType::TRANSITION_NONE &&
+      fromTexture.isAllocated()) {
+    endBatch();
+    drawTransition();
+    return;
+  }
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, &vertices[0]);
+  glTexCoordPointer(4, GL_FLOAT, 0, &texCoords[0]);
+
+  ofTextureData& data = texture.getTextureData();
+  if (data.textureID != boundTextureId) {
+    endBatch();
+    bind(texture);
+    PIMAPPER_COUNT_BIND();
+    boundTextureId = data.textureID;
+    boundTextureTarget = data.textureTarget;
+  }
+  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, &indices[0]);
+  // Client side arrays are sent on every draw
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(vertices.size() / 3);
+  PIMAPPER_COUNT_DRAW(indices.size());
+  if (!bKeepBound) endBatch();
+
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void SceneSurface::endBatch() {
+  if (boundTextureId == 0) return;
+  unbind(boundTextureTarget);
+  PIMAPPER_COUNT_UNBIND();
+  boundTextureId = 0;
+}
+
+void SceneSurface::bind(ofTexture& texture) {
+  ofTextureData& data = texture.getTextureData();
+  glEnable(data.textureTarget);
+  glBindTexture(data.textureTarget, data.textureID);
+  // Texture coordinates are normalized, see BaseSurface
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+  glLoadIdentity();
+#ifndef TARGET_OPENGLES
+  if (data.textureTarget == GL_TEXTURE_RECTANGLE_ARB) {
+    glScalef(data.width, data.height, 1.0f);
+  } else
+#endif
+  {
+    glScalef(data.width / data.tex_w, data.height / data.tex_h, 1.0f);
+  }
+  glMatrixMode(GL_MODELVIEW);
+}
+
+void SceneSurface::unbind(GLenum target) {
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glBindTexture(target, 0);
+  glDisable(target);
+}
+
+void SceneSurface::drawTransition() {
+  GLfloat* drawVertices = &vertices[0];
+  GLfloat* drawTexCoords = &texCoords[0];
+  GLfloat* drawFromTexCoords =
+      fromTexCoords.size() ? &fromTexCoords[0] : &texCoords[0];
+  vector<GLushort>* drawIndices = &indices;
+  if (transition == TransitionType::TRANSITION_WIPE) {
+    splitWipe();
+    drawVertices = &wipeVertices[0];
+    drawTexCoords = &wipeTexCoords[0];
+    drawFromTexCoords = &wipeFromTexCoords[0];
+    drawIndices = &wipeIndices;
+  } else {
+    int numVertices = vertices.size() / 3;
+    blendColors.resize(numVertices * 4);
+    for (int i = 0; i < numVertices; i++) {
+      blendColors[i * 4] = 1.0f;
+      blendColors[i * 4 + 1] = 1.0f;
+      blendColors[i * 4 + 2] = 1.0f;
+      blendColors[i * 4 + 3] = progress;
+    }
+  }
+  int numVertices = blendColors.size() / 4;
+
+  // The color array leaves the current color undefined
+  GLfloat color[4];
+  glGetFloatv(GL_CURRENT_COLOR, color);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, drawVertices);
+  glColorPointer(4, GL_FLOAT, 0, &blendColors[0]);
+
+  // Unit 0 passes the outgoing texture on
+  glActiveTexture(GL_TEXTURE0);
+  glClientActiveTexture(GL_TEXTURE0);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(4, GL_FLOAT, 0, drawFromTexCoords);
+  bind(fromTexture);
+  PIMAPPER_COUNT_BIND();
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+  // Unit 1 interpolates towards the incoming texture by the vertex alpha,
+  // so both are blended in a single pass
+  glActiveTexture(GL_TEXTURE1);
+  glClientActiveTexture(GL_TEXTURE1);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(4, GL_FLOAT, 0, drawTexCoords);
+  bind(texture);
+  PIMAPPER_COUNT_BIND();
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_INTERPOLATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_RGB, GL_TEXTURE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SRC1_RGB, GL_PREVIOUS);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SRC2_RGB, GL_PRIMARY_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_RGB, GL_SRC_ALPHA);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_INTERPOLATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SRC0_ALPHA, GL_TEXTURE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SRC1_ALPHA, GL_PREVIOUS);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SRC2_ALPHA, GL_PRIMARY_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_ALPHA, GL_SRC_ALPHA);
+
+  glDrawElements(GL_TRIANGLES, drawIndices->size(), GL_UNSIGNED_SHORT,
+                 &(*drawIndices)[0]);
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(numVertices);
+  PIMAPPER_COUNT_DRAW(drawIndices->size());
+
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  unbind(texture.getTextureData().textureTarget);
+  PIMAPPER_COUNT_UNBIND();
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glActiveTexture(GL_TEXTURE0);
+  glClientActiveTexture(GL_TEXTURE0);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  unbind(fromTexture.getTextureData().textureTarget);
+  PIMAPPER_COUNT_UNBIND();
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glColor4f(color[0], color[1], color[2], color[3]);
+}
+
+void SceneSurface::splitWipe() {
+  // Colors are interpolated linearly between vertices, so triangles the
+  // soft edge crosses are cut where it starts and where it ends. Outside
+  // of the edge the amount is then exactly 0 or 1.
+  float edge = progress * (1.0f + WIPE_EDGE_WIDTH);
+  float cuts[2] = {edge - WIPE_EDGE_WIDTH, edge};
+
+  wipeVertices = vertices;
+  wipeTexCoords = texCoords;
+  wipeFromTexCoords = fromTexCoords.size() ? fromTexCoords : texCoords;
+  wipeIndices.clear();
+  vector<GLushort> polygon;
+  vector<GLushort> before;
+  vector<GLushort> after;
+  for (int i = 0; i + 2 < indices.size(); i += 3) {
+    // Triangles on one side of both cuts stay as they are
+    int sides[3];
+    for (int j = 0; j < 3; j++) {
+      float position = getWipePosition(&texCoords[indices[i + j] * 4]);
+      sides[j] = (position >= cuts[0]) + (position >= cuts[1]);
+    }
+    if (sides[0] == sides[1] && sides[1] == sides[2]) {
+      wipeIndices.insert(wipeIndices.end(), &indices[i], &indices[i] + 3);
+      continue;
+    }
+
+    polygon.assign(&indices[i], &indices[i] + 3);
+    for (int c = 0; c < 2; c++) {
+      before.clear();
+      after.clear();
+      for (int j = 0; j < polygon.size(); j++) {
+        GLushort a = polygon[j];
+        GLushort b = polygon[(j + 1) % polygon.size()];
+        bool bBeforeA = getWipePosition(&wipeTexCoords[a * 4]) < cuts[c];
+        bool bBeforeB = getWipePosition(&wipeTexCoords[b * 4]) < cuts[c];
+        if (bBeforeA) {
+          before.push_back(a);
+        } else {
+          after.push_back(a);
+        }
+        if (bBeforeA != bBeforeB) {
+          GLushort cut = cutWipeEdge(a, b, cuts[c]);
+          before.push_back(cut);
+          after.push_back(cut);
+        }
+      }
+      addWipePolygon(before);
+      polygon.swap(after);
+    }
+    addWipePolygon(polygon);
+  }
+
+  // The incoming texture is left of the edge
+  int numVertices = wipeVertices.size() / 3;
+  blendColors.resize(numVertices * 4);
+  for (int i = 0; i < numVertices; i++) {
+    float position = getWipePosition(&wipeTexCoords[i * 4]);
+    blendColors[i * 4] = 1.0f;
+    blendColors[i * 4 + 1] = 1.0f;
+    blendColors[i * 4 + 2] = 1.0f;
+    blendColors[i * 4 + 3] =
+        ofClamp((edge - position) / WIPE_EDGE_WIDTH, 0.0f, 1.0f);
+  }
+}
+
+float SceneSurface::getWipePosition(const GLfloat* texCoord) {
+  return (texCoord[0] / texCoord[3] - region.x) / region.width;
+}
+
+GLushort SceneSurface::cutWipeEdge(GLushort a, GLushort b, float position) {
+  // s / q is not linear along the edges of perspective quads, solve
+  // (sa + t * (sb - sa)) / (qa + t * (qb - qa)) = s for t
+  float s = region.x + position * region.width;
+  GLfloat* texCoordA = &wipeTexCoords[a * 4];
+  GLfloat* texCoordB = &wipeTexCoords[b * 4];
+  float t = (s * texCoordA[3] - texCoordA[0]) /
+            (texCoordB[0] - texCoordA[0] - s * (texCoordB[3] - texCoordA[3]));
+
+  // Interpolate before adding, adding may move the arrays
+  GLfloat vertex[3];
+  GLfloat texCoord[4];
+  GLfloat fromTexCoord[4];
+  for (int i = 0; i < 4; i++) {
+    if (i < 3) {
+      vertex[i] = ofLerp(wipeVertices[a * 3 + i], wipeVertices[b * 3 + i], t);
+    }
+    texCoord[i] = ofLerp(texCoordA[i], texCoordB[i], t);
+    fromTexCoord[i] = ofLerp(wipeFromTexCoords[a * 4 + i],
+                             wipeFromTexCoords[b * 4 + i], t);
+  }
+  wipeVertices.insert(wipeVertices.end(), vertex, vertex + 3);
+  wipeTexCoords.insert(wipeTexCoords.end(), texCoord, texCoord + 4);
+  wipeFromTexCoords.insert(wipeFromTexCoords.end(), fromTexCoord,
+                           fromTexCoord + 4);
+  return wipeVertices.size() / 3 - 1;
+}
+
+void SceneSurface::addWipePolygon(vector<GLushort>& polygon) {
+  // Parts of a triangle cut by lines are convex
+  for (int i = 1; i + 1 < polygon.size(); i++) {
+    wipeIndices.push_back(polygon[0]);
+    wipeIndices.push_back(polygon[i]);
+    wipeIndices.push_back(polygon[i + 1]);
+  }
+}
+
+void SceneSurface::mapTexCoords(vector<GLfloat>& texCoords,
+                                const ofRectangle& from,
+                                const ofRectangle& to) {
+  if (from == to) return;
+  // Linear in s and q, so perspective correct coordinates stay correct
+  float scaleX = to.width / from.width;
+  float scaleY = to.height / from.height;
+  for (int i = 0; i + 3 < texCoords.size(); i += 4) {
+    GLfloat q = texCoords[i + 3];
+    texCoords[i] = to.x * q + (texCoords[i] - from.x * q) * scaleX;
+    texCoords[i + 1] = to.y * q + (texCoords[i + 1] - from.y * q) * scaleY;
+  }
+}
+}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ofMain.h"
+#include "TransitionType.h"
+
+namespace ofx {
+namespace piMapper {
+// Copy of everything needed to draw a surface. It does not point back to
+// the surface, so it stays valid while the surface is being edited.
+//
+// Textures are copies too. A copy shares the GL texture of the source and
+// keeps it alive after the media server unloaded the source, until the
+// copy is overwritten. oF counts these references without a lock, so
+// copy and destroy scene surfaces on the main thread only. Drawing them
+// goes straight to GL and works on any thread with a current context.
+struct SceneSurface {
+  SceneSurface();
+
+  // BaseSurface::getId and getRevision at the time of the copy
+  unsigned int id;
+  unsigned int revision;
+  // Not allocated if the source has no texture
+  ofTexture texture;
+  bool bStatic;
+  // x, y, z per vertex
+  vector<GLfloat> vertices;
+  // s, t, r, q per vertex, q makes the texture of quads perspective correct.
+  // They are mapped into the region of the texture.
+  vector<GLfloat> texCoords;
+  vector<GLushort> indices;
+  // Normalized part of the texture the source shows
+  ofRectangle region;
+
+  // Texture being blended out, see BaseSurface::setTransition. Not
+  // allocated without a transition.
+  ofTexture fromTexture;
+  int transition;
+  float progress;
+  // Texture coordinates in the region of the outgoing texture, empty if
+  // the regions are the same
+  vector<GLfloat> fromTexCoords;
+
+  // Surfaces drawn one after the other with bKeepBound share the bind
+  // of a texture, like images packed into one atlas page. Call endBatch
+  // after the last one.
+  void draw(bool bKeepBound = false);
+  static void endBatch();
+
+  // Moves 4d texture coordinates from one normalized region into another
+  static void mapTexCoords(vector<GLfloat>& texCoords, const ofRectangle& from,
+                           const ofRectangle& to);
+
+ private:
+  // r, g, b, a per vertex, alpha is the amount of the incoming texture
+  vector<GLfloat> blendColors;
+  // Geometry of a wipe, cut where the soft edge starts and ends
+  vector<GLfloat> wipeVertices;
+  vector<GLfloat> wipeTexCoords;
+  vector<GLfloat> wipeFromTexCoords;
+  vector<GLushort> wipeIndices;
+  // Left bound by the last draw of a batch, 0 if none
+  static GLuint boundTextureId;
+  static GLenum boundTextureTarget;
+
+  void drawTransition();
+  void splitWipe();
+  // Horizontal position in the texture region, 0 to 1
+  float getWipePosition(const GLfloat* texCoord);
+  // Adds the point of the edge between wipe vertices a and b at position
+  // and returns its index
+  GLushort cutWipeEdge(GLushort a, GLushort b, float position);
+  void addWipePolygon(vector<GLushort>& polygon);
+  // Like ofTexture::bind and unbind without the renderer, which belongs
+  // to the main thread
+  static void bind(ofTexture& texture);
+  static void unbind(GLenum target);
+};
+}
+}
@@ -0,0 +1,161 @@
+#include "SettingsWriter.h"
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+SettingsWriter::SettingsWriter() {
+  bBusy = false;
+  ofAddListener(ofEvents().update, this, &SettingsWriter::update);
+}
+
+SettingsWriter::~SettingsWriter() {
+  ofRemoveListener(ofEvents().update, this, &SettingsWriter::update);
+  if (isThreadRunning()) {
+    // Let the thread finish writing what is queued
+    lock();
+    stopThread();
+    condition.signal();
+    unlock();
+    waitForThread(false);
+  }
+}
+
+void SettingsWriter::save(vector<SurfaceSnapshot>& snapshot,
+                          std::string fileName, int journalSequence) {
+  Job job;
+  job.snapshot = snapshot;
+  job.fileName = fileName;
+  // Resolve the path on the main thread
+  job.filePath = ofToDataPath(fileName, true);
+  job.journalSequence = journalSequence;
+  job.success = false;
+
+  lock();
+  if (pendingJobs.size() && pendingJobs.back().fileName == fileName) {
+    pendingJobs.back() = job;
+  } else {
+    pendingJobs.push_back(job);
+  }
+  condition.signal();
+  unlock();
+
+  if (!isThreadRunning()) {
+    startThread(true, false);
+  }
+}
+
+bool SettingsWriter::isSaving() {
+  lock();
+  bool saving = bBusy || pendingJobs.size() || finishedJobs.size();
+  unlock();
+  return saving;
+}
+
+void SettingsWriter::update(ofEventArgs& args) {
+  std::deque<Job> jobs;
+  lock();
+  jobs.swap(finishedJobs);
+  unlock();
+
+  for (int i = 0; i < jobs.size(); i++) {
+    if (jobs[i].success) {
+      ofNotifyEvent(onSaveComplete, jobs[i].fileName, this);
+    } else {
+      PIMAPPER_LOG_ERROR("SettingsWriter") << "Failed to save " << jobs[i].fileName;
+      ofNotifyEvent(onSaveFailed, jobs[i].fileName, this);
+    }
+  }
+}
+
+void SettingsWriter::write(ofxXmlSettings& xml,
+                           vector<SurfaceSnapshot>& snapshot,
+                           int journalSequence) {
+  if (journalSequence > 0) {
+    xml.addValue("journal-sequence", journalSequence);
+  }
+  xml.addTag("surfaces");
+  xml.pushTag("surfaces");
+  for (int i = 0; i < snapshot.size(); i++) {
+    xml.addTag("surface");
+    xml.pushTag("surface", i);
+    SurfaceSnapshot& surface = snapshot[i];
+
+    xml.addTag("vertices");
+    xml.pushTag("vertices");
+    for (int j = 0; j < surface.vertices.size(); j++) {
+      xml.addTag("vertex");
+      xml.pushTag("vertex", j);
+      xml.addValue("x", surface.vertices[j].x);
+      xml.addValue("y", surface.vertices[j].y);
+      xml.popTag();  // vertex
+    }
+    xml.popTag();  // vertices
+
+    xml.addTag("texCoords");
+    xml.pushTag("texCoords");
+    for (int j = 0; j < surface.texCoords.size(); j++) {
+      xml.addTag("texCoord");
+      xml.pushTag("texCoord", j);
+      xml.addValue("x", surface.texCoords[j].x);
+      xml.addValue("y", surface.texCoords[j].y);
+      xml.popTag();  // texCoord
+    }
+    xml.popTag();  // texCoords
+
+    xml.addTag("source");
+    xml.pushTag("source");
+    xml.addValue("source-type", surface.sourceType);
+    xml.addValue("source-name", surface.sourceName);
+    xml.popTag();  // source
+    xml.popTag();  // surface
+  }
+  xml.popTag();  // surfaces
+}
+
+void SettingsWriter::threadedFunction() {
+  while (true) {
+    lock();
+    while (!pendingJobs.size() && isThreadRunning()) {
+      condition.wait(mutex);
+    }
+    if (!pendingJobs.size()) {
+      // Stopped and nothing left to write
+      unlock();
+      break;
+    }
+    Job job = pendingJobs.front();
+    pendingJobs.pop_front();
+    bBusy = true;
+    unlock();
+
+    job.success = writeFile(job);
+    // Snapshot is not needed anymore, don't keep it around
+    job.snapshot.clear();
+
+    lock();
+    finishedJobs.push_back(job);
+    bBusy = false;
+    unlock();
+  }
+}
+
+bool SettingsWriter::writeFile(Job& job) {
+  ofxXmlSettings xml;
+  write(xml, job.snapshot, job.journalSequence);
+
+  std::string tempPath = job.filePath + ".tmp";
+  if (!xml.saveFile(tempPath)) {
+    return false;
+  }
+  // rename() replaces the target atomically on POSIX systems
+#ifdef TARGET_WIN32
+  std::remove(job.filePath.c_str());
+#endif
+  if (std::rename(tempPath.c_str(), job.filePath.c_str()) != 0) {
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofEvents.h"
+#include "ofxXmlSettings.h"
+#include "Poco/Condition.h"
+#include "SurfaceSnapshot.h"
+
+namespace ofx {
+namespace piMapper {
+// Serializes surface snapshots to xml on a background thread. Files are
+// written to a temporary file first and then renamed over the target,
+// so an interrupted save never leaves a half written settings file.
+// Completion and failure are reported on the main thread via events.
+class SettingsWriter : public ofThread {
+ public:
+  SettingsWriter();
+  ~SettingsWriter();
+
+  // Queue a save. If a save of the same file is still waiting,
+  // it is replaced by this one. A journal sequence greater than 0 is
+  // stored along with the surfaces, see EditJournal.
+  void save(vector<SurfaceSnapshot>& snapshot, std::string fileName,
+            int journalSequence = 0);
+  // True until completion of every queued save has been reported
+  bool isSaving();
+  void update(ofEventArgs& args);
+
+  // Write snapshot into xml settings object
+  static void write(ofxXmlSettings& xml, vector<SurfaceSnapshot>& snapshot,
+                    int journalSequence = 0);
+
+  // Events are passed the file name that was given to save()
+  ofEvent<std::string> onSaveComplete;
+  ofEvent<std::string> onSaveFailed;
+
+ private:
+  struct Job {
+    vector<SurfaceSnapshot> snapshot;
+    std::string fileName;
+    std::string filePath;
+    int journalSequence;
+    bool success;
+  };
+
+  std::deque<Job> pendingJobs;
+  std::deque<Job> finishedJobs;
+  Poco::Condition condition;
+  bool bBusy;
+
+  void threadedFunction();
+  bool writeFile(Job& job);
+};
+}
+}
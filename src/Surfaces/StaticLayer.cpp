@@ -0,0 +1,82 @@
+#include "StaticLayer.h"
+#include "RenderStats.h"
+
+namespace ofx {
+namespace piMapper {
+StaticLayer::StaticLayer() { bDirty = true; }
+
+StaticLayer::~StaticLayer() {
+  surfaces.clear();
+  ids.clear();
+  revisions.clear();
+  textureIds.clear();
+  regions.clear();
+}
+
+void StaticLayer::setSurfaces(vector<SceneSurface*>& newSurfaces) {
+  // Compare surface ids, revisions and textures with what we have rendered
+  surfaces = newSurfaces;
+  if (surfaces.size() != ids.size()) {
+    bDirty = true;
+  } else {
+    for (int i = 0; i < surfaces.size(); i++) {
+      if (surfaces[i]->id != ids[i] ||
+          surfaces[i]->revision != revisions[i] ||
+          surfaces[i]->texture.getTextureData().textureID !=
+              textureIds[i] ||
+          surfaces[i]->region != regions[i]) {
+        bDirty = true;
+        break;
+      }
+    }
+  }
+
+  if (!bDirty) return;
+
+  ids.resize(surfaces.size());
+  revisions.resize(surfaces.size());
+  textureIds.resize(surfaces.size());
+  regions.resize(surfaces.size());
+  for (int i = 0; i < surfaces.size(); i++) {
+    ids[i] = surfaces[i]->id;
+    revisions[i] = surfaces[i]->revision;
+    textureIds[i] = surfaces[i]->texture.getTextureData().textureID;
+    regions[i] = surfaces[i]->region;
+  }
+}
+
+void StaticLayer::draw() {
+  if (!fbo.isAllocated() || fbo.getWidth() != ofGetWidth() ||
+      fbo.getHeight() != ofGetHeight()) {
+    fbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
+    bDirty = true;
+  }
+
+  if (bDirty) render();
+
+  fbo.draw(0, 0);
+  PIMAPPER_COUNT_BIND();
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(4);
+  PIMAPPER_COUNT_DRAW(4);
+  PIMAPPER_COUNT_UNBIND();
+}
+
+bool StaticLayer::isDirty() { return bDirty; }
+
+void StaticLayer::render() {
+  // Render surfaces with full color, the current style
+  // is applied when drawing the layer itself
+  ofPushStyle();
+  ofSetColor(255, 255, 255, 255);
+  fbo.begin();
+  ofClear(0, 0, 0, 0);
+  for (int i = 0; i < surfaces.size(); i++) {
+    surfaces[i]->draw(true);
+  }
+  SceneSurface::endBatch();
+  fbo.end();
+  ofPopStyle();
+  bDirty = false;
+}
+}
+}
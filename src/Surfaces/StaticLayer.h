@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SceneSurface.h"
+
+namespace ofx {
+namespace piMapper {
+// Caches a run of static surfaces in a full screen FBO so that they
+// can be drawn as a single textured quad. The FBO is redrawn only when
+// one of the surfaces, their order, their textures or the window size
+// changes.
+class StaticLayer {
+ public:
+  StaticLayer();
+  ~StaticLayer();
+
+  // Assign the surfaces this layer consists of, in drawing order.
+  // They have to stay valid until draw is called.
+  void setSurfaces(vector<SceneSurface*>& newSurfaces);
+  void draw();
+  bool isDirty();
+
+ private:
+  vector<SceneSurface*> surfaces;
+  vector<unsigned int> ids;
+  vector<unsigned int> revisions;
+  // Repacking an atlas moves images without a new revision
+  vector<GLuint> textureIds;
+  vector<ofRectangle> regions;
+  ofFbo fbo;
+  bool bDirty;
+
+  void render();
+};
+}
+}
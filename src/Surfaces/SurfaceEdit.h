@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SurfaceSnapshot.h"
+
+namespace ofx {
+namespace piMapper {
+// Describes a single editing operation on the surfaces of a SurfaceManager.
+// Surfaces are referenced by their index (z-order) at the time of the edit.
+struct SurfaceEdit {
+  enum { VERTEX, TEX_COORD, MOVE, SOURCE, ADD, REMOVE };
+
+  int type;
+  int surfaceIndex;
+  // Vertex or texture coordinate index for VERTEX and TEX_COORD
+  int pointIndex;
+  // Old and new position for VERTEX and TEX_COORD, to is the delta for MOVE
+  ofVec2f from;
+  ofVec2f to;
+  // Source before and after a SOURCE edit
+  std::string fromSourceType;
+  std::string fromSourceName;
+  std::string sourceType;
+  std::string sourceName;
+  // Complete surface for ADD and REMOVE
+  SurfaceSnapshot surface;
+
+  SurfaceEdit() {
+    type = VERTEX;
+    surfaceIndex = 0;
+    pointIndex = 0;
+  }
+};
+}
+}
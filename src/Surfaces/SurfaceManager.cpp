@@ -1,18 +1,95 @@
 #include "SurfaceManager.h"
+#include "Profiler.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
+static ofRectangle getBounds(vector<ofVec2f>& points) {
+  ofRectangle bounds(points[0].x, points[0].y, 0.0f, 0.0f);
+  for (int i = 1; i < points.size(); i++) {
+    bounds.growToInclude(points[i].x, points[i].y);
+  }
+  return bounds;
+}
+
   SurfaceManager::SurfaceManager() {
     // Init variables
     mediaServer = NULL;
+    selectedSurface = NULL;
+    bTrackChanges = true;
+    compactInterval = DEFAULT_COMPACT_INTERVAL;
+    lastCompactTime = 0.0f;
+    compactingSequence = 0;
+    bCompactPending = false;
+    loadedJournalSequence = 0;
+    bJournalEdits = true;
+    watchInterval = DEFAULT_WATCH_INTERVAL;
+    lastWatchTime = 0.0f;
+    watchedModified = 0;
+    watchedSize = 0;
+    ofAddListener(ofEvents().update, this, &SurfaceManager::update);
+    ofAddListener(settingsWriter.onSaveComplete, this,
+                  &SurfaceManager::handleSaveComplete);
+    ofAddListener(settingsWriter.onSaveFailed, this,
+                  &SurfaceManager::handleSaveFailed);
   }
 
-SurfaceManager::~SurfaceManager() { clear(); }
+SurfaceManager::~SurfaceManager() {
+  renderer.stopRenderThread();
+  // Shutting down is not an edit
+  bTrackChanges = false;
+  journal.close();
+  ofRemoveListener(ofEvents().update, this, &SurfaceManager::update);
+  ofRemoveListener(settingsWriter.onSaveComplete, this,
+                   &SurfaceManager::handleSaveComplete);
+  ofRemoveListener(settingsWriter.onSaveFailed, this,
+                   &SurfaceManager::handleSaveFailed);
+  clear();
+}
 
-void SurfaceManager::draw() {
-  for (int i = 0; i < surfaces.size(); i++) {
-    surfaces[i]->draw();
+void SurfaceManager::update(ofEventArgs& args) {
+  PIMAPPER_PROFILE("update", "SurfaceManager");
+  flushEdits();
+  applyVertexInput();
+
+  if (watchedFileName != "" &&
+      ofGetElapsedTimef() - lastWatchTime >= watchInterval) {
+    lastWatchTime = ofGetElapsedTimef();
+    checkWatchedFile();
   }
+
+  updateTransitions();
+  updateGeometry();
+  publishScene();
+
+  if (fadeSources.size() && !renderer.isCrossfadePending()) {
+    releaseSources(fadeSources);
+  }
+
+  if (!journal.isOpen()) return;
+  journal.flush();
+
+  if (journal.getNumEntries() <= 0) return;
+  if (journal.getNumEntries() >= MAX_JOURNAL_ENTRIES ||
+      ofGetElapsedTimef() - lastCompactTime >= compactInterval) {
+    saveXmlSettings(autosaveFileName);
+  }
+}
+
+void SurfaceManager::draw() {
+  if (renderer.isRenderThreadRunning()) return;
+  PIMAPPER_PROFILE("draw", "SurfaceManager");
+  renderer.draw();
+}
+
+void SurfaceManager::startRenderThread(RenderContext* context) {
+  renderer.startRenderThread(context);
+}
+
+void SurfaceManager::stopRenderThread() { renderer.stopRenderThread(); }
+
+bool SurfaceManager::isRenderThreadRunning() {
+  return renderer.isRenderThreadRunning();
 }
 
 void SurfaceManager::addSurface(int surfaceType) {
@@ -24,6 +101,8 @@ void SurfaceManager::addSurface(int surfaceType) {
     ofLogFatalError("SurfaceManager") << "Attempt to add non-existing surface type";
     std::exit(EXIT_FAILURE);
   }
+
+  trackSurfaceAdded();
 }
 
 void SurfaceManager::addSurface(int surfaceType, BaseSource* newSource) {
@@ -37,6 +116,8 @@ void SurfaceManager::addSurface(int surfaceType, BaseSource* newSource) {
     ofLogFatalError("SurfaceManager") << "Attempt to add non-existing surface type";
     std::exit(EXIT_FAILURE);
   }
+
+  trackSurfaceAdded();
 }
 
 void SurfaceManager::addSurface(int surfaceType, vector<ofVec2f> vertices,
@@ -75,6 +156,8 @@ void SurfaceManager::addSurface(int surfaceType, vector<ofVec2f> vertices,
     ofLogFatalError("SurfaceManager") << "Attempt to add non-existing surface type";
     std::exit(EXIT_FAILURE);
   }
+
+  trackSurfaceAdded();
 }
 
 void SurfaceManager::addSurface(int surfaceType, BaseSource* newSource,
@@ -116,6 +199,48 @@ void SurfaceManager::addSurface(int surfaceType, BaseSource* newSource,
     ofLogFatalError("SurfaceManager") << "Attempt to add non-existing surface type";
     std::exit(EXIT_FAILURE);
   }
+
+  trackSurfaceAdded();
+}
+
+void SurfaceManager::addSurface(SurfaceSnapshot& surface) {
+  BaseSource* source =
+      loadSource(surface.sourceType, surface.sourceName, &surface.texCoords);
+  if (source != NULL) {
+    addSurface(surface.type, source, surface.vertices, surface.texCoords);
+  } else {
+    addSurface(surface.type, surface.vertices, surface.texCoords);
+  }
+}
+
+void SurfaceManager::removeSurface(int index) {
+  if (index < 0 || index >= surfaces.size()) {
+    throw std::runtime_error("Surface index out of bounds.");
+  }
+
+  if (bTrackChanges) {
+    // Changes made before the removal come first, undoing the removal
+    // restores the surface as it was last
+    trackChanges();
+    SurfaceEdit edit;
+    edit.type = SurfaceEdit::REMOVE;
+    edit.surfaceIndex = index;
+    edit.surface = trackedSurfaces[index];
+    recordEdit(edit);
+  }
+
+  if (surfaces[index] == selectedSurface) {
+    selectedSurface = NULL;
+  }
+  // Adding the surface again, like undo does, loads it again
+  BaseSource* source = surfaces[index]->getSource();
+  if (source->isLoadable()) {
+    mediaServer->unloadMedia(source->getPath());
+  }
+  delete surfaces[index];
+  surfaces.erase(surfaces.begin() + index);
+  trackedSurfaces.erase(trackedSurfaces.begin() + index);
+  trackedRevisions.erase(trackedRevisions.begin() + index);
 }
 
 void SurfaceManager::removeSelectedSurface() {
@@ -124,9 +249,7 @@ void SurfaceManager::removeSelectedSurface() {
   }
   for (int i = 0; i < surfaces.size(); i++) {
     if (surfaces[i] == selectedSurface) {
-      delete surfaces[i];
-      surfaces.erase(surfaces.begin() + i);
-      selectedSurface = NULL;
+      removeSurface(i);
       break;
     }
   }
@@ -138,6 +261,9 @@ void SurfaceManager::clear() {
     delete surfaces.back();
     surfaces.pop_back();
   }
+  trackedSurfaces.clear();
+  trackedRevisions.clear();
+  selectedSurface = NULL;
 }
 
 void SurfaceManager::saveXmlSettings(string fileName) {
@@ -146,55 +272,80 @@ void SurfaceManager::saveXmlSettings(string fileName) {
     ofLogFatalError("SurfaceManager") << "Media server not set";
     std::exit(EXIT_FAILURE);
   }
-  // We need a fresh copy of the xml settings object
-  xmlSettings.clear();
-  // Save surfaces
-  xmlSettings.addTag("surfaces");
-  xmlSettings.pushTag("surfaces");
-  for (int i = 0; i < surfaces.size(); i++) {
-    xmlSettings.addTag("surface");
-    xmlSettings.pushTag("surface", i);
-    BaseSurface* surface = surfaces[i];
 
-    xmlSettings.addTag("vertices");
-    xmlSettings.pushTag("vertices");
-    vector<ofVec3f>* vertices = &surface->getVertices();
-    for (int j = 0; j < vertices->size(); j++) {
-      xmlSettings.addTag("vertex");
-      xmlSettings.pushTag("vertex", j);
-      ofVec3f* vertex = &(*vertices)[j];
-      xmlSettings.addValue("x", vertex->x);
-      xmlSettings.addValue("y", vertex->y);
+  // Saving the autosave file compacts the journal. Only one of those
+  // saves may be in flight as the journal is truncated when it completes.
+  int journalSequence = 0;
+  if (journal.isOpen() && fileName == autosaveFileName) {
+    if (compactingSequence > 0) {
+      bCompactPending = true;
+      return;
+    }
+    // Make sure every change that ends up in the file is journaled
+    if (bTrackChanges) {
+      trackChanges();
+    }
+    journal.flush();
+    journalSequence = journal.getSequence();
+    compactingSequence = journalSequence;
+    lastCompactTime = ofGetElapsedTimef();
+  }
 
-      // we don't need z as it will be 0 anyways
+  // Take a cheap copy here and leave the xml work to the writer thread
+  vector<SurfaceSnapshot> snapshot;
+  getSnapshot(snapshot);
+  settingsWriter.save(snapshot, fileName, journalSequence);
+}
 
-      xmlSettings.popTag();  // vertex
-    }
-    xmlSettings.popTag();  // vertices
+void SurfaceManager::getSnapshot(vector<SurfaceSnapshot>& snapshot) {
+  snapshot.clear();
+  snapshot.reserve(surfaces.size());
+  for (int i = 0; i < surfaces.size(); i++) {
+    snapshot.push_back(getSnapshot(surfaces[i]));
+  }
+}
 
-    xmlSettings.addTag("texCoords");
-    xmlSettings.pushTag("texCoords");
-    vector<ofVec2f>* texCoords = &surface->getTexCoords();
-    for (int j = 0; j < texCoords->size(); j++) {
-      xmlSettings.addTag("texCoord");
-      xmlSettings.pushTag("texCoord", j);
-      ofVec2f* texCoord = &(*texCoords)[j];
-      xmlSettings.addValue("x", texCoord->x);
-      xmlSettings.addValue("y", texCoord->y);
-      xmlSettings.popTag();  // texCoord
+SurfaceSnapshot SurfaceManager::getSnapshot(BaseSurface* surface) {
+  SurfaceSnapshot snapshot;
+  snapshot.type = surface->getType();
+  // we don't need z as it will be 0 anyways
+  vector<ofVec3f>& vertices = surface->getVertices();
+  for (int i = 0; i < vertices.size(); i++) {
+    snapshot.vertices.push_back(ofVec2f(vertices[i].x, vertices[i].y));
+  }
+  snapshot.texCoords = surface->getTexCoords();
+  snapshot.sourceType =
+      SourceType::GetSourceTypeName(surface->getSource()->getType());
+  snapshot.sourceName = surface->getSource()->getName();
+  return snapshot;
+}
+
+void SurfaceManager::handleSaveComplete(string& fileName) {
+  PIMAPPER_LOG_NOTICE("SurfaceManager") << "Saved " << fileName;
+  if (fileName == watchedFileName) {
+    // Do not reload what we have just written
+    FileUtils::getStamp(ofToDataPath(watchedFileName, true), watchedModified,
+                        watchedSize);
+  }
+  if (fileName == autosaveFileName && compactingSequence > 0) {
+    // Everything up to the saved sequence is in the file now
+    journal.truncate(compactingSequence);
+    compactingSequence = 0;
+    if (bCompactPending) {
+      bCompactPending = false;
+      saveXmlSettings(autosaveFileName);
     }
-    xmlSettings.popTag();  // texCoords
-    xmlSettings.addTag("source");
-    xmlSettings.pushTag("source");
-    string sourceTypeName = SourceType::GetSourceTypeName(surface->getSource()->getType());
-    cout << "sourceTypeName: " << sourceTypeName << endl;
-    xmlSettings.addValue("source-type", sourceTypeName);
-    xmlSettings.addValue("source-name", surface->getSource()->getName());
-    xmlSettings.popTag();  // source
-    xmlSettings.popTag();  // surface
   }
-  xmlSettings.popTag();  // surfaces
-  xmlSettings.save(fileName);
+  ofNotifyEvent(onSaveComplete, fileName, this);
+}
+
+void SurfaceManager::handleSaveFailed(string& fileName) {
+  if (fileName == autosaveFileName && compactingSequence > 0) {
+    // Keep the journal, we will try again on the next interval
+    compactingSequence = 0;
+    bCompactPending = false;
+  }
+  ofNotifyEvent(onSaveFailed, fileName, this);
 }
 
 void SurfaceManager::loadXmlSettings(string fileName) {
@@ -203,162 +354,901 @@ void SurfaceManager::loadXmlSettings(string fileName) {
     ofLogFatalError("SurfaceManager") << "Media server not set";
     std::exit(EXIT_FAILURE);
   }
+
+  // Loading and replaying are not edits by themselves
+  bool bTrack = bTrackChanges;
+  bTrackChanges = false;
+  if (loadSurfaces(fileName)) {
+    replayJournal(fileName);
+  }
+  // Or the next update records the replayed edits once more
+  for (int i = 0; i < surfaces.size(); i++) {
+    acceptChanges(i);
+  }
+  bTrackChanges = bTrack;
+}
+
+bool SurfaceManager::loadSurfaces(string fileName) {
+  vector<SurfaceSnapshot> snapshot;
+  if (!readSurfaces(fileName, snapshot)) {
+    return false;
+  }
+  for (int i = 0; i < snapshot.size(); i++) {
+    addSurface(snapshot[i]);
+  }
+  return true;
+}
+
+bool SurfaceManager::readSurfaces(string fileName,
+                                  vector<SurfaceSnapshot>& snapshot) {
+  snapshot.clear();
   if (!xmlSettings.loadFile(fileName)) {
-    ofLogWarning("SurfaceManager") << "Could not load XML settings";
-    return;
+    PIMAPPER_LOG_WARNING("SurfaceManager") << "Could not load XML settings";
+    return false;
   }
   if (!xmlSettings.tagExists("surfaces")) {
-    ofLogWarning("SurfaceManager") << "XML settings is empty or has wrong markup";
-    return;
+    PIMAPPER_LOG_WARNING("SurfaceManager") << "XML settings is empty or has wrong markup";
+    return false;
   }
 
+  // Defaults for missing coordinates
+  static const ofVec2f triangleVertices[] = {
+      ofVec2f(0.0f, 0.0f), ofVec2f(100.0f, 0.0f), ofVec2f(0.0f, 100.0f)};
+  static const ofVec2f triangleTexCoords[] = {
+      ofVec2f(0.0f, 0.0f), ofVec2f(1.0f, 0.0f), ofVec2f(0.0f, 1.0f)};
+  static const ofVec2f quadVertices[] = {
+      ofVec2f(0.0f, 0.0f), ofVec2f(100.0f, 0.0f), ofVec2f(100.0f, 100.0f),
+      ofVec2f(0.0f, 100.0f)};
+  static const ofVec2f quadTexCoords[] = {
+      ofVec2f(0.0f, 0.0f), ofVec2f(1.0f, 0.0f), ofVec2f(1.0f, 1.0f),
+      ofVec2f(0.0f, 1.0f)};
+
   xmlSettings.pushTag("surfaces");
 
   int numSurfaces = xmlSettings.getNumTags("surface");
   for (int i = 0; i < numSurfaces; i++) {
     xmlSettings.pushTag("surface", i);
-    // attempt to load surface source
+    SurfaceSnapshot surface;
+
     xmlSettings.pushTag("source");
-    string sourceType = xmlSettings.getValue("source-type", "");
-    string sourceName = xmlSettings.getValue("source-name", "");
-    BaseSource* source = NULL;
-    if (sourceName != "" && sourceName != "none" && sourceType != "") {
-      // Load source depending on type
-      int typeEnum = SourceType::GetSourceTypeEnum(sourceType);
-      // Construct full path
-      string dir = mediaServer->getDefaultMediaDir(typeEnum);
-      std::stringstream pathss;
-      pathss << ofToDataPath(dir, true) << sourceName;
-      string sourcePath = pathss.str();
-      // Load media by using full path
-      source = mediaServer->loadMedia(sourcePath, typeEnum);
-    }
+    surface.sourceType = xmlSettings.getValue("source-type", "");
+    surface.sourceName = xmlSettings.getValue("source-name", "");
     xmlSettings.popTag();  // source
+
+    // The number of vertices tells triangles from quads
     xmlSettings.pushTag("vertices");
-    vector<ofVec2f> vertices;
     int vertexCount = xmlSettings.getNumTags("vertex");
-    // it's a triangle ?
+    xmlSettings.popTag();  // vertices
+
+    const ofVec2f* defaultVertices;
+    const ofVec2f* defaultTexCoords;
     if (vertexCount == 3) {
-      //ofLog(OF_LOG_NOTICE, "create Triangle");
-      xmlSettings.pushTag("vertex", 0);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                 xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
+      surface.type = SurfaceType::TRIANGLE_SURFACE;
+      defaultVertices = triangleVertices;
+      defaultTexCoords = triangleTexCoords;
+    } else if (vertexCount == 4) {
+      surface.type = SurfaceType::QUAD_SURFACE;
+      defaultVertices = quadVertices;
+      defaultTexCoords = quadTexCoords;
+    } else {
+      xmlSettings.popTag();  // surface
+      continue;
+    }
 
-      xmlSettings.pushTag("vertex", 1);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 100.0f),
-                                 xmlSettings.getValue("y", 0.0f)));
+    xmlSettings.pushTag("vertices");
+    for (int j = 0; j < vertexCount; j++) {
+      xmlSettings.pushTag("vertex", j);
+      surface.vertices.push_back(
+          ofVec2f(xmlSettings.getValue("x", defaultVertices[j].x),
+                  xmlSettings.getValue("y", defaultVertices[j].y)));
       xmlSettings.popTag();
+    }
+    xmlSettings.popTag();  // vertices
 
-      xmlSettings.pushTag("vertex", 2);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                 xmlSettings.getValue("y", 100.0f)));
+    xmlSettings.pushTag("texCoords");
+    for (int j = 0; j < vertexCount; j++) {
+      xmlSettings.pushTag("texCoord", j);
+      surface.texCoords.push_back(
+          ofVec2f(xmlSettings.getValue("x", defaultTexCoords[j].x),
+                  xmlSettings.getValue("y", defaultTexCoords[j].y)));
       xmlSettings.popTag();
+    }
+    xmlSettings.popTag();  // texCoords
 
-      xmlSettings.popTag();  // vertices
+    snapshot.push_back(surface);
+    xmlSettings.popTag();  // surface
+  }
 
-      xmlSettings.pushTag("texCoords");
+  xmlSettings.popTag();  // surfaces
+  return true;
+}
 
-      vector<ofVec2f> texCoords;
+void SurfaceManager::replayJournal(string fileName) {
+  loadedFileName = fileName;
+  loadedJournalSequence = xmlSettings.getValue("journal-sequence", 0);
 
-      xmlSettings.pushTag("texCoord", 0);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                  xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
+  string journalPath = ofToDataPath(fileName + JOURNAL_FILE_EXTENSION, true);
+  vector<SurfaceEdit> edits;
+  EditJournal::read(journalPath, loadedJournalSequence, edits);
+  if (!edits.size()) return;
 
-      xmlSettings.pushTag("texCoord", 1);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 1.0f),
-                                  xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
+  PIMAPPER_LOG_NOTICE("SurfaceManager") << "Replaying " << edits.size()
+                                << " journaled edits of " << fileName;
+  for (int i = 0; i < edits.size(); i++) {
+    applyEdit(edits[i]);
+  }
+}
 
-      xmlSettings.pushTag("texCoord", 2);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                  xmlSettings.getValue("y", 1.0f)));
-      xmlSettings.popTag();
+BaseSource* SurfaceManager::loadSource(string sourceType, string sourceName,
+                                       vector<ofVec2f>* texCoords) {
+  string sourcePath = getSourcePath(sourceType, sourceName);
+  if (sourcePath == "") {
+    return NULL;
+  }
+  // Before loading, so the image is cropped right away
+  if (texCoords != NULL && texCoords->size()) {
+    mediaServer->includeTexCoords(sourcePath, getBounds(*texCoords));
+  }
+  // Load media by using full path
+  int typeEnum = SourceType::GetSourceTypeEnum(sourceType);
+  return mediaServer->loadMedia(sourcePath, typeEnum);
+}
+
+int SurfaceManager::getNeededImageSize() {
+  float neededSize = 0.0f;
+  for (int i = 0; i < surfaces.size(); i++) {
+    BaseSource* source = surfaces[i]->getSource();
+    // Part of the whole image the source shows
+    ofRectangle region(0.0f, 0.0f, 1.0f, 1.0f);
+    if (source->getType() == SourceType::SOURCE_TYPE_REGION) {
+      RegionSource* regionSource = static_cast<RegionSource*>(source);
+      if (regionSource->getParent() == NULL ||
+          regionSource->getParent()->getType() !=
+              SourceType::SOURCE_TYPE_IMAGE) {
+        continue;
+      }
+      region = regionSource->getRegion();
+    } else if (source->getType() != SourceType::SOURCE_TYPE_IMAGE) {
+      continue;
+    }
+    if (source->getWidth() <= 0.0f || source->getHeight() <= 0.0f) continue;
+
+    vector<ofVec3f>& vertices = surfaces[i]->getVertices();
+    vector<ofVec2f>& texCoords = surfaces[i]->getTexCoords();
+    ofRectangle bounds(vertices[0].x, vertices[0].y, 0.0f, 0.0f);
+    for (int j = 1; j < vertices.size(); j++) {
+      bounds.growToInclude(vertices[j].x, vertices[j].y);
+    }
+    ofRectangle texBounds = getBounds(texCoords);
+    if (texBounds.width <= 0.0f || texBounds.height <= 0.0f) continue;
+
+    // Pixels of the whole image needed in each direction, the larger
+    // side follows from the aspect ratio of the image
+    float neededWidth = bounds.width / (texBounds.width * region.width);
+    float neededHeight = bounds.height / (texBounds.height * region.height);
+    float aspect = (source->getWidth() / region.width) /
+                   (source->getHeight() / region.height);
+    float size = aspect >= 1.0f ? std::max(neededWidth, neededHeight * aspect)
+                                : std::max(neededHeight, neededWidth / aspect);
+    neededSize = std::max(neededSize, size);
+  }
+  return ceil(neededSize);
+}
+
+string SurfaceManager::getSourcePath(string sourceType, string sourceName) {
+  if (sourceName == "" || sourceName == "none" || sourceType == "") {
+    return "";
+  }
+  int typeEnum = SourceType::GetSourceTypeEnum(sourceType);
+  if (typeEnum == SourceType::SOURCE_TYPE_NONE) {
+    return "";
+  }
+  if (typeEnum == SourceType::SOURCE_TYPE_REGION) {
+    // Path of the parent with the region appended, see RegionSource
+    string parent;
+    ofRectangle region;
+    if (!RegionSource::splitRegion(sourceName, parent, region)) return "";
+    size_t separator = parent.find('/');
+    if (separator == string::npos) return "";
+    string parentType = parent.substr(0, separator);
+    if (parentType != SOURCE_TYPE_NAME_IMAGE &&
+        parentType != SOURCE_TYPE_NAME_VIDEO) {
+      return "";
+    }
+    string parentPath =
+        getSourcePath(parentType, parent.substr(separator + 1));
+    if (parentPath == "") return "";
+    return RegionSource::addRegion(parentPath, region);
+  }
+  // Construct full path
+  string dir = mediaServer->getDefaultMediaDir(typeEnum);
+  std::stringstream pathss;
+  pathss << ofToDataPath(dir, true) << sourceName;
+  return pathss.str();
+}
+
+void SurfaceManager::holdSources(vector<SurfaceSnapshot>& snapshot,
+                                 vector<BaseSource*>& sources) {
+  for (int i = 0; i < snapshot.size(); i++) {
+    BaseSource* source =
+        loadSource(snapshot[i].sourceType, snapshot[i].sourceName,
+                   &snapshot[i].texCoords);
+    if (source != NULL) {
+      sources.push_back(source);
+    }
+  }
+}
 
-      xmlSettings.popTag();  // texCoords
+void SurfaceManager::releaseSources(vector<BaseSource*>& sources) {
+  for (int i = 0; i < sources.size(); i++) {
+    mediaServer->unloadMedia(sources[i]->getPath());
+  }
+  sources.clear();
+}
+
+void SurfaceManager::enableAutosave(string fileName, float newCompactInterval) {
+  disableAutosave();
+  autosaveFileName = fileName;
+  compactInterval = newCompactInterval;
+
+  // Sequence numbers have to continue after what the file already contains
+  string journalPath = ofToDataPath(fileName + JOURNAL_FILE_EXTENSION, true);
+  int afterSequence = fileName == loadedFileName ? loadedJournalSequence : 0;
+  journal.open(journalPath, afterSequence);
+
+  if (fileName != loadedFileName && journal.getNumEntries() > 0) {
+    // These were recorded on top of another file, we can't use them
+    PIMAPPER_LOG_WARNING("SurfaceManager")
+        << "Discarding journal of " << fileName
+        << " as it does not belong to the loaded settings";
+    journal.truncate(journal.getSequence());
+  }
 
-      // now we have variables sourceName and sourceTexture
-      // by checking those we can use one or another addSurface method
-      if (sourceName != "none" && source != NULL) {
-        addSurface(SurfaceType::TRIANGLE_SURFACE, source, vertices,
-                   texCoords);
+  // Start with a file that matches what we have right now
+  saveXmlSettings(autosaveFileName);
+}
+
+void SurfaceManager::disableAutosave() {
+  journal.close();
+  autosaveFileName = "";
+  compactingSequence = 0;
+  bCompactPending = false;
+}
+
+void SurfaceManager::watchXmlSettings(string fileName, float newWatchInterval) {
+  watchedFileName = fileName;
+  watchInterval = newWatchInterval;
+  lastWatchTime = ofGetElapsedTimef();
+  if (!FileUtils::getStamp(ofToDataPath(watchedFileName, true),
+                           watchedModified, watchedSize)) {
+    watchedModified = 0;
+    watchedSize = 0;
+  }
+}
+
+void SurfaceManager::unwatchXmlSettings() { watchedFileName = ""; }
+
+void SurfaceManager::reloadXmlSettings(string fileName) {
+  if (mediaServer == NULL) {
+    ofLogFatalError("SurfaceManager") << "Media server not set";
+    std::exit(EXIT_FAILURE);
+  }
+
+  vector<SurfaceSnapshot> snapshot;
+  if (!readSurfaces(fileName, snapshot)) {
+    // Probably caught in the middle of being written, wait for the next change
+    PIMAPPER_LOG_WARNING("SurfaceManager") << "Could not reload " << fileName;
+    return;
+  }
+
+  // Keep edits made so far apart from the reload
+  flushEdits();
+
+  if (journal.isOpen() && fileName == autosaveFileName) {
+    // The file on disk wins over everything journaled so far. The reload
+    // itself is not journaled either, the file already contains it.
+    journal.truncate(journal.getSequence());
+    bJournalEdits = false;
+    applySurfaces(snapshot);
+    bJournalEdits = true;
+    // Store the journal sequence with the reloaded file right away
+    saveXmlSettings(autosaveFileName);
+  } else {
+    applySurfaces(snapshot);
+  }
+
+  PIMAPPER_LOG_NOTICE("SurfaceManager") << "Reloaded " << fileName;
+  ofNotifyEvent(onReload, fileName, this);
+}
+
+void SurfaceManager::applySurfaces(vector<SurfaceSnapshot>& snapshot) {
+  // Hold a reference to the media of every surface in the new version, so
+  // media of surfaces that are added again or handed to another surface is
+  // not unloaded in between
+  vector<BaseSource*> heldSources;
+  holdSources(snapshot, heldSources);
+
+  // Surfaces that are the same at the start and at the end are left alone,
+  // so adding or removing one does not shift the ones after it. Surfaces
+  // in between are paired by position, the file has no surface ids.
+  int first = 0;
+  while (first < surfaces.size() && first < snapshot.size() &&
+         isSameSurface(surfaces[first], snapshot[first])) {
+    first++;
+  }
+  int currentEnd = surfaces.size();
+  int targetEnd = snapshot.size();
+  while (currentEnd > first && targetEnd > first &&
+         isSameSurface(surfaces[currentEnd - 1], snapshot[targetEnd - 1])) {
+    currentEnd--;
+    targetEnd--;
+  }
+
+  // Surfaces that are not in the file anymore
+  while (currentEnd > targetEnd) {
+    SurfaceEdit edit;
+    edit.type = SurfaceEdit::REMOVE;
+    edit.surfaceIndex = currentEnd - 1;
+    applyEdit(edit);
+    currentEnd--;
+  }
+
+  for (int i = first; i < targetEnd; i++) {
+    SurfaceSnapshot& target = snapshot[i];
+
+    // New surfaces and the ones that changed type are added from scratch
+    if (i >= currentEnd || surfaces[i]->getType() != target.type) {
+      SurfaceEdit edit;
+      if (i < currentEnd) {
+        edit.type = SurfaceEdit::REMOVE;
+        edit.surfaceIndex = i;
+        applyEdit(edit);
       } else {
-        addSurface(SurfaceType::TRIANGLE_SURFACE, vertices, texCoords);
+        currentEnd++;
       }
+      edit.type = SurfaceEdit::ADD;
+      edit.surfaceIndex = i;
+      edit.surface = target;
+      applyEdit(edit);
+      continue;
     }
-    // it's a quad ?
-    else if (vertexCount == 4)
-    // if (surface-type == QUAD_SURFACE)
-    {
-      xmlSettings.pushTag("vertex", 0);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                 xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
 
-      xmlSettings.pushTag("vertex", 1);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 100.0f),
-                                 xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
+    BaseSurface* surface = surfaces[i];
+    vector<ofVec3f>& vertices = surface->getVertices();
+    for (int j = 0; j < target.vertices.size() && j < vertices.size(); j++) {
+      // Saved coordinates are rounded, ignore the difference
+      if (!target.vertices[j].match(ofVec2f(vertices[j].x, vertices[j].y))) {
+        surface->setVertex(j, target.vertices[j]);
+      }
+    }
+    vector<ofVec2f>& texCoords = surface->getTexCoords();
+    for (int j = 0; j < target.texCoords.size() && j < texCoords.size();
+         j++) {
+      if (!target.texCoords[j].match(texCoords[j])) {
+        surface->setTexCoord(j, target.texCoords[j]);
+      }
+    }
 
-      xmlSettings.pushTag("vertex", 2);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 100.0f),
-                                 xmlSettings.getValue("y", 100.0f)));
-      xmlSettings.popTag();
+    SurfaceSnapshot current = getSnapshot(surfaces[i]);
+    if (current.sourceType != target.sourceType ||
+        current.sourceName != target.sourceName) {
+      SurfaceEdit edit;
+      edit.type = SurfaceEdit::SOURCE;
+      edit.surfaceIndex = i;
+      edit.sourceType = target.sourceType;
+      edit.sourceName = target.sourceName;
+      applyEdit(edit);
+    }
+  }
+  flushEdits();
+  releaseSources(heldSources);
+}
 
-      xmlSettings.pushTag("vertex", 3);
-      vertices.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                 xmlSettings.getValue("y", 100.0f)));
-      xmlSettings.popTag();
+bool SurfaceManager::isSameSurface(BaseSurface* surface,
+                                   SurfaceSnapshot& target) {
+  SurfaceSnapshot current = getSnapshot(surface);
+  if (current.type != target.type ||
+      current.sourceType != target.sourceType ||
+      current.sourceName != target.sourceName ||
+      current.vertices.size() != target.vertices.size() ||
+      current.texCoords.size() != target.texCoords.size()) {
+    return false;
+  }
+  // Saved coordinates are rounded, ignore the difference
+  for (int i = 0; i < current.vertices.size(); i++) {
+    if (!target.vertices[i].match(current.vertices[i])) return false;
+  }
+  for (int i = 0; i < current.texCoords.size(); i++) {
+    if (!target.texCoords[i].match(current.texCoords[i])) return false;
+  }
+  return true;
+}
 
-      xmlSettings.popTag();  // vertices
+bool SurfaceManager::addPreset(string name, string fileName) {
+  if (mediaServer == NULL) {
+    ofLogFatalError("SurfaceManager") << "Media server not set";
+    std::exit(EXIT_FAILURE);
+  }
 
-      xmlSettings.pushTag("texCoords");
+  Preset preset;
+  if (!readSurfaces(fileName, preset.surfaces)) {
+    PIMAPPER_LOG_WARNING("SurfaceManager") << "Could not read preset "
+                                           << fileName;
+    return false;
+  }
+  // Hold the new media before releasing the old, shared media stays loaded
+  holdSources(preset.surfaces, preset.sources);
+  removePreset(name);
+  presets[name] = preset;
+  PIMAPPER_LOG_VERBOSE("SurfaceManager") << "Added preset " << name << " with "
+                                         << preset.sources.size()
+                                         << " sources";
+  return true;
+}
 
-      vector<ofVec2f> texCoords;
+void SurfaceManager::capturePreset(string name) {
+  if (mediaServer == NULL) {
+    ofLogFatalError("SurfaceManager") << "Media server not set";
+    std::exit(EXIT_FAILURE);
+  }
 
-      xmlSettings.pushTag("texCoord", 0);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                  xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
+  Preset preset;
+  getSnapshot(preset.surfaces);
+  holdSources(preset.surfaces, preset.sources);
+  removePreset(name);
+  presets[name] = preset;
+}
 
-      xmlSettings.pushTag("texCoord", 1);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 1.0f),
-                                  xmlSettings.getValue("y", 0.0f)));
-      xmlSettings.popTag();
+void SurfaceManager::removePreset(string name) {
+  std::map<string, Preset>::iterator it = presets.find(name);
+  if (it == presets.end()) return;
+  releaseSources(it->second.sources);
+  presets.erase(it);
+}
 
-      xmlSettings.pushTag("texCoord", 2);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 1.0f),
-                                  xmlSettings.getValue("y", 1.0f)));
-      xmlSettings.popTag();
+void SurfaceManager::clearPresets() {
+  while (presets.size()) {
+    removePreset(presets.begin()->first);
+  }
+}
 
-      xmlSettings.pushTag("texCoord", 3);
-      texCoords.push_back(ofVec2f(xmlSettings.getValue("x", 0.0f),
-                                  xmlSettings.getValue("y", 1.0f)));
-      xmlSettings.popTag();
+bool SurfaceManager::hasPreset(string name) { return presets.count(name) > 0; }
 
-      xmlSettings.popTag();  // texCoords
+void SurfaceManager::getPresetNames(vector<string>& names) {
+  names.clear();
+  std::map<string, Preset>::iterator it;
+  for (it = presets.begin(); it != presets.end(); it++) {
+    names.push_back(it->first);
+  }
+}
 
-      // now we have variables sourceName and sourceTexture
-      // by checking those we can use one or another addSurface method
-      if (sourceName != "none" && source != NULL) {
-        addSurface(SurfaceType::QUAD_SURFACE, source, vertices,
-                   texCoords);
-      } else {
-        addSurface(SurfaceType::QUAD_SURFACE, vertices, texCoords);
+bool SurfaceManager::switchPreset(string name, float fadeDuration) {
+  PIMAPPER_PROFILE("update", "switch preset");
+  std::map<string, Preset>::iterator it = presets.find(name);
+  if (it == presets.end()) {
+    PIMAPPER_LOG_WARNING("SurfaceManager") << "No preset named " << name;
+    return false;
+  }
+
+  if (fadeDuration > 0.0f) {
+    // The renderer caches the outgoing surfaces on its next draw
+    releaseSources(fadeSources);
+    vector<SurfaceSnapshot> outgoing;
+    getSnapshot(outgoing);
+    holdSources(outgoing, fadeSources);
+  }
+
+  // Every source of the preset is loaded, this only moves references
+  flushEdits();
+  applySurfaces(it->second.surfaces);
+
+  renderer.crossfade(fadeDuration);
+  updateGeometry();
+  publishScene();
+
+  ofNotifyEvent(onPresetSwitched, name, this);
+  return true;
+}
+
+void SurfaceManager::transitionSource(int index, string sourceType,
+                                      string sourceName, int transitionType,
+                                      float duration) {
+  if (index < 0 || index >= surfaces.size()) {
+    throw std::runtime_error("Surface index out of bounds.");
+  }
+  if (mediaServer == NULL) {
+    ofLogFatalError("SurfaceManager") << "Media server not set";
+    std::exit(EXIT_FAILURE);
+  }
+
+  unsigned int surfaceId = surfaces[index]->getId();
+  for (int i = 0; i < transitions.size(); i++) {
+    if (transitions[i].surfaceId != surfaceId) continue;
+    // One that has not started yet never applies its edit
+    if (transitions[i].bStarted) surfaces[index]->clearTransition();
+    endTransition(i);
+    break;
+  }
+
+  Transition transition;
+  transition.surfaceId = surfaceId;
+  transition.sourceType = sourceType;
+  transition.sourceName = sourceName;
+  transition.sourcePath = getSourcePath(sourceType, sourceName);
+  transition.type = transitionType;
+  transition.duration = duration;
+  transition.startTime = 0.0f;
+  transition.fromSource = NULL;
+  transition.bStarted = false;
+  if (transition.sourcePath != "") {
+    mediaServer->prefetchMedia(transition.sourcePath,
+                               SourceType::GetSourceTypeEnum(sourceType));
+  }
+  transitions.push_back(transition);
+}
+
+int SurfaceManager::getNumTransitions() { return transitions.size(); }
+
+bool SurfaceManager::isTransitionPending(string sourcePath) {
+  for (int i = 0; i < transitions.size(); i++) {
+    if (!transitions[i].bStarted && transitions[i].sourcePath == sourcePath) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SurfaceManager::updateTransitions() {
+  if (!transitions.size()) return;
+  PIMAPPER_PROFILE("update", "transitions");
+  float now = ofGetElapsedTimef();
+  int i = 0;
+  while (i < transitions.size()) {
+    Transition& transition = transitions[i];
+    int index = getSurfaceIndex(transition.surfaceId);
+    if (index < 0) {
+      // The surface has been removed
+      endTransition(i);
+      continue;
+    }
+
+    if (!transition.bStarted) {
+      if (transition.sourcePath != "" &&
+          mediaServer->isPrefetchFailed(transition.sourcePath)) {
+        // The surface keeps its source
+        PIMAPPER_LOG_WARNING("SurfaceManager")
+            << "Not changing the source, could not load "
+            << transition.sourcePath;
+        endTransition(i);
+        continue;
+      }
+      if (transition.sourcePath != "" &&
+          !mediaServer->isMediaReady(transition.sourcePath)) {
+        i++;
+        continue;
       }
+      startTransition(transition, index);
     }
 
-    xmlSettings.popTag();  // surface
+    float progress = transition.duration > 0.0f
+                         ? (now - transition.startTime) / transition.duration
+                         : 1.0f;
+    if (progress >= 1.0f) {
+      surfaces[index]->clearTransition();
+      endTransition(i);
+      continue;
+    }
+    surfaces[index]->setTransition(transition.fromSource, transition.type,
+                                   progress);
+    i++;
+  }
+}
+
+void SurfaceManager::startTransition(Transition& transition, int index) {
+  // Keep the outgoing media loaded while it is blended out
+  BaseSource* fromSource = surfaces[index]->getSource();
+  if (fromSource->isLoadable()) {
+    mediaServer->loadMedia(fromSource->getPath(), fromSource->getType());
+    transition.fromPath = fromSource->getPath();
   }
+  transition.fromSource = fromSource;
 
-  xmlSettings.popTag();  // surfaces
+  // The media is ready, this loads nothing
+  SurfaceEdit edit;
+  edit.type = SurfaceEdit::SOURCE;
+  edit.surfaceIndex = index;
+  edit.sourceType = transition.sourceType;
+  edit.sourceName = transition.sourceName;
+  applyEdit(edit);
+
+  transition.startTime = ofGetElapsedTimef();
+  transition.bStarted = true;
+}
+
+void SurfaceManager::endTransition(int transitionIndex) {
+  Transition& transition = transitions[transitionIndex];
+  if (!transition.bStarted) {
+    // Drops the media only if nothing else has loaded it meanwhile
+    if (transition.sourcePath != "") {
+      mediaServer->cancelPrefetch(transition.sourcePath);
+    }
+  } else if (transition.fromPath != "") {
+    mediaServer->unloadMedia(transition.fromPath);
+  }
+  transitions.erase(transitions.begin() + transitionIndex);
+}
+
+int SurfaceManager::getSurfaceIndex(unsigned int id) {
+  for (int i = 0; i < surfaces.size(); i++) {
+    if (surfaces[i]->getId() == id) return i;
+  }
+  return -1;
+}
+
+void SurfaceManager::checkWatchedFile() {
+  // Our own save would look like a change
+  if (settingsWriter.isSaving()) return;
+
+  long long modified;
+  unsigned long long size;
+  if (!FileUtils::getStamp(ofToDataPath(watchedFileName, true), modified,
+                           size)) {
+    return;
+  }
+  if (modified == watchedModified && size == watchedSize) return;
+
+  watchedModified = modified;
+  watchedSize = size;
+  reloadXmlSettings(watchedFileName);
+}
+
+void SurfaceManager::applyEdit(SurfaceEdit& edit) {
+  if (edit.type == SurfaceEdit::ADD) {
+    // Surfaces are appended, the edit is recorded once the new
+    // surface has been moved where it belongs
+    bool bTrack = bTrackChanges;
+    bTrackChanges = false;
+    addSurface(edit.surface);
+    bTrackChanges = bTrack;
+
+    int index = surfaces.size() - 1;
+    if (edit.surfaceIndex >= 0 && edit.surfaceIndex < index) {
+      index = edit.surfaceIndex;
+      std::rotate(surfaces.begin() + index, surfaces.end() - 1,
+                  surfaces.end());
+      std::rotate(trackedSurfaces.begin() + index, trackedSurfaces.end() - 1,
+                  trackedSurfaces.end());
+      std::rotate(trackedRevisions.begin() + index,
+                  trackedRevisions.end() - 1, trackedRevisions.end());
+    }
+
+    if (bTrackChanges) {
+      SurfaceEdit added;
+      added.type = SurfaceEdit::ADD;
+      added.surfaceIndex = index;
+      added.surface = trackedSurfaces[index];
+      recordEdit(added);
+    }
+    return;
+  }
+
+  if (edit.surfaceIndex < 0 || edit.surfaceIndex >= surfaces.size()) {
+    PIMAPPER_LOG_WARNING("SurfaceManager") << "Edit refers to non-existing surface "
+                                   << edit.surfaceIndex;
+    return;
+  }
+  BaseSurface* surface = surfaces[edit.surfaceIndex];
+
+  if (edit.type == SurfaceEdit::VERTEX) {
+    surface->setVertex(edit.pointIndex, edit.to);
+  } else if (edit.type == SurfaceEdit::TEX_COORD) {
+    surface->setTexCoord(edit.pointIndex, edit.to);
+  } else if (edit.type == SurfaceEdit::MOVE) {
+    surface->moveBy(edit.to);
+  } else if (edit.type == SurfaceEdit::SOURCE) {
+    BaseSource* oldSource = surface->getSource();
+    BaseSource* newSource = loadSource(edit.sourceType, edit.sourceName,
+                                       &surface->getTexCoords());
+    if (oldSource->isLoadable()) {
+      mediaServer->unloadMedia(oldSource->getPath());
+    }
+    if (newSource == NULL) {
+      newSource = surface->getDefaultSource();
+    }
+    surface->setSource(newSource);
+  } else if (edit.type == SurfaceEdit::REMOVE) {
+    removeSurface(edit.surfaceIndex);
+  }
+  flushEdits();
+}
+
+void SurfaceManager::flushEdits() {
+  if (bTrackChanges) {
+    trackChanges();
+  }
+}
+
+void SurfaceManager::trackChanges() {
+  for (int i = 0; i < surfaces.size(); i++) {
+    BaseSurface* surface = surfaces[i];
+    if (surface->getRevision() == trackedRevisions[i]) continue;
+    trackedRevisions[i] = surface->getRevision();
+
+    SurfaceSnapshot current = getSnapshot(surface);
+    SurfaceSnapshot& tracked = trackedSurfaces[i];
+
+    if (current.sourceType != tracked.sourceType ||
+        current.sourceName != tracked.sourceName) {
+      SurfaceEdit edit;
+      edit.type = SurfaceEdit::SOURCE;
+      edit.surfaceIndex = i;
+      edit.fromSourceType = tracked.sourceType;
+      edit.fromSourceName = tracked.sourceName;
+      edit.sourceType = current.sourceType;
+      edit.sourceName = current.sourceName;
+      recordEdit(edit);
+    }
+
+    // All vertices shifted by the same amount means the surface was moved
+    int numChangedVertices = 0;
+    bool bMoved = current.vertices.size() > 1;
+    ofVec2f delta;
+    for (int j = 0; j < current.vertices.size(); j++) {
+      if (current.vertices[j] == tracked.vertices[j]) {
+        bMoved = false;
+        continue;
+      }
+      ofVec2f vertexDelta = current.vertices[j] - tracked.vertices[j];
+      if (numChangedVertices == 0) {
+        delta = vertexDelta;
+      } else if (!vertexDelta.match(delta, 0.001f)) {
+        bMoved = false;
+      }
+      numChangedVertices++;
+    }
+
+    if (bMoved) {
+      SurfaceEdit edit;
+      edit.type = SurfaceEdit::MOVE;
+      edit.surfaceIndex = i;
+      edit.to = delta;
+      recordEdit(edit);
+    } else if (numChangedVertices) {
+      for (int j = 0; j < current.vertices.size(); j++) {
+        if (current.vertices[j] == tracked.vertices[j]) continue;
+        SurfaceEdit edit;
+        edit.type = SurfaceEdit::VERTEX;
+        edit.surfaceIndex = i;
+        edit.pointIndex = j;
+        edit.from = tracked.vertices[j];
+        edit.to = current.vertices[j];
+        recordEdit(edit);
+      }
+    }
+
+    for (int j = 0; j < current.texCoords.size(); j++) {
+      if (current.texCoords[j] == tracked.texCoords[j]) continue;
+      SurfaceEdit edit;
+      edit.type = SurfaceEdit::TEX_COORD;
+      edit.surfaceIndex = i;
+      edit.pointIndex = j;
+      edit.from = tracked.texCoords[j];
+      edit.to = current.texCoords[j];
+      recordEdit(edit);
+    }
+
+    tracked = current;
+  }
+}
+
+void SurfaceManager::trackSurfaceAdded() {
+  trackedSurfaces.push_back(getSnapshot(surfaces.back()));
+  trackedRevisions.push_back(surfaces.back()->getRevision());
+
+  if (bTrackChanges) {
+    SurfaceEdit edit;
+    edit.type = SurfaceEdit::ADD;
+    edit.surfaceIndex = surfaces.size() - 1;
+    edit.surface = trackedSurfaces.back();
+    recordEdit(edit);
+  }
+}
+
+void SurfaceManager::acceptChanges(int index) {
+  // Take the surface as it is now without recording an edit
+  trackedSurfaces[index] = getSnapshot(surfaces[index]);
+  trackedRevisions[index] = surfaces[index]->getRevision();
+}
+
+void SurfaceManager::recordEdit(SurfaceEdit& edit) {
+  if (bJournalEdits) {
+    journal.append(edit);
+  }
+  ofNotifyEvent(onSurfaceEdited, edit, this);
 }
   
   void SurfaceManager::setMediaServer(MediaServer* newMediaServer) {
     mediaServer = newMediaServer;
   }
 
+void SurfaceManager::setFlattenStaticSurfaces(bool flatten) {
+  renderer.setFlattenStaticSurfaces(flatten);
+}
+
+bool SurfaceManager::getFlattenStaticSurfaces() {
+  return renderer.getFlattenStaticSurfaces();
+}
+
+VertexInput* SurfaceManager::getVertexInput() { return &vertexInput; }
+
+void SurfaceManager::applyVertexInput() {
+  vertexInput.getLatest(vertexUpdates);
+  if (!vertexUpdates.size()) return;
+
+  std::map<unsigned int, int> indices;
+  for (int i = 0; i < surfaces.size(); i++) {
+    indices[surfaces[i]->getId()] = i;
+  }
+
+  for (int i = 0; i < vertexUpdates.size(); i++) {
+    VertexUpdate& update = vertexUpdates[i];
+    std::map<unsigned int, int>::iterator it = indices.find(update.surfaceId);
+    // Surface was removed meanwhile
+    if (it == indices.end()) continue;
+    BaseSurface* surface = surfaces[it->second];
+
+    if (update.numVertices == surface->getVertices().size()) {
+      for (int j = 0; j < update.numVertices; j++) {
+        surface->setVertex(j, update.vertices[j]);
+      }
+    }
+    if (update.numTexCoords == surface->getTexCoords().size()) {
+      for (int j = 0; j < update.numTexCoords; j++) {
+        surface->setTexCoord(j, update.texCoords[j]);
+      }
+    }
+    acceptChanges(it->second);
+  }
+}
+
+void SurfaceManager::updateGeometry() {
+  PIMAPPER_PROFILE("update", "geometry");
+  geometryJob.surfaces.clear();
+  for (int i = 0; i < surfaces.size(); i++) {
+    if (surfaces[i]->isGeometryDirty()) {
+      geometryJob.surfaces.push_back(surfaces[i]);
+      // Texture coordinates or the source may have changed
+      includeTexCoords(surfaces[i]);
+    }
+  }
+  jobSystem.run(geometryJob, geometryJob.surfaces.size());
+}
+
+void SurfaceManager::includeTexCoords(BaseSurface* surface) {
+  int type = surface->getSource()->getType();
+  if (mediaServer == NULL || surface->getTexCoords().empty() ||
+      (type != SourceType::SOURCE_TYPE_IMAGE &&
+       type != SourceType::SOURCE_TYPE_REGION)) {
+    return;
+  }
+  mediaServer->includeTexCoords(surface->getSource()->getPath(),
+                                getBounds(surface->getTexCoords()));
+}
+
+void SurfaceManager::setNumGeometryWorkers(int numWorkers) {
+  jobSystem.setNumWorkers(numWorkers);
+}
+
+int SurfaceManager::getNumGeometryWorkers() {
+  return jobSystem.getNumWorkers();
+}
+
+void SurfaceManager::GeometryJob::execute(int index) {
+  surfaces[index]->updateGeometry();
+}
+
+void SurfaceManager::publishScene() { renderer.publish(surfaces); }
+
 BaseSurface* SurfaceManager::selectSurface(int index) {
   if (index >= surfaces.size()) {
     throw std::runtime_error("Surface index out of bounds.");
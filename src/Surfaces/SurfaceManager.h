@@ -3,13 +3,32 @@
 #include "BaseSurface.h"
 #include "TriangleSurface.h"
 #include "QuadSurface.h"
+#include "SceneRenderer.h"
+#include "JobSystem.h"
+#include "VertexInput.h"
+#include "SurfaceSnapshot.h"
+#include "Preset.h"
+#include "SettingsWriter.h"
+#include "SurfaceEdit.h"
+#include "EditJournal.h"
 #include "SurfaceType.h"
+#include "TransitionType.h"
 #include "MediaServer.h"
 #include "BaseSource.h"
 #include "SourceType.h"
 
 #include "ofEvents.h"
 #include "ofxXmlSettings.h"
+#include "FileUtils.h"
+
+// Journal of a settings file is stored next to it with this extension
+#define JOURNAL_FILE_EXTENSION ".journal"
+// Default seconds between journal compactions
+#define DEFAULT_COMPACT_INTERVAL 60.0f
+// Compact earlier if the journal grows larger than this
+#define MAX_JOURNAL_ENTRIES 5000
+// Default seconds between checks of a watched settings file
+#define DEFAULT_WATCH_INTERVAL 1.0f
 
 using namespace std;
 
@@ -20,30 +39,223 @@ class SurfaceManager {
   SurfaceManager();
   ~SurfaceManager();
 
+  void update(ofEventArgs& args);
+  // Draws the surfaces as they were at the last update, nothing while
+  // the render thread runs
   void draw();
+  // Draw the surfaces on a thread of their own into context, so editing
+  // and media loads on the main thread do not delay the output. See
+  // SceneRenderer for what is not available then. Stop it before the
+  // window closes, in ofApp::exit for instance.
+  void startRenderThread(RenderContext* context);
+  void stopRenderThread();
+  bool isRenderThreadRunning();
   void addSurface(int surfaceType);
   void addSurface(int surfaceType, BaseSource* newSource);
   void addSurface(int surfaceType, vector<ofVec2f> vertices,
                   vector<ofVec2f> texCoords);
   void addSurface(int surfaceType, BaseSource* newSource,
                   vector<ofVec2f> vertices, vector<ofVec2f> texCoords);
+  void addSurface(SurfaceSnapshot& surface);
+  void removeSurface(int index);
   void removeSelectedSurface();
+  // Removes all surfaces, this is not recorded as an edit
   void clear();
+  // Saving happens on a background thread, see onSaveComplete
   void saveXmlSettings(string fileName);
+  // Replays the journal of the file if there is one
   void loadXmlSettings(string fileName);
+
+  // Write every edit to the journal of fileName as it happens and
+  // compact the journal into fileName every compactInterval seconds
+  void enableAutosave(string fileName,
+                      float compactInterval = DEFAULT_COMPACT_INTERVAL);
+  void disableAutosave();
+
+  // Reload fileName whenever it changes on disk, see reloadXmlSettings
+  void watchXmlSettings(string fileName,
+                        float watchInterval = DEFAULT_WATCH_INTERVAL);
+  void unwatchXmlSettings();
+  // Apply only the differences between fileName and the current surfaces.
+  // Media that stays in use is not loaded again. Surfaces are paired by
+  // position once the unchanged ones at the start and end are skipped, so
+  // a single surface can be added or removed anywhere without touching
+  // the others.
+  void reloadXmlSettings(string fileName);
+
+  // Keep the surfaces of fileName in memory as preset name, loading all
+  // of their media right away. Replaces a preset of the same name.
+  bool addPreset(string name, string fileName);
+  // Keep the current surfaces in memory as preset name
+  void capturePreset(string name);
+  // Release the media of a preset that is not used otherwise
+  void removePreset(string name);
+  void clearPresets();
+  bool hasPreset(string name);
+  void getPresetNames(vector<string>& names);
+  // Apply the differences to preset name within this call, without
+  // touching the disk. The switch is an edit like any other. Surfaces
+  // drawn before fade out over fadeDuration seconds.
+  bool switchPreset(string name, float fadeDuration = 0.0f);
+
+  // Change the source of a surface over duration seconds. The media is
+  // prefetched in the background, the change itself is a SOURCE edit
+  // applied once it is ready. Starting another transition on the same
+  // surface finishes the running one at once.
+  void transitionSource(
+      int index, string sourceType, string sourceName,
+      int transitionType = TransitionType::TRANSITION_CROSSFADE,
+      float duration = DEFAULT_TRANSITION_DURATION);
+  // Transitions waiting for their media or running
+  int getNumTransitions();
+  // A transition waits for the media, which it drops if it never starts
+  bool isTransitionPending(string sourcePath);
+  // Full path of a media file as given to MediaServer, empty for none
+  string getSourcePath(string sourceType, string sourceName);
+  // Largest side an image needs so no surface shows it enlarged, from
+  // the size of the surfaces on screen and their texture coordinates.
+  // 0 if no surface shows an image.
+  int getNeededImageSize();
+
+  // Apply an edit as if the user had done it, onSurfaceEdited
+  // is notified before this returns
+  void applyEdit(SurfaceEdit& edit);
+  // Notify onSurfaceEdited of changes made since the last update
+  void flushEdits();
   void setMediaServer(MediaServer* newMediaServer);
 
+  // Composite consecutive static surfaces into cached layers
+  void setFlattenStaticSurfaces(bool flatten);
+  bool getFlattenStaticSurfaces();
+
+  // Push vertex updates here from any thread, they are applied on the
+  // next update. They are not edits: neither journaled nor undoable.
+  VertexInput* getVertexInput();
+  // Apply the latest pushed vertex updates, this happens on every update
+  void applyVertexInput();
+
+  // Recalculate derived geometry of all changed surfaces in parallel,
+  // this happens on every update
+  void updateGeometry();
+  // 0 updates geometry on the calling thread only
+  void setNumGeometryWorkers(int numWorkers);
+  int getNumGeometryWorkers();
+
+  // Hand the current state of all surfaces over to the renderer,
+  // this happens on every update
+  void publishScene();
+
   BaseSurface* getSurface(int index);
   int size();
   BaseSurface* selectSurface(int index);
   BaseSurface* getSelectedSurface();
   void deselectSurface();
 
+  // Copy geometry and source references of all surfaces
+  void getSnapshot(vector<SurfaceSnapshot>& snapshot);
+  SurfaceSnapshot getSnapshot(BaseSurface* surface);
+
+  // Passed the file name given to saveXmlSettings
+  ofEvent<string> onSaveComplete;
+  ofEvent<string> onSaveFailed;
+
+  // Notified once per change of surface geometry or source,
+  // as well as on adding and removing surfaces
+  ofEvent<SurfaceEdit> onSurfaceEdited;
+
+  // Passed the file name given to reloadXmlSettings
+  ofEvent<string> onReload;
+
+  // Passed the name given to switchPreset
+  ofEvent<string> onPresetSwitched;
+
  private:
+  class GeometryJob : public Job {
+   public:
+    vector<BaseSurface*> surfaces;
+    void execute(int index);
+  };
+
+  struct Transition {
+    unsigned int surfaceId;
+    string sourceType;
+    string sourceName;
+    // Empty for the default source
+    string sourcePath;
+    int type;
+    float duration;
+    float startTime;
+    BaseSource* fromSource;
+    // Media of fromSource held until the transition ends, empty
+    // for the default source
+    string fromPath;
+    bool bStarted;
+  };
+
   std::vector<BaseSurface*> surfaces;
   BaseSurface* selectedSurface;
   ofxXmlSettings xmlSettings;
   MediaServer* mediaServer;
+  SceneRenderer renderer;
+  JobSystem jobSystem;
+  GeometryJob geometryJob;
+  VertexInput vertexInput;
+  vector<VertexUpdate> vertexUpdates;
+  SettingsWriter settingsWriter;
+
+  // Last known state of every surface, used to find out what has changed
+  vector<SurfaceSnapshot> trackedSurfaces;
+  vector<unsigned int> trackedRevisions;
+  bool bTrackChanges;
+
+  EditJournal journal;
+  string autosaveFileName;
+  float compactInterval;
+  float lastCompactTime;
+  int compactingSequence;
+  bool bCompactPending;
+  string loadedFileName;
+  int loadedJournalSequence;
+  bool bJournalEdits;
+
+  string watchedFileName;
+  float watchInterval;
+  float lastWatchTime;
+  long long watchedModified;
+  unsigned long long watchedSize;
+
+  std::map<string, Preset> presets;
+  // Media of the surfaces fading out, held until the renderer cached them
+  vector<BaseSource*> fadeSources;
+
+  vector<Transition> transitions;
+
+  bool loadSurfaces(string fileName);
+  bool readSurfaces(string fileName, vector<SurfaceSnapshot>& snapshot);
+  void applySurfaces(vector<SurfaceSnapshot>& snapshot);
+  // Equal up to the rounding of saved coordinates
+  bool isSameSurface(BaseSurface* surface, SurfaceSnapshot& target);
+  void checkWatchedFile();
+  void replayJournal(string fileName);
+  // Texture coordinates of the surface the source is for let the media
+  // server crop images, see MediaServer::setCropImages
+  BaseSource* loadSource(string sourceType, string sourceName,
+                         vector<ofVec2f>* texCoords = NULL);
+  // Report the texture coordinates of surfaces showing images
+  void includeTexCoords(BaseSurface* surface);
+  void updateTransitions();
+  void startTransition(Transition& transition, int index);
+  void endTransition(int transitionIndex);
+  int getSurfaceIndex(unsigned int id);
+  void holdSources(vector<SurfaceSnapshot>& snapshot,
+                   vector<BaseSource*>& sources);
+  void releaseSources(vector<BaseSource*>& sources);
+  void trackChanges();
+  void trackSurfaceAdded();
+  void acceptChanges(int index);
+  void recordEdit(SurfaceEdit& edit);
+  void handleSaveComplete(string& fileName);
+  void handleSaveFailed(string& fileName);
 };
 }
 }
\ No newline at end of file
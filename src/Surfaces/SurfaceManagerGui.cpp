@@ -1,4 +1,5 @@
 #include "SurfaceManagerGui.h"
+#include "Profiler.h"
 
 namespace ofx {
 namespace piMapper {
@@ -12,7 +13,7 @@ SurfaceManagerGui::SurfaceManagerGui() {
 
 SurfaceManagerGui::~SurfaceManagerGui() {
   unregisterMouseEvents();
-  surfaceManager = NULL;
+  setSurfaceManager(NULL);
 }
 
 void SurfaceManagerGui::registerMouseEvents() {
@@ -35,6 +36,8 @@ void SurfaceManagerGui::unregisterMouseEvents() {
 
 void SurfaceManagerGui::draw() {
   if (surfaceManager == NULL) return;
+  PIMAPPER_PROFILE("draw", "SurfaceManagerGui");
+  PIMAPPER_PROFILE_GPU("SurfaceManagerGui");
 
   if (guiMode == GuiMode::NONE) {
     surfaceManager->draw();
@@ -83,7 +86,15 @@ void SurfaceManagerGui::draw() {
 void SurfaceManagerGui::mousePressed(ofMouseEventArgs& args) {
   if (guiMode == GuiMode::NONE) {
     return;
-  } else if (guiMode == GuiMode::TEXTURE_MAPPING) {
+  }
+
+  // Every click starts a new undo step
+  if (surfaceManager != NULL) {
+    surfaceManager->flushEdits();
+  }
+  editHistory.seal();
+
+  if (guiMode == GuiMode::TEXTURE_MAPPING) {
     bool bSurfaceSelected = false;
 
     CircleJoint* hitJoint =
@@ -151,6 +162,12 @@ void SurfaceManagerGui::mouseReleased(ofMouseEventArgs& args) {
   stopDrag();
   projectionEditor.stopDragJoints();
   textureEditor.stopDragJoints();
+
+  // A drag ends up as a single undo step
+  if (surfaceManager != NULL) {
+    surfaceManager->flushEdits();
+  }
+  editHistory.seal();
 }
 
 void SurfaceManagerGui::mouseDragged(ofMouseEventArgs& args) {
@@ -169,7 +186,16 @@ void SurfaceManagerGui::mouseDragged(ofMouseEventArgs& args) {
 }
 
 void SurfaceManagerGui::setSurfaceManager(SurfaceManager* newSurfaceManager) {
+  if (surfaceManager != NULL) {
+    ofRemoveListener(surfaceManager->onReload, this,
+                     &SurfaceManagerGui::handleReload);
+  }
   surfaceManager = newSurfaceManager;
+  if (surfaceManager != NULL) {
+    ofAddListener(surfaceManager->onReload, this,
+                  &SurfaceManagerGui::handleReload);
+  }
+  editHistory.setSurfaceManager(surfaceManager);
   projectionEditor.setSurfaceManager(surfaceManager);
   sourcesEditor.setSurfaceManager(surfaceManager);
 }
@@ -246,5 +272,41 @@ void SurfaceManagerGui::drawSelectedSurfaceTextureHighlight() {
 void SurfaceManagerGui::startDrag() { bDrag = true; }
 
 void SurfaceManagerGui::stopDrag() { bDrag = false; }
+
+void SurfaceManagerGui::undo() {
+  stopDrag();
+  editHistory.undo();
+  refreshEditors();
+}
+
+void SurfaceManagerGui::redo() {
+  stopDrag();
+  editHistory.redo();
+  refreshEditors();
+}
+
+EditHistory& SurfaceManagerGui::getEditHistory() { return editHistory; }
+
+void SurfaceManagerGui::handleReload(string& fileName) {
+  stopDrag();
+  editHistory.seal();
+  refreshEditors();
+}
+
+void SurfaceManagerGui::refreshEditors() {
+  if (surfaceManager == NULL) return;
+
+  // The selected surface may have been removed by the undo
+  if (surfaceManager->getSelectedSurface() == NULL) {
+    projectionEditor.clearJoints();
+    textureEditor.clear();
+    return;
+  }
+
+  projectionEditor.createJoints();
+  if (guiMode == GuiMode::TEXTURE_MAPPING) {
+    textureEditor.setSurface(surfaceManager->getSelectedSurface());
+  }
+}
 }
 }
\ No newline at end of file
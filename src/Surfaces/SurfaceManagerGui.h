@@ -7,6 +7,7 @@
 #include "ofGraphics.h"
 
 #include "SurfaceManager.h"
+#include "EditHistory.h"
 #include "TextureEditor.h"
 #include "ProjectionEditor.h"
 #include "SourcesEditor.h"
@@ -33,6 +34,10 @@ class SurfaceManagerGui {
   void drawSelectedSurfaceTextureHighlight();
   void startDrag();
   void stopDrag();
+  // Undo and redo edits of surfaces and refresh the editors
+  void undo();
+  void redo();
+  EditHistory& getEditHistory();
 
  private:
   SurfaceManager* surfaceManager;
@@ -40,9 +45,13 @@ class SurfaceManagerGui {
   TextureEditor textureEditor;
   ProjectionEditor projectionEditor;
   SourcesEditor sourcesEditor;
+  EditHistory editHistory;
   int guiMode;
   bool bDrag;
   ofVec2f clickPosition;
+
+  void refreshEditors();
+  void handleReload(string& fileName);
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofx {
+namespace piMapper {
+// Plain copy of everything that is stored about a surface in the settings
+// file. Snapshots do not reference live surfaces or sources, so they can be
+// handed over to other threads safely.
+struct SurfaceSnapshot {
+  int type;
+  vector<ofVec2f> vertices;
+  vector<ofVec2f> texCoords;
+  std::string sourceType;
+  std::string sourceName;
+};
+}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Seconds a source transition takes unless given otherwise
+#define DEFAULT_TRANSITION_DURATION 0.5f
+// Width of the soft edge of a wipe, relative to the width of the texture
+#define WIPE_EDGE_WIDTH 0.1f
+
+namespace ofx {
+  namespace piMapper {
+    struct TransitionType {
+      enum { TRANSITION_NONE, TRANSITION_CROSSFADE, TRANSITION_WIPE };
+    };
+  }
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "TriangleSurface.h"
+#include "RenderStats.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
@@ -39,36 +41,66 @@ void TriangleSurface::setup(ofVec2f p1, ofVec2f p2, ofVec2f p3, ofVec2f t1,
   mesh.addTexCoord(t1);
   mesh.addTexCoord(t2);
   mesh.addTexCoord(t3);
+
+  bGeometryDirty = true;
 }
 
 void TriangleSurface::draw() {
-  if (source->getTexture() == NULL) {
-    ofLogWarning("TriangleSurface") << "Source texture is empty. Not drawing.";
+  // Part of a large source the texture coordinates touch
+  BaseSource* view = getSourceView();
+  if (view->getTexture() == NULL) {
+    PIMAPPER_LOG_THROTTLED(OF_LOG_WARNING, "TriangleSurface")
+        << "Source texture is empty. Not drawing.";
     return;
   }
   
-  source->getTexture()->bind();
-  mesh.draw();
-  source->getTexture()->unbind();
+  updateGeometry();
+  // Into the region of the texture the source shows
+  ofRectangle region = view->getTextureRegion();
+  GLfloat texCoords[12];
+  for (int i = 0; i < 12; i += 4) {
+    texCoords[i] = region.x + triangleTexCoordinates[i] * region.width;
+    texCoords[i + 1] = region.y + triangleTexCoordinates[i + 1] * region.height;
+    texCoords[i + 2] = 0.0f;
+    texCoords[i + 3] = 1.0f;
+  }
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(4, GL_FLOAT, 0, texCoords);
+  glVertexPointer(3, GL_FLOAT, 0, triangleVertices);
+
+  view->getTexture()->bind();
+  PIMAPPER_COUNT_BIND();
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  PIMAPPER_COUNT_GEOMETRY_UPLOAD(mesh.getNumVertices());
+  PIMAPPER_COUNT_DRAW(mesh.getNumVertices());
+  view->getTexture()->unbind();
+  PIMAPPER_COUNT_UNBIND();
+
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 void TriangleSurface::setVertex(int index, ofVec2f p) {
   if (index > 2) {
-    ofLog() << "Vertex with this index does not exist: " << index << endl;
+    PIMAPPER_LOG_WARNING("TriangleSurface")
+        << "Vertex with this index does not exist: " << index;
     return;
   }
 
   mesh.setVertex(index, p);
+  markChanged();
 }
 
 void TriangleSurface::setTexCoord(int index, ofVec2f t) {
   if (index > 2) {
-    ofLog() << "Texture coordinate with this index does not exist: " << index
-            << endl;
+    PIMAPPER_LOG_WARNING("TriangleSurface")
+        << "Texture coordinate with this index does not exist: " << index;
     return;
   }
 
   mesh.setTexCoord(index, t);
+  markChanged();
 }
 
 void TriangleSurface::moveBy(ofVec2f v) {
@@ -76,15 +108,16 @@ void TriangleSurface::moveBy(ofVec2f v) {
   for (int i = 0; i < vertices.size(); i++) {
     vertices[i] += v;
   }
+  markChanged();
 }
 
 int TriangleSurface::getType() { return SurfaceType::TRIANGLE_SURFACE; }
 
 bool TriangleSurface::hitTest(ofVec2f p) {
-  // Construct ofPolyline from vertices
-  ofPolyline line = getHitArea();
+  updateGeometry();
+  if (!hitBounds.inside(p.x, p.y)) return false;
 
-  if (line.inside(p.x, p.y)) {
+  if (hitArea.inside(p.x, p.y)) {
     return true;
   } else {
     return false;
@@ -93,7 +126,8 @@ bool TriangleSurface::hitTest(ofVec2f p) {
 
 ofVec2f TriangleSurface::getVertex(int index) {
   if (index > 2) {
-    ofLog() << "Vertex with this index does not exist: " << index << endl;
+    PIMAPPER_LOG_WARNING("TriangleSurface")
+        << "Vertex with this index does not exist: " << index;
     throw std::runtime_error("Vertex index out of bounds.");
   }
 
@@ -110,19 +144,14 @@ ofVec2f TriangleSurface::getTexCoord(int index) {
 }
 
 ofPolyline TriangleSurface::getHitArea() {
-  ofPolyline line;
-  line.addVertex(ofPoint(mesh.getVertex(0).x, mesh.getVertex(0).y));
-  line.addVertex(ofPoint(mesh.getVertex(1).x, mesh.getVertex(1).y));
-  line.addVertex(ofPoint(mesh.getVertex(2).x, mesh.getVertex(2).y));
-  line.close();
-
-  return line;
+  updateGeometry();
+  return hitArea;
 }
 
 ofPolyline TriangleSurface::getTextureHitArea() {
   ofPolyline line;
   vector<ofVec2f>& texCoords = mesh.getTexCoords();
-  ofVec2f textureSize = ofVec2f(source->getTexture()->getWidth(), source->getTexture()->getHeight());
+  ofVec2f textureSize = ofVec2f(source->getWidth(), source->getHeight());
   for (int i = 0; i < texCoords.size(); i++) {
     line.addVertex(ofPoint(texCoords[i] * textureSize));
   }
@@ -137,5 +166,39 @@ vector<ofVec3f>& TriangleSurface::getVertices() {
 }
 
 vector<ofVec2f>& TriangleSurface::getTexCoords() { return mesh.getTexCoords(); }
+
+void TriangleSurface::getGeometry(vector<GLfloat>& vertices,
+                                  vector<GLfloat>& texCoords,
+                                  vector<GLushort>& indices) {
+  updateGeometry();
+  vertices.assign(triangleVertices, triangleVertices + 9);
+  texCoords.assign(triangleTexCoordinates, triangleTexCoordinates + 12);
+  indices.resize(3);
+  for (int i = 0; i < 3; i++) {
+    indices[i] = i;
+  }
+}
+
+void TriangleSurface::calculateGeometry() {
+  hitArea.clear();
+  hitArea.addVertex(ofPoint(mesh.getVertex(0).x, mesh.getVertex(0).y));
+  hitArea.addVertex(ofPoint(mesh.getVertex(1).x, mesh.getVertex(1).y));
+  hitArea.addVertex(ofPoint(mesh.getVertex(2).x, mesh.getVertex(2).y));
+  hitArea.close();
+  hitBounds = hitArea.getBoundingBox();
+
+  // Same layout as the 4d texture coordinates of quads, q is always 1
+  for (int i = 0; i < 3; i++) {
+    ofVec3f vertex = mesh.getVertex(i);
+    ofVec2f texCoord = mesh.getTexCoord(i);
+    triangleVertices[i * 3] = vertex.x;
+    triangleVertices[i * 3 + 1] = vertex.y;
+    triangleVertices[i * 3 + 2] = vertex.z;
+    triangleTexCoordinates[i * 4] = texCoord.x;
+    triangleTexCoordinates[i * 4 + 1] = texCoord.y;
+    triangleTexCoordinates[i * 4 + 2] = 0.0f;
+    triangleTexCoordinates[i * 4 + 3] = 1.0f;
+  }
+}
 }
 }
\ No newline at end of file
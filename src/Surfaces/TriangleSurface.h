@@ -27,6 +27,13 @@ class TriangleSurface : public BaseSurface {
   ofPolyline getTextureHitArea();
   vector<ofVec3f>& getVertices();
   vector<ofVec2f>& getTexCoords();
+  void getGeometry(vector<GLfloat>& vertices, vector<GLfloat>& texCoords,
+                   vector<GLushort>& indices);
+
+ private:
+  void calculateGeometry();
+  GLfloat triangleVertices[9];
+  GLfloat triangleTexCoordinates[12];
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "VertexInput.h"
+
+namespace ofx {
+namespace piMapper {
+VertexUpdate::VertexUpdate() {
+  surfaceId = 0;
+  numVertices = 0;
+  numTexCoords = 0;
+}
+
+VertexInput::VertexInput(int capacity) : queue(capacity) {
+  numEvicted = 0;
+  numReplaced = 0;
+}
+
+void VertexInput::push(const VertexUpdate& update) {
+  // Another thread may fill the freed slot first, then evict the next one
+  VertexUpdate oldest;
+  while (!queue.push(update)) {
+    evictedMutex.lock();
+    if (queue.pop(oldest)) {
+      std::map<unsigned int, VertexUpdate>::iterator it =
+          evicted.find(oldest.surfaceId);
+      if (it == evicted.end()) {
+        evicted[oldest.surfaceId] = oldest;
+      } else {
+        merge(it->second, oldest);
+      }
+      numEvicted++;
+    }
+    evictedMutex.unlock();
+  }
+}
+
+void VertexInput::push(const VertexUpdate* updates, int count) {
+  for (int i = 0; i < count; i++) {
+    push(updates[i]);
+  }
+}
+
+void VertexInput::getLatest(vector<VertexUpdate>& latest) {
+  latest.clear();
+  latestIndices.clear();
+  evictedMutex.lock();
+  // Evicted updates are older than anything still queued
+  std::map<unsigned int, VertexUpdate>::iterator evictedIt;
+  for (evictedIt = evicted.begin(); evictedIt != evicted.end(); evictedIt++) {
+    latestIndices[evictedIt->first] = latest.size();
+    latest.push_back(evictedIt->second);
+  }
+  evicted.clear();
+
+  // Producers may keep pushing while we drain, stop after one queue full
+  VertexUpdate update;
+  for (int i = 0; i < queue.getCapacity() && queue.pop(update); i++) {
+    std::map<unsigned int, int>::iterator it =
+        latestIndices.find(update.surfaceId);
+    if (it == latestIndices.end()) {
+      latestIndices[update.surfaceId] = latest.size();
+      latest.push_back(update);
+    } else {
+      // Vertices and texture coordinates may come in separate updates
+      merge(latest[it->second], update);
+      numReplaced++;
+    }
+  }
+  evictedMutex.unlock();
+}
+
+void VertexInput::merge(VertexUpdate& merged, const VertexUpdate& update) {
+  if (update.numVertices) {
+    merged.numVertices = update.numVertices;
+    std::copy(update.vertices, update.vertices + MAX_VERTEX_UPDATE_POINTS,
+              merged.vertices);
+  }
+  if (update.numTexCoords) {
+    merged.numTexCoords = update.numTexCoords;
+    std::copy(update.texCoords, update.texCoords + MAX_VERTEX_UPDATE_POINTS,
+              merged.texCoords);
+  }
+}
+
+unsigned int VertexInput::getNumEvicted() {
+  evictedMutex.lock();
+  unsigned int count = numEvicted;
+  evictedMutex.unlock();
+  return count;
+}
+
+unsigned int VertexInput::getNumReplaced() { return numReplaced; }
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ofMain.h"
+#include "LockFreeQueue.h"
+
+// Enough for quads
+#define MAX_VERTEX_UPDATE_POINTS 4
+// Updates that can wait for the next frame before the oldest are evicted
+#define DEFAULT_VERTEX_INPUT_CAPACITY 1024
+
+namespace ofx {
+namespace piMapper {
+// New vertex and texture coordinate positions for one surface
+struct VertexUpdate {
+  VertexUpdate();
+
+  // BaseSurface::getId of the surface to change
+  unsigned int surfaceId;
+  // Leave at 0 to keep the vertices or texture coordinates as they are.
+  // Other counts must match the surface.
+  int numVertices;
+  int numTexCoords;
+  ofVec2f vertices[MAX_VERTEX_UPDATE_POINTS];
+  ofVec2f texCoords[MAX_VERTEX_UPDATE_POINTS];
+};
+
+// Takes vertex updates from any number of threads without locking, for
+// example from a tracker running faster than the frame rate. SurfaceManager
+// applies the latest update of every surface once per frame and drops the
+// ones before it. If the queue fills up between two frames, push evicts the
+// oldest update to make room, so the newest positions always get through.
+// Evicted updates are merged per surface under a lock instead of being
+// lost, so vertices pushed before a texture coordinate only update of the
+// same surface still arrive.
+class VertexInput {
+ public:
+  VertexInput(int capacity = DEFAULT_VERTEX_INPUT_CAPACITY);
+
+  // Any thread
+  void push(const VertexUpdate& update);
+  void push(const VertexUpdate* updates, int count);
+
+  // Main thread. The latest vertices and texture coordinates of every
+  // surface pushed since the last call. Surfaces with evicted updates
+  // come first, the others in the order they were first seen.
+  void getLatest(vector<VertexUpdate>& latest);
+
+  // Old updates evicted because the queue was full
+  unsigned int getNumEvicted();
+  // Updates replaced by a newer one for the same surface
+  unsigned int getNumReplaced();
+
+ private:
+  LockFreeQueue<VertexUpdate> queue;
+  unsigned int numEvicted;
+  unsigned int numReplaced;
+  std::map<unsigned int, int> latestIndices;
+  // Merged evicted updates by surface id. The mutex is only taken by a
+  // push that finds the queue full, and by getLatest so that an update
+  // being evicted is never applied after a newer one.
+  std::map<unsigned int, VertexUpdate> evicted;
+  ofMutex evictedMutex;
+
+  // Takes the vertices and texture coordinates update has
+  static void merge(VertexUpdate& merged, const VertexUpdate& update);
+};
+}
+}
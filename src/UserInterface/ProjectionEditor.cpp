@@ -1,4 +1,6 @@
 #include "ProjectionEditor.h"
+#include "Profiler.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
@@ -59,6 +61,7 @@ void ProjectionEditor::disable() {
 }
 
 void ProjectionEditor::update(ofEventArgs& args) {
+  PIMAPPER_PROFILE("update", "ProjectionEditor");
   // update surface if one of the joints is being dragged
   for (int i = 0; i < joints.size(); i++) {
     if (joints[i]->isDragged() || joints[i]->isSelected()) {
@@ -177,7 +180,8 @@ void ProjectionEditor::createJoints() {
   clearJoints();
 
   if (surfaceManager->getSelectedSurface() == NULL) {
-    ofLog(OF_LOG_WARNING, "Trying to create joints while no surface selected.");
+    PIMAPPER_LOG_WARNING("ProjectionEditor")
+        << "Trying to create joints while no surface selected.";
     return;
   }
 
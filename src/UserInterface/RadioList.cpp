@@ -1,4 +1,5 @@
 #include "RadioList.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
@@ -76,7 +77,7 @@ void RadioList::selectItem(int index) {
   
   bool RadioList::selectItemByValue(std::string itemValue) {
     if (itemValue == "") {
-      ofLogNotice("RadioList") << "Item value empty";
+      PIMAPPER_LOG_NOTICE("RadioList") << "Item value empty";
       return false;
     }
     unselectAll();
@@ -94,7 +95,7 @@ void RadioList::selectItem(int index) {
       toggle->addListener(this, &RadioList::onToggleClicked);
       return true;
     }
-    ofLogNotice("RadioList") << "Item with value " << itemValue << " not found";
+    PIMAPPER_LOG_NOTICE("RadioList") << "Item with value " << itemValue << " not found";
     return false;
   }
 
@@ -113,7 +114,8 @@ void RadioList::enable() {
   *toggle = true;
   toggle->addListener(this, &RadioList::onToggleClicked);
 
-  cout << "num items after enable: " << guiGroup.getNumControls() << endl;
+  PIMAPPER_LOG_VERBOSE("RadioList") << "num items after enable: "
+                                    << guiGroup.getNumControls();
 }
 
 void RadioList::disable() {
@@ -1,4 +1,5 @@
 #include "SourcesEditor.h"
+#include "Log.h"
 
 namespace ofx {
 namespace piMapper {
@@ -72,7 +73,8 @@ namespace piMapper {
   void SourcesEditor::draw() {
     // Don't draw if there is no source selected
     if (surfaceManager->getSelectedSurface() == NULL) {
-      ofLogNotice("SourcesEditor") << "No surface selected";
+      PIMAPPER_LOG_THROTTLED(OF_LOG_NOTICE, "SourcesEditor")
+          << "No surface selected";
       return;
     }
     if (imageSelector->size()) {
@@ -96,7 +98,7 @@ namespace piMapper {
   void SourcesEditor::enable() {
     // Don't enable if there is no surface selected
     if (surfaceManager->getSelectedSurface() == NULL) {
-      ofLogNotice("SourcesEditor") << "No surface selected. Not enabling and not showing source list.";
+      PIMAPPER_LOG_NOTICE("SourcesEditor") << "No surface selected. Not enabling and not showing source list.";
       return;
     }
     if (imageSelector->size()) {
@@ -130,7 +132,7 @@ namespace piMapper {
 
   void SourcesEditor::selectSourceRadioButton(std::string& sourcePath) {
     if (sourcePath == "") {
-      ofLogNotice("SourcesEditor") << "Path is empty";
+      PIMAPPER_LOG_NOTICE("SourcesEditor") << "Path is empty";
       if (imageSelector->size()) {
         imageSelector->unselectAll();
       }
@@ -152,20 +154,22 @@ namespace piMapper {
         return;
       }
       // Log warning if we are still here
-      ofLogWarning("SourcesEditor") << "Could not find option in any of the source lists";
+      PIMAPPER_LOG_WARNING("SourcesEditor") << "Could not find option in any of the source lists";
     }
   }
   
   void SourcesEditor::init() {
     mediaServer = NULL; // Pointers to NULL pointer so we can check later
     isMediaServerExternal = false;
+    transitionType = TransitionType::TRANSITION_CROSSFADE;
+    transitionDuration = DEFAULT_TRANSITION_DURATION;
     registerAppEvents();
   }
   
   void SourcesEditor::addMediaServerListeners() {
     // Check if the media server is valid
     if (mediaServer == NULL) {
-      ofLogError("SourcesEditor::addMediaServerListeners", "Media server not set");
+      PIMAPPER_LOG_ERROR("SourcesEditor") << "Media server not set";
       return;
     }
     // Add listeners to custom events of the media server
@@ -181,7 +185,7 @@ namespace piMapper {
   void SourcesEditor::removeMediaServerListeners() {
     // Check if the media server is valid
     if (mediaServer == NULL) {
-      ofLogError("SourcesEditor::addMediaServerListeners", "Media server not set");
+      PIMAPPER_LOG_ERROR("SourcesEditor") << "Media server not set";
       return;
     }
     // Remove listeners to custom events of the media server
@@ -196,35 +200,35 @@ namespace piMapper {
   void SourcesEditor::handleImageSelected(string& imagePath) {
     // Unselect video item if any selected
     videoSelector->unselectAll();
-    BaseSurface* surface = surfaceManager->getSelectedSurface();
-    if (surface == NULL) {
-      ofLogNotice("SourcesEditor") << "No surface selected";
-      return;
-    }
-    // Unload old media
-    BaseSource* source = surface->getSource();
-    if (source->isLoadable()) {
-      mediaServer->unloadMedia(source->getPath());
-    }
-    // Load new image
-    surface->setSource(mediaServer->loadImage(imagePath));
+    selectSource(SOURCE_TYPE_NAME_IMAGE, imagePath);
   }
   
   void SourcesEditor::handleVideoSelected(string& videoPath) {
     // Unselect image item if any selected
     imageSelector->unselectAll();
+    selectSource(SOURCE_TYPE_NAME_VIDEO, videoPath);
+  }
+  
+  void SourcesEditor::selectSource(string sourceType, string& path) {
     BaseSurface* surface = surfaceManager->getSelectedSurface();
     if (surface == NULL) {
-      ofLogNotice("SourcesEditor") << "No surface selected";
+      PIMAPPER_LOG_NOTICE("SourcesEditor") << "No surface selected";
       return;
     }
-    // Unload old media
-    BaseSource* source = surface->getSource();
-    if (source->isLoadable()) {
-      mediaServer->unloadMedia(source->getPath());
+    int index = 0;
+    while (surfaceManager->getSurface(index) != surface) {
+      index++;
     }
-    // Load new video
-    surface->setSource(mediaServer->loadVideo(videoPath));
+    // Sources are referred to by file name within their media directory
+    std::vector<std::string> pathParts = ofSplitString(path, "/");
+    surfaceManager->transitionSource(index, sourceType,
+                                     pathParts[pathParts.size() - 1],
+                                     transitionType, transitionDuration);
+  }
+  
+  void SourcesEditor::setTransition(int newTransitionType, float duration) {
+    transitionType = newTransitionType;
+    transitionDuration = duration;
   }
   
   void SourcesEditor::clearMediaServer() {
@@ -239,23 +243,23 @@ namespace piMapper {
   }
   
   void SourcesEditor::handleImageAdded(string& path) {
-    cout << "image added: " << path << endl;
+    PIMAPPER_LOG_VERBOSE("SourcesEditor") << "image added: " << path;
   }
   
   void SourcesEditor::handleImageRemoved(string& path) {
-    cout << "image removed: " << path << endl;
+    PIMAPPER_LOG_VERBOSE("SourcesEditor") << "image removed: " << path;
   }
   
   void SourcesEditor::handleVideoAdded(string& path) {
-    cout << "video added: " << path << endl;
+    PIMAPPER_LOG_VERBOSE("SourcesEditor") << "video added: " << path;
   }
   
   void SourcesEditor::handleVideoRemoved(string& path) {
-    cout << "video removed: " << path << endl;
+    PIMAPPER_LOG_VERBOSE("SourcesEditor") << "video removed: " << path;
   }
   
   void SourcesEditor::handleImageLoaded(string& path) {
-    cout << "Image loaded: " << path << endl;
+    PIMAPPER_LOG_VERBOSE("SourcesEditor") << "Image loaded: " << path;
     
     // Test image unload
     // mediaServer->unloadImage(path);
@@ -265,7 +269,7 @@ namespace piMapper {
   }
   
   void SourcesEditor::handleImageUnloaded(string& path) {
-    cout << "Image unloaded: " << path << endl;
+    PIMAPPER_LOG_VERBOSE("SourcesEditor") << "Image unloaded: " << path;
   }
 }
 }
\ No newline at end of file
@@ -36,11 +36,17 @@ class SourcesEditor {
   int getLoadedTexCount();
   ofTexture* getTexture(int index);
 
+  // How selected media replaces the source of the selected surface,
+  // TransitionType::TRANSITION_NONE with duration 0 switches at once
+  void setTransition(int transitionType, float duration);
+
  private:
   MediaServer* mediaServer;
   SurfaceManager* surfaceManager;
   RadioList* imageSelector;
   RadioList* videoSelector;
+  int transitionType;
+  float transitionDuration;
   
   // Is the media server pointer local or from somewhere else?
   // We use this to determine if we are allowed to clear media server locally.
@@ -56,6 +62,8 @@ class SourcesEditor {
   // Handles GUI event, whenever someone has clicked on a radio button
   void handleImageSelected(string& imagePath);
   void handleVideoSelected(string& videoPath);
+  // Media is prefetched and blended in by the surface manager
+  void selectSource(string sourceType, string& path);
   
   // Careful clearing of the media server,
   // clears only if the media server has been initialized locally
@@ -1,4 +1,5 @@
 #include "TextureEditor.h"
+#include "Profiler.h"
 
 namespace ofx {
 namespace piMapper {
@@ -42,11 +43,12 @@ void TextureEditor::disable() {
 }
 
 void TextureEditor::update(ofEventArgs& args) {
+  PIMAPPER_PROFILE("update", "TextureEditor");
   if (surface == NULL) return;
 
   // update surface if one of the joints is being dragged
-  ofVec2f textureSize = ofVec2f(surface->getSource()->getTexture()->getWidth(),
-                                surface->getSource()->getTexture()->getHeight());
+  ofVec2f textureSize = ofVec2f(surface->getSource()->getWidth(),
+                                surface->getSource()->getHeight());
   
   // Get selected joint index
   int selectedJointIndex = 0;
@@ -138,8 +140,8 @@ void TextureEditor::createJoints() {
   if (surface == NULL) return;
   clearJoints();
   vector<ofVec2f>& texCoords = surface->getTexCoords();
-  ofVec2f textureSize = ofVec2f(surface->getSource()->getTexture()->getWidth(),
-                                surface->getSource()->getTexture()->getHeight());
+  ofVec2f textureSize = ofVec2f(surface->getSource()->getWidth(),
+                                surface->getSource()->getHeight());
 
   for (int i = 0; i < texCoords.size(); i++) {
     joints.push_back(new CircleJoint());
@@ -163,11 +165,12 @@ void TextureEditor::unselectAllJoints() {
 void TextureEditor::moveTexCoords(ofVec2f by) {
   if (surface == NULL) return;
   vector<ofVec2f>& texCoords = surface->getTexCoords();
-  ofVec2f textureSize = ofVec2f(surface->getSource()->getTexture()->getWidth(),
-                                surface->getSource()->getTexture()->getHeight());
+  ofVec2f textureSize = ofVec2f(surface->getSource()->getWidth(),
+                                surface->getSource()->getHeight());
   for (int i = 0; i < texCoords.size(); i++) {
     joints[i]->position += by;
-    texCoords[i] = joints[i]->position / textureSize;
+    // Go through setTexCoord so the surface knows it has changed
+    surface->setTexCoord(i, joints[i]->position / textureSize);
   }
 }
 
@@ -0,0 +1,48 @@
+#include "BackgroundWorker.h"
+
+namespace ofx {
+namespace piMapper {
+BackgroundWorker::BackgroundWorker() {}
+
+BackgroundWorker::~BackgroundWorker() {}
+
+void BackgroundWorker::wake() {
+  lock();
+  condition.signal();
+  unlock();
+  if (!isThreadRunning()) {
+    startThread(true, false);
+  }
+}
+
+void BackgroundWorker::stop() {
+  if (!isThreadRunning()) return;
+  lock();
+  clearTasks();
+  stopThread();
+  condition.signal();
+  unlock();
+  waitForThread(false);
+}
+
+void BackgroundWorker::threadedFunction() {
+  while (true) {
+    lock();
+    while (!takeTask()) {
+      if (!isThreadRunning()) {
+        unlock();
+        return;
+      }
+      condition.wait(mutex);
+    }
+    unlock();
+
+    runTask();
+
+    lock();
+    finishTask();
+    unlock();
+  }
+}
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Condition.h"
+
+namespace ofx {
+namespace piMapper {
+// Runs queued tasks one after the other on a thread of its own, which
+// starts with the first task and sleeps while there is nothing to do.
+// Subclasses keep their queue and results under lock and implement the
+// steps of a task. Results wait until the main thread collects them.
+class BackgroundWorker : public ofThread {
+ public:
+  BackgroundWorker();
+  virtual ~BackgroundWorker();
+
+ protected:
+  // Call after queueing a task, without holding the lock
+  void wake();
+  // Call first thing in the destructor of a subclass. The task being run
+  // is finished, queued ones are dropped with clearTasks.
+  void stop();
+
+  // With the lock held. Takes the next task off the queue, false if there
+  // is none.
+  virtual bool takeTask() = 0;
+  // Without the lock, other threads may queue meanwhile
+  virtual void runTask() = 0;
+  // With the lock held, stores the result of the task
+  virtual void finishTask() = 0;
+  // With the lock held, when stopping
+  virtual void clearTasks() = 0;
+
+ private:
+  Poco::Condition condition;
+
+  void threadedFunction();
+};
+}
+}
@@ -0,0 +1,72 @@
+#include "FileUtils.h"
+#include "Log.h"
+
+namespace ofx {
+namespace piMapper {
+bool FileUtils::getStamp(std::string path, long long& modified,
+                         unsigned long long& size) {
+  try {
+    Poco::File file(path);
+    if (!file.exists()) return false;
+    modified = file.getLastModified().epochMicroseconds();
+    size = file.getSize();
+  } catch (Poco::Exception& e) {
+    PIMAPPER_LOG_WARNING("FileUtils") << e.displayText();
+    return false;
+  }
+  return true;
+}
+
+std::string FileUtils::getCachePath(std::string path, std::string cacheDir,
+                                    std::string extension) {
+  std::string dataPath = ofToDataPath("", true);
+  if (dataPath.size() && dataPath[dataPath.size() - 1] != '/') {
+    dataPath += "/";
+  }
+  std::string cachePath = ofToDataPath(cacheDir, true);
+  if (path.find(dataPath) == 0) {
+    return cachePath + path.substr(dataPath.size()) + extension;
+  }
+  // FNV-1a
+  unsigned int hash = 2166136261u;
+  for (int i = 0; i < path.size(); i++) {
+    hash = (hash ^ (unsigned char)path[i]) * 16777619u;
+  }
+  std::vector<std::string> pathParts = ofSplitString(path, "/");
+  return cachePath + ofToHex(hash) + "-" + pathParts[pathParts.size() - 1] +
+         extension;
+}
+
+void FileUtils::writeUInt32(std::ofstream& file, unsigned int value) {
+  unsigned char bytes[4];
+  for (int i = 0; i < 4; i++) {
+    bytes[i] = (value >> (i * 8)) & 0xff;
+  }
+  file.write((char*)bytes, 4);
+}
+
+void FileUtils::writeUInt64(std::ofstream& file, unsigned long long value) {
+  writeUInt32(file, value & 0xffffffff);
+  writeUInt32(file, value >> 32);
+}
+
+unsigned int FileUtils::readUInt32(const unsigned char* data) {
+  return (unsigned int)data[0] | ((unsigned int)data[1] << 8) |
+         ((unsigned int)data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+unsigned long long FileUtils::readUInt64(const unsigned char* data) {
+  return readUInt32(data) | ((unsigned long long)readUInt32(data + 4) << 32);
+}
+
+unsigned int FileUtils::readUInt32BigEndian(const unsigned char* data) {
+  return ((unsigned int)data[0] << 24) | ((unsigned int)data[1] << 16) |
+         ((unsigned int)data[2] << 8) | (unsigned int)data[3];
+}
+
+unsigned long long FileUtils::readUInt64BigEndian(const unsigned char* data) {
+  return ((unsigned long long)readUInt32BigEndian(data) << 32) |
+         readUInt32BigEndian(data + 4);
+}
+}
+}
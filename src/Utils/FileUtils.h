@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+
+namespace ofx {
+namespace piMapper {
+// Helpers shared by the files we write next to media and settings
+class FileUtils {
+ public:
+  // Modification time in microseconds and size of a file, used to tell
+  // whether something derived from it is still current. False if the
+  // file does not exist.
+  static bool getStamp(std::string path, long long& modified,
+                       unsigned long long& size);
+  // Where to keep a file made from path in cacheDir of the data folder.
+  // Files in the data folder keep their path relative to it, so files of
+  // the same name in different folders get caches of their own. Others
+  // are named after a hash of their full path.
+  static std::string getCachePath(std::string path, std::string cacheDir,
+                                  std::string extension);
+
+  // Fields of our own cache files are little endian
+  static void writeUInt32(std::ofstream& file, unsigned int value);
+  static void writeUInt64(std::ofstream& file, unsigned long long value);
+  static unsigned int readUInt32(const unsigned char* data);
+  static unsigned long long readUInt64(const unsigned char* data);
+  // Big endian, like the boxes of MP4 files
+  static unsigned int readUInt32BigEndian(const unsigned char* data);
+  static unsigned long long readUInt64BigEndian(const unsigned char* data);
+};
+}
+}
@@ -0,0 +1,173 @@
+#include "JobSystem.h"
+#include "Poco/Environment.h"
+
+namespace ofx {
+namespace piMapper {
+JobSystem::JobSystem() {
+  job = NULL;
+  generation = 0;
+  numBusy = 0;
+  bStopping = false;
+  setNumWorkers(Poco::Environment::processorCount() - 1);
+}
+
+JobSystem::~JobSystem() { setNumWorkers(0); }
+
+void JobSystem::setNumWorkers(int numWorkers) {
+  if (numWorkers < 0) numWorkers = 0;
+  stopWorkers();
+
+  while (ranges.size()) {
+    delete ranges.back();
+    ranges.pop_back();
+  }
+  for (int i = 0; i < numWorkers; i++) {
+    workers.push_back(new Worker(this, i));
+  }
+  for (int i = 0; i <= numWorkers; i++) {
+    ranges.push_back(new Range());
+    ranges.back()->begin = 0;
+    ranges.back()->end = 0;
+  }
+}
+
+int JobSystem::getNumWorkers() { return workers.size(); }
+
+void JobSystem::run(Job& newJob, int count) {
+  if (count <= 0) return;
+  if (!workers.size() || count < MIN_PARALLEL_JOBS) {
+    for (int i = 0; i < count; i++) {
+      newJob.execute(i);
+    }
+    return;
+  }
+
+  // Workers are idle between runs, the ranges are ours to set
+  for (int i = 0; i < ranges.size(); i++) {
+    ranges[i]->mutex.lock();
+    ranges[i]->begin = count * i / ranges.size();
+    ranges[i]->end = count * (i + 1) / ranges.size();
+    ranges[i]->mutex.unlock();
+  }
+
+  mutex.lock();
+  job = &newJob;
+  numBusy = workers.size();
+  generation++;
+  startCondition.broadcast();
+  mutex.unlock();
+
+  for (int i = 0; i < workers.size(); i++) {
+    if (!workers[i]->isThreadRunning()) {
+      workers[i]->startThread(true, false);
+    }
+  }
+
+  process(ranges.size() - 1);
+
+  mutex.lock();
+  while (numBusy > 0) {
+    doneCondition.wait(mutex);
+  }
+  job = NULL;
+  mutex.unlock();
+}
+
+JobSystem::Worker::Worker(JobSystem* newJobSystem, int newIndex) {
+  jobSystem = newJobSystem;
+  index = newIndex;
+}
+
+void JobSystem::Worker::threadedFunction() { jobSystem->work(index); }
+
+void JobSystem::work(int self) {
+  // A worker started late still picks up the run that started it
+  int seenGeneration = 0;
+  while (true) {
+    mutex.lock();
+    while (generation == seenGeneration && !bStopping) {
+      startCondition.wait(mutex);
+    }
+    if (bStopping) {
+      mutex.unlock();
+      return;
+    }
+    seenGeneration = generation;
+    mutex.unlock();
+
+    process(self);
+
+    mutex.lock();
+    numBusy--;
+    if (numBusy == 0) doneCondition.signal();
+    mutex.unlock();
+  }
+}
+
+void JobSystem::process(int self) {
+  int begin;
+  int end;
+  while (true) {
+    if (!take(self, begin, end)) {
+      if (steal(self)) continue;
+      return;
+    }
+    for (int i = begin; i < end; i++) {
+      job->execute(i);
+    }
+  }
+}
+
+bool JobSystem::take(int self, int& begin, int& end) {
+  Range& range = *ranges[self];
+  range.mutex.lock();
+  begin = range.begin;
+  end = std::min(range.begin + JOB_BATCH_SIZE, range.end);
+  range.begin = end;
+  range.mutex.unlock();
+  return begin < end;
+}
+
+bool JobSystem::steal(int self) {
+  // Start with the next one so thieves spread out
+  for (int i = 1; i < ranges.size(); i++) {
+    Range& victim = *ranges[(self + i) % ranges.size()];
+    victim.mutex.lock();
+    int count = (victim.end - victim.begin + 1) / 2;
+    int begin = victim.end - count;
+    int end = victim.end;
+    victim.end = begin;
+    victim.mutex.unlock();
+    if (count <= 0) continue;
+
+    Range& range = *ranges[self];
+    range.mutex.lock();
+    range.begin = begin;
+    range.end = end;
+    range.mutex.unlock();
+    return true;
+  }
+  return false;
+}
+
+void JobSystem::stopWorkers() {
+  if (!workers.size()) return;
+  mutex.lock();
+  bStopping = true;
+  startCondition.broadcast();
+  mutex.unlock();
+
+  for (int i = 0; i < workers.size(); i++) {
+    if (workers[i]->isThreadRunning()) {
+      workers[i]->waitForThread(false);
+    }
+    delete workers[i];
+  }
+  workers.clear();
+
+  mutex.lock();
+  bStopping = false;
+  mutex.unlock();
+}
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Condition.h"
+
+// Below this many indices run executes everything on the calling thread
+#define MIN_PARALLEL_JOBS 64
+// Indices a thread takes from its own range at once
+#define JOB_BATCH_SIZE 16
+
+namespace ofx {
+namespace piMapper {
+// Work handed to JobSystem::run. execute is called exactly once for every
+// index, from any thread, so different indices must not share data.
+class Job {
+ public:
+  virtual ~Job() {}
+  virtual void execute(int index) = 0;
+};
+
+// Spreads the indices of a job over a fixed set of worker threads. Every
+// thread starts with an even share. A thread that runs out of work steals
+// half of what another one has left. run blocks until every index is done
+// and the calling thread works along. Which thread executes an index does
+// not change the result, as long as jobs keep to their own index.
+class JobSystem {
+ public:
+  // Uses one worker per core besides the calling thread
+  JobSystem();
+  ~JobSystem();
+
+  // 0 runs every job on the calling thread
+  void setNumWorkers(int numWorkers);
+  int getNumWorkers();
+
+  void run(Job& job, int count);
+
+ private:
+  class Worker : public ofThread {
+   public:
+    Worker(JobSystem* newJobSystem, int newIndex);
+    void threadedFunction();
+
+   private:
+    JobSystem* jobSystem;
+    int index;
+  };
+
+  struct Range {
+    ofMutex mutex;
+    int begin;
+    int end;
+  };
+
+  vector<Worker*> workers;
+  // One per worker plus the last one for the calling thread
+  vector<Range*> ranges;
+  Job* job;
+  int generation;
+  int numBusy;
+  bool bStopping;
+  ofMutex mutex;
+  Poco::Condition startCondition;
+  Poco::Condition doneCondition;
+
+  void work(int self);
+  void process(int self);
+  bool take(int self, int& begin, int& end);
+  bool steal(int self);
+  void stopWorkers();
+};
+}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofx {
+namespace piMapper {
+// Bounded queue that any number of threads can push to and pop from
+// without locks. Every slot carries a sequence number that tells whether
+// it is free to write or ready to read, so a full or empty queue is
+// detected without touching the other side. Based on Dmitry Vyukov's
+// bounded MPMC queue. Uses the GCC atomic builtins, which gcc and clang
+// provide on the Raspberry Pi, Linux and OS X.
+template <class T>
+class LockFreeQueue {
+ public:
+  // Capacity is rounded up to a power of two
+  LockFreeQueue(int capacity) {
+    int size = 2;
+    while (size < capacity) size *= 2;
+    cells.resize(size);
+    for (int i = 0; i < size; i++) {
+      cells[i].sequence = i;
+    }
+    mask = size - 1;
+    enqueuePosition = 0;
+    dequeuePosition = 0;
+  }
+
+  // False if the queue is full, nothing is pushed then
+  bool push(const T& item) {
+    Cell* cell;
+    unsigned int position = load(enqueuePosition);
+    while (true) {
+      cell = &cells[position & mask];
+      int difference = (int)(load(cell->sequence) - position);
+      if (difference == 0) {
+        if (__sync_bool_compare_and_swap(&enqueuePosition, position,
+                                         position + 1)) {
+          break;
+        }
+        position = load(enqueuePosition);
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = load(enqueuePosition);
+      }
+    }
+    cell->item = item;
+    store(cell->sequence, position + 1);
+    return true;
+  }
+
+  // False if the queue is empty
+  bool pop(T& item) {
+    Cell* cell;
+    unsigned int position = load(dequeuePosition);
+    while (true) {
+      cell = &cells[position & mask];
+      int difference = (int)(load(cell->sequence) - (position + 1));
+      if (difference == 0) {
+        if (__sync_bool_compare_and_swap(&dequeuePosition, position,
+                                         position + 1)) {
+          break;
+        }
+        position = load(dequeuePosition);
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = load(dequeuePosition);
+      }
+    }
+    item = cell->item;
+    store(cell->sequence, position + mask + 1);
+    return true;
+  }
+
+  int getCapacity() { return cells.size(); }
+
+ private:
+  struct Cell {
+    volatile unsigned int sequence;
+    T item;
+  };
+
+  vector<Cell> cells;
+  unsigned int mask;
+  // Keep producers and consumers off each other's cache line
+  char padding0[64];
+  volatile unsigned int enqueuePosition;
+  char padding1[64];
+  volatile unsigned int dequeuePosition;
+  char padding2[64];
+
+  // Full barriers, the builtins have no lighter ones
+  static unsigned int load(volatile unsigned int& value) {
+    unsigned int result = value;
+    __sync_synchronize();
+    return result;
+  }
+
+  static void store(volatile unsigned int& value, unsigned int newValue) {
+    __sync_synchronize();
+    value = newValue;
+  }
+};
+}
+}
@@ -3,4 +3,11 @@
 #include "SurfaceManager.h"
 #include "SurfaceManagerGui.h"
 
-#include "MediaServer.h"
\ No newline at end of file
+#include "MediaServer.h"
+#include "ControlServer.h"
+#include "CueList.h"
+
+#include "Profiler.h"
+#include "Log.h"
+#include "RenderStats.h"
+#include "StatsHud.h"
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "LoopTest.h"
+
+using namespace ofx::piMapper;
+
+LoopTest::LoopTest() : Test("loop") {}
+
+void LoopTest::execute() {
+#ifdef TARGET_RASPBERRY_PI
+  // The OMX player loops by itself, there is nothing to measure
+  ofLogNotice("Test") << getName() << ": skipped on the Pi";
+#else
+  if (!ofFile::doesFileExist(LOOP_TEST_FILE)) {
+    ofLogNotice("Test") << getName() << ": no " << LOOP_TEST_FILE
+                        << ", skipped";
+    return;
+  }
+  string path = ofToDataPath(LOOP_TEST_FILE, true);
+  double frameDuration = getFrameDuration(path);
+  check(frameDuration > 0.0, "can not read the frame rate of " + path);
+  if (frameDuration <= 0.0) return;
+
+  VideoSource source;
+  source.loadVideo(path);
+  source.setGaplessLoop(true);
+
+  // Updates like the app loop would
+  ofEventArgs args;
+  float startTime = ofGetElapsedTimef();
+  while (source.getNumLoops() < LOOP_TEST_LOOPS &&
+         ofGetElapsedTimef() - startTime < LOOP_TEST_TIMEOUT) {
+    source.update(args);
+    ofSleepMillis(LOOP_TEST_UPDATE_MILLIS);
+  }
+  int numLoops = source.getNumLoops();
+  double maxInterval = source.getMaxLoopInterval();
+  source.clear();
+
+  check(numLoops >= LOOP_TEST_LOOPS,
+        "looped " + ofToString(numLoops) + " times in " +
+            ofToString(LOOP_TEST_TIMEOUT) + " seconds");
+  check(maxInterval <= LOOP_TEST_MAX_FRAMES * frameDuration,
+        "loop point took " + ofToString(maxInterval / 1000.0) + " ms, " +
+            ofToString(maxInterval / frameDuration, 1) + " frames");
+#endif
+}
+
+double LoopTest::getFrameDuration(string path) {
+  ofVideoPlayer player;
+  player.setUseTexture(false);
+  if (!player.loadMovie(path)) return 0.0;
+  double duration = player.getDuration();
+  int numFrames = player.getTotalNumFrames();
+  player.close();
+  if (duration <= 0.0 || numFrames <= 0) return 0.0;
+  return duration * 1000000.0 / numFrames;
+}
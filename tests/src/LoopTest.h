@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxPiMapper.h"
+#include "Test.h"
+
+// Clip in the data folder, skipped if it is not there
+#define LOOP_TEST_FILE "loop.mp4"
+#define LOOP_TEST_LOOPS 3
+#define LOOP_TEST_UPDATE_MILLIS 5
+#define LOOP_TEST_TIMEOUT 120.0f
+// Longest allowed interval at a loop point, in frame durations of the clip
+#define LOOP_TEST_MAX_FRAMES 2.0
+
+// Plays a clip with gapless looping until it looped a few times. No
+// interval between the last frame and the first one after a loop point
+// may be longer than about two frames.
+class LoopTest : public Test {
+ public:
+  LoopTest();
+
+ protected:
+  void execute();
+
+ private:
+  // Microseconds per frame of the clip, 0 if it can't be read
+  double getFrameDuration(string path);
+};
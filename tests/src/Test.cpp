@@ -0,0 +1,24 @@
+#include "Test.h"
+
+Test::Test(string newName) {
+  name = newName;
+  numFailures = 0;
+}
+
+bool Test::run() {
+  numFailures = 0;
+  ofLogNotice("Test") << name;
+  execute();
+  if (numFailures) {
+    ofLogError("Test") << name << " failed " << numFailures << " checks";
+  }
+  return numFailures == 0;
+}
+
+string Test::getName() { return name; }
+
+void Test::check(bool condition, string message) {
+  if (condition) return;
+  ofLogError("Test") << name << ": " << message;
+  numFailures++;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofMain.h"
+
+// One focused check of the addon. A failed check is logged and fails the
+// test, the test still runs to the end so all failures show up at once.
+class Test {
+ public:
+  Test(string name);
+  virtual ~Test() {};
+
+  // True if every check passed
+  bool run();
+  string getName();
+
+ protected:
+  virtual void execute() = 0;
+  void check(bool condition, string message);
+
+ private:
+  string name;
+  int numFailures;
+};
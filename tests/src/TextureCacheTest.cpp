@@ -0,0 +1,147 @@
+#include "TextureCacheTest.h"
+
+using namespace ofx::piMapper;
+
+TextureCacheTest::TextureCacheTest() : Test("texturecache") {}
+
+void TextureCacheTest::execute() {
+  testCodec(3, GL_ETC1_RGB8_OES);
+  testCodec(4, GL_COMPRESSED_RGBA8_ETC2_EAC);
+  testCache();
+  testCachePath();
+}
+
+void TextureCacheTest::testCodec(int numChannels, int expectedFormat) {
+  string name = numChannels == 4 ? "RGBA" : "RGB";
+  ofPixels pixels;
+  makeImage(pixels, TEXTURE_CACHE_TEST_WIDTH, TEXTURE_CACHE_TEST_HEIGHT,
+            numChannels);
+  vector<unsigned char> blocks;
+  int format = EtcCodec::encode(pixels, blocks);
+  check(format == expectedFormat,
+        name + " encoded as format " + ofToHex(format));
+  size_t size = EtcCodec::getDataSize(format, TEXTURE_CACHE_TEST_WIDTH,
+                                      TEXTURE_CACHE_TEST_HEIGHT);
+  check(size > 0 && blocks.size() == size,
+        name + " encoded to " + ofToString(blocks.size()) + " bytes, not " +
+            ofToString(size));
+  if (blocks.empty()) return;
+
+  ofPixels decoded;
+  check(EtcCodec::decode(&blocks[0], blocks.size(), format,
+                         TEXTURE_CACHE_TEST_WIDTH, TEXTURE_CACHE_TEST_HEIGHT,
+                         decoded),
+        name + " blocks do not decode");
+  double psnr = getPsnr(pixels, decoded);
+  check(psnr >= TEXTURE_CACHE_TEST_MIN_PSNR,
+        name + " decodes with a PSNR of " + ofToString(psnr, 1) + " dB");
+  // Too little data for the size
+  check(!EtcCodec::decode(&blocks[0], blocks.size() - 1, format,
+                          TEXTURE_CACHE_TEST_WIDTH,
+                          TEXTURE_CACHE_TEST_HEIGHT, decoded),
+        name + " blocks decode from truncated data");
+}
+
+void TextureCacheTest::testCache() {
+  ofPixels pixels;
+  makeImage(pixels, TEXTURE_CACHE_TEST_WIDTH, TEXTURE_CACHE_TEST_HEIGHT, 3);
+  // Lossless, the cache encodes the same pixels
+  ofSaveImage(pixels, TEXTURE_CACHE_TEST_FILE);
+  string imagePath = ofToDataPath(TEXTURE_CACHE_TEST_FILE, true);
+  string cachePath = TextureCache::getCachePath(imagePath);
+  ofFile::removeFile(cachePath, false);
+  check(!TextureCache::isCurrent(cachePath, imagePath),
+        "missing cache is current");
+
+  int format = TextureCache::build(imagePath, cachePath);
+  check(format == GL_ETC1_RGB8_OES,
+        "cache built with format " + ofToHex(format));
+  check(TextureCache::isCurrent(cachePath, imagePath),
+        "cache is not current after building it");
+  check(!TextureCache::isCurrent(cachePath, imagePath,
+                                 TEXTURE_CACHE_TEST_WIDTH - 1),
+        "cache larger than the size asked for is current");
+
+  CompressedImage image;
+  check(TextureCache::load(cachePath, imagePath, image),
+        "cache does not load after building it");
+  vector<unsigned char> blocks;
+  EtcCodec::encode(pixels, blocks);
+  check(image.format == format && image.width == TEXTURE_CACHE_TEST_WIDTH &&
+            image.height == TEXTURE_CACHE_TEST_HEIGHT,
+        "cache loads as " + ofToString(image.width) + "x" +
+            ofToString(image.height) + " format " + ofToHex(image.format));
+  check(image.data == blocks, "cache loads other blocks than were encoded");
+
+  // A different image of a different size, so the stamp changes even
+  // where modification times are only in seconds
+  makeImage(pixels, TEXTURE_CACHE_TEST_WIDTH / 2,
+            TEXTURE_CACHE_TEST_HEIGHT / 2, 3);
+  ofSaveImage(pixels, TEXTURE_CACHE_TEST_FILE);
+  check(!TextureCache::isCurrent(cachePath, imagePath),
+        "cache of a changed image is current");
+  check(!TextureCache::load(cachePath, imagePath, image),
+        "cache of a changed image loads");
+
+  TextureCache::build(imagePath, cachePath);
+  check(TextureCache::load(cachePath, imagePath, image) &&
+            image.width == TEXTURE_CACHE_TEST_WIDTH / 2,
+        "rebuilt cache does not load the changed image");
+
+  ofFile::removeFile(cachePath, false);
+  ofFile::removeFile(TEXTURE_CACHE_TEST_FILE);
+}
+
+void TextureCacheTest::testCachePath() {
+  // Images in the data folder keep their path in the cache folder
+  string imagePath = ofToDataPath("sources/images/a.png", true);
+  string expected = ofToDataPath(
+      string(DEFAULT_TEXTURE_CACHE_DIR) + "sources/images/a.png.ktx", true);
+  string cachePath = TextureCache::getCachePath(imagePath);
+  check(cachePath == expected,
+        "cache of " + imagePath + " is " + cachePath + ", not " + expected);
+
+  // Others are named after a hash of their path, images of the same name
+  // get caches of their own
+  string cacheDir = ofToDataPath(DEFAULT_TEXTURE_CACHE_DIR, true);
+  string first = TextureCache::getCachePath("/media/one/a.png");
+  string second = TextureCache::getCachePath("/media/two/a.png");
+  check(first.find(cacheDir) == 0 && second.find(cacheDir) == 0,
+        "caches of images outside the data folder are not in " + cacheDir);
+  check(first != second, "images of the same name share " + first);
+  check(ofIsStringInString(first, "-a.png.ktx"),
+        first + " is not named after its image");
+  check(first == TextureCache::getCachePath("/media/one/a.png"),
+        "cache path of an image changes");
+}
+
+void TextureCacheTest::makeImage(ofPixels& pixels, int width, int height,
+                                 int numChannels) {
+  pixels.allocate(width, height, numChannels);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < numChannels; c++) {
+        float value =
+            c == 3 ? 255.0f * x / (width - 1)
+                   : 128.0f + 100.0f * sin(x * 0.05f * (c + 1)) *
+                                  cos(y * 0.04f);
+        pixels[(y * width + x) * numChannels + c] =
+            ofClamp(value, 0.0f, 255.0f);
+      }
+    }
+  }
+}
+
+double TextureCacheTest::getPsnr(ofPixels& a, ofPixels& b) {
+  if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight() ||
+      a.getNumChannels() != b.getNumChannels()) {
+    return 0.0;
+  }
+  double squaredError = 0.0;
+  for (int i = 0; i < a.size(); i++) {
+    double difference = a[i] - b[i];
+    squaredError += difference * difference;
+  }
+  if (squaredError == 0.0) return 99.0;
+  return 10.0 * log10(255.0 * 255.0 * a.size() / squaredError);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxPiMapper.h"
+#include "EtcCodec.h"
+#include "TextureCache.h"
+#include "FileUtils.h"
+#include "Test.h"
+
+// No multiples of 4, so the edge blocks are covered as well
+#define TEXTURE_CACHE_TEST_WIDTH 130
+#define TEXTURE_CACHE_TEST_HEIGHT 66
+// Lowest quality of the decoded blocks, smooth images come out near 37 dB
+#define TEXTURE_CACHE_TEST_MIN_PSNR 32.0
+// Written to the data folder and removed again
+#define TEXTURE_CACHE_TEST_FILE "texture_cache_test.png"
+
+// Encodes and decodes opaque and transparent images with EtcCodec, builds
+// and loads a cached texture and checks that it is no longer used once
+// its image changes. Needs no GL context.
+class TextureCacheTest : public Test {
+ public:
+  TextureCacheTest();
+
+ protected:
+  void execute();
+
+ private:
+  void testCodec(int numChannels, int expectedFormat);
+  void testCache();
+  void testCachePath();
+  // Smooth gradients, alpha rises from left to right
+  void makeImage(ofPixels& pixels, int width, int height, int numChannels);
+  // In dB, 0 if the sizes differ
+  double getPsnr(ofPixels& a, ofPixels& b);
+};
@@ -0,0 +1,151 @@
+#include "UndoTest.h"
+
+using namespace ofx::piMapper;
+
+UndoTest::UndoTest() : Test("undo") {}
+
+void UndoTest::execute() {
+  MediaServer mediaServer;
+
+  SurfaceManager surfaceManager;
+  surfaceManager.setMediaServer(&mediaServer);
+  EditHistory history;
+  history.setSurfaceManager(&surfaceManager);
+  playScript(surfaceManager, &history, UNDO_TEST_ENTRIES);
+
+  int numKept = history.size();
+  check(numKept > 0, "history is empty");
+  check(numKept < UNDO_TEST_ENTRIES,
+        "script did not exceed the memory budget, nothing was dropped");
+  check(history.getMemoryUsage() <= DEFAULT_HISTORY_MEMORY_BUDGET,
+        "history uses " + ofToString(history.getMemoryUsage()) +
+            " bytes, more than its budget");
+
+  vector<SurfaceSnapshot> end;
+  surfaceManager.getSnapshot(end);
+
+  int numUndone = 0;
+  while (history.canUndo()) {
+    history.undo();
+    numUndone++;
+  }
+  check(numUndone == numKept, "undid " + ofToString(numUndone) + " of " +
+                                  ofToString(numKept) + " entries");
+
+  // The same script up to the oldest kept entry
+  SurfaceManager expectedManager;
+  expectedManager.setMediaServer(&mediaServer);
+  playScript(expectedManager, NULL, UNDO_TEST_ENTRIES - numKept);
+  vector<SurfaceSnapshot> expected;
+  expectedManager.getSnapshot(expected);
+  vector<SurfaceSnapshot> undone;
+  surfaceManager.getSnapshot(undone);
+  string difference = compare(expected, undone);
+  check(difference == "", "after undo " + difference);
+
+  int numRedone = 0;
+  while (history.canRedo()) {
+    history.redo();
+    numRedone++;
+  }
+  check(numRedone == numKept, "redid " + ofToString(numRedone) + " of " +
+                                  ofToString(numKept) + " entries");
+  vector<SurfaceSnapshot> redone;
+  surfaceManager.getSnapshot(redone);
+  difference = compare(end, redone);
+  check(difference == "", "after redo " + difference);
+}
+
+void UndoTest::playScript(SurfaceManager& surfaceManager,
+                          EditHistory* history, int numEntries) {
+  ofSeedRandom(UNDO_TEST_SEED);
+  for (int i = 0; i < UNDO_TEST_SURFACES; i++) {
+    addSurface(surfaceManager);
+  }
+  if (history != NULL) {
+    // Adding the surfaces is not part of the script
+    history->clear();
+  }
+
+  // Every step makes exactly one history entry
+  for (int i = 0; i < numEntries; i++) {
+    if (history != NULL) history->seal();
+    int surfaceIndex = (int)ofRandom(surfaceManager.size());
+    int step = i % 50;
+    if (step == 20) {
+      addSurface(surfaceManager);
+      continue;
+    }
+    if (step == 45) {
+      surfaceManager.removeSurface(surfaceIndex);
+      continue;
+    }
+
+    // A drag over a few frames
+    BaseSurface* surface = surfaceManager.getSurface(surfaceIndex);
+    int gesture = step % 3;
+    int pointIndex = (int)ofRandom(surface->getVertices().size());
+    for (int j = 0; j < UNDO_TEST_GESTURE_STEPS; j++) {
+      if (gesture == 0) {
+        surface->moveBy(ofVec2f(ofRandom(-2, 2), ofRandom(-2, 2)));
+      } else if (gesture == 1) {
+        ofVec3f& vertex = surface->getVertices()[pointIndex];
+        surface->setVertex(pointIndex, ofVec2f(vertex.x + ofRandom(-2, 2),
+                                               vertex.y + ofRandom(-2, 2)));
+      } else {
+        ofVec2f texCoord = surface->getTexCoords()[pointIndex];
+        surface->setTexCoord(
+            pointIndex,
+            texCoord + ofVec2f(ofRandom(-0.01f, 0.01f), ofRandom(-0.01f, 0.01f)));
+      }
+      surfaceManager.flushEdits();
+    }
+  }
+}
+
+void UndoTest::addSurface(SurfaceManager& surfaceManager) {
+  int surfaceType = ofRandom(1.0f) < 0.5f ? SurfaceType::QUAD_SURFACE
+                                          : SurfaceType::TRIANGLE_SURFACE;
+  int numVertices = surfaceType == SurfaceType::QUAD_SURFACE ? 4 : 3;
+  ofVec2f center(ofRandom(1920), ofRandom(1080));
+  vector<ofVec2f> vertices;
+  vector<ofVec2f> texCoords;
+  for (int i = 0; i < numVertices; i++) {
+    float angle = TWO_PI * i / numVertices;
+    vertices.push_back(center +
+                       ofVec2f(cos(angle), sin(angle)) * ofRandom(20, 200));
+    texCoords.push_back(
+        ofVec2f(0.5f + cos(angle) * 0.5f, 0.5f + sin(angle) * 0.5f));
+  }
+  surfaceManager.addSurface(surfaceType, vertices, texCoords);
+}
+
+string UndoTest::compare(vector<SurfaceSnapshot>& expected,
+                         vector<SurfaceSnapshot>& actual) {
+  if (expected.size() != actual.size()) {
+    return ofToString(actual.size()) + " surfaces instead of " +
+           ofToString(expected.size());
+  }
+  for (int i = 0; i < expected.size(); i++) {
+    if (!isSameSurface(expected[i], actual[i])) {
+      return "surface " + ofToString(i) + " differs";
+    }
+  }
+  return "";
+}
+
+bool UndoTest::isSameSurface(SurfaceSnapshot& a, SurfaceSnapshot& b) {
+  if (a.type != b.type || a.sourceType != b.sourceType ||
+      a.sourceName != b.sourceName ||
+      a.vertices.size() != b.vertices.size() ||
+      a.texCoords.size() != b.texCoords.size()) {
+    return false;
+  }
+  for (int i = 0; i < a.vertices.size(); i++) {
+    if (!a.vertices[i].match(b.vertices[i], 0.01f)) return false;
+  }
+  for (int i = 0; i < a.texCoords.size(); i++) {
+    if (!a.texCoords[i].match(b.texCoords[i], 0.0001f)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxPiMapper.h"
+#include "EditHistory.h"
+#include "Test.h"
+
+// History entries made by the edit script, enough to exceed the default
+// memory budget several times
+#define UNDO_TEST_ENTRIES 60000
+#define UNDO_TEST_SURFACES 40
+#define UNDO_TEST_GESTURE_STEPS 5
+#define UNDO_TEST_SEED 29
+
+// Replays a long script of drags, added and removed surfaces with the
+// default memory budget. Undoing everything has to give back the surfaces
+// as they were before the oldest entry that was kept, redoing everything
+// the surfaces at the end of the script.
+class UndoTest : public Test {
+ public:
+  UndoTest();
+
+ protected:
+  void execute();
+
+ private:
+  // Plays the first numEntries history entries of the script on a new
+  // set of surfaces, records them in history unless that is NULL
+  void playScript(ofx::piMapper::SurfaceManager& surfaceManager,
+                  ofx::piMapper::EditHistory* history, int numEntries);
+  void addSurface(ofx::piMapper::SurfaceManager& surfaceManager);
+  // Names the first surface that differs, empty if there is none
+  string compare(vector<ofx::piMapper::SurfaceSnapshot>& expected,
+                 vector<ofx::piMapper::SurfaceSnapshot>& actual);
+  bool isSameSurface(ofx::piMapper::SurfaceSnapshot& a,
+                     ofx::piMapper::SurfaceSnapshot& b);
+};
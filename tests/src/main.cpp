@@ -0,0 +1,17 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofApp.h"
+
+// Usage: tests [name of the only test to run]
+int main(int argc, char* argv[])
+{
+	// No window and no GL context
+	ofAppNoWindow window;
+	ofSetupOpenGL(&window, 1024, 768, OF_WINDOW);
+
+	ofApp* app = new ofApp();
+	if (argc > 1) {
+		app->testName = argv[1];
+	}
+	ofRunApp(app);
+}
@@ -0,0 +1,42 @@
+#include "ofApp.h"
+#include "UndoTest.h"
+#include "LoopTest.h"
+#include "TextureCacheTest.h"
+
+ofApp::ofApp() {
+  tests.push_back(new UndoTest());
+  tests.push_back(new LoopTest());
+  tests.push_back(new TextureCacheTest());
+}
+
+ofApp::~ofApp() {
+  for (int i = 0; i < tests.size(); i++) {
+    delete tests[i];
+  }
+}
+
+void ofApp::setup() {
+  ofSetLogLevel(OF_LOG_WARNING);
+  ofSetLogLevel("Test", OF_LOG_NOTICE);
+  // Same random input on every run
+  ofSeedRandom(1);
+
+  int numRun = 0;
+  int numFailed = 0;
+  for (int i = 0; i < tests.size(); i++) {
+    if (testName != "" && tests[i]->getName() != testName) continue;
+    numRun++;
+    if (!tests[i]->run()) {
+      numFailed++;
+    }
+  }
+
+  if (numRun == 0) {
+    ofLogError("Test") << "No test named " << testName;
+    ofExit(1);
+    return;
+  }
+  ofLogNotice("Test") << numRun - numFailed << " of " << numRun
+                      << " tests passed";
+  ofExit(numFailed ? 1 : 0);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Test.h"
+
+// Runs every test once on startup and exits. The exit code is not 0 if a
+// test failed.
+class ofApp : public ofBaseApp {
+ public:
+  ofApp();
+  ~ofApp();
+
+  void setup();
+
+  // Runs only the test of this name if set
+  string testName;
+
+ private:
+  vector<Test*> tests;
+};